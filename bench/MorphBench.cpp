@@ -0,0 +1,609 @@
+// FacialBench times the hot paths of the morph pipeline and writes the results as JSON so runs from
+// different releases can be compared. Every result has a stable "id", the throughput is in
+// vertices * targets per second (the work a dense blend would do) and the memory used is reported
+// alongside.
+// usage FacialBench [--models models.txt] [--out results.json] [--min-time ms] [--quick]
+#include "ActiveWeights.h"
+#include "BlendRig.h"
+#include "BlendShapeEvaluator.h"
+#include "DeltaCodec.h"
+#include "ModelFile.h"
+#include "ObjTargetReader.h"
+#include "ParseNumber.h"
+#include "RigCache.h"
+#include "RigLoader.h"
+#include "WeightSolver.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+struct Timing
+{
+  size_t iterations = 0;
+  double minMs = 0.0;
+  double medianMs = 0.0;
+  double meanMs = 0.0;
+};
+
+/// @brief run _f once to warm up then until both _minMs and _minIterations have been reached
+template <typename F>
+Timing measure(F &&_f, double _minMs, size_t _minIterations = 3)
+{
+  _f();
+  std::vector<double> times;
+  double total = 0.0;
+  while (times.size() < _minIterations || (total < _minMs && times.size() < 100000))
+  {
+    auto start = std::chrono::steady_clock::now();
+    _f();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    times.push_back(ms);
+    total += ms;
+  }
+  Timing t;
+  t.iterations = times.size();
+  t.meanMs = total / times.size();
+  std::sort(times.begin(), times.end());
+  t.minMs = times.front();
+  t.medianMs = times[times.size() / 2];
+  return t;
+}
+
+/// @brief the peak resident set of the process so far, 0 where we can't find out
+uint64_t peakRssBytes()
+{
+#if defined(_WIN32)
+  return 0;
+#else
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#if defined(__APPLE__)
+  return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief collects results as a JSON array of flat objects, one per measurement
+//----------------------------------------------------------------------------------------------------------------------
+class Results
+{
+  public:
+    void begin(const std::string &_group, const std::string &_id)
+    {
+      m_out << (m_count++ == 0 ? "\n    {" : ",\n    {");
+      m_first = true;
+      add("group", _group);
+      add("id", _group + "/" + _id);
+    }
+    void add(const char *_key, const std::string &_value)
+    {
+      key(_key);
+      m_out << '"';
+      for (char c : _value)
+      {
+        if (c == '"' || c == '\\')
+          m_out << '\\';
+        m_out << c;
+      }
+      m_out << '"';
+    }
+    void add(const char *_key, const char *_value) { add(_key, std::string(_value)); }
+    void add(const char *_key, double _value)
+    {
+      key(_key);
+      // JSON has no inf or nan
+      if (std::isfinite(_value))
+        m_out << _value;
+      else
+        m_out << "null";
+    }
+    void add(const char *_key, uint64_t _value)
+    {
+      key(_key);
+      m_out << _value;
+    }
+    void add(const Timing &_t)
+    {
+      add("iterations", static_cast<uint64_t>(_t.iterations));
+      add("ms_min", _t.minMs);
+      add("ms_median", _t.medianMs);
+      add("ms_mean", _t.meanMs);
+    }
+    void end() { m_out << '}'; }
+    std::string str() const { return m_out.str(); }
+
+  private:
+    void key(const char *_key)
+    {
+      m_out << (m_first ? "" : ", ") << '"' << _key << "\": ";
+      m_first = false;
+    }
+    std::ostringstream m_out;
+    size_t m_count = 0;
+    bool m_first = true;
+};
+
+/// @brief vertices * targets per second for a time in ms
+double throughput(size_t _numVerts, size_t _numTargets, double _ms)
+{
+  return _ms > 0.0 ? static_cast<double>(_numVerts) * _numTargets / (_ms * 0.001) : 0.0;
+}
+
+std::string fixed(double _v, int _precision)
+{
+  std::ostringstream s;
+  s.setf(std::ios::fixed);
+  s.precision(_precision);
+  s << _v;
+  return s.str();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief a grid of _numVerts vertices with _numTargets targets, each moving a round patch of about
+/// _density of the vertices (a face target moves a region, not scattered vertices)
+//----------------------------------------------------------------------------------------------------------------------
+void buildSyntheticRig(BlendRig &_rig, size_t _numVerts, size_t _numTargets, float _density, uint32_t _seed)
+{
+  size_t side = std::max<size_t>(2, static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(_numVerts)))));
+  size_t n = side * side;
+  std::vector<float> positions(n * 3);
+  std::vector<float> normals(n * 3);
+  for (size_t j = 0; j < side; ++j)
+  {
+    for (size_t i = 0; i < side; ++i)
+    {
+      size_t v = j * side + i;
+      positions[v * 3] = static_cast<float>(i) / side;
+      positions[v * 3 + 1] = static_cast<float>(j) / side;
+      positions[v * 3 + 2] = 0.1f * std::sin(i * 0.05f) * std::cos(j * 0.05f);
+      normals[v * 3] = 0.0f;
+      normals[v * 3 + 1] = 0.0f;
+      normals[v * 3 + 2] = 1.0f;
+    }
+  }
+  std::vector<BlendRig::Corner> corners;
+  corners.reserve((side - 1) * (side - 1) * 6);
+  for (size_t j = 0; j + 1 < side; ++j)
+  {
+    for (size_t i = 0; i + 1 < side; ++i)
+    {
+      uint32_t a = static_cast<uint32_t>(j * side + i);
+      uint32_t b = a + 1;
+      uint32_t c = a + static_cast<uint32_t>(side);
+      uint32_t d = c + 1;
+      for (uint32_t v : {a, b, d, a, d, c})
+        corners.push_back({v, v});
+    }
+  }
+  _rig.buildBase(positions.data(), n, normals.data(), n, corners);
+
+  std::mt19937 rng(_seed);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  float radius = std::sqrt(_density / 3.14159265f);
+  std::vector<float> targetPositions = positions;
+  std::vector<float> targetNormals = normals;
+  for (size_t t = 0; t < _numTargets; ++t)
+  {
+    float cx = unit(rng);
+    float cy = unit(rng);
+    float dx = unit(rng) - 0.5f;
+    float dy = unit(rng) - 0.5f;
+    float dz = unit(rng) - 0.5f;
+    std::vector<size_t> moved;
+    for (size_t v = 0; v < n; ++v)
+    {
+      float x = positions[v * 3] - cx;
+      float y = positions[v * 3 + 1] - cy;
+      float d = std::sqrt(x * x + y * y) / radius;
+      if (d >= 1.0f)
+        continue;
+      float falloff = 1.0f - d * d;
+      targetPositions[v * 3] += dx * falloff * 0.1f;
+      targetPositions[v * 3 + 1] += dy * falloff * 0.1f;
+      targetPositions[v * 3 + 2] += dz * falloff * 0.1f;
+      targetNormals[v * 3] += x * falloff;
+      targetNormals[v * 3 + 1] += y * falloff;
+      moved.push_back(v);
+    }
+    _rig.addTarget("target" + std::to_string(t), targetPositions.data(), n, targetNormals.data(), n);
+    for (auto v : moved)
+    {
+      std::memcpy(&targetPositions[v * 3], &positions[v * 3], 3 * sizeof(float));
+      std::memcpy(&targetNormals[v * 3], &normals[v * 3], 3 * sizeof(float));
+    }
+  }
+}
+
+/// @brief a weight vector with _numActive random targets non zero
+std::vector<float> randomWeights(size_t _numTargets, size_t _numActive, uint32_t _seed)
+{
+  std::vector<float> weights(_numTargets, 0.0f);
+  std::vector<size_t> order(_numTargets);
+  for (size_t i = 0; i < _numTargets; ++i)
+    order[i] = i;
+  std::mt19937 rng(_seed);
+  std::shuffle(order.begin(), order.end(), rng);
+  std::uniform_real_distribution<float> weight(0.05f, 1.0f);
+  for (size_t i = 0; i < std::min(_numActive, _numTargets); ++i)
+    weights[order[i]] = weight(rng);
+  return weights;
+}
+
+/// @brief the bytes a rig holds on the CPU and what each delta format puts on the GPU
+void reportMemory(Results &_results, const std::string &_id, const BlendRig &_rig)
+{
+  auto &targets = _rig.targets();
+  _results.begin("memory", _id);
+  _results.add("verts", static_cast<uint64_t>(_rig.numVerts()));
+  _results.add("targets", static_cast<uint64_t>(_rig.numTargets()));
+  _results.add("entries", static_cast<uint64_t>(targets.numEntries()));
+  _results.add("base_bytes", static_cast<uint64_t>(_rig.vertexData().size() * sizeof(float) +
+                                                    _rig.indices().size() * sizeof(uint32_t)));
+  _results.add("sparse_bytes", static_cast<uint64_t>(targets.sparseBytes()));
+  _results.add("dense_bytes", static_cast<uint64_t>(targets.denseBytes()));
+  _results.add("gpu_float_bytes", static_cast<uint64_t>(targets.numEntries() * 8 * sizeof(float) +
+                                                         (_rig.numVerts() + 1) * sizeof(int32_t)));
+  _results.end();
+}
+
+/// @brief buildVertexMajor then each delta format, the work createMorphMesh does before the upload
+void benchPacking(Results &_results, const std::string &_id, const BlendRig &_rig, double _minMs)
+{
+  std::vector<int32_t> offsets;
+  std::vector<float> entries;
+  auto t = measure([&]() { _rig.targets().buildVertexMajor(offsets, entries); }, _minMs);
+  _results.begin("pack", _id + "/vertex_major");
+  _results.add("verts", static_cast<uint64_t>(_rig.numVerts()));
+  _results.add("targets", static_cast<uint64_t>(_rig.numTargets()));
+  _results.add("entries", static_cast<uint64_t>(entries.size() / 8));
+  _results.add(t);
+  _results.add("vert_targets_per_sec", throughput(_rig.numVerts(), _rig.numTargets(), t.medianMs));
+  _results.add("bytes", static_cast<uint64_t>(entries.size() * sizeof(float)));
+  _results.end();
+  for (auto format : {DeltaCodec::Format::Half, DeltaCodec::Format::SNorm16})
+  {
+    if (_rig.numTargets() > DeltaCodec::maxTargets(format))
+      continue;
+    DeltaCodec::Packed packed;
+    t = measure(
+        [&]() {
+          packed = DeltaCodec::encode(format, entries.data(), offsets.data(), _rig.numVerts(), _rig.normals(),
+                                      _rig.numTargets());
+        },
+        _minMs);
+    _results.begin("pack", _id + "/" + DeltaCodec::formatName(format));
+    _results.add("verts", static_cast<uint64_t>(_rig.numVerts()));
+    _results.add("targets", static_cast<uint64_t>(_rig.numTargets()));
+    _results.add("entries", static_cast<uint64_t>(entries.size() / 8));
+    _results.add(t);
+    _results.add("vert_targets_per_sec", throughput(_rig.numVerts(), _rig.numTargets(), t.medianMs));
+    _results.add("bytes", static_cast<uint64_t>(packed.bytes()));
+    _results.end();
+  }
+}
+
+/// @brief the CPU blend with 1, 10% and all of the targets active on every kernel the cpu has, with
+/// blended normals and again with the normals rebuilt from the faces
+void benchEvaluate(Results &_results, const std::string &_id, const BlendRig &_rig, double _minMs)
+{
+  BlendShapeEvaluator evaluator;
+  evaluator.setRig(_rig);
+  size_t numTargets = _rig.numTargets();
+  std::vector<size_t> activeCounts = {1, std::max<size_t>(1, numTargets / 10), numTargets};
+  activeCounts.erase(std::unique(activeCounts.begin(), activeCounts.end()), activeCounts.end());
+  for (auto mode : {NormalRebuilder::Mode::Blend, NormalRebuilder::Mode::Topology})
+  {
+    if (!evaluator.setNormalMode(mode))
+      continue;
+    // blend keeps the original ids so results stay comparable with older runs
+    std::string suffix = mode == NormalRebuilder::Mode::Blend ? "" : std::string("/") + NormalRebuilder::modeName(mode);
+    for (auto kernel : {BlendShapeEvaluator::Kernel::Scalar, BlendShapeEvaluator::Kernel::SSE,
+                        BlendShapeEvaluator::Kernel::AVX2})
+    {
+      if (!evaluator.setKernel(kernel))
+        continue;
+      for (auto active : activeCounts)
+      {
+        auto weights = randomWeights(numTargets, active, static_cast<uint32_t>(active));
+        // the number of (vertex, target) entries the sparse loop really touches
+        uint64_t touched = 0;
+        for (size_t t = 0; t < numTargets; ++t)
+        {
+          if (weights[t] != 0.0f)
+            touched += _rig.targets().target(t).size();
+        }
+        auto t = measure([&]() { evaluator.evaluate(weights.data()); }, _minMs);
+        _results.begin("evaluate", _id + "/a" + std::to_string(active) + "/" +
+                                       BlendShapeEvaluator::kernelName(kernel) + suffix);
+        _results.add("kernel", BlendShapeEvaluator::kernelName(kernel));
+        _results.add("normals", NormalRebuilder::modeName(mode));
+        _results.add("verts", static_cast<uint64_t>(_rig.numVerts()));
+        _results.add("targets", static_cast<uint64_t>(numTargets));
+        _results.add("active", static_cast<uint64_t>(active));
+        _results.add("entries_touched", touched);
+        if (mode == NormalRebuilder::Mode::Topology)
+          _results.add("normals_rebuilt", static_cast<uint64_t>(evaluator.numNormalsRebuilt()));
+        _results.add(t);
+        _results.add("vert_targets_per_sec", throughput(_rig.numVerts(), active, t.medianMs));
+        _results.add("entries_per_sec", t.medianMs > 0.0 ? touched / (t.medianMs * 0.001) : 0.0);
+        _results.end();
+      }
+    }
+  }
+}
+
+/// @brief fitting the weights to a blended pose, from every position and from 100 markers, starting
+/// from zero as the first frame of a sequence would
+void benchSolve(Results &_results, const std::string &_id, const BlendRig &_rig, double _minMs)
+{
+  size_t numTargets = _rig.numTargets();
+  auto weights = randomWeights(numTargets, std::max<size_t>(1, numTargets / 10), 7);
+  BlendShapeEvaluator evaluator;
+  evaluator.setRig(_rig);
+  evaluator.evaluate(weights.data());
+  // the solver takes obj positions
+  std::vector<float> blended(_rig.numVerts() * 3);
+  evaluator.positions().toInterleaved(blended.data());
+  std::vector<float> positions(_rig.numSourcePositions() * 3);
+  for (size_t v = 0; v < _rig.numVerts(); ++v)
+    std::copy_n(&blended[v * 3], 3, &positions[_rig.positionIndex()[v] * 3]);
+  std::vector<uint32_t> markers;
+  for (size_t m = 0; m < 100; ++m)
+    markers.push_back(static_cast<uint32_t>(m * _rig.numSourcePositions() / 100));
+  std::vector<float> markerPositions;
+  for (auto m : markers)
+    markerPositions.insert(markerPositions.end(), &positions[m * 3], &positions[m * 3 + 3]);
+  WeightSolver solver;
+  auto setup = measure([&]() { solver.setRig(_rig); }, _minMs);
+  for (bool useMarkers : {false, true})
+  {
+    if (useMarkers)
+      solver.setMarkers(markers);
+    const float *input = useMarkers ? markerPositions.data() : positions.data();
+    std::vector<float> solved(numTargets);
+    WeightSolver::Result result;
+    auto t = measure(
+        [&]() {
+          std::fill(solved.begin(), solved.end(), 0.0f);
+          result = solver.solve(input, solved.data());
+        },
+        _minMs);
+    float weightError = 0.0f;
+    for (size_t i = 0; i < numTargets; ++i)
+      weightError = std::max(weightError, std::abs(solved[i] - weights[i]));
+    _results.begin("solve", _id + (useMarkers ? "/markers100" : "/all"));
+    _results.add("verts", static_cast<uint64_t>(_rig.numVerts()));
+    _results.add("targets", static_cast<uint64_t>(numTargets));
+    _results.add("inputs", static_cast<uint64_t>(solver.numInputs()));
+    _results.add("setup_ms", setup.medianMs);
+    _results.add(t);
+    _results.add("solver_iterations", static_cast<uint64_t>(result.iterations));
+    _results.add("rms_error", static_cast<double>(result.rmsError));
+    // targets none of the markers move can't be recovered, so the weights are only checked against all
+    if (!useMarkers)
+      _results.add("max_weight_error", static_cast<double>(weightError));
+    _results.end();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief the CPU side of a weight upload: gather the active list and copy the weights and the list
+/// into the next segment of a ring, which is all WeightBuffer does on the persistently mapped path.
+/// The GL calls themselves need a context so they are left to the profiler overlay.
+//----------------------------------------------------------------------------------------------------------------------
+void benchUpload(Results &_results, size_t _numTargets, size_t _instances, double _minMs)
+{
+  constexpr size_t c_numSegments = 3;
+  size_t count = _numTargets * _instances;
+  auto weights = randomWeights(count, std::max<size_t>(1, count / 10), 7);
+  std::vector<float> ring(c_numSegments * count * 3);
+  size_t segment = 0;
+  ActiveWeights active;
+  auto t = measure(
+      [&]() {
+        float *dst = ring.data() + segment * count * 3;
+        active.update(weights.data(), _numTargets);
+        std::memcpy(dst, weights.data(), count * sizeof(float));
+        std::memcpy(dst + count, active.packed().data(), active.packed().size() * sizeof(float));
+        segment = (segment + 1) % c_numSegments;
+      },
+      _minMs);
+  _results.begin("upload", "t" + std::to_string(_numTargets) + "/i" + std::to_string(_instances));
+  _results.add("targets", static_cast<uint64_t>(_numTargets));
+  _results.add("instances", static_cast<uint64_t>(_instances));
+  _results.add("bytes", static_cast<uint64_t>(count * sizeof(float)));
+  _results.add(t);
+  _results.add("bytes_per_sec", t.medianMs > 0.0 ? count * sizeof(float) / (t.medianMs * 0.001) : 0.0);
+  _results.end();
+}
+
+/// @brief the rig from models.txt, parsed from the obj files (parseModelFile's slow path) and from the cache
+bool benchModels(Results &_results, const std::string &_modelName, double _minMs)
+{
+  ModelFile models;
+  if (!models.load(_modelName))
+  {
+    std::cerr << models.errorString() << ", skipping the obj benchmarks\n";
+    return false;
+  }
+  BlendRig rig(models.deltaEpsilon());
+  RigLoader loader;
+  std::string error;
+  // parsing takes a while so a handful of runs is plenty
+  auto t = measure(
+      [&]() {
+        BlendRig parsed(models.deltaEpsilon());
+        if (!loader.load(models, parsed))
+          error = loader.errorString();
+        else
+          rig = std::move(parsed);
+      },
+      0.0, 3);
+  if (!error.empty())
+  {
+    std::cerr << error << '\n';
+    return false;
+  }
+  _results.begin("load", "obj");
+  _results.add("models", _modelName);
+  _results.add("verts", static_cast<uint64_t>(rig.numVerts()));
+  _results.add("targets", static_cast<uint64_t>(rig.numTargets()));
+  _results.add("files", static_cast<uint64_t>(loader.timings().size()));
+  _results.add(t);
+  _results.add("vert_targets_per_sec", throughput(rig.numVerts(), rig.numTargets(), t.medianMs));
+  _results.end();
+
+  // the targets alone on one thread, compare bytes_per_sec with the disk to see what bounds it
+  ObjTargetReader reader;
+  size_t targetBytes = 0;
+  t = measure(
+      [&]() {
+        targetBytes = 0;
+        for (auto &entry : models.blendShapes())
+        {
+          reader.read(entry.path, rig.numSourcePositions(), rig.numSourceNormals());
+          targetBytes += reader.fileBytes();
+        }
+      },
+      _minMs);
+  _results.begin("load", "obj_targets");
+  _results.add("files", static_cast<uint64_t>(models.blendShapes().size()));
+  _results.add("bytes", static_cast<uint64_t>(targetBytes));
+  _results.add(t);
+  _results.add("bytes_per_sec", t.medianMs > 0.0 ? targetBytes / (t.medianMs * 0.001) : 0.0);
+  _results.end();
+
+  // the fast path, written to a temporary so the real cache is left alone
+  std::string cacheName = models.cacheFileName() + ".bench";
+  if (RigCache::write(cacheName, rig, models.sourceHash()))
+  {
+    t = measure(
+        [&]() {
+          RigCache cache;
+          BlendRig cached;
+          if (cache.open(cacheName))
+            cache.toRig(cached);
+        },
+        _minMs);
+    _results.begin("load", "cache");
+    _results.add("verts", static_cast<uint64_t>(rig.numVerts()));
+    _results.add("targets", static_cast<uint64_t>(rig.numTargets()));
+    _results.add(t);
+    _results.add("vert_targets_per_sec", throughput(rig.numVerts(), rig.numTargets(), t.medianMs));
+    _results.end();
+    std::remove(cacheName.c_str());
+  }
+  reportMemory(_results, "models", rig);
+  benchPacking(_results, "models", rig, _minMs);
+  benchEvaluate(_results, "models", rig, _minMs);
+  return true;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  std::string modelName = "models.txt";
+  std::string outName;
+  double minMs = 200.0;
+  bool quick = false;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "--models" && i + 1 < argc)
+      modelName = argv[++i];
+    else if (arg == "--out" && i + 1 < argc)
+      outName = argv[++i];
+    else if (arg == "--min-time" && i + 1 < argc && parseNumber(argv[i + 1], minMs))
+      ++i;
+    else if (arg == "--quick")
+      quick = true;
+    else
+    {
+      std::cerr << "usage FacialBench [--models models.txt] [--out results.json] [--min-time ms] [--quick]\n";
+      return EXIT_FAILURE;
+    }
+  }
+  if (quick)
+    minMs = std::min(minMs, 20.0);
+
+  Results results;
+  std::cerr << "models " << modelName << '\n';
+  benchModels(results, modelName, minMs);
+
+  // synthetic rigs up to production size, --quick keeps to the small ones
+  std::vector<size_t> vertCounts = quick ? std::vector<size_t>{2500, 10000} : std::vector<size_t>{10000, 100000};
+  std::vector<size_t> targetCounts = quick ? std::vector<size_t>{16, 50} : std::vector<size_t>{50, 500};
+  for (auto verts : vertCounts)
+  {
+    for (auto targets : targetCounts)
+    {
+      for (float density : {0.02f, 0.1f})
+      {
+        std::string id = "v" + std::to_string(verts) + "/t" + std::to_string(targets) + "/d" + fixed(density, 2);
+        std::cerr << "synthetic " << id << '\n';
+        BlendRig rig;
+        buildSyntheticRig(rig, verts, targets, density, static_cast<uint32_t>(verts + targets));
+        reportMemory(results, id, rig);
+        benchPacking(results, id, rig, minMs);
+        benchEvaluate(results, id, rig, minMs);
+        benchSolve(results, id, rig, minMs);
+      }
+    }
+  }
+  for (auto targets : targetCounts)
+  {
+    for (size_t instances : {size_t(1), size_t(64), size_t(4096)})
+      benchUpload(results, targets, instances, minMs);
+  }
+
+  std::ostringstream json;
+  json << "{\n  \"benchmark\": \"FacialBench\",\n  \"format\": 1,\n  \"time\": " << std::time(nullptr)
+       << ",\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n  \"kernels\": [";
+  const char *separator = "";
+  for (auto kernel : {BlendShapeEvaluator::Kernel::Scalar, BlendShapeEvaluator::Kernel::SSE,
+                      BlendShapeEvaluator::Kernel::AVX2})
+  {
+    if (BlendShapeEvaluator::kernelSupported(kernel))
+    {
+      json << separator << '"' << BlendShapeEvaluator::kernelName(kernel) << '"';
+      separator = ", ";
+    }
+  }
+  json << "],\n  \"quick\": " << (quick ? "true" : "false") << ",\n  \"min_time_ms\": " << minMs
+       << ",\n  \"peak_rss_bytes\": " << peakRssBytes() << ",\n  \"results\": [" << results.str() << "\n  ]\n}\n";
+  if (outName.empty())
+  {
+    std::cout << json.str();
+  }
+  else
+  {
+    std::ofstream out(outName);
+    out << json.str();
+    if (!out)
+    {
+      std::cerr << "unable to write " << outName << '\n';
+      return EXIT_FAILURE;
+    }
+    std::cerr << "results written to " << outName << '\n';
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,48 @@
+#ifndef ACTIVEWEIGHTS_H_
+#define ACTIVEWEIGHTS_H_
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ActiveWeights.h
+/// @brief the targets that have a non zero weight this frame
+/// @class ActiveWeights
+/// @brief most of the time only a few of the weights are non zero (resetWeights zeros them all), this
+/// keeps a compact list of (target index, weight) so the blend only loops over the targets that add
+/// anything. The list is in target order, which is the order the rows of deltas are sorted in.
+//----------------------------------------------------------------------------------------------------------------------
+class ActiveWeights
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief rebuild the list from the full weight vector
+    /// @param [in] _weights one weight per target
+    /// @param [in] _count the number of targets
+    //----------------------------------------------------------------------------------------------------------------------
+    void update(const float *_weights, size_t _count);
+    void update(const std::vector<float> &_weights) { update(_weights.data(), _weights.size()); }
+    size_t size() const { return m_indices.size(); }
+    bool empty() const { return m_indices.empty(); }
+    /// @brief the total number of targets the last update was given
+    size_t numTargets() const { return m_numTargets; }
+    const std::vector<uint32_t> &indices() const { return m_indices; }
+    const std::vector<float> &weights() const { return m_weights; }
+    /// @brief (index, weight) pairs with the index as a float (as the target index in the delta entries)
+    /// which is how the shader reads them
+    const std::vector<float> &packed() const { return m_packed; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief is looping over the active targets cheaper than looping over a vertex's whole row of deltas
+    /// each active target costs a binary search of the row so this is only true when very few are active
+    /// @param [in] _avgRowLength the mean number of delta entries per vertex
+    /// @param [in] _maxRowLength the longest row
+    //----------------------------------------------------------------------------------------------------------------------
+    bool cheaperThanRows(double _avgRowLength, size_t _maxRowLength) const;
+
+  private:
+    size_t m_numTargets = 0;
+    std::vector<uint32_t> m_indices;
+    std::vector<float> m_weights;
+    std::vector<float> m_packed;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef ANIMATIONCLIP_H_
+#define ANIMATIONCLIP_H_
+#include <cstdint>
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AnimationClip.h
+/// @brief keyframed weight curves for the blend targets
+/// @class AnimationClip
+/// @brief one curve per animated target, matched to the rig by target name. Each key says how the
+/// segment that starts at it is interpolated :
+/// Linear  straight line to the next key
+/// Hermite cubic using the out slope of this key and the in slope of the next (in weight units per second)
+/// Bezier  as Hermite but the handles also have a length, as a fraction of the segment (1/3 is Hermite)
+/// Clips are stored in a small binary file (see save) or can be written by hand as text (see loadText)
+//----------------------------------------------------------------------------------------------------------------------
+class AnimationClip
+{
+  public:
+    /// @brief bump this whenever the binary layout changes
+    static constexpr uint32_t c_version = 1;
+    enum class Interpolation : uint32_t
+    {
+      Linear,
+      Hermite,
+      Bezier
+    };
+    struct Key
+    {
+      float time = 0.0f;
+      float value = 0.0f;
+      float inSlope = 0.0f;
+      float outSlope = 0.0f;
+      float inWeight = 1.0f / 3.0f;
+      float outWeight = 1.0f / 3.0f;
+      Interpolation interpolation = Interpolation::Linear;
+    };
+    struct Curve
+    {
+      std::string target;
+      /// @brief sorted by time
+      std::vector<Key> keys;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add a curve, the keys are sorted by time
+    //----------------------------------------------------------------------------------------------------------------------
+    void addCurve(Curve &&_curve);
+    void clear() { m_curves.clear(); }
+    const std::vector<Curve> &curves() const { return m_curves; }
+    size_t numKeys() const;
+    /// @brief time of the last key of any curve
+    float duration() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write the binary clip
+    //----------------------------------------------------------------------------------------------------------------------
+    bool save(const std::string &_fname) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief read a binary clip
+    /// @returns false if the file is missing, not a clip, the wrong version or truncated, see errorString()
+    //----------------------------------------------------------------------------------------------------------------------
+    bool load(const std::string &_fname);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief read the text form, one entry per line with # for comments
+    /// curve,target name
+    /// key,time,value[,linear]
+    /// key,time,value,hermite,inSlope,outSlope
+    /// key,time,value,bezier,inSlope,outSlope,inWeight,outWeight
+    /// keys belong to the last curve line
+    /// @returns false if the file can't be opened or a line can't be parsed, errorString() names the line
+    //----------------------------------------------------------------------------------------------------------------------
+    bool loadText(const std::string &_fname);
+    /// @brief load or loadText depending on whether the file ends in .txt
+    bool loadAny(const std::string &_fname);
+    /// @brief why the last load failed
+    const std::string &errorString() const { return m_error; }
+
+  private:
+    std::vector<Curve> m_curves;
+    std::string m_error;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef ASYNCWRITER_H_
+#define ASYNCWRITER_H_
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AsyncWriter.h
+/// @brief writes buffers to disk on its own thread so producers don't wait on I/O
+/// @class AsyncWriter
+/// @brief producers take a buffer with acquire, fill it and hand it back with writeFile (a whole file) or
+/// writeAt (at an offset in the file given to open). There are a fixed number of buffers, once they are
+/// all queued acquire blocks, so a disk slower than the producers limits memory rather than growing a
+/// queue. Buffers are reused so their capacity is only allocated once.
+//----------------------------------------------------------------------------------------------------------------------
+class AsyncWriter
+{
+  public:
+    using Buffer = std::vector<unsigned char>;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _numBuffers how many buffers can be filled or queued at once
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit AsyncWriter(size_t _numBuffers = 8);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief dtor writes anything still queued
+    //----------------------------------------------------------------------------------------------------------------------
+    ~AsyncWriter();
+    AsyncWriter(const AsyncWriter &) = delete;
+    AsyncWriter &operator=(const AsyncWriter &) = delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief open (truncating) the file used by writeAt
+    //----------------------------------------------------------------------------------------------------------------------
+    bool open(const std::string &_fname);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief an empty buffer to fill, blocks until one is free
+    //----------------------------------------------------------------------------------------------------------------------
+    Buffer *acquire();
+    /// @brief queue _buffer to be written as the whole of _fname
+    void writeFile(const std::string &_fname, Buffer *_buffer);
+    /// @brief queue _buffer to be written at _offset in the open file
+    void writeAt(uint64_t _offset, Buffer *_buffer);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief wait for the queue to empty and close the open file
+    /// @returns false if any write failed
+    //----------------------------------------------------------------------------------------------------------------------
+    bool finish();
+    /// @brief time the writer thread spent writing
+    double writeMs() const { return m_writeMs; }
+    uint64_t bytesWritten() const { return m_bytes; }
+
+  private:
+    struct Job
+    {
+      std::string fname;
+      uint64_t offset;
+      Buffer *buffer;
+    };
+    void writer();
+    void queue(Job &&_job);
+    std::vector<Buffer> m_buffers;
+    std::vector<Buffer *> m_free;
+    std::deque<Job> m_jobs;
+    std::FILE *m_file = nullptr;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_bufferFree;
+    std::thread m_thread;
+    /// @brief how many jobs the writer has taken but not finished
+    size_t m_writing = 0;
+    bool m_stop = false;
+    bool m_failed = false;
+    double m_writeMs = 0.0;
+    uint64_t m_bytes = 0;
+};
+
+#endif
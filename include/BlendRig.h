@@ -0,0 +1,92 @@
+#ifndef BLENDRIG_H_
+#define BLENDRIG_H_
+#include "BlendTargetSet.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BlendRig.h
+/// @brief the base mesh, topology and sparse targets of a face rig in the form the GPU and the
+/// CPU evaluator want it
+/// @class BlendRig
+/// @brief obj files index positions and normals separately so each face corner is a (position, normal)
+/// pair. The rig builds one vertex per unique pair and an index list for the triangles, so shared
+/// vertices are only stored (and blended) once and the post transform vertex cache can do its job.
+/// The target deltas are stored per unique vertex as well.
+//----------------------------------------------------------------------------------------------------------------------
+class BlendRig
+{
+  public:
+    /// @brief one corner of a triangle as indices into the obj position and normal lists
+    struct Corner
+    {
+      uint32_t vert;
+      uint32_t norm;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _epsilon deltas at or below this are dropped from the targets
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit BlendRig(float _epsilon = 1e-5f) : m_targets(_epsilon) {}
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief build the indexed base mesh, this removes any targets
+    /// @param [in] _positions obj positions as interleaved xyz
+    /// @param [in] _numPositions number of positions
+    /// @param [in] _normals obj normals as interleaved xyz
+    /// @param [in] _numNormals number of normals
+    /// @param [in] _corners three per triangle
+    /// @returns false if a corner references a position or normal that doesn't exist
+    //----------------------------------------------------------------------------------------------------------------------
+    bool buildBase(const float *_positions, size_t _numPositions, const float *_normals, size_t _numNormals,
+                   const std::vector<Corner> &_corners);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add a target from the full obj position / normal lists of the target mesh, the deltas
+    /// against the base are worked out here
+    /// @returns false if the list sizes don't match the base mesh
+    //----------------------------------------------------------------------------------------------------------------------
+    bool addTarget(const std::string &_name, const float *_positions, size_t _numPositions, const float *_normals,
+                   size_t _numNormals);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add a target whose deltas are already worked out, such as one kept from another rig with the same base
+    //----------------------------------------------------------------------------------------------------------------------
+    void addTarget(const std::string &_name, BlendTargetSet::Target &&_target);
+    /// @brief drop the targets and keep the base mesh
+    void removeTargets();
+
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set everything in one go, used when the rig comes from a baked cache rather than obj files
+    //----------------------------------------------------------------------------------------------------------------------
+    void assign(std::vector<float> &&_vertexData, std::vector<uint32_t> &&_indices, std::vector<uint32_t> &&_positionIndex,
+                std::vector<uint32_t> &&_normalIndex, size_t _numSourcePositions, size_t _numSourceNormals,
+                std::vector<std::string> &&_targetNames, BlendTargetSet &&_targets);
+
+    size_t numVerts() const { return m_positionIndex.size(); }
+    size_t numIndices() const { return m_indices.size(); }
+    size_t numTargets() const { return m_targets.numTargets(); }
+    /// @brief the vertex data is all the positions (xyz) followed by all the normals (xyz), so it can be
+    /// sent to the GPU as one buffer
+    const std::vector<float> &vertexData() const { return m_vertexData; }
+    const float *positions() const { return m_vertexData.data(); }
+    const float *normals() const { return m_vertexData.data() + numVerts() * 3; }
+    const std::vector<uint32_t> &indices() const { return m_indices; }
+    /// @brief the obj position / normal each unique vertex came from
+    const std::vector<uint32_t> &positionIndex() const { return m_positionIndex; }
+    const std::vector<uint32_t> &normalIndex() const { return m_normalIndex; }
+    size_t numSourcePositions() const { return m_numSourcePositions; }
+    size_t numSourceNormals() const { return m_numSourceNormals; }
+    const std::vector<std::string> &targetNames() const { return m_targetNames; }
+    const BlendTargetSet &targets() const { return m_targets; }
+    void setDeltaEpsilon(float _e) { m_targets.setEpsilon(_e); }
+
+  private:
+    std::vector<float> m_vertexData;
+    std::vector<uint32_t> m_indices;
+    std::vector<uint32_t> m_positionIndex;
+    std::vector<uint32_t> m_normalIndex;
+    size_t m_numSourcePositions = 0;
+    size_t m_numSourceNormals = 0;
+    std::vector<std::string> m_targetNames;
+    BlendTargetSet m_targets;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef BLENDSHAPEEVALUATOR_H_
+#define BLENDSHAPEEVALUATOR_H_
+#include "ActiveWeights.h"
+#include "BlendRig.h"
+#include "BlendTargetSet.h"
+#include "NormalRebuilder.h"
+#include "SoAVec3.h"
+#include <cstddef>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BlendShapeEvaluator.h
+/// @brief headless CPU version of the blend loop in shaders/PerFragASDVert.glsl, it has no Qt or OpenGL
+/// dependency so it can be used on machines without a GPU
+/// @class BlendShapeEvaluator
+/// @brief takes a base mesh plus N target deltas and a weight vector and produces the deformed positions
+/// and normals. Data is held as structure of arrays (x,y,z streams) so the inner loops can run
+/// 4 (SSE) or 8 (AVX2) vertices at a time, a scalar version is always available as a fallback.
+/// Targets are held sparse (see BlendTargetSet) so only the vertices that move are touched.
+/// With the Topology normal mode (and a topology from setRig or setTopology) the normal deltas are ignored
+/// and the normals around the moved vertices are rebuilt from the faces instead, see NormalRebuilder.
+//----------------------------------------------------------------------------------------------------------------------
+
+class BlendShapeEvaluator
+{
+  public:
+    /// @brief which implementation of the inner loops to use
+    enum class Kernel
+    {
+      Auto,
+      Scalar,
+      SSE,
+      AVX2
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set the base (neutral) mesh, this clears any targets already added
+    /// @param [in] _positions interleaved xyz positions
+    /// @param [in] _normals interleaved xyz normals
+    /// @param [in] _numVerts the number of vertices in both arrays
+    //----------------------------------------------------------------------------------------------------------------------
+    void setBaseMesh(const float *_positions, const float *_normals, size_t _numVerts);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add a blend target, the deltas are target - base (as packed in createMorphMesh)
+    /// @param [in] _positionDeltas interleaved xyz position deltas, numVerts() entries
+    /// @param [in] _normalDeltas interleaved xyz normal deltas, numVerts() entries
+    /// @returns the index of the target (which is the index into the weight vector)
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t addTarget(const float *_positionDeltas, const float *_normalDeltas);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief replace all the targets with an already built set, it must have numVerts() vertices
+    /// @returns false if the vertex counts don't match
+    //----------------------------------------------------------------------------------------------------------------------
+    bool setTargets(const BlendTargetSet &_targets);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief use the base mesh and targets of a rig (vertices are the unique vertices of the rig)
+    //----------------------------------------------------------------------------------------------------------------------
+    void setRig(const BlendRig &_rig);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the triangles of the base mesh, only needed for the Topology normal mode
+    /// @param [in] _indices three per triangle
+    /// @param [in] _positionIndex the obj position of each vertex, numVerts() entries
+    //----------------------------------------------------------------------------------------------------------------------
+    void setTopology(const std::vector<uint32_t> &_indices, const std::vector<uint32_t> &_positionIndex);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief choose how the normals are made, the adjacency is built on the next evaluate
+    /// @returns false if Topology is asked for without a topology (Blend is kept)
+    //----------------------------------------------------------------------------------------------------------------------
+    bool setNormalMode(NormalRebuilder::Mode _m);
+    NormalRebuilder::Mode normalMode() const { return m_normalMode; }
+    /// @brief the adjacency used by the Topology mode, built on demand
+    const NormalRebuilder &normalRebuilder();
+    /// @brief how many normals the last Topology evaluate rebuilt
+    size_t numNormalsRebuilt() const { return m_lastTouched.size(); }
+    /// @brief deltas at or below this are dropped by addTarget (existing targets are not changed)
+    void setDeltaEpsilon(float _e) { m_targets.setEpsilon(_e); }
+    const BlendTargetSet &targets() const { return m_targets; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief evaluate the blend, _weights must hold numTargets() values
+    /// the result is the same as the vertex shader, P = base + sum(w*dP) and N = normalize(base + sum(w*dN))
+    //----------------------------------------------------------------------------------------------------------------------
+    void evaluate(const float *_weights);
+    void evaluate(const std::vector<float> &_weights) { evaluate(_weights.data()); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief evaluate with only the non zero weights, the cost scales with the number of active targets
+    /// if nothing is active and the last call wasn't either the results are left as they are
+    //----------------------------------------------------------------------------------------------------------------------
+    void evaluate(const ActiveWeights &_active);
+    /// @brief the active list built by the last evaluate(const float *) call
+    const ActiveWeights &activeWeights() const { return m_active; }
+
+    size_t numVerts() const { return m_numVerts; }
+    size_t numTargets() const { return m_targets.numTargets(); }
+    /// @brief the results of the last evaluate call
+    const SoAVec3 &positions() const { return m_outPositions; }
+    const SoAVec3 &normals() const { return m_outNormals; }
+
+    /// @brief choose the kernel, Auto picks the widest one the cpu supports
+    /// @returns false if the requested kernel isn't available (the current one is kept)
+    bool setKernel(Kernel _k);
+    Kernel kernel() const { return m_kernel; }
+    static bool kernelSupported(Kernel _k);
+    static const char *kernelName(Kernel _k);
+
+  private:
+    size_t m_numVerts = 0;
+    SoAVec3 m_basePositions;
+    SoAVec3 m_baseNormals;
+    BlendTargetSet m_targets;
+    SoAVec3 m_outPositions;
+    SoAVec3 m_outNormals;
+    ActiveWeights m_active;
+    /// @brief true when the outputs hold the (normalized) base mesh
+    bool m_outputIsBase = false;
+    Kernel m_kernel = Kernel::Scalar;
+    bool m_kernelChosen = false;
+    std::vector<uint32_t> m_indices;
+    std::vector<uint32_t> m_positionIndex;
+    NormalRebuilder::Mode m_normalMode = NormalRebuilder::Mode::Blend;
+    NormalRebuilder m_rebuilder;
+    /// @brief set when the mesh or targets change under the rebuilder
+    bool m_rebuilderDirty = true;
+    SoAVec3 m_unitBaseNormals;
+    /// @brief the vertices the last topology evaluate rebuilt, the rest of m_outNormals are m_unitBaseNormals
+    std::vector<uint32_t> m_lastTouched;
+    bool m_normalsFromTopology = false;
+    void evaluateTopology(const ActiveWeights &_active);
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef BLENDTARGETSET_H_
+#define BLENDTARGETSET_H_
+#include "SoAVec3.h"
+#include <cstdint>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BlendTargetSet.h
+/// @brief sparse storage for the blend target deltas
+/// @class BlendTargetSet
+/// @brief each target only keeps the vertices that actually move, a vertex is dropped when every
+/// component of both its position and normal delta is below epsilon. The data is held target major
+/// (a list of vertex index + delta per target) for the CPU, and can be flipped to a vertex major
+/// layout for the vertex shader which can't scatter.
+//----------------------------------------------------------------------------------------------------------------------
+class BlendTargetSet
+{
+  public:
+    /// @brief the non zero part of one target
+    struct Target
+    {
+      /// @brief vertex index of each entry, sorted
+      std::vector<uint32_t> indices;
+      SoAVec3 positions;
+      SoAVec3 normals;
+      size_t size() const { return indices.size(); }
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _epsilon deltas with all components at or below this are treated as zero
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit BlendTargetSet(float _epsilon = 1e-5f) : m_epsilon(_epsilon) {}
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief remove all the targets and set the vertex count for the next lot
+    //----------------------------------------------------------------------------------------------------------------------
+    void reset(size_t _numVerts);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add a target from dense (one per vertex) deltas
+    /// @param [in] _positionDeltas interleaved xyz position deltas, numVerts() entries
+    /// @param [in] _normalDeltas interleaved xyz normal deltas, numVerts() entries
+    /// @returns the index of the target
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t addTarget(const float *_positionDeltas, const float *_normalDeltas);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add an already sparse target
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t addTarget(Target &&_target);
+
+    void setEpsilon(float _e) { m_epsilon = _e; }
+    float epsilon() const { return m_epsilon; }
+    size_t numVerts() const { return m_numVerts; }
+    size_t numTargets() const { return m_targets.size(); }
+    const Target &target(size_t _i) const { return m_targets[_i]; }
+    /// @brief total number of (vertex, target) entries kept
+    size_t numEntries() const;
+    /// @brief bytes used by the sparse data
+    size_t sparseBytes() const;
+    /// @brief bytes the old dense Vec4 layout would use (position and normal row for each target at every vertex)
+    size_t denseBytes() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief build the vertex major version used by the shader
+    /// @param [out] _offsets numVerts()+1 values, the entries for vertex v are [_offsets[v], _offsets[v+1])
+    /// @param [out] _entries two vec4 per entry, (dP.xyz, target index) then (dN.xyz, 0)
+    //----------------------------------------------------------------------------------------------------------------------
+    void buildVertexMajor(std::vector<int32_t> &_offsets, std::vector<float> &_entries) const;
+
+  private:
+    float m_epsilon;
+    size_t m_numVerts = 0;
+    std::vector<Target> m_targets;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef CLIPSAMPLER_H_
+#define CLIPSAMPLER_H_
+#include "AnimationClip.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ClipSampler.h
+/// @brief evaluates the curves of an AnimationClip into a weight vector
+/// @class ClipSampler
+/// @brief bind turns every segment of every curve into a cubic in the segment's normalised time, so
+/// sampling is a polynomial per curve (Bezier segments whose handles don't split time evenly also
+/// solve for the curve parameter first). Each curve remembers the segment it used last time, as
+/// playback moves forward that is the right one or the next, so sample costs O(curves) rather than
+/// a search through the keys. A jump elsewhere falls back to a binary search.
+//----------------------------------------------------------------------------------------------------------------------
+class ClipSampler
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief precompute the segments of a clip for a rig
+    /// @param [in] _targetNames the rig's targets in weight order, curves are matched by name and curves
+    /// for targets the rig doesn't have are skipped
+    /// @returns the number of curves bound
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t bind(const AnimationClip &_clip, const std::vector<std::string> &_targetNames);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write the value of every bound curve at _time into its weight, other weights are untouched
+    /// before the first key a curve holds its first value and after the last key its last
+    //----------------------------------------------------------------------------------------------------------------------
+    void sample(float _time, float *_weights);
+    void sample(float _time, std::vector<float> &_weights) { sample(_time, _weights.data()); }
+    size_t numCurves() const { return m_curves.size(); }
+    float duration() const { return m_duration; }
+
+  private:
+    struct Segment
+    {
+      float invLength;
+      /// @brief value = v[0] + v[1]s + v[2]s^2 + v[3]s^3
+      float v[4];
+      /// @brief time = x[0]s + x[1]s^2 + x[2]s^3 when solveTime is set, otherwise time is s
+      float x[3];
+      bool solveTime;
+    };
+    struct Curve
+    {
+      uint32_t target;
+      uint32_t first;
+      uint32_t count;
+      uint32_t cursor;
+      float firstValue;
+      float lastValue;
+    };
+    float evaluate(const Segment &_seg, float _s) const;
+    std::vector<Curve> m_curves;
+    std::vector<Segment> m_segments;
+    /// @brief start time of each segment, kept apart so the searches only touch this
+    std::vector<float> m_starts;
+    /// @brief end time of each curve's last segment
+    std::vector<float> m_ends;
+    float m_duration = 0.0f;
+};
+
+#endif
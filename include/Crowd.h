@@ -0,0 +1,50 @@
+#ifndef CROWD_H_
+#define CROWD_H_
+#include "ClipSampler.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Crowd.h
+/// @brief the per instance data for drawing many copies of the rig
+/// @class Crowd
+/// @brief lays the heads out in a grid facing the camera, each slightly turned and scaled, and gives each
+/// its own weights every frame. The weights of all the heads are one array, head i's start at
+/// i * numTargets, and the model matrices are column major 4x4s, so both can be uploaded as they are
+/// and indexed by the head.
+//----------------------------------------------------------------------------------------------------------------------
+class Crowd
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief lay out a new crowd, the weights start at zero
+    /// @param [in] _seed the same seed gives the same crowd
+    //----------------------------------------------------------------------------------------------------------------------
+    void resize(size_t _count, size_t _numTargets, uint32_t _seed = 1);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set every head's weights for _time
+    /// @param [in] _clip if it has curves every head plays it looping, each from its own start and at its
+    /// own speed, otherwise the weights are driven by sine waves
+    //----------------------------------------------------------------------------------------------------------------------
+    void update(float _time, ClipSampler *_clip);
+    size_t size() const { return m_heads.size(); }
+    size_t numTargets() const { return m_numTargets; }
+    const std::vector<float> &weights() const { return m_weights; }
+    const std::vector<float> &matrices() const { return m_matrices; }
+    /// @brief half the width of the grid, to frame it with the camera
+    float radius() const { return m_radius; }
+
+  private:
+    struct Head
+    {
+      float phase;
+      float speed;
+    };
+    std::vector<Head> m_heads;
+    std::vector<float> m_weights;
+    std::vector<float> m_matrices;
+    size_t m_numTargets = 0;
+    float m_radius = 0.0f;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef DELTABASIS_H_
+#define DELTABASIS_H_
+#include "BlendTargetSet.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file DeltaBasis.h
+/// @brief a smaller set of basis shapes that mix back into the rig's targets
+/// @class DeltaBasis
+/// @brief targets are strongly correlated (left / right pairs, brow up / down share most of their
+/// motion) so the matrix with a column of deltas (positions and normals) per target is close to a lower
+/// rank. This is a PCA of it: the eigenvectors of the targets' Gram matrix give K basis shapes (each a
+/// mix of the targets) and an N x K mixing matrix such that target i ~ sum_k mixing[i][k] * shape k. A pose is
+/// then sum_k c_k * shape k with c = weights x mixing, worked out on the CPU once a frame, and the
+/// shaders and evaluator just see K targets with coefficients as their weights (which can be negative).
+/// K is the fewest shapes that reproduce every target at full weight to within a tolerance on any
+/// vertex. The shapes are usually denser than the targets, report() says whether the rig gets any
+/// smaller and how many deltas each vertex fetches.
+//----------------------------------------------------------------------------------------------------------------------
+class DeltaBasis
+{
+  public:
+    struct Report
+    {
+      size_t numTargets = 0;
+      size_t numShapes = 0;
+      /// @brief vertex major float deltas (BlendTargetSet::buildVertexMajor) of the targets and of the
+      /// shapes plus the mixing matrix
+      size_t targetBytes = 0;
+      size_t basisBytes = 0;
+      /// @brief mean and longest number of deltas a vertex fetches
+      double targetRow = 0.0;
+      double basisRow = 0.0;
+      size_t targetMaxRow = 0;
+      size_t basisMaxRow = 0;
+      /// @brief the largest distance of any vertex of any target at full weight from the real one
+      float positionError = 0.0f;
+      float normalError = 0.0f;
+      size_t worstTarget = 0;
+      double ms = 0.0;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief factorise the targets
+    /// @param [in] _offsets _entries vertex major deltas (BlendTargetSet::buildVertexMajor)
+    /// @param [in] _epsilon shape deltas at or below this are dropped, as for the targets
+    /// @param [in] _tolerance the largest position error allowed on any vertex of any target
+    /// @param [in] _maxShapes at most this many shapes even if the tolerance isn't met, 0 for no limit
+    //----------------------------------------------------------------------------------------------------------------------
+    void build(const int32_t *_offsets, const float *_entries, size_t _numVerts, size_t _numTargets, float _epsilon,
+               float _tolerance, size_t _maxShapes = 0);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief take a basis that was built offline (see RigCache), only the mixing is kept so project works
+    /// but shapes() is empty, the cache holds them vertex major for the GPU
+    /// @param [in] _mixing _numTargets rows of _numShapes values
+    //----------------------------------------------------------------------------------------------------------------------
+    void assign(size_t _numTargets, size_t _numShapes, const float *_mixing);
+    void clear();
+    bool empty() const { return m_numShapes == 0; }
+    size_t numShapes() const { return m_numShapes; }
+    size_t numTargets() const { return m_numTargets; }
+    /// @brief the shapes as sparse targets, for BlendShapeEvaluator::setTargets or buildVertexMajor
+    const BlendTargetSet &shapes() const { return m_shapes; }
+    /// @brief numTargets() rows of numShapes() values
+    const std::vector<float> &mixing() const { return m_mixing; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the shape coefficients for target weights
+    /// @param [in] _weights _count sets of numTargets() weights one after another (a crowd)
+    /// @param [out] _coefficients _count sets of numShapes() values
+    //----------------------------------------------------------------------------------------------------------------------
+    void project(const float *_weights, float *_coefficients, size_t _count = 1) const;
+    const Report &report() const { return m_report; }
+
+  private:
+    size_t m_numTargets = 0;
+    size_t m_numShapes = 0;
+    BlendTargetSet m_shapes;
+    std::vector<float> m_mixing;
+    Report m_report;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef DELTACODEC_H_
+#define DELTACODEC_H_
+#include "BlendTargetSet.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file DeltaCodec.h
+/// @brief smaller formats for the vertex major delta entries sent to the GPU
+/// @class DeltaCodec
+/// @brief the float layout from BlendTargetSet::buildVertexMajor is 32 bytes per entry. The other formats :
+/// Half    (dP.xyz, target) then (dN.xyz, 0) as RGBA16F, 16 bytes per entry, at most 2048 targets as the
+///         target index has to be exact in a half
+/// SNorm16 (dP.xyz, target) as RGBA16I with dP scaled by the largest component of its target, plus the
+///         normal of the target (base + dN) octahedral encoded as RG16I in a second stream, 12 bytes
+///         per entry. The normal delta is recovered as decode(oct) - base normal.
+/// The CPU has to use the same decoded values as the GPU to match it so quantise applies the round trip
+/// to a target set.
+//----------------------------------------------------------------------------------------------------------------------
+class DeltaCodec
+{
+  public:
+    enum class Format
+    {
+      Float32,
+      Half,
+      SNorm16
+    };
+    /// @brief the encoded entries
+    struct Packed
+    {
+      Format format = Format::Float32;
+      /// @brief Float32 entries as buildVertexMajor
+      std::vector<float> floats;
+      /// @brief Half (8 per entry) or SNorm16 (4 per entry) texels
+      std::vector<uint16_t> entries;
+      /// @brief SNorm16 octahedral normals, 2 per entry
+      std::vector<int16_t> normals;
+      /// @brief SNorm16 position scale for each target
+      std::vector<float> scales;
+      size_t bytes() const;
+    };
+    static const char *formatName(Format _f);
+    /// @returns false if the name isn't float, half or snorm16
+    static bool parseFormat(const std::string &_name, Format &_f);
+    /// @brief the largest target count a format can index
+    static size_t maxTargets(Format _f);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief encode vertex major entries
+    /// @param [in] _entries 8 floats per entry as BlendTargetSet::buildVertexMajor
+    /// @param [in] _offsets numVerts+1 row starts
+    /// @param [in] _baseNormals interleaved xyz normal of each vertex
+    //----------------------------------------------------------------------------------------------------------------------
+    static Packed encode(Format _f, const float *_entries, const int32_t *_offsets, size_t _numVerts,
+                         const float *_baseNormals, size_t _numTargets);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief decode back to 8 floats per entry, this is what the shader sees
+    //----------------------------------------------------------------------------------------------------------------------
+    static void decode(const Packed &_packed, const int32_t *_offsets, size_t _numVerts, const float *_baseNormals,
+                       std::vector<float> &_entries);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief replace the deltas of a target set with what they become after an encode / decode
+    /// @param [in] _baseNormals interleaved xyz normal of each vertex of the set
+    //----------------------------------------------------------------------------------------------------------------------
+    static void quantise(BlendTargetSet &_targets, Format _f, const float *_baseNormals);
+
+    static uint16_t toHalf(float _v);
+    static float fromHalf(uint16_t _h);
+    static void octEncode(const float _n[3], int16_t _out[2]);
+    static void octDecode(const int16_t _in[2], float _n[3]);
+};
+
+#endif
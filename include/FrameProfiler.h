@@ -0,0 +1,142 @@
+#ifndef FRAMEPROFILER_H_
+#define FRAMEPROFILER_H_
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameProfiler.h
+/// @brief where the time of each frame goes, kept for the last few seconds of frames
+/// @class FrameProfiler
+/// @brief the sections are fixed when the profiler is made and referred to by index so timing one costs
+/// two clock reads. Each section keeps its CPU time and, if the caller measures it (see GpuTimer), its GPU
+/// time for the last c_history frames. The time from one frame to the next is kept as well so the
+/// percentiles and a histogram of frame times can be shown. While tracing every section is also recorded
+/// as an event for a Chrome trace (chrome://tracing or ui.perfetto.dev), CPU sections on one track and
+/// GPU sections on another. There is nothing GL here so the same profiler can time headless work.
+//----------------------------------------------------------------------------------------------------------------------
+class FrameProfiler
+{
+  public:
+    /// @brief frames kept for the averages and percentiles
+    static constexpr size_t c_history = 240;
+    /// @brief upper edges (ms) of the frame time histogram buckets, the last bucket has no upper edge
+    static constexpr double c_bucketEdges[] = {4.0, 8.0, 16.7, 33.3, 50.0};
+    static constexpr size_t c_numBuckets = sizeof(c_bucketEdges) / sizeof(c_bucketEdges[0]) + 1;
+    /// @brief the most events a trace holds, later ones are dropped
+    static constexpr size_t c_maxTraceEvents = 1 << 20;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief times a section of CPU work for as long as it is in scope
+    //----------------------------------------------------------------------------------------------------------------------
+    class Scope
+    {
+      public:
+        Scope(FrameProfiler &_profiler, size_t _section) : m_profiler(_profiler), m_section(_section)
+        {
+          m_profiler.beginSection(m_section);
+        }
+        ~Scope() { m_profiler.endSection(m_section); }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+      private:
+        FrameProfiler &m_profiler;
+        size_t m_section;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _sections the name of each section, the index into this is the section id
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit FrameProfiler(std::vector<std::string> _sections);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief call at the start of each frame, records the time since the last call as the frame time
+    //----------------------------------------------------------------------------------------------------------------------
+    void beginFrame();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief call once everything in the frame has been timed
+    //----------------------------------------------------------------------------------------------------------------------
+    void endFrame();
+    void beginSection(size_t _section);
+    void endSection(size_t _section);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief add the GPU time of a section, this usually arrives a few frames after the CPU time
+    /// @param [in] _section the section
+    /// @param [in] _startMs when it started on the GPU, in ms on the now() clock
+    /// @param [in] _ms how long it took
+    //----------------------------------------------------------------------------------------------------------------------
+    void addGpuTime(size_t _section, double _startMs, double _ms);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief forget the frame times, used when frames haven't been drawn back to back (the window was
+    /// idle) so the gap doesn't show up as a slow frame
+    //----------------------------------------------------------------------------------------------------------------------
+    void resetFrameTimes();
+    /// @brief ms since the profiler was made, the time base of the trace
+    double now() const;
+
+    size_t numSections() const { return m_sections.size(); }
+    const std::string &sectionName(size_t _section) const { return m_sections[_section].name; }
+    /// @brief mean times over the history, the GPU time is 0 if it has never been added
+    double cpuMs(size_t _section) const;
+    double gpuMs(size_t _section) const;
+    bool hasGpuTimes() const { return m_hasGpu; }
+    /// @brief frame times in the history
+    size_t numFrames() const { return m_numFrameTimes; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a percentile of the frame times in the history
+    /// @param [in] _p 0 to 100
+    //----------------------------------------------------------------------------------------------------------------------
+    double percentile(double _p) const;
+    /// @brief how many frames of the history fall in each bucket, see c_bucketEdges
+    std::vector<size_t> histogram() const;
+
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start or stop recording trace events, starting throws away any earlier events
+    //----------------------------------------------------------------------------------------------------------------------
+    void setTracing(bool _on);
+    bool isTracing() const { return m_tracing; }
+    size_t numTraceEvents() const { return m_trace.size(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write the recorded events as Chrome trace event JSON
+    /// @returns false if the file can't be written
+    //----------------------------------------------------------------------------------------------------------------------
+    bool writeChromeTrace(const std::string &_fname) const;
+
+  private:
+    struct Section
+    {
+      std::string name;
+      /// @brief when the open section started in ms
+      double startMs = 0.0;
+      /// @brief per frame totals, a section can be timed more than once a frame
+      double cpuThisFrame = 0.0;
+      std::vector<float> cpuMs;
+      std::vector<float> gpuMs;
+      size_t gpuNext = 0;
+      size_t numGpu = 0;
+    };
+    struct TraceEvent
+    {
+      uint32_t section;
+      /// @brief 0 for CPU, 1 for GPU
+      uint32_t track;
+      double startMs;
+      double ms;
+    };
+    void trace(size_t _section, uint32_t _track, double _startMs, double _ms);
+    std::chrono::steady_clock::time_point m_start;
+    std::vector<Section> m_sections;
+    /// @brief ring of the last c_history frame times, m_frameNext is the next one to write
+    std::vector<float> m_frameTimes;
+    size_t m_frameNext = 0;
+    size_t m_numFrameTimes = 0;
+    /// @brief ring index of the frame being timed and how many frames of section times there are
+    size_t m_cpuNext = 0;
+    size_t m_numCpuFrames = 0;
+    double m_lastFrameStart = -1.0;
+    bool m_hasGpu = false;
+    bool m_tracing = false;
+    std::vector<TraceEvent> m_trace;
+};
+
+#endif
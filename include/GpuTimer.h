@@ -0,0 +1,80 @@
+#ifndef GPUTIMER_H_
+#define GPUTIMER_H_
+#include "FrameProfiler.h"
+#include <ngl/Types.h>
+#include <cstddef>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GpuTimer.h
+/// @brief GL timer queries for the sections of a FrameProfiler
+/// @class GpuTimer
+/// @brief each section gets a GL_TIMESTAMP query at its start and end, timestamps (unlike
+/// GL_TIME_ELAPSED) can be nested and overlap. The queries are in a ring of frames and are only read
+/// back once the GPU has finished them, a few frames later, so timing never stalls the pipeline. The
+/// GPU clock is lined up with the profiler clock when the timer is created so the GPU sections land in
+/// the right place in a trace. A section is timed once per frame, later uses in the same frame are
+/// ignored.
+//----------------------------------------------------------------------------------------------------------------------
+class GpuTimer
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief times a section on the GPU for as long as it is in scope
+    //----------------------------------------------------------------------------------------------------------------------
+    class Scope
+    {
+      public:
+        Scope(GpuTimer &_timer, size_t _section) : m_timer(_timer), m_section(_section) { m_timer.begin(m_section); }
+        ~Scope() { m_timer.end(m_section); }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+      private:
+        GpuTimer &m_timer;
+        size_t m_section;
+    };
+    GpuTimer() = default;
+    ~GpuTimer();
+    GpuTimer(const GpuTimer &) = delete;
+    GpuTimer &operator=(const GpuTimer &) = delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief create the queries, needs a current GL context
+    /// @param [in] _profiler the profiler the times are for, one query pair per section
+    /// @param [in] _numFrames frames in flight before a read back would have to wait
+    /// @returns false if the context has no timestamp queries, the timer then does nothing
+    //----------------------------------------------------------------------------------------------------------------------
+    bool create(const FrameProfiler &_profiler, size_t _numFrames = 4);
+    bool isAvailable() const { return !m_frames.empty(); }
+    /// @brief queries are only issued while enabled
+    void setEnabled(bool _on) { m_enabled = _on; }
+    void begin(size_t _section);
+    void end(size_t _section);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief call once the frame's sections have been issued, adds the times of any frames the GPU has
+    /// finished to _profiler
+    //----------------------------------------------------------------------------------------------------------------------
+    void endFrame(FrameProfiler &_profiler);
+
+  private:
+    struct Frame
+    {
+      /// @brief begin and end query of each section
+      std::vector<GLuint> queries;
+      std::vector<bool> begun;
+      std::vector<bool> ended;
+      /// @brief the end query issued last, sections don't end in index order
+      GLuint lastQuery = 0;
+      bool pending = false;
+    };
+    /// @brief read the results of _frame, waiting for them if _wait is set
+    /// @returns false if they aren't ready and _wait isn't set
+    bool collect(Frame &_frame, FrameProfiler &_profiler, bool _wait);
+    void destroy();
+    std::vector<Frame> m_frames;
+    size_t m_current = 0;
+    bool m_enabled = false;
+    /// @brief profiler ms minus GPU timestamp ms
+    double m_offsetMs = 0.0;
+};
+
+#endif
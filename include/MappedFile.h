@@ -0,0 +1,53 @@
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+#include <cstddef>
+#include <string>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MappedFile.h
+/// @brief read only memory mapping of a whole file
+/// @class MappedFile
+/// @brief the OS pages the file in as it is touched so large files can be read without copying them
+/// into our own buffers first. Uses mmap on unix and file mapping objects on windows.
+//----------------------------------------------------------------------------------------------------------------------
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&_other) noexcept;
+    MappedFile &operator=(MappedFile &&_other) noexcept;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief map the file, any current mapping is closed first
+    /// @returns false if the file can't be opened or mapped (an empty file maps to size 0 and returns true)
+    //----------------------------------------------------------------------------------------------------------------------
+    bool open(const std::string &_fname);
+    void close();
+    bool isOpen() const { return m_open; }
+    enum class Advice
+    {
+      /// @brief start reading the range in now, it will be wanted soon
+      WillNeed,
+      /// @brief the range won't be read again soon, its pages can be dropped (they are read again if it is)
+      DontNeed
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief tell the OS how part of the file will be used, a hint so it can't fail. The range is widened
+    /// to whole pages for WillNeed and narrowed to them for DontNeed so neighbouring data isn't dropped
+    //----------------------------------------------------------------------------------------------------------------------
+    void advise(size_t _offset, size_t _bytes, Advice _advice) const;
+    const unsigned char *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+  private:
+    const unsigned char *m_data = nullptr;
+    size_t m_size = 0;
+    bool m_open = false;
+#if defined(_WIN32)
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef MESHBAKER_H_
+#define MESHBAKER_H_
+#include "AsyncWriter.h"
+#include "BlendRig.h"
+#include "BlendShapeEvaluator.h"
+#include "PoseCache.h"
+#include "WorkStealingPool.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MeshBaker.h
+/// @brief offline export of the deformed mesh for every frame of an animation, no GPU needed
+/// @class MeshBaker
+/// @brief frames are evaluated in parallel on a WorkStealingPool, one BlendShapeEvaluator per worker,
+/// and each worker formats its frame into a buffer from an AsyncWriter so the disk writes overlap the
+/// next frames being evaluated. With a pose cache a frame whose weights have already been baked is copied
+/// rather than blended again, which is most of a clip that holds poses. The output is either an obj per
+/// frame, with the same vertices, normals and faces as the base obj so it can replace it in other tools,
+/// or a single PointCache.
+//----------------------------------------------------------------------------------------------------------------------
+class MeshBaker
+{
+  public:
+    struct Stats
+    {
+      size_t frames = 0;
+      size_t threads = 0;
+      /// @brief wall clock time of the bake
+      double wallMs = 0.0;
+      /// @brief evaluate and format time summed over the workers
+      double computeMs = 0.0;
+      /// @brief time the writer thread spent writing
+      double writeMs = 0.0;
+      uint64_t bytes = 0;
+      uint64_t steals = 0;
+      /// @brief the pose cache's lookups, all zero without one
+      PoseCache::Stats poses;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _rig the rig to bake, it must outlive the baker
+    /// @param [in] _numThreads workers, 0 means one per hardware thread
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit MeshBaker(const BlendRig &_rig, size_t _numThreads = 0);
+    /// @brief how the baked normals are made (Normals in models.txt), blended unless set
+    void setNormalMode(NormalRebuilder::Mode _m);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief keep up to _budgetBytes of baked frames (never more than one bake needs) to reuse, see PoseCache
+    /// @param [in] _step the weights are rounded to this, 0 only reuses exactly the same weights so the
+    /// output is unchanged
+    //----------------------------------------------------------------------------------------------------------------------
+    void setPoseCache(size_t _budgetBytes, float _step = 0.0f);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief read the weights for every frame
+    /// @param [in] _fname a clip (AnimationClip::loadAny) sampled at _fps, a weight stream capture (.fws,
+    /// see WeightStream) or a csv of time then one column per target (as FacialClip sample writes)
+    /// @param [in] _targetNames the rig's targets, clip curves are matched to them by name
+    /// @param [out] _frames numTargets weights per frame, one frame after another
+    /// @returns false with _error set if the file can't be read or a csv row isn't a time and a number per target
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool loadWeights(const std::string &_fname, const std::vector<std::string> &_targetNames, float _fps,
+                            std::vector<float> &_frames, std::string &_error);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write an obj per frame
+    /// @param [in] _pattern the file name, a run of # is replaced by the zero padded frame number, without
+    /// one _#### is added before the extension
+    //----------------------------------------------------------------------------------------------------------------------
+    bool bakeObj(const std::vector<float> &_frames, const std::string &_pattern);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write every frame to one PointCache
+    //----------------------------------------------------------------------------------------------------------------------
+    bool bakePointCache(const std::vector<float> &_frames, float _fps, uint64_t _sourceHash, const std::string &_fname);
+    const Stats &stats() const { return m_stats; }
+    /// @brief the file name bakeObj uses for _frame
+    static std::string objFrameName(const std::string &_pattern, size_t _frame);
+
+  private:
+    /// @brief writes a frame given as the rig's vertex data, numVerts positions then normals
+    using FrameWriter = std::function<void(size_t, const float *, AsyncWriter &)>;
+    void bake(size_t _numFrames, const std::vector<float> &_frames, AsyncWriter &_writer, const FrameWriter &_write);
+    const BlendRig &m_rig;
+    WorkStealingPool m_pool;
+    std::vector<BlendShapeEvaluator> m_evaluators;
+    /// @brief each worker's frame and pose key
+    std::vector<std::vector<float>> m_frames;
+    std::vector<PoseCache::Key> m_poseKeys;
+    size_t m_poseBudget = 0;
+    float m_poseStep = 0.0f;
+    /// @brief shared by the workers, the slots and m_poses are only touched under m_poseMutex
+    PoseCache m_poseCache;
+    std::unique_ptr<float[]> m_poses;
+    std::mutex m_poseMutex;
+    /// @brief for each obj position / normal a unique vertex that uses it, or -1
+    std::vector<int64_t> m_positionSource;
+    std::vector<int64_t> m_normalSource;
+    /// @brief the f lines, the same for every frame
+    std::string m_objFaces;
+    Stats m_stats;
+};
+
+#endif
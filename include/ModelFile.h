@@ -0,0 +1,101 @@
+#ifndef MODELFILE_H_
+#define MODELFILE_H_
+#include "DeltaCodec.h"
+#include "NormalRebuilder.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ModelFile.h
+/// @brief reads the models.txt rig description
+/// @class ModelFile
+/// @brief models.txt is a comma separated list, one entry per line
+/// BaseMesh,path
+/// BlendShape,name,path
+/// Corrective,name,path,driver,driver[,driver...] (weight is the product of the drivers' weights, a driver is
+/// a BlendShape or another Corrective)
+/// InBetween,name,path,driver,weight (the shape at that weight of driver, between 0 and 1)
+/// DeltaEpsilon,value
+/// DeltaFormat,float|half|snorm16 (how the deltas are stored on the GPU, see DeltaCodec)
+/// Normals,blend|topology (blend the normal deltas or rebuild from the faces, see NormalRebuilder)
+/// Clip,path (an AnimationClip to play)
+/// Lod,ratio[,ratio...] (the fraction of the triangles each simplified level keeps, see RigLod)
+/// LodPixels,value (how many pixels a level's error may cover before a finer one is drawn)
+/// Basis,tolerance[,maxShapes] (blend basis shapes mixed from the targets, see DeltaBasis)
+/// lines starting with # are comments
+//----------------------------------------------------------------------------------------------------------------------
+class ModelFile
+{
+  public:
+    /// @brief every kind of entry is a target of the rig, correctives and in-betweens have their weight
+    /// worked out from others (see WeightProgram)
+    enum class Kind
+    {
+      BlendShape,
+      Corrective,
+      InBetween
+    };
+    struct Entry
+    {
+      std::string name;
+      std::string path;
+      Kind kind = Kind::BlendShape;
+      /// @brief target names, the product for a Corrective or the one target for an InBetween
+      std::vector<std::string> drivers;
+      /// @brief the driver weight an InBetween is at full strength
+      float weight = 1.0f;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief parse the file, once it opens nothing a previous load read is kept
+    /// @returns false if it can't be opened, has no BaseMesh or a number doesn't parse, see errorString
+    //----------------------------------------------------------------------------------------------------------------------
+    bool load(const std::string &_fname);
+    const std::string &errorString() const { return m_error; }
+    const std::string &fileName() const { return m_fileName; }
+    const std::string &baseMesh() const { return m_baseMesh; }
+    /// @brief every target in file order, including correctives and in-betweens
+    const std::vector<Entry> &blendShapes() const { return m_blendShapes; }
+    float deltaEpsilon() const { return m_deltaEpsilon; }
+    /// @brief float unless the file asks for (and correctly names) another format
+    DeltaCodec::Format deltaFormat() const { return m_deltaFormat; }
+    /// @brief blend unless the file asks for topology
+    NormalRebuilder::Mode normalMode() const { return m_normalMode; }
+    /// @brief empty if there is no Clip line
+    const std::string &clip() const { return m_clip; }
+    /// @brief empty if there is no Lod line, only the full mesh is drawn
+    const std::vector<float> &lodRatios() const { return m_lodRatios; }
+    float lodPixels() const { return m_lodPixels; }
+    /// @brief 0 if there is no Basis line, the targets are blended as they are
+    float basisTolerance() const { return m_basisTolerance; }
+    /// @brief 0 for no limit
+    size_t basisMaxShapes() const { return m_basisMaxShapes; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a hash of the entries plus the size and modification time of every file they reference,
+    /// if any of these change the hash will too so it is used to spot an out of date rig cache
+    //----------------------------------------------------------------------------------------------------------------------
+    uint64_t sourceHash() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the default name for the baked rig, models.txt becomes models.rig
+    //----------------------------------------------------------------------------------------------------------------------
+    std::string cacheFileName() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a hash of the size and modification time of _path, it changes whenever the file is written
+    //----------------------------------------------------------------------------------------------------------------------
+    static uint64_t fileStamp(const std::string &_path);
+
+  private:
+    std::string m_fileName;
+    std::string m_baseMesh;
+    std::vector<Entry> m_blendShapes;
+    float m_deltaEpsilon = 1e-5f;
+    DeltaCodec::Format m_deltaFormat = DeltaCodec::Format::Float32;
+    NormalRebuilder::Mode m_normalMode = NormalRebuilder::Mode::Blend;
+    std::string m_clip;
+    std::vector<float> m_lodRatios;
+    float m_lodPixels = 1.0f;
+    float m_basisTolerance = 0.0f;
+    size_t m_basisMaxShapes = 0;
+    std::string m_error;
+};
+
+#endif
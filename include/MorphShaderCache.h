@@ -0,0 +1,41 @@
+#ifndef MORPHSHADERCACHE_H_
+#define MORPHSHADERCACHE_H_
+#include "MorphShaderSource.h"
+#include <string>
+#include <unordered_set>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MorphShaderCache.h
+/// @brief compiles the blend shape shader for each rig it is asked for and keeps the programs
+/// @class MorphShaderCache
+/// @brief programs are held in the ngl::ShaderLib under MorphShaderSource::name so loading another rig
+/// with the same number of targets just picks up the program that is already linked. The template is
+/// read from disk once and all the programs share one compiled fragment shader.
+//----------------------------------------------------------------------------------------------------------------------
+class MorphShaderCache
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _vertexTemplate path to the vertex shader template
+    /// @param [in] _fragmentShader name of an already compiled ngl::ShaderLib fragment shader
+    /// @param [in] _baseName prefix for the program names
+    //----------------------------------------------------------------------------------------------------------------------
+    MorphShaderCache(const std::string &_vertexTemplate, const std::string &_fragmentShader,
+                     const std::string &_baseName);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief get the program for a variant, building it if this is the first time it is asked for
+    /// @param [out] _created true if the program was linked by this call so the caller can set the
+    /// uniforms that don't change per frame
+    /// @returns the program name or an empty string if it failed to build
+    //----------------------------------------------------------------------------------------------------------------------
+    std::string program(const MorphShaderSource::Variant &_variant, bool &_created);
+    size_t numPrograms() const { return m_programs.size(); }
+
+  private:
+    std::string m_template;
+    std::string m_fragmentShader;
+    std::string m_baseName;
+    std::unordered_set<std::string> m_programs;
+};
+
+#endif
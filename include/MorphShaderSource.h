@@ -0,0 +1,57 @@
+#ifndef MORPHSHADERSOURCE_H_
+#define MORPHSHADERSOURCE_H_
+#include "DeltaCodec.h"
+#include <cstddef>
+#include <string>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file MorphShaderSource.h
+/// @brief builds the blend shape vertex shader for a given rig
+/// @class MorphShaderSource
+/// @brief the vertex shader is written as a template (shaders/PerFragASDVert.glsl), before it is compiled
+/// the #version line is set and the rig specific defines are added after it :
+/// NUM_TARGETS the number of targets in the rig
+/// MORPH_UNROLLED set for small rigs, the row loop is given NUM_TARGETS as a constant bound (a row can't
+/// be longer than that) so the compiler can unroll it
+/// WEIGHTS_IN_TBO set when the context has no shader storage buffers (mac is stuck on 4.1) so the
+/// weights are read from a texture buffer instead
+/// DELTAS_SNORM16 the deltas are in the DeltaCodec::Format::SNorm16 layout (half needs no change to the
+/// shader, the texture buffer format does the conversion)
+/// MORPH_COMPUTE build the compute pre-pass that writes the blended mesh to a buffer rather than the
+/// vertex shader (needs 4.3 so never has WEIGHTS_IN_TBO)
+/// MORPH_INSTANCED build the crowd vertex shader, instance i reads its weights from NUM_TARGETS * i on
+/// and its model matrix from a texture buffer
+/// MORPH_TOPOLOGY_NORMALS the deltas are positions only (one texel per entry) and no normal deltas are
+/// blended, the normals are rebuilt from the faces by shaders/RenormaliseComp.glsl (see NormalRebuilder)
+/// Large rigs use a runtime bound loop that skips targets whose weight is zero.
+//----------------------------------------------------------------------------------------------------------------------
+class MorphShaderSource
+{
+  public:
+    /// @brief rigs with this many targets or fewer get the unrolled loop
+    static constexpr size_t c_unrollLimit = 16;
+    /// @brief what a compiled shader depends on, one program is built per distinct variant
+    struct Variant
+    {
+      size_t numTargets = 0;
+      bool weightsInTBO = false;
+      DeltaCodec::Format deltaFormat = DeltaCodec::Format::Float32;
+      bool compute = false;
+      /// @brief ignored for compute
+      bool instanced = false;
+      /// @brief position only deltas, the normals are rebuilt afterwards
+      bool topologyNormals = false;
+      bool unrolled() const { return numTargets <= c_unrollLimit; }
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a name for the variant that can be used for the shader program
+    /// @param [in] _base prefix for the name
+    //----------------------------------------------------------------------------------------------------------------------
+    static std::string name(const std::string &_base, const Variant &_variant);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the template with the #version line and defines for the variant
+    /// @param [in] _template the shader source, if the first line is a #version it is replaced
+    //----------------------------------------------------------------------------------------------------------------------
+    static std::string specialise(const std::string &_template, const Variant &_variant);
+};
+
+#endif
@@ -5,7 +5,25 @@
 #include <ngl/Obj.h>
 #include <ngl/Mat4.h>
 #include "WindowParams.h"
+#include "BlendRig.h"
+#include "RigCache.h"
+#include "WeightBuffer.h"
+#include "ActiveWeights.h"
+#include "MorphShaderCache.h"
+#include "ClipSampler.h"
+#include "DeltaBasis.h"
+#include "WeightStream.h"
+#include "Crowd.h"
+#include "FrameProfiler.h"
+#include "GpuTimer.h"
+#include "NormalRebuilder.h"
+#include "PointCachePlayer.h"
+#include "PoseCache.h"
+#include "RigLod.h"
+#include "RigReloader.h"
+#include "WeightProgram.h"
 #include <QOpenGLWindow>
+#include <chrono>
 #include <memory>
 //----------------------------------------------------------------------------------------------------------------------
 /// @file NGLScene.h
@@ -50,6 +68,40 @@ class NGLScene : public QOpenGLWindow
     void changeWeight(Direction _d );
     void changeActiveWeight(Direction _d);
     void resetWeights();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief drive the weights from a WeightStream, call before the window is shown
+    /// @param [in] _source - for stdin or the path of a unix socket to create
+    //----------------------------------------------------------------------------------------------------------------------
+    void setStreamSource(const std::string &_source);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start in crowd mode
+    /// @param [in] _count number of heads
+    //----------------------------------------------------------------------------------------------------------------------
+    void setCrowd(size_t _count);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief time the crowd at 1, 4, 16 ... c_maxCrowd heads, print the results and quit. Run it without
+    /// vsync or every step will report the refresh rate
+    //----------------------------------------------------------------------------------------------------------------------
+    void startCrowdBenchmark();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief record a Chrome trace from the first frame, written to _fname when recording stops (R) or
+    /// the window closes
+    //----------------------------------------------------------------------------------------------------------------------
+    void setTraceFile(const std::string &_fname);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief watch models.txt and its obj files and reload what changes, call before the window is shown
+    //----------------------------------------------------------------------------------------------------------------------
+    void setWatch(bool _watch);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief play a baked PointCache of the rig instead of blending it, call before the window is shown
+    //----------------------------------------------------------------------------------------------------------------------
+    void setPointCache(const std::string &_fname);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief how much GPU memory the compute pre-pass may keep poses it has blended in, see PoseCache
+    /// @param [in] _budgetBytes 0 turns it off
+    /// @param [in] _step the weights are rounded to this to find a pose
+    //----------------------------------------------------------------------------------------------------------------------
+    void setPoseCache(size_t _budgetBytes, float _step);
 
 
 private:
@@ -73,24 +125,215 @@ private:
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief a simple light use to illuminate the screen
     //----------------------------------------------------------------------------------------------------------------------
-    /// @brief our model
-    std::vector< std::unique_ptr<ngl::Obj>> m_meshes;
-    /// @brief the base mesh
-    std::unique_ptr<ngl::Obj> m_baseMesh;
     /// @brief eye mesh
     std::unique_ptr<ngl::Obj> m_eyeMesh;
     /// @brief text for rendering
     std::unique_ptr<ngl::Text> m_text;
     /// @brief the weights for the models
     std::vector <ngl::Real> m_weights;
+    /// @brief the correctives and in-betweens of models.txt
+    WeightProgram m_weightProgram;
+    /// @brief m_weights with the correctives and in-betweens worked out, what is blended
+    std::vector<float> m_blendWeights;
+    /// @brief basis shapes blended in place of the targets (Basis in models.txt), empty when not used
+    DeltaBasis m_basis;
+    float m_basisTolerance = 0.0f;
+    size_t m_basisMaxShapes = 0;
+    /// @brief m_blendWeights projected onto the basis shapes
+    std::vector<float> m_basisWeights;
+    /// @brief GPU copy of m_blendWeights (or m_basisWeights), written once per frame
+    WeightBuffer m_weightBuffer;
+    /// @brief the non zero weights, rebuilt every frame
+    ActiveWeights m_active;
+    /// @brief GPU copy of m_active
+    WeightBuffer m_activeBuffer;
+    /// @brief mean and longest number of delta entries per vertex, used to pick the shader loop
+    double m_avgRowLength = 0.0;
+    size_t m_maxRowLength = 0;
     /// @brief text name of blend meshes
     std::vector <std::string> m_meshNames;
     /// @brief active weight
     size_t m_activeWeight;
+    /// @brief the indexed base mesh and sparse targets built from the obj files, this is empty if
+    /// the rig came from the cache (use m_rigCache.toRig to fill it)
+    BlendRig m_rig;
+    /// @brief the baked rig mapped from disk
+    RigCache m_rigCache;
     /// @brief the mesh with all the data in it
     std::unique_ptr<ngl::AbstractVAO> m_vaoMesh;
-    /// @brief the id for the texture buffer object
+    /// @brief the id for the texture buffer object holding the sparse deltas
     GLuint m_tboID;
+    /// @brief the id for the texture buffer object with the start of each vertex's deltas
+    GLuint m_offsetTboID;
+    /// @brief the blend shader programs built so far, one per rig size
+    std::unique_ptr<MorphShaderCache> m_morphShaders;
+    /// @brief the program for the current rig
+    std::string m_morphProgram;
+    /// @brief true if the context has no storage buffers so the weights are sent as a texture buffer
+    bool m_weightsInTBO = false;
+    /// @brief the light position (same as the camera)
+    ngl::Vec3 m_lightPos;
+    /// @brief octahedral normals and per target scales for DeltaCodec::Format::SNorm16
+    GLuint m_normalTboID = 0;
+    GLuint m_scaleTboID = 0;
+    /// @brief the buffers behind the delta textures
+    enum DeltaBuffer
+    {
+      DeltaEntries,
+      DeltaNormals,
+      DeltaScales,
+      DeltaOffsets,
+      NumDeltaBuffers
+    };
+    GLuint m_deltaBuffers[NumDeltaBuffers] = {0, 0, 0, 0};
+    /// @brief the bytes sent to each delta buffer
+    struct DeltaTexels
+    {
+      std::vector<unsigned char> entries;
+      std::vector<unsigned char> normals;
+      std::vector<unsigned char> scales;
+      std::vector<unsigned char> offsets;
+    };
+    /// @brief a copy of what the delta buffers hold, only kept while watching so a reload can send
+    /// just the ranges that differ
+    DeltaTexels m_deltaTexels;
+    std::vector<std::pair<size_t, size_t>> m_changedRanges;
+    /// @brief how the deltas are stored on the GPU (DeltaFormat in models.txt)
+    DeltaCodec::Format m_deltaFormat = DeltaCodec::Format::Float32;
+    /// @brief the compute version of m_morphProgram, empty if the context can't run compute shaders
+    std::string m_computeProgram;
+    /// @brief true to blend with the compute pre-pass rather than in the vertex shader
+    bool m_useCompute = false;
+    /// @brief set when the deformed mesh has to be blended even if the weights are the same
+    bool m_deformedDirty = true;
+    /// @brief the weights the deformed mesh was last blended with
+    std::vector<ngl::Real> m_blendedWeights;
+    /// @brief how many times the pre-pass has run
+    size_t m_computePasses = 0;
+    /// @brief the base mesh for the pre-pass (same layout as the VAO)
+    GLuint m_baseBuffer = 0;
+    /// @brief the output of the pre-pass, drawn with PerFragADSDeformed
+    std::unique_ptr<ngl::AbstractVAO> m_vaoDeformed;
+    /// @brief outputs of the pre-pass kept to be copied back when their weights come round again, a slot
+    /// of m_poseBuffer each (--pose-cache, the default rounds to a fifth of changeWeight's step)
+    size_t m_poseCacheBytes = 64 * 1024 * 1024;
+    float m_poseStep = 0.01f;
+    PoseCache m_poseCache;
+    PoseCache::Key m_poseKey;
+    GLuint m_poseBuffer = 0;
+    /// @brief blend the normal deltas or rebuild the normals from the faces (Normals in models.txt),
+    /// rebuilding runs as a second compute pass so it always uses the pre-pass
+    NormalRebuilder::Mode m_normalMode = NormalRebuilder::Mode::Blend;
+    NormalRebuilder m_normalRebuilder;
+    /// @brief shaders/RenormaliseComp.glsl, empty if the context can't run compute shaders
+    std::string m_renormaliseProgram;
+    /// @brief face offsets, faces, corners and rest normals of m_normalRebuilder (bindings 4 to 7)
+    GLuint m_adjacencyBuffers[4] = {0, 0, 0, 0};
+    /// @brief the vertices to rebuild this frame (binding 8)
+    GLuint m_touchedBuffer = 0;
+    size_t m_numTouched = 0;
+    size_t m_numVerts = 0;
+    /// @brief the simplified levels, all their indices follow the full mesh's in the VAO's element buffer
+    RigLod m_lod;
+    /// @brief the triangle fraction of each level (Lod in models.txt)
+    std::vector<float> m_lodRatios;
+    /// @brief false to always draw the full mesh, toggled with L
+    bool m_useLod = true;
+    /// @brief the level the single face was last drawn at
+    size_t m_faceLevel = 0;
+    /// @brief the clip named in models.txt, played with P
+    std::string m_clipName;
+    ClipSampler m_clipSampler;
+    bool m_playing = false;
+    std::chrono::steady_clock::time_point m_playStart;
+    /// @brief live weights, see setStreamSource
+    std::string m_streamSource;
+    WeightStream m_stream;
+    WeightStream::Frame m_streamFrame;
+    /// @brief set when m_streamFrame has been drawn but not yet swapped to the screen
+    bool m_streamShowing = false;
+    /// @brief the last few send to screen latencies in ms
+    static constexpr size_t c_latencySamples = 120;
+    std::vector<float> m_streamLatency;
+    size_t m_latencyIndex = 0;
+    /// @brief crowd mode draws m_crowdCount heads with an instanced draw per level of detail and their eyes
+    /// with another
+    static constexpr size_t c_maxCrowd = 4096;
+    bool m_crowdMode = false;
+    size_t m_crowdCount = 64;
+    Crowd m_crowd;
+    std::string m_crowdProgram;
+    /// @brief every head's weights, head i's start at i * numTargets
+    WeightBuffer m_crowdWeights;
+    std::vector<float> m_crowdBlendWeights;
+    std::vector<float> m_crowdBasisWeights;
+    /// @brief the model matrix of each head, read by the shaders through texture unit 6
+    GLuint m_instanceBuffer = 0;
+    GLuint m_instanceTboID = 0;
+    /// @brief the heads grouped by level of detail, read through texture unit 7, and the size of each group
+    GLuint m_headBuffer = 0;
+    GLuint m_headTboID = 0;
+    std::vector<int32_t> m_crowdOrder;
+    std::vector<uint32_t> m_crowdLevels;
+    std::unique_ptr<ngl::AbstractVAO> m_vaoEyes;
+    size_t m_numEyeVerts = 0;
+    size_t m_numIndices = 0;
+    std::chrono::steady_clock::time_point m_crowdStart;
+    /// @brief see startCrowdBenchmark
+    static constexpr size_t c_benchWarmup = 30;
+    static constexpr size_t c_benchFrames = 300;
+    bool m_benchmarking = false;
+    size_t m_benchFrames = 0;
+    std::chrono::steady_clock::time_point m_benchStart;
+    /// @brief the sections m_profiler times, in the order of the names it is made with
+    enum ProfileSection : size_t
+    {
+      ProfileFrame,
+      ProfileBlend,
+      ProfileMatrices,
+      ProfileMorphDraw,
+      ProfileEyes,
+      ProfileCrowd,
+      ProfileText,
+      ProfileCacheUpload
+    };
+    FrameProfiler m_profiler{
+        {"paintGL", "compute blend", "matrices + weights", "morph draw", "eyes", "crowd", "text", "cache upload"}};
+    GpuTimer m_gpuTimer;
+    /// @brief T shows the timings
+    bool m_showProfiler = false;
+    /// @brief where R writes the trace
+    std::string m_traceFile = "trace.json";
+    /// @brief --watch, reload the rig when models.txt or its obj files change
+    bool m_watch = false;
+    RigReloader m_reloader;
+    RigReloader::Result m_reload;
+    /// @brief set by timerEvent when m_reload is waiting to be applied in paintGL
+    bool m_reloadPending = false;
+    int m_watchTimer = 0;
+    /// @brief the result of the last reload for the overlay
+    std::string m_reloadStatus;
+    /// @brief the models.txt the rig was loaded from
+    ModelFile m_modelFile;
+    /// @brief --cache, a baked point cache drawn as it is instead of the blend (K switches between them)
+    std::string m_cacheFile;
+    PointCachePlayer m_cachePlayer;
+    bool m_cacheMode = false;
+    /// @brief the frames go through a fenced ring of vertex buffers so writing one never waits on the GPU
+    WeightBuffer m_cacheRing;
+    /// @brief a vertex array of its own so its attributes can point at the ring segment of each frame
+    GLuint m_cacheVAO = 0;
+    GLuint m_cacheIndexBuffer = 0;
+    /// @brief the playhead in seconds and its direction, 1 forwards, -1 backwards, 0 paused
+    double m_cacheTime = 0.0;
+    int m_cacheDirection = 1;
+    std::chrono::steady_clock::time_point m_cacheClock;
+    /// @brief the frame on screen, shown again while the next one is still being read
+    size_t m_cacheShown = 0;
+    /// @brief the ring segment holding it, drawn again rather than copied from the mapping again
+    size_t m_cacheOffset = 0;
+    /// @brief deltas smaller than this are not stored (can be set with DeltaEpsilon in models.txt)
+    float m_deltaEpsilon = 1e-5f;
     /// left eye rotation
     ngl::Vec3 m_leftEyeRot;
     /// left right rotation
@@ -129,10 +372,86 @@ private:
     /// @param _event the Qt Event structure
     //----------------------------------------------------------------------------------------------------------------------
     void wheelEvent( QWheelEvent *_event);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief checks the reloader while watching, asks for a frame when it has a new rig
+    /// @param _event the Qt Event structure
+    //----------------------------------------------------------------------------------------------------------------------
+    void timerEvent(QTimerEvent *_event);
 
     /// do our morphing for the 3 meshes
     void createMorphMesh();
-    /// @brief parse the models file
+    /// @brief get the blend shader for the loaded rig, building it if we haven't seen this size before
+    void selectMorphShader();
+    /// @brief material and light values for a program drawing the face
+    void setLightingUniforms(const std::string &_program);
+    /// @brief texture units for a program that reads the deltas
+    void setDeltaUniforms(const std::string &_program);
+    void bindDeltaTextures();
+    /// @brief work out m_maxRowLength and m_avgRowLength
+    void measureRows(const int32_t *_offsets, size_t _numVerts, size_t _numEntries);
+    /// @brief the deltas as the texture buffers hold them in the current format
+    /// @param [in] _baseNormals the base mesh normals, used by DeltaCodec::Format::SNorm16
+    void packDeltas(const int32_t *_offsets, const float *_entries, size_t _numVerts, size_t _numEntries,
+                    const float *_baseNormals, DeltaTexels &_out) const;
+    GLenum deltaEntryFormat() const;
+    /// @brief fill delta buffer _b and point its texture on unit _unit at it, creating both the first time
+    void setDeltaBuffer(DeltaBuffer _b, GLuint &_texture, GLenum _unit, GLenum _format,
+                        const std::vector<unsigned char> &_data);
+    /// @brief send only the parts of _data that differ from m_deltaTexels
+    /// @returns the number of bytes sent
+    size_t patchDeltaBuffer(DeltaBuffer _b, GLuint &_texture, GLenum _unit, GLenum _format,
+                            const std::vector<unsigned char> &_data);
+    /// @brief size the weight and active target buffers for m_meshNames
+    void createWeightBuffers();
+    /// @brief how many targets the GPU blends, the basis shapes if there are any
+    size_t numBlendTargets() const { return m_basis.empty() ? m_meshNames.size() : m_basis.numShapes(); }
+    /// @brief take the delta format, normal mode, clip and levels of detail from m_modelFile
+    void applyModelSettings();
+    /// @brief compile the correctives and in-betweens of m_modelFile
+    void compileWeightProgram();
+    /// @brief start the reloader from the rig that was just loaded
+    void startWatching();
+    /// @brief the vertex array and ring for m_cachePlayer, closes it if the rig no longer matches
+    void createCacheMesh();
+    /// @brief upload the frame at the playhead (or the last one if it isn't read yet) and draw it
+    void drawCachedFace();
+    /// @brief pause and move the playhead _frames frames
+    void stepCache(int _frames);
+    /// @brief swap in the rig the reloader built, called from paintGL
+    void applyReload();
+    /// @brief send the weights and active list for the current program
+    void uploadWeights();
+    /// @brief run the compute pre-pass if the weights have changed since the last one, or copy the pose
+    /// from m_poseBuffer if it has been blended before
+    void blendDeformedMesh();
+    /// @brief empty the pose cache, resizing it and m_poseBuffer if the rig has changed
+    void createPoseCache();
+    /// @brief build the face adjacency for rebuilding the normals and send it to the GPU
+    void createNormalAdjacency(const float *_vertexData, const uint32_t *_indices, size_t _numIndices,
+                               const uint32_t *_positionIndex, const int32_t *_offsets, const float *_entries);
+    /// @brief load and bind the clip from models.txt
+    void loadClip();
+    void togglePlayback();
+    /// @brief record the latency of the stream frame that was just swapped to the screen
+    void streamFrameShown();
+    /// @brief the single face and its eyes
+    void drawFace();
+    /// @brief draw _instances copies of level _level with the VAO that is bound
+    void drawLevel(size_t _level, GLsizei _instances = 1) const;
+    /// @brief build the instanced eye mesh and place the eyes for the CrowdEyes shader
+    void createCrowdEyes();
+    /// @brief lay out m_crowdCount heads and size the per instance buffers
+    void resizeCrowd();
+    void drawCrowd();
+    /// @brief time the frame just swapped when benchmarking the crowd
+    void crowdBenchmarkFrame();
+    /// @brief the help and status text
+    void drawText();
+    /// @brief the frame time percentiles and histogram and the time of each section
+    void drawProfiler();
+    /// @brief start recording a trace, or stop and write it to m_traceFile
+    void toggleTrace();
+    /// @brief parse the models file and load the rig, from the baked cache if it is up to date
     void parseModelFile();
 
 };
@@ -0,0 +1,113 @@
+#ifndef NORMALREBUILDER_H_
+#define NORMALREBUILDER_H_
+#include "ActiveWeights.h"
+#include "BlendTargetSet.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file NormalRebuilder.h
+/// @brief works out the deformed normals from the deformed positions rather than blending normal deltas
+/// @class NormalRebuilder
+/// @brief blending normal deltas linearly is only right for one target at a time, combined shapes get
+/// normals that don't match the surface. This rebuilds them from the faces around each vertex instead,
+/// so the targets only need position deltas (half the delta memory and fetches on the GPU).
+/// The adjacency is a CSR list of the faces around each vertex. Vertices split at the same obj position
+/// with the same base normal (uv seams) share their faces so the split doesn't show, vertices split
+/// with different normals (hard edges) keep their own. The authored base normals are kept: each
+/// rebuilt normal is the base normal turned by the rotation from the face normal at rest to the face
+/// normal now, so the neutral pose shades exactly as before. Only vertices next to a face a target
+/// moves can change, these lists are kept per target so a frame only rebuilds the region its active
+/// targets touch.
+//----------------------------------------------------------------------------------------------------------------------
+class NormalRebuilder
+{
+  public:
+    /// @brief how the deformed normals are made
+    enum class Mode
+    {
+      /// @brief base normal plus the weighted normal deltas, normalized
+      Blend,
+      /// @brief rebuilt from the deformed faces
+      Topology
+    };
+    static const char *modeName(Mode _m);
+    /// @returns false if the name isn't blend or topology
+    static bool parseMode(const std::string &_name, Mode &_m);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief build the adjacency and the rest pose face normals, this forgets any targets
+    /// @param [in] _indices three per triangle
+    /// @param [in] _positionIndex the obj position of each vertex (BlendRig::positionIndex)
+    /// @param [in] _positions interleaved xyz base positions
+    /// @param [in] _normals interleaved xyz base normals
+    /// @param [in] _numVerts the number of vertices
+    //----------------------------------------------------------------------------------------------------------------------
+    void build(const uint32_t *_indices, size_t _numIndices, const uint32_t *_positionIndex, const float *_positions,
+               const float *_normals, size_t _numVerts);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief work out the vertices each target can change the normal of
+    //----------------------------------------------------------------------------------------------------------------------
+    void setTargets(const BlendTargetSet &_targets);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the same from vertex major rows (BlendTargetSet::buildVertexMajor), as the rig cache holds
+    //----------------------------------------------------------------------------------------------------------------------
+    void setTargets(const int32_t *_offsets, const float *_entries, size_t _numTargets);
+    size_t numVerts() const { return m_numVerts; }
+    size_t numTargets() const { return m_targetOffsets.empty() ? 0 : m_targetOffsets.size() - 1; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the vertices whose normals the active targets can change, in order
+    //----------------------------------------------------------------------------------------------------------------------
+    const std::vector<uint32_t> &touched(const ActiveWeights &_active);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief rebuild the normals of _vertices
+    /// @param [in] _positions deformed x, y and z streams
+    /// @param [in] _baseNormals base normal x, y and z streams, unit length
+    /// @param [in] _vertices which vertices to rebuild
+    /// @param [out] _normals x, y and z streams to write, only _vertices are written
+    //----------------------------------------------------------------------------------------------------------------------
+    void rebuild(const float *const _positions[3], const float *const _baseNormals[3],
+                 const std::vector<uint32_t> &_vertices, float *const _normals[3]);
+    /// @brief the faces around vertex v are faces()[offsets()[v]] to faces()[offsets()[v+1]]
+    const std::vector<int32_t> &offsets() const { return m_offsets; }
+    const std::vector<uint32_t> &faces() const { return m_faces; }
+    /// @brief three corners per face
+    const std::vector<uint32_t> &indices() const { return m_indices; }
+    /// @brief unit sum of the face normals around each vertex at rest, interleaved xyz
+    const std::vector<float> &restNormals() const { return m_restNormals; }
+    /// @brief bytes held for the adjacency and target regions
+    size_t bytes() const;
+
+  private:
+    size_t m_numVerts = 0;
+    std::vector<int32_t> m_offsets;
+    std::vector<uint32_t> m_faces;
+    std::vector<uint32_t> m_indices;
+    std::vector<float> m_restNormals;
+    /// @brief the faces that use each vertex as a corner, not shared across a seam
+    std::vector<int32_t> m_cornerOffsets;
+    std::vector<uint32_t> m_cornerFaces;
+    /// @brief vertices that share their faces, group g is m_groupVerts[m_groupOffsets[g]..m_groupOffsets[g+1]]
+    std::vector<uint32_t> m_vertexGroup;
+    std::vector<int32_t> m_groupOffsets;
+    std::vector<uint32_t> m_groupVerts;
+    /// @brief the vertices target t can change are m_targetVerts[m_targetOffsets[t]..m_targetOffsets[t+1]]
+    std::vector<int64_t> m_targetOffsets;
+    std::vector<uint32_t> m_targetVerts;
+    /// @brief scratch for touched, a vertex is already in the list if its stamp is the current one
+    std::vector<uint32_t> m_stamps;
+    uint32_t m_stamp = 0;
+    std::vector<uint32_t> m_touched;
+    /// @brief scratch for rebuild, the face normals worked out this call are the ones with the current stamp
+    std::vector<float> m_faceNormals;
+    std::vector<uint32_t> m_faceStamps;
+    uint32_t m_faceStamp = 0;
+    /// @brief the vertices that share a face with any of _moved, in order
+    void region(const std::vector<uint32_t> &_moved, std::vector<uint32_t> &_out);
+    /// @brief called with each target's moved vertices in turn
+    void beginTargets();
+    void addTarget(const std::vector<uint32_t> &_moved);
+    uint32_t nextStamp();
+};
+
+#endif
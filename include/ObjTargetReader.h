@@ -0,0 +1,42 @@
+#ifndef OBJTARGETREADER_H_
+#define OBJTARGETREADER_H_
+#include <cstddef>
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ObjTargetReader.h
+/// @brief reads just the positions and normals of a blend target obj
+/// @class ObjTargetReader
+/// @brief a target shares the base mesh's faces, so everything but its v and vn lines (faces, uvs,
+/// groups, materials) is skipped without being parsed. The file is memory mapped and the numbers are
+/// read with std::from_chars straight into arrays sized from the base mesh, so there is no per line
+/// allocation or stream and reading a target costs little more than touching its pages.
+/// A reader keeps its arrays between files, give each thread its own to reuse them.
+//----------------------------------------------------------------------------------------------------------------------
+class ObjTargetReader
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief read the positions and normals of _path
+    /// @param [in] _numPositions _numNormals how many the base mesh has, the file must have the same.
+    /// 0 accepts any number, the arrays then grow as the file is read
+    /// @returns false if the file can't be read or the counts don't match, see errorString()
+    //----------------------------------------------------------------------------------------------------------------------
+    bool read(const std::string &_path, size_t _numPositions = 0, size_t _numNormals = 0);
+    /// @brief interleaved xyz
+    const std::vector<float> &positions() const { return m_positions; }
+    const std::vector<float> &normals() const { return m_normals; }
+    size_t numPositions() const { return m_positions.size() / 3; }
+    size_t numNormals() const { return m_normals.size() / 3; }
+    /// @brief the size of the last file read
+    size_t fileBytes() const { return m_fileBytes; }
+    const std::string &errorString() const { return m_error; }
+
+  private:
+    std::vector<float> m_positions;
+    std::vector<float> m_normals;
+    size_t m_fileBytes = 0;
+    std::string m_error;
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef PARSENUMBER_H_
+#define PARSENUMBER_H_
+#include <charconv>
+#include <string>
+#include <system_error>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ParseNumber.h
+/// @brief reads a models.txt field or a command line value as a number
+/// @param [in] _s the whole of it has to be the number, "0.5," or "64MB" are rejected
+/// @returns false for an empty, half typed or out of range value rather than throwing like std::stof
+//----------------------------------------------------------------------------------------------------------------------
+template <typename T>
+bool parseNumber(const std::string &_s, T &_value)
+{
+  const char *end = _s.data() + _s.size();
+  auto result = std::from_chars(_s.data(), end, _value);
+  return !_s.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef POINTCACHE_H_
+#define POINTCACHE_H_
+#include <cstddef>
+#include <cstdint>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file PointCache.h
+/// @brief the binary file of baked deformed meshes written by MeshBaker
+/// @class PointCache
+/// @brief a Header then one frame after another, each frame is the deformed mesh in the same layout as
+/// BlendRig::vertexData (all the positions then all the normals, per unique vertex) so it can go
+/// straight into the vertex buffer. Frames start on page boundaries so any frame can be mapped or read
+/// on its own. The header holds the ModelFile::sourceHash of the rig so a cache can be matched to the
+/// rig it was baked from. Data is little endian.
+//----------------------------------------------------------------------------------------------------------------------
+class PointCache
+{
+  public:
+    /// @brief bump this whenever the layout changes
+    static constexpr uint32_t c_version = 1;
+    static constexpr uint64_t c_pageSize = 4096;
+    struct Header
+    {
+      char magic[4];
+      uint32_t byteOrder;
+      uint32_t version;
+      uint32_t numVerts;
+      uint64_t numFrames;
+      uint64_t sourceHash;
+      /// @brief bytes from the start of one frame to the next
+      uint64_t frameStride;
+      float fps;
+      uint32_t pad;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a filled in header for a cache of _numFrames frames
+    //----------------------------------------------------------------------------------------------------------------------
+    static Header makeHeader(size_t _numVerts, size_t _numFrames, float _fps, uint64_t _sourceHash);
+    /// @brief true if _header is a point cache of this version
+    static bool valid(const Header &_header);
+    /// @brief the bytes of mesh data in a frame
+    static uint64_t frameBytes(size_t _numVerts) { return static_cast<uint64_t>(_numVerts) * 6 * sizeof(float); }
+    /// @brief where frame _frame starts in the file
+    static uint64_t frameOffset(const Header &_header, size_t _frame) { return c_pageSize + _frame * _header.frameStride; }
+    /// @brief the size of the whole file
+    static uint64_t fileSize(const Header &_header) { return frameOffset(_header, _header.numFrames); }
+};
+
+#endif
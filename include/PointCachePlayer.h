@@ -0,0 +1,99 @@
+#ifndef POINTCACHEPLAYER_H_
+#define POINTCACHEPLAYER_H_
+#include "MappedFile.h"
+#include "PointCache.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file PointCachePlayer.h
+/// @brief plays back a PointCache straight from a memory mapping
+/// @class PointCachePlayer
+/// @brief the cache is mapped rather than read so a frame is just a pointer into it, but touching a page
+/// that isn't in memory yet stalls on the disk. A prefetch thread follows the playhead: it reads the
+/// frames ahead of it (in the direction of play, wrapping as playback loops) and a few behind it, nearest
+/// first, and drops the pages of frames that have left that window so a cache far larger than RAM plays
+/// in a fixed amount of memory. frame() only hands out frames the thread has finished reading, so the
+/// caller never waits on I/O and shows the last ready frame instead when it gets ahead of the disk.
+//----------------------------------------------------------------------------------------------------------------------
+class PointCachePlayer
+{
+  public:
+    struct Stats
+    {
+      /// @brief frames read in and dropped by the prefetch thread
+      uint64_t framesRead = 0;
+      uint64_t framesDropped = 0;
+      /// @brief frames asked for before they were read
+      uint64_t late = 0;
+    };
+    PointCachePlayer() = default;
+    ~PointCachePlayer();
+    PointCachePlayer(const PointCachePlayer &) = delete;
+    PointCachePlayer &operator=(const PointCachePlayer &) = delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief map a cache and start prefetching from frame 0
+    /// @param [in] _numVerts the rig's vertex count, the cache must have the same
+    /// @returns false if the file can't be mapped, isn't a point cache, is truncated or is for another rig
+    //----------------------------------------------------------------------------------------------------------------------
+    bool open(const std::string &_fname, size_t _numVerts);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    const std::string &errorString() const { return m_error; }
+    size_t numFrames() const { return static_cast<size_t>(m_header.numFrames); }
+    size_t numVerts() const { return m_header.numVerts; }
+    float fps() const { return m_header.fps; }
+    uint64_t sourceHash() const { return m_header.sourceHash; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief how many frames to keep read ahead of and behind the playhead
+    //----------------------------------------------------------------------------------------------------------------------
+    void setWindow(size_t _ahead, size_t _behind);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief move the playhead, the prefetch thread starts on the new window straight away
+    /// @param [in] _direction 1 playing forwards, -1 backwards, 0 paused or scrubbing (both sides)
+    //----------------------------------------------------------------------------------------------------------------------
+    void setPlayhead(size_t _frame, int _direction);
+    /// @brief true once frame _frame has been read in
+    bool isReady(size_t _frame) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the mesh of a frame in the BlendRig::vertexData layout (numVerts() positions then normals)
+    /// @returns nullptr if the frame hasn't been read in yet, it is then counted as late
+    //----------------------------------------------------------------------------------------------------------------------
+    const float *frame(size_t _frame);
+    /// @brief the frame showing at _seconds, wrapping either way
+    size_t frameAt(double _seconds) const;
+    Stats stats() const;
+    /// @brief how many frames are in memory now
+    size_t numResident() const { return m_numResident.load(std::memory_order_relaxed); }
+
+  private:
+    void prefetch();
+    /// @brief how far _frame is from the playhead in frames along (_forward) or against the direction of play
+    size_t distance(size_t _frame, size_t _playhead, int _direction, bool _forward) const;
+    MappedFile m_file;
+    PointCache::Header m_header = {};
+    std::string m_error;
+    size_t m_ahead = 64;
+    size_t m_behind = 16;
+    std::unique_ptr<std::atomic<bool>[]> m_ready;
+    std::atomic<size_t> m_numResident{0};
+    std::atomic<uint64_t> m_framesRead{0};
+    std::atomic<uint64_t> m_framesDropped{0};
+    std::atomic<uint64_t> m_late{0};
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    size_t m_playhead = 0;
+    int m_direction = 1;
+    /// @brief bumped by setPlayhead so the thread can tell it has been overtaken
+    uint64_t m_moves = 0;
+    bool m_stop = false;
+};
+
+#endif
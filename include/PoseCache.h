@@ -0,0 +1,97 @@
+#ifndef POSECACHE_H_
+#define POSECACHE_H_
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file PoseCache.h
+/// @brief remembers which weight vectors have already been blended
+/// @class PoseCache
+/// @brief the same poses keep coming back (neutral, the stock expressions, a held pose, the 0.05 steps
+/// changeWeight moves in) so the deformed mesh of each is kept and handed back rather than blended again.
+/// A pose is keyed on its weights rounded to a step, weights that round to the same multiples share it,
+/// so a hit can be up to half a step per weight from the pose that was blended. The cache only manages
+/// the keys: the budget is split into fixed size slots and find / insert say which slot a pose is in,
+/// the caller keeps the meshes in whatever it likes (a vector on the CPU, a buffer on the GPU). When it is
+/// full insert reuses the least recently used slot. It isn't thread safe, makeKey is the only const part.
+//----------------------------------------------------------------------------------------------------------------------
+class PoseCache
+{
+  public:
+    struct Stats
+    {
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+      /// @brief poses dropped to make room for another
+      uint64_t evictions = 0;
+      uint64_t evictedBytes = 0;
+    };
+    /// @brief a weight vector rounded to the step and its hash
+    struct Key
+    {
+      std::vector<int32_t> steps;
+      uint64_t hash = 0;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief size the cache, this empties it but keeps the stats
+    /// @param [in] _numWeights the length of every weight vector
+    /// @param [in] _poseBytes the size of one deformed mesh
+    /// @param [in] _budgetBytes how much the meshes may take, as many whole poses as fit (0 turns it off)
+    /// @param [in] _step weights are rounded to multiples of this, 0 keys on the exact values
+    //----------------------------------------------------------------------------------------------------------------------
+    void configure(size_t _numWeights, size_t _poseBytes, size_t _budgetBytes, float _step);
+    /// @brief forget every pose, the rig or how it is blended has changed
+    void clear();
+    bool enabled() const { return m_numSlots != 0; }
+    size_t numWeights() const { return m_numWeights; }
+    size_t poseBytes() const { return m_poseBytes; }
+    size_t budgetBytes() const { return m_budgetBytes; }
+    float step() const { return m_step; }
+    /// @brief the most poses it can hold and how many it holds now
+    size_t numSlots() const { return m_numSlots; }
+    size_t size() const { return m_size; }
+    size_t bytes() const { return m_size * m_poseBytes; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief round numWeights() weights to the step
+    //----------------------------------------------------------------------------------------------------------------------
+    void makeKey(const float *_weights, Key &_key) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief look a pose up, a hit becomes the most recently used
+    /// @returns the slot holding it or -1 if it has to be blended
+    //----------------------------------------------------------------------------------------------------------------------
+    int64_t find(const Key &_key);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief make room for a pose that has just been blended, only when enabled()
+    /// @returns the slot to write it to, the least recently used one if the cache is full
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t insert(const Key &_key);
+    const Stats &stats() const { return m_stats; }
+    void resetStats() { m_stats = Stats(); }
+    /// @brief hits as a fraction of the lookups
+    double hitRate() const;
+
+  private:
+    /// @brief take a slot out of the recently used list, and put one at its front
+    void unlink(uint32_t _slot);
+    void pushFront(uint32_t _slot);
+    size_t m_numWeights = 0;
+    size_t m_poseBytes = 0;
+    size_t m_budgetBytes = 0;
+    float m_step = 0.0f;
+    size_t m_numSlots = 0;
+    size_t m_size = 0;
+    /// @brief the key in each slot, numWeights() steps a slot
+    std::vector<int32_t> m_slotSteps;
+    std::vector<uint64_t> m_slotHashes;
+    /// @brief the slots from most to least recently used, linked through the slot indices
+    static constexpr uint32_t c_none = UINT32_MAX;
+    std::vector<uint32_t> m_prev;
+    std::vector<uint32_t> m_next;
+    uint32_t m_head = c_none;
+    uint32_t m_tail = c_none;
+    std::unordered_map<uint64_t, uint32_t> m_slots;
+    Stats m_stats;
+};
+
+#endif
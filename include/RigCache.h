@@ -0,0 +1,118 @@
+#ifndef RIGCACHE_H_
+#define RIGCACHE_H_
+#include "BlendRig.h"
+#include "DeltaBasis.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file RigCache.h
+/// @brief versioned binary version of a BlendRig so we don't have to parse the obj files every run
+/// @class RigCache
+/// @brief the file is a fixed header, a table of sections and then the sections themselves each
+/// starting on a 16 byte boundary. The vertex data, element buffer, delta offsets and delta entries
+/// are stored exactly as the GPU wants them so they can be handed to glBufferData straight from the
+/// mapping. The target major deltas for the CPU are stored as well so toRig doesn't have to rebuild
+/// anything. FacialRigBake can store a DeltaBasis as well, its mixing matrix and vertex major shapes,
+/// along with the Basis settings it was built for since they aren't part of the hash. The header holds
+/// the ModelFile::sourceHash of the files it was baked from so an out of date cache can be spotted.
+/// Data is little endian.
+//----------------------------------------------------------------------------------------------------------------------
+class RigCache
+{
+  public:
+    /// @brief bump this whenever the layout changes, old files are then treated as a cache miss
+    static constexpr uint32_t c_version = 2;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief bake a rig to disk
+    /// @param [in] _fname the file to write
+    /// @param [in] _rig the rig to write
+    /// @param [in] _sourceHash the hash of the models.txt entries it was built from
+    /// @param [in] _basis the basis of the targets if there is one, may be empty if it came out no smaller
+    /// @param [in] _basisTolerance _basisMaxShapes the Basis line _basis was built for
+    /// @returns false if the file can't be written
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool write(const std::string &_fname, const BlendRig &_rig, uint64_t _sourceHash,
+                      const DeltaBasis *_basis = nullptr, float _basisTolerance = 0.0f, size_t _basisMaxShapes = 0);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief map a baked rig
+    /// @returns false if the file is missing, the wrong version or the sections don't fit in the file
+    //----------------------------------------------------------------------------------------------------------------------
+    bool open(const std::string &_fname);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+
+    uint64_t sourceHash() const { return m_sourceHash; }
+    float deltaEpsilon() const { return m_deltaEpsilon; }
+    size_t numVerts() const { return m_numVerts; }
+    size_t numIndices() const { return m_numIndices; }
+    size_t numTargets() const { return m_targetNames.size(); }
+    size_t numEntries() const { return m_numEntries; }
+    const std::vector<std::string> &targetNames() const { return m_targetNames; }
+    /// @brief GPU ready data, these point into the mapping so are only valid while the cache is open
+    /// all positions then all normals (xyz)
+    const float *vertexData() const;
+    const uint32_t *indices() const;
+    /// @brief the obj position of each vertex as BlendRig::positionIndex
+    const uint32_t *positionIndex() const;
+    /// @brief numVerts()+1 row starts as BlendTargetSet::buildVertexMajor
+    const int32_t *deltaOffsets() const;
+    /// @brief two vec4 per entry as BlendTargetSet::buildVertexMajor
+    const float *deltaEntries() const;
+    /// @brief the Basis line the basis was baked for, a tolerance of 0 if none was
+    float basisTolerance() const { return m_basisTolerance; }
+    size_t basisMaxShapes() const { return m_basisMaxShapes; }
+    /// @brief 0 if there is no basis or it was no smaller than the targets
+    size_t numBasisShapes() const { return m_numBasisShapes; }
+    size_t numBasisEntries() const { return m_numBasisEntries; }
+    /// @brief DeltaBasis::Report::positionError
+    float basisError() const { return m_basisError; }
+    /// @brief numTargets() rows of numBasisShapes() as DeltaBasis::mixing
+    const float *basisMixing() const;
+    /// @brief the shapes vertex major, numVerts()+1 row starts and two vec4 per entry
+    const int32_t *basisOffsets() const;
+    const float *basisEntries() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief copy the data into a BlendRig for use on the CPU
+    //----------------------------------------------------------------------------------------------------------------------
+    void toRig(BlendRig &_rig) const;
+
+  private:
+    enum Section : uint32_t
+    {
+      VertexData,
+      Indices,
+      PositionIndex,
+      NormalIndex,
+      DeltaOffsets,
+      DeltaEntries,
+      TargetSizes,
+      TargetIndices,
+      TargetDeltas,
+      TargetNames,
+      BasisMixing,
+      BasisOffsets,
+      BasisEntries,
+      NumSections
+    };
+    const unsigned char *section(Section _s) const { return m_file.data() + m_sectionOffsets[_s]; }
+
+    MappedFile m_file;
+    uint64_t m_sectionOffsets[NumSections] = {};
+    uint64_t m_sourceHash = 0;
+    float m_deltaEpsilon = 0.0f;
+    size_t m_numVerts = 0;
+    size_t m_numIndices = 0;
+    size_t m_numEntries = 0;
+    size_t m_numSourcePositions = 0;
+    size_t m_numSourceNormals = 0;
+    float m_basisTolerance = 0.0f;
+    size_t m_basisMaxShapes = 0;
+    size_t m_numBasisShapes = 0;
+    size_t m_numBasisEntries = 0;
+    float m_basisError = 0.0f;
+    std::vector<std::string> m_targetNames;
+};
+
+#endif
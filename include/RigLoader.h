@@ -0,0 +1,64 @@
+#ifndef RIGLOADER_H_
+#define RIGLOADER_H_
+#include "BlendRig.h"
+#include "ModelFile.h"
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file RigLoader.h
+/// @brief builds a BlendRig from the obj files listed in models.txt
+/// @class RigLoader
+/// @brief this is the slow path, it's only used when there is no up to date baked rig (see RigCache)
+/// and by the FacialRigBake tool. The base mesh is parsed with ngl::Obj for its faces, then the targets
+/// are read by ObjTargetReader on a ThreadPool, one task per file, and the results are gathered in
+/// models.txt order so the target indices don't depend on which file finished first. Nothing here
+/// touches OpenGL so the GL upload is left to the caller.
+//----------------------------------------------------------------------------------------------------------------------
+class RigLoader
+{
+  public:
+    /// @brief how long each file took to parse
+    struct FileTiming
+    {
+      std::string path;
+      double ms;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _numThreads workers used for parsing, 0 means one per hardware thread
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit RigLoader(size_t _numThreads = 0) : m_numThreads(_numThreads) {}
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief parse the base mesh and every BlendShape entry and build the rig
+    /// @param [in] _models the parsed models.txt
+    /// @param [out] _rig the rig to fill in
+    /// @returns false on error, see errorString()
+    //----------------------------------------------------------------------------------------------------------------------
+    bool load(const ModelFile &_models, BlendRig &_rig);
+    const std::string &errorString() const { return m_error; }
+    /// @brief per file parse times from the last load, base mesh first then models.txt order
+    const std::vector<FileTiming> &timings() const { return m_timings; }
+    /// @brief wall clock time of the last load
+    double totalMs() const { return m_totalMs; }
+    /// @brief print the timings to std::cout
+    void printTimings() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief parse one target obj, a RigReloader::Parser
+    /// @param [out] _positions _normals interleaved xyz
+    /// @returns false if the file has no vertices or normals
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool parseTarget(const std::string &_path, std::vector<float> &_positions, std::vector<float> &_normals);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief load the whole rig, a RigReloader::Loader
+    /// @param [out] _error errorString() on failure
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool loadRig(const ModelFile &_models, BlendRig &_rig, std::string &_error);
+
+  private:
+    size_t m_numThreads;
+    std::string m_error;
+    std::vector<FileTiming> m_timings;
+    double m_totalMs = 0.0;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef RIGLOD_H_
+#define RIGLOD_H_
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file RigLod.h
+/// @brief simplified versions of the rig's topology for faces drawn small
+/// @class RigLod
+/// @brief the base mesh is decimated by half edge collapses, each one moves a vertex onto a neighbour and
+/// drops the two triangles between them, so every level is made of a subset of the full rig's vertices.
+/// A kept vertex keeps its deltas as they are, which is the transfer: the levels are just index lists
+/// into the same vertex and delta buffers, and a level only runs the vertex shader (and fetches delta
+/// rows) for the vertices it uses.
+/// The collapses are ordered by a quadric error on the base mesh plus how far apart the deltas of the two
+/// vertices are, so lips and lids that move a lot keep their detail. Vertices split at the same obj
+/// position (uv seams) stay where they are, open borders (eyes, mouth, neck) only collapse along
+/// themselves. Each level records the largest distance its surface can be from the full one, in any pose
+/// the targets reach at weight 1, and the level drawn is the coarsest whose error covers less than a
+/// pixel at the size the face is on screen.
+//----------------------------------------------------------------------------------------------------------------------
+class RigLod
+{
+  public:
+    struct Level
+    {
+      /// @brief three per triangle, indices into the full rig's vertices
+      std::vector<uint32_t> indices;
+      /// @brief how many of the full rig's vertices are used
+      size_t numVerts = 0;
+      /// @brief bound on the distance from the full surface in model units
+      float error = 0.0f;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief decimate the base mesh, level 0 is always the full mesh
+    /// @param [in] _indices three per triangle
+    /// @param [in] _positionIndex the obj position of each vertex (BlendRig::positionIndex)
+    /// @param [in] _positions interleaved xyz base positions
+    /// @param [in] _numVerts the number of vertices
+    /// @param [in] _offsets _entries vertex major deltas (BlendTargetSet::buildVertexMajor), may be null
+    /// @param [in] _ratios the fraction of the triangles each further level keeps, largest first
+    //----------------------------------------------------------------------------------------------------------------------
+    void build(const uint32_t *_indices, size_t _numIndices, const uint32_t *_positionIndex, const float *_positions,
+               size_t _numVerts, const int32_t *_offsets, const float *_entries, const std::vector<float> &_ratios);
+    void clear() { m_levels.clear(); }
+    size_t numLevels() const { return m_levels.size(); }
+    const Level &level(size_t _i) const { return m_levels[_i]; }
+    /// @brief all the levels' indices one after another, level _i starts at firstIndex(_i)
+    std::vector<uint32_t> packedIndices() const;
+    size_t firstIndex(size_t _i) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief how many pixels a model unit covers at the centre of the mesh
+    /// @param [in] _modelView column major 4x4, rotation, translation and a uniform scale
+    /// @param [in] _projectionY element [1][1] of the projection
+    /// @param [in] _viewportHeight in pixels
+    /// @returns a huge value if the camera is inside the bounds
+    //----------------------------------------------------------------------------------------------------------------------
+    float pixelsPerUnit(const float *_modelView, float _projectionY, float _viewportHeight) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the coarsest level whose error is within maxPixelError() at _pixelsPerUnit
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t selectLevel(float _pixelsPerUnit) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief pick a level for each of many instances and group them by it, so each level is one draw
+    /// @param [in] _view column major view matrix
+    /// @param [in] _models _count column major model matrices one after another
+    /// @param [out] _order the instance indices, level 0's first
+    /// @param [out] _counts numLevels() values, how many of _order are at each level
+    //----------------------------------------------------------------------------------------------------------------------
+    void selectLevels(const float *_view, const float *_models, size_t _count, float _projectionY,
+                      float _viewportHeight, std::vector<int32_t> &_order, std::vector<uint32_t> &_counts) const;
+    void setMaxPixelError(float _pixels) { m_maxPixelError = _pixels; }
+    float maxPixelError() const { return m_maxPixelError; }
+    /// @brief the centre and radius of the base mesh's bounding sphere
+    const float *centre() const { return m_centre; }
+    float radius() const { return m_radius; }
+
+  private:
+    std::vector<Level> m_levels;
+    float m_centre[3] = {0.0f, 0.0f, 0.0f};
+    float m_radius = 0.0f;
+    float m_maxPixelError = 1.0f;
+};
+
+#endif
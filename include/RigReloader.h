@@ -0,0 +1,138 @@
+#ifndef RIGRELOADER_H_
+#define RIGRELOADER_H_
+#include "BlendRig.h"
+#include "ModelFile.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file RigReloader.h
+/// @brief watches models.txt and the obj files it lists and rebuilds the rig when they change
+/// @class RigReloader
+/// @brief a worker thread polls the size and modification time of models.txt and every file it names.
+/// When one changes only the targets whose file (or entry) changed are parsed again, the others are
+/// copied from the last rig, and the new rig and its vertex major deltas are handed to the render
+/// thread through poll. The render thread then only has to send what differs (see changedRanges),
+/// so tweaking a shape on a large rig costs the parse of one file rather than a restart.
+/// A changed base mesh or DeltaEpsilon changes every delta, so then the whole rig is loaded again, still
+/// on the worker. The obj parser and rig loader are passed in so the library doesn't need NGL. A file that
+/// fails to parse (an editor part way through saving it) is tried again on the next poll. Changes are
+/// measured against the last rig the render thread accepted, until it does no more are looked for.
+//----------------------------------------------------------------------------------------------------------------------
+class RigReloader
+{
+  public:
+    /// @brief reads the obj positions and normals as interleaved xyz, false on failure
+    using Parser =
+        std::function<bool(const std::string &_path, std::vector<float> &_positions, std::vector<float> &_normals)>;
+    /// @brief builds the whole rig from models.txt, false with _error set on failure
+    using Loader = std::function<bool(const ModelFile &_models, BlendRig &_rig, std::string &_error)>;
+    /// @brief a rebuilt rig
+    struct Result
+    {
+      ModelFile models;
+      BlendRig rig;
+      /// @brief rig.targets() as BlendTargetSet::buildVertexMajor lays them out
+      std::vector<int32_t> offsets;
+      std::vector<float> entries;
+      /// @brief the targets (new indices) that were parsed again
+      std::vector<size_t> parsed;
+      /// @brief the target names or their order changed, the weights and shaders need rebuilding
+      bool targetsChanged = false;
+      /// @brief the base mesh or epsilon changed, every target was loaded again
+      bool fullReload = false;
+      /// @brief time taken to parse and rebuild
+      double ms = 0.0;
+      /// @brief why the last change couldn't be loaded, offsets is empty if there is no new rig with it
+      std::string error;
+    };
+    RigReloader(Parser _parser, Loader _loader);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief dtor stops the worker
+    //----------------------------------------------------------------------------------------------------------------------
+    ~RigReloader();
+    RigReloader(const RigReloader &) = delete;
+    RigReloader &operator=(const RigReloader &) = delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start watching, changes are measured against _rig
+    /// @param [in] _models the parsed models.txt _rig was built from
+    /// @param [in] _rig the rig the render thread has now
+    /// @param [in] _intervalMs how often the files are checked
+    //----------------------------------------------------------------------------------------------------------------------
+    void start(const ModelFile &_models, const BlendRig &_rig, unsigned int _intervalMs = 250);
+    void stop();
+    bool isWatching() const { return m_thread.joinable(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief take the latest rebuild, called by the render thread
+    /// @returns false if nothing has changed since the last call
+    //----------------------------------------------------------------------------------------------------------------------
+    bool poll(Result &_result);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the rig from the last poll is in use, later changes are measured against it
+    //----------------------------------------------------------------------------------------------------------------------
+    void accept();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief check the files now rather than at the next interval, the work is still done on the worker
+    //----------------------------------------------------------------------------------------------------------------------
+    void check();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the byte ranges that differ between two buffers, compared in _block sized pieces and with
+    /// runs at most a block apart merged so the ranges can each be one glBufferSubData
+    /// @param [out] _ranges (offset, size) pairs
+    //----------------------------------------------------------------------------------------------------------------------
+    static void changedRanges(const void *_old, const void *_new, size_t _bytes, size_t _block,
+                              std::vector<std::pair<size_t, size_t>> &_ranges);
+
+  private:
+    /// @brief what a rig was built from
+    struct Source
+    {
+      ModelFile models;
+      BlendRig rig;
+      /// @brief rig without its targets, the start of every rebuild
+      BlendRig base;
+      uint64_t modelsStamp = 0;
+      uint64_t baseStamp = 0;
+      /// @brief the stamp of each target's file by target name
+      std::unordered_map<std::string, uint64_t> stamps;
+    };
+    void worker();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief rebuild if anything changed, into m_next
+    /// @returns false if nothing did
+    //----------------------------------------------------------------------------------------------------------------------
+    bool rebuild(Result &_result);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief load the whole rig again when the base or epsilon changed
+    /// @param [out] _error why it couldn't be loaded
+    //----------------------------------------------------------------------------------------------------------------------
+    bool reloadAll(ModelFile &_models, uint64_t _modelsStamp, uint64_t _baseStamp, Result &_result,
+                   std::string &_error);
+    Parser m_parser;
+    Loader m_loader;
+    /// @brief the rig the render thread has, only used by the worker unless a rebuild is waiting
+    Source m_current;
+    /// @brief the last rig handed over, it becomes m_current when the render thread accepts it
+    Source m_next;
+    unsigned int m_intervalMs = 250;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+    bool m_checkNow = false;
+    bool m_ready = false;
+    /// @brief m_next has been handed over and not accepted yet, nothing is rebuilt until it is
+    bool m_waiting = false;
+    Result m_result;
+    /// @brief the last error published, the same one isn't published again every poll
+    std::string m_lastError;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SOAVEC3_H_
+#define SOAVEC3_H_
+#include <cstddef>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SoAVec3.h
+/// @brief a simple structure of arrays for xyz data, used by the CPU side of the rig so the inner
+/// loops can work on 4 or 8 values at a time
+//----------------------------------------------------------------------------------------------------------------------
+struct SoAVec3
+{
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  void resize(size_t _n)
+  {
+    x.resize(_n);
+    y.resize(_n);
+    z.resize(_n);
+  }
+  void reserve(size_t _n)
+  {
+    x.reserve(_n);
+    y.reserve(_n);
+    z.reserve(_n);
+  }
+  void push_back(float _x, float _y, float _z)
+  {
+    x.push_back(_x);
+    y.push_back(_y);
+    z.push_back(_z);
+  }
+  size_t size() const { return x.size(); }
+  /// @brief fill from interleaved xyz triples
+  void fromInterleaved(const float *_xyz, size_t _n)
+  {
+    resize(_n);
+    for (size_t i = 0; i < _n; ++i)
+    {
+      x[i] = _xyz[i * 3];
+      y[i] = _xyz[i * 3 + 1];
+      z[i] = _xyz[i * 3 + 2];
+    }
+  }
+  /// @brief write out as interleaved xyz triples, _xyz must hold 3*size() floats
+  void toInterleaved(float *_xyz) const
+  {
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+      _xyz[i * 3] = x[i];
+      _xyz[i * 3 + 1] = y[i];
+      _xyz[i * 3 + 2] = z[i];
+    }
+  }
+};
+
+#endif
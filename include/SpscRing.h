@@ -0,0 +1,69 @@
+#ifndef SPSCRING_H_
+#define SPSCRING_H_
+#include <atomic>
+#include <cstddef>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SpscRing.h
+/// @brief a lock free ring buffer for one producer thread and one consumer thread
+/// @class SpscRing
+/// @brief the slots are allocated once up front and reused, the producer fills the slot returned by
+/// beginPush in place and publishes it with endPush, the consumer reads front and hands the slot back
+/// with pop. Head and tail live on their own cache lines so the two threads don't share one.
+//----------------------------------------------------------------------------------------------------------------------
+template <typename T>
+class SpscRing
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _capacity number of slots, rounded up to a power of two
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit SpscRing(size_t _capacity = 8)
+    {
+      size_t size = 2;
+      while (size < _capacity)
+        size <<= 1;
+      m_slots.resize(size);
+      m_mask = size - 1;
+    }
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+    size_t capacity() const { return m_slots.size(); }
+    /// @brief direct access to every slot, only safe before either thread starts (to preallocate them)
+    std::vector<T> &slots() { return m_slots; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief producer, the next free slot
+    /// @returns nullptr if the ring is full
+    //----------------------------------------------------------------------------------------------------------------------
+    T *beginPush()
+    {
+      size_t head = m_head.load(std::memory_order_relaxed);
+      if (head - m_tail.load(std::memory_order_acquire) == m_slots.size())
+        return nullptr;
+      return &m_slots[head & m_mask];
+    }
+    /// @brief producer, publish the slot from beginPush
+    void endPush() { m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief consumer, the oldest published slot
+    /// @returns nullptr if the ring is empty
+    //----------------------------------------------------------------------------------------------------------------------
+    T *front()
+    {
+      size_t tail = m_tail.load(std::memory_order_relaxed);
+      if (tail == m_head.load(std::memory_order_acquire))
+        return nullptr;
+      return &m_slots[tail & m_mask];
+    }
+    /// @brief consumer, give the slot from front back to the producer
+    void pop() { m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  private:
+    std::vector<T> m_slots;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ThreadPool.h
+/// @brief a fixed size pool of worker threads
+/// @class ThreadPool
+/// @brief tasks are queued with submit and the result comes back through a std::future, so callers
+/// that need results in a given order just keep the futures in that order
+//----------------------------------------------------------------------------------------------------------------------
+class ThreadPool
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _numThreads how many workers, 0 means one per hardware thread
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit ThreadPool(size_t _numThreads = 0);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief dtor finishes any queued tasks then joins the workers
+    //----------------------------------------------------------------------------------------------------------------------
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief queue a task
+    /// @returns a future for the result of _f
+    //----------------------------------------------------------------------------------------------------------------------
+    template <typename F>
+    auto submit(F &&_f) -> std::future<decltype(_f())>
+    {
+      using Result = decltype(_f());
+      // packaged_task is move only and std::function needs to copy so share it
+      auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(_f));
+      auto future = task->get_future();
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.emplace_back([task]() { (*task)(); });
+      }
+      m_wake.notify_one();
+      return future;
+    }
+    size_t size() const { return m_threads.size(); }
+
+  private:
+    void worker();
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef WEIGHTBUFFER_H_
+#define WEIGHTBUFFER_H_
+#include <ngl/Types.h>
+#include <cstddef>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file WeightBuffer.h
+/// @brief shader storage buffer used to send the blend weights to the GPU in one write per frame
+/// @class WeightBuffer
+/// @brief the buffer is split into a ring of segments, each frame writes the next segment and binds
+/// that range so we never write over data a draw still in flight is reading. On GL 4.4 and above the
+/// buffer is persistently mapped and written with a memcpy, each segment has a fence so we only wait
+/// if the GPU is more than numSegments frames behind. Older contexts fall back to glBufferSubData
+/// into the ring. As the shader uses an unsized array there is no limit on the number of weights
+/// beyond the buffer size. Contexts without storage buffers (before 4.3) use a ring of R32F texture
+/// buffers instead, one buffer per segment as glTexBufferRange is 4.3 as well.
+/// The same ring also streams whole meshes as a vertex buffer (Target::ArrayBuffer), nothing is bound
+/// then and the caller points its attributes at offset() of buffer() after each upload.
+//----------------------------------------------------------------------------------------------------------------------
+class WeightBuffer
+{
+  public:
+    enum class Target
+    {
+      StorageBuffer,
+      TextureBuffer,
+      ArrayBuffer
+    };
+    WeightBuffer() = default;
+    ~WeightBuffer();
+    WeightBuffer(const WeightBuffer &) = delete;
+    WeightBuffer &operator=(const WeightBuffer &) = delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief create (or re-create) the buffer, needs a current GL context
+    /// @param [in] _count the maximum number of floats written per frame
+    /// @param [in] _binding the shader storage binding point the shader block uses, or the texture
+    /// unit for a texture buffer, unused for an array buffer
+    /// @param [in] _numSegments how many frames can be in flight before we wait
+    /// @param [in] _target storage buffer or texture buffer
+    //----------------------------------------------------------------------------------------------------------------------
+    void create(size_t _count, GLuint _binding, size_t _numSegments = 3, Target _target = Target::StorageBuffer);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write the weights into the next segment and bind it ready for drawing
+    //----------------------------------------------------------------------------------------------------------------------
+    void upload(const float *_data, size_t _count);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief call once the draws using the current segment have been issued
+    //----------------------------------------------------------------------------------------------------------------------
+    void fence();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief fence the segment at _offset again after drawing it once more, without moving on, so an
+    /// ArrayBuffer segment can be drawn for as long as there is nothing new to write
+    //----------------------------------------------------------------------------------------------------------------------
+    void refence(size_t _offset);
+    size_t capacity() const { return m_capacity; }
+    bool isPersistent() const { return m_mapped != nullptr; }
+    /// @brief the buffer and the byte offset of the segment the last upload wrote, for Target::ArrayBuffer
+    GLuint buffer() const { return m_buffer; }
+    size_t offset() const { return m_current * m_segmentSize; }
+
+  private:
+    void destroy();
+    GLuint m_buffer = 0;
+    GLuint m_binding = 0;
+    /// @brief GL_SHADER_STORAGE_BUFFER or GL_ARRAY_BUFFER for the single buffer ring
+    GLenum m_target = GL_SHADER_STORAGE_BUFFER;
+    size_t m_capacity = 0;
+    size_t m_segmentSize = 0;
+    size_t m_current = 0;
+    unsigned char *m_mapped = nullptr;
+    std::vector<GLsync> m_fences;
+    /// @brief the per segment buffers and textures for Target::TextureBuffer
+    std::vector<GLuint> m_texBuffers;
+    std::vector<GLuint> m_textures;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef WEIGHTSOLVER_H_
+#define WEIGHTSOLVER_H_
+#include "BlendRig.h"
+#include "WeightProgram.h"
+#include "WorkStealingPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file WeightSolver.h
+/// @brief fits the weights of a rig to a scanned or tracked face
+/// @class WeightSolver
+/// @brief finds the weights in [0, 1] whose blend is closest (least squares over the positions) to a
+/// whole target mesh or to a few marker vertices, with an optional L1 penalty that favours fewer active
+/// targets. With D the delta rows of the fitted vertices and y the offset of the scan from the base
+/// this is min |D w - y|^2 + sparsity * sum(w). D^T D only depends on the rig and the marker set so it
+/// is worked out once in setRig / setMarkers, a solve is then D^T y (one pass over the sparse deltas of
+/// the fitted vertices) and projected coordinate descent on the N x N system, warm started from the
+/// weights passed in, which is tens of microseconds for a tracked frame.
+/// Positions are in obj order (as ObjTargetReader reads them) rather than per unique vertex so a seam
+/// vertex isn't counted twice. Targets that a WeightProgram drives (correctives and in-betweens) aren't
+/// linear in the weights that are set so they are held at 0, the result is the weights as set.
+//----------------------------------------------------------------------------------------------------------------------
+class WeightSolver
+{
+  public:
+    struct Settings
+    {
+      /// @brief L1 penalty on the weights, in squared distance per unit of weight
+      float sparsity = 0.0f;
+      /// @brief added to the diagonal so targets the fitted vertices don't see stay at 0
+      float damping = 1e-6f;
+      size_t maxIterations = 100;
+      /// @brief stop once no weight moves more than this in an iteration
+      float tolerance = 1e-5f;
+    };
+    struct Result
+    {
+      /// @brief root mean square distance of the fitted vertices from the scan
+      float rmsError = 0.0f;
+      size_t iterations = 0;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief precompute the normal equations for a rig, this fits every obj position until setMarkers
+    /// @param [in] _program targets it drives are left out of the fit, may be nullptr
+    //----------------------------------------------------------------------------------------------------------------------
+    void setRig(const BlendRig &_rig, const WeightProgram *_program = nullptr);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief fit only these obj positions (0 based) from now on, empty for all of them again
+    /// @returns false if an index is past the end of the base mesh, the marker set is then unchanged
+    //----------------------------------------------------------------------------------------------------------------------
+    bool setMarkers(const std::vector<uint32_t> &_positions);
+    void setSettings(const Settings &_s) { m_settings = _s; }
+    const Settings &settings() const { return m_settings; }
+    size_t numTargets() const { return m_numTargets; }
+    /// @brief how many xyz positions solve expects, the markers or every obj position
+    size_t numInputs() const { return m_rows.size(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief fit one frame
+    /// @param [in] _positions numInputs() interleaved xyz positions
+    /// @param [in,out] _weights numTargets() weights, the starting point (zeros or the last frame) and the result
+    /// @note the working vectors are kept between calls so a frame doesn't allocate, one solver per thread
+    //----------------------------------------------------------------------------------------------------------------------
+    Result solve(const float *_positions, float *_weights);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief fit a sequence in parallel, each worker takes runs of frames and starts each frame from the
+    /// one before it
+    /// @param [in] _frames _numFrames sets of numInputs() xyz positions
+    /// @param [out] _weights _numFrames sets of numTargets() weights
+    /// @param [out] _results one per frame, may be nullptr
+    //----------------------------------------------------------------------------------------------------------------------
+    void solveSequence(const float *_frames, size_t _numFrames, float *_weights, WorkStealingPool &_pool,
+                       Result *_results = nullptr) const;
+
+  private:
+    /// @brief D^T y, the weights and A w as they are solved, kept per thread like MeshBaker's evaluators
+    struct Scratch
+    {
+      std::vector<double> rhs;
+      std::vector<double> w;
+      std::vector<double> aw;
+    };
+    Result solve(const float *_positions, float *_weights, Scratch &_scratch) const;
+    /// @brief the gram matrix and the base positions of m_rows
+    void buildNormalEquations();
+    Settings m_settings;
+    size_t m_numTargets = 0;
+    /// @brief the delta of every target at each obj position, position major: (target, dx, dy, dz)
+    struct Delta
+    {
+      uint32_t target;
+      float x;
+      float y;
+      float z;
+    };
+    std::vector<uint32_t> m_deltaOffsets;
+    std::vector<Delta> m_deltas;
+    std::vector<float> m_basePositions;
+    std::vector<bool> m_fixed;
+    /// @brief the obj positions being fitted and their base positions
+    std::vector<uint32_t> m_rows;
+    std::vector<float> m_rowBase;
+    /// @brief D^T D of m_rows, N x N, the damping is added as it is solved so it can change without a rebuild
+    std::vector<double> m_gram;
+    /// @brief for solve, solveSequence has one for each worker
+    Scratch m_scratch;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef WEIGHTSTREAM_H_
+#define WEIGHTSTREAM_H_
+#include "SpscRing.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file WeightStream.h
+/// @brief live weight frames from another process
+/// @class WeightStream
+/// @brief a background thread reads weight packets from stdin or a unix domain socket and pushes them
+/// through an SpscRing to the render thread, which only ever wants the newest one (latest frame wins, if
+/// the render thread stalls and the ring fills the newest frame is held back rather than thrown away).
+/// Each packet is a PacketHeader followed by numWeights floats in target order, packets are read in
+/// whatever chunks arrive so a slow sender never stalls the thread mid packet. A capture file is just
+/// the packets one after another, so recording a stream is a tee. Not available on windows.
+//----------------------------------------------------------------------------------------------------------------------
+class WeightStream
+{
+  public:
+    struct PacketHeader
+    {
+      char magic[4];
+      uint32_t numWeights;
+      uint64_t sequence;
+      /// @brief steady clock (CLOCK_MONOTONIC) nanoseconds when the sender wrote the packet, shared by
+      /// every process on the machine so the receiver can measure the latency
+      int64_t sendTime;
+    };
+    struct Frame
+    {
+      std::vector<float> weights;
+      uint64_t sequence = 0;
+      int64_t sendTime = 0;
+      /// @brief steady clock nanoseconds when the reader thread had the whole packet
+      int64_t receiveTime = 0;
+    };
+    static constexpr char c_magic[4] = {'F', 'W', 'P', 'K'};
+    /// @brief packets claiming more weights than this are treated as garbage
+    static constexpr uint32_t c_maxWeights = 1 << 16;
+
+    WeightStream() = default;
+    ~WeightStream();
+    WeightStream(const WeightStream &) = delete;
+    WeightStream &operator=(const WeightStream &) = delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start reading, any current stream is stopped first
+    /// @param [in] _source - for stdin otherwise the path of a unix socket to listen on, a stale socket
+    /// file is replaced. The socket takes one sender at a time and waits for the next when it goes.
+    /// @param [in] _numWeights the rig's target count, longer packets are cut and shorter ones zero filled
+    /// @returns false if the socket can't be created
+    //----------------------------------------------------------------------------------------------------------------------
+    bool open(const std::string &_source, size_t _numWeights);
+    void stop();
+    bool isOpen() const { return m_thread.joinable(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief render thread, take every frame that has arrived and keep the newest
+    /// @param [out] _frame the newest frame, its weights are swapped with a ring slot so nothing allocates
+    /// @returns false if nothing arrived since the last call
+    //----------------------------------------------------------------------------------------------------------------------
+    bool latest(Frame &_frame);
+    uint64_t received() const { return m_received.load(std::memory_order_relaxed); }
+    /// @brief frames the reader threw away because the ring was full (the render thread stalled) and a
+    /// newer frame arrived before there was room
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    /// @brief frames that arrived but were superseded before the render thread got to them
+    uint64_t skipped() const { return m_skipped; }
+    /// @brief senders dropped for sending something that isn't a packet
+    uint64_t malformed() const { return m_malformed.load(std::memory_order_relaxed); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief steady clock in nanoseconds, the clock used for sendTime and receiveTime
+    //----------------------------------------------------------------------------------------------------------------------
+    static int64_t now();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write one packet, retrying short writes
+    /// @returns false if the descriptor fails (e.g. the reader went away)
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool writePacket(int _fd, uint64_t _sequence, int64_t _sendTime, const float *_weights, uint32_t _numWeights);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief blocking read of one packet, used to read capture files
+    /// @returns false at the end of the input or if it isn't a packet
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool readPacket(int _fd, PacketHeader &_header, std::vector<float> &_weights);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief connect to a socket made by open
+    /// @returns the descriptor or -1
+    //----------------------------------------------------------------------------------------------------------------------
+    static int connect(const std::string &_path);
+
+  private:
+    void reader();
+    /// @brief parse the complete packets in m_pending
+    /// @returns false if the data isn't a packet stream
+    bool consume();
+    /// @brief move m_overflow into the ring
+    /// @returns false if it is still full
+    bool flushOverflow();
+    SpscRing<Frame> m_ring{16};
+    std::thread m_thread;
+    size_t m_numWeights = 0;
+    int m_fd = -1;
+    int m_listenFd = -1;
+    std::string m_socketPath;
+    /// @brief writing to this wakes the reader out of poll to stop it
+    int m_wakeFds[2] = {-1, -1};
+    std::vector<unsigned char> m_pending;
+    /// @brief the newest frame when the ring is full, reader thread only
+    Frame m_overflow;
+    bool m_hasOverflow = false;
+    std::atomic<uint64_t> m_received{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_malformed{0};
+    uint64_t m_skipped = 0;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef WORKSTEALINGPOOL_H_
+#define WORKSTEALINGPOOL_H_
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file WorkStealingPool.h
+/// @brief worker threads for loops whose iterations don't all cost the same
+/// @class WorkStealingPool
+/// @brief parallelFor gives each worker an even share of the index range. Workers take indices from
+/// the front of their own range and when it runs out steal the back half of the largest range left,
+/// so a worker that drew cheap iterations (e.g. frames with few active targets) helps with the
+/// expensive ones instead of sitting idle. Unlike ThreadPool each call passes the worker index so
+/// callers can keep per worker scratch data without locking.
+//----------------------------------------------------------------------------------------------------------------------
+class WorkStealingPool
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor
+    /// @param [in] _numThreads how many workers, 0 means one per hardware thread
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit WorkStealingPool(size_t _numThreads = 0);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+    size_t size() const { return m_threads.size(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief run _task(index, worker) for every index in [0, _count) and wait for them all
+    /// @param [in] _task worker is in [0, size()), calls with the same worker never overlap
+    //----------------------------------------------------------------------------------------------------------------------
+    void parallelFor(size_t _count, const std::function<void(size_t, size_t)> &_task);
+    /// @brief how many ranges were stolen by the last parallelFor
+    uint64_t steals() const { return m_steals.load(std::memory_order_relaxed); }
+
+  private:
+    /// @brief what is left of a worker's share, on its own cache line
+    struct alignas(64) Range
+    {
+      std::mutex mutex;
+      size_t begin = 0;
+      size_t end = 0;
+    };
+    void worker(size_t _index);
+    bool next(size_t _worker, size_t &_index);
+    std::vector<std::thread> m_threads;
+    std::unique_ptr<Range[]> m_ranges;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_finished;
+    const std::function<void(size_t, size_t)> *m_task = nullptr;
+    /// @brief bumped for each parallelFor so the workers know there is new work
+    uint64_t m_generation = 0;
+    size_t m_busy = 0;
+    bool m_stop = false;
+    std::atomic<uint64_t> m_steals{0};
+};
+
+#endif
@@ -0,0 +1,29 @@
+#version 410 core
+// draws the eyes of every head in the crowd with one instanced draw, two instances per head
+layout (location =0) in vec3 inVert;
+layout (location =1) in vec3 inNormal;
+
+uniform mat4 V;
+uniform mat4 P;
+// where each eye sits on the head, left then right
+uniform mat4 eyeTX[2];
+// the model matrix of each head, four texels per matrix (see MORPH_INSTANCED in PerFragASDVert.glsl)
+uniform samplerBuffer instanceTBO;
+
+out vec3 position;
+out vec3 normal;
+
+mat4 instanceMatrix(int _i)
+{
+	return mat4(texelFetch(instanceTBO,4*_i),texelFetch(instanceTBO,4*_i+1),
+							texelFetch(instanceTBO,4*_i+2),texelFetch(instanceTBO,4*_i+3));
+}
+
+void main()
+{
+	mat4 MV=V*instanceMatrix(gl_InstanceID/2)*eyeTX[gl_InstanceID%2];
+	// the eyes are scaled unevenly so the normals need the inverse transpose
+	normal=normalize(transpose(inverse(mat3(MV)))*inNormal);
+	position=vec3(MV*vec4(inVert,1.0));
+	gl_Position=P*vec4(position,1.0);
+}
@@ -0,0 +1,21 @@
+#version 410 core
+// draws the mesh the compute pre-pass has already blended (see MORPH_COMPUTE in PerFragASDVert.glsl)
+layout (location =0) in vec3 inVert;
+layout (location =1) in vec3 inNormal;
+
+// transform matrix values
+uniform mat4 MVP;
+uniform mat3 normalMatrix;
+uniform mat4 MV;
+
+out vec3 position;
+out vec3 normal;
+
+void main()
+{
+	// the blended normal isn't unit length yet
+	normal = normalize( normalMatrix * inNormal);
+	// now calculate the eye cord position for the frag stage
+	position = vec3(MV * vec4(inVert,1.0));
+	gl_Position = MVP*vec4(inVert,1.0);
+}
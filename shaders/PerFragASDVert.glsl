@@ -1,62 +1,312 @@
-#version 330 core
+#version 410 core
 // this is base on http://http.developer.nvidia.com/GPUGems3/gpugems3_ch03.html
+
+// this file is a template, MorphShaderSource replaces the #version (4.3 with storage buffers, the 4.1
+// above everywhere else) and adds these for the loaded rig
+#ifndef NUM_TARGETS
+#define NUM_TARGETS 1
+#endif
+
+#ifdef MORPH_COMPUTE
+// the compute pre-pass blends each vertex once into the deformed buffer which is then drawn as is
+layout (local_size_x=64) in;
+// both buffers are laid out as the VAO, all the positions then all the normals
+layout (std430, binding=2) readonly buffer BaseMesh
+{
+	float base[];
+};
+layout (std430, binding=3) writeonly buffer DeformedMesh
+{
+	float deformed[];
+};
+uniform int numVerts;
+vec3 baseVert;
+vec3 baseNormal;
+#else
 layout (location =0) in vec3 baseVert;
 layout (location =1) in vec3 baseNormal;
 
+#ifdef MORPH_INSTANCED
+// crowd drawing, each instance has its own model matrix and weights
+uniform mat4 V;
+uniform mat4 P;
+// four texels per model matrix, one column each
+uniform samplerBuffer instanceTBO;
+mat4 instanceMatrix(int _i)
+{
+	return mat4(texelFetch(instanceTBO,4*_i),texelFetch(instanceTBO,4*_i+1),
+							texelFetch(instanceTBO,4*_i+2),texelFetch(instanceTBO,4*_i+3));
+}
+// the heads grouped by level of detail, each level is its own draw starting at firstHead
+uniform isamplerBuffer headTBO;
+uniform int firstHead;
+#else
 // transform matrix values
 uniform mat4 MVP;
 uniform mat3 normalMatrix;
 uniform mat4 MV;
+#endif
+#endif
+
+#ifdef MORPH_INSTANCED
+// the weights of every instance one after another, main points this at the head's
+int weightOffset=0;
+#else
+const int weightOffset=0;
+#endif
+
+#ifdef WEIGHTS_IN_TBO
+// no storage buffers before 4.3, one float per target
+uniform samplerBuffer weightTBO;
+float weight(int _i)
+{
+	return texelFetch(weightTBO,weightOffset+_i).r;
+}
+#else
+// all of the weights arrive in one buffer write per frame (see WeightBuffer), the array is unsized
+// so the number of targets isn't limited by the uniform space
+layout (std430, binding=0) readonly buffer Weights
+{
+	float weights[];
+};
+float weight(int _i)
+{
+	return weights[weightOffset+_i];
+}
+#endif
+
+// the targets with a non zero weight as (target index, weight) in target order, see ActiveWeights
+uniform int numActive;
+// when only a few targets are active it is cheaper to search the row for each than walk all of it
+uniform bool useActiveList;
+#ifdef WEIGHTS_IN_TBO
+uniform samplerBuffer activeTBO;
+vec2 activeTarget(int _i)
+{
+	return vec2(texelFetch(activeTBO,2*_i).r,texelFetch(activeTBO,2*_i+1).r);
+}
+#else
+layout (std430, binding=1) readonly buffer ActiveTargets
+{
+	vec2 active[];
+};
+vec2 activeTarget(int _i)
+{
+	return active[_i];
+}
+#endif
+
 
-#define meshOffset 28
-#define numWeights 14
-uniform float weights[numWeights];
 
+#ifdef DELTAS_SNORM16
+// sparse deltas, one texel per entry (dP.xyz, target index) as int16 with dP scaled by targetScale
+uniform isamplerBuffer TBO;
+// the largest position delta component of each target
+uniform samplerBuffer targetScale;
+vec4 entryPosition(int _i)
+{
+	ivec4 e=texelFetch(TBO,_i);
+	float step=texelFetch(targetScale,e.w).r/32767.0;
+	return vec4(vec3(e.xyz)*step,float(e.w));
+}
+float entryTarget(int _i)
+{
+	return float(texelFetch(TBO,_i).w);
+}
+#ifdef MORPH_TOPOLOGY_NORMALS
+// the normals are rebuilt from the faces afterwards (RenormaliseComp.glsl) so there are no normal deltas
+vec3 entryNormal(int _i)
+{
+	return vec3(0.0);
+}
+#else
+// octahedral encoded normal of the target for each entry, the delta is that minus the base normal
+uniform isamplerBuffer normalTBO;
+vec3 octDecode(vec2 _e)
+{
+	vec3 n=vec3(_e,1.0-abs(_e.x)-abs(_e.y));
+	if (n.z<0.0)
+		n.xy=(1.0-abs(n.yx))*vec2(n.x>=0.0 ? 1.0 : -1.0,n.y>=0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+vec3 entryNormal(int _i)
+{
+	return octDecode(max(vec2(texelFetch(normalTBO,_i).xy)/32767.0,vec2(-1.0)))-baseNormal;
+}
+#endif
+#else
+#ifdef MORPH_TOPOLOGY_NORMALS
+// sparse deltas, one texel per entry (dP.xyz, target index) as float or half, the normals are rebuilt
+// from the faces afterwards (RenormaliseComp.glsl)
+uniform samplerBuffer TBO;
+vec4 entryPosition(int _i)
+{
+	return texelFetch(TBO,_i);
+}
+float entryTarget(int _i)
+{
+	return texelFetch(TBO,_i).w;
+}
+vec3 entryNormal(int _i)
+{
+	return vec3(0.0);
+}
+#else
+// sparse deltas, two texels per entry (dP.xyz, target index) then (dN.xyz, unused) as float or half
+uniform samplerBuffer TBO;
+vec4 entryPosition(int _i)
+{
+	return texelFetch(TBO,2*_i);
+}
+float entryTarget(int _i)
+{
+	return texelFetch(TBO,2*_i).w;
+}
+vec3 entryNormal(int _i)
+{
+	return texelFetch(TBO,2*_i+1).xyz;
+}
+#endif
+#endif
+// start of the entries for each vertex, the row for vertex v is [deltaOffsets[v], deltaOffsets[v+1])
+// indexed by the unique vertex id
+uniform isamplerBuffer deltaOffsets;
+
+// sum of the weighted deltas for a vertex
+void blend(int _v, out vec3 o_weightVert, out vec3 o_weightNorm)
+{
+	vec3 weightNorm=vec3(0.0f);
+	vec3 weightVert=vec3(0.0f);
+	// only the targets that move this vertex are stored
+	int start=texelFetch(deltaOffsets,_v).r;
+	int end=texelFetch(deltaOffsets,_v+1).r;
+	if (useActiveList)
+	{
+		// the row and the active list are both in target order so each search starts where the last ended
+		int lo=start;
+		for (int a=0; a<numActive && lo<end; ++a)
+		{
+			vec2 t=activeTarget(a);
+			int hi=end;
+			while (lo<hi)
+			{
+				int mid=(lo+hi)/2;
+				if (entryTarget(mid)<t.x)
+					lo=mid+1;
+				else
+					hi=mid;
+			}
+			if (lo<end)
+			{
+				vec4 dP=entryPosition(lo);
+				if (dP.w==t.x)
+				{
+					weightVert+= dP.xyz*t.y;
+					weightNorm+= entryNormal(lo)*t.y;
+					++lo;
+				}
+			}
+		}
+	}
+	else
+	{
+#ifdef MORPH_UNROLLED
+		// a row can't be longer than the number of targets, with a constant bound the loop can be unrolled
+		for (int k=0; k<NUM_TARGETS; ++k)
+		{
+			int i=start+k;
+			if (i>=end)
+				break;
+			vec4 dP=entryPosition(i);
+			float w=weight(int(dP.w));
+			weightVert+= dP.xyz*w;
+			weightNorm+= entryNormal(i)*w;
+		}
+#else
+		for (int i=start; i<end; ++i)
+		{
+			vec4 dP=entryPosition(i);
+			float w=weight(int(dP.w));
+			// with a lot of targets most weights are zero, don't fetch the normal for those
+			if (w==0.0)
+				continue;
+			weightVert+= dP.xyz*w;
+			weightNorm+= entryNormal(i)*w;
+		}
+#endif
+	}
 
+	o_weightVert=weightVert;
+	o_weightNorm=weightNorm;
+}
 
+#ifdef MORPH_COMPUTE
+void main()
+{
+	int v=int(gl_GlobalInvocationID.x);
+	if (v>=numVerts)
+		return;
+	baseVert=vec3(base[3*v],base[3*v+1],base[3*v+2]);
+	int n=3*(numVerts+v);
+	baseNormal=vec3(base[n],base[n+1],base[n+2]);
+	vec3 weightVert;
+	vec3 weightNorm;
+	blend(v,weightVert,weightNorm);
+	vec3 finalP=baseVert+weightVert;
+	vec3 finalN=baseNormal+weightNorm;
+	deformed[3*v]=finalP.x;
+	deformed[3*v+1]=finalP.y;
+	deformed[3*v+2]=finalP.z;
+	deformed[n]=finalN.x;
+	deformed[n+1]=finalN.y;
+	deformed[n+2]=finalN.z;
+}
+#elif defined(MORPH_INSTANCED)
+out vec3 position;
+out vec3 normal;
+void main()
+{
+	int head=texelFetch(headTBO,firstHead+gl_InstanceID).r;
+	weightOffset=head*NUM_TARGETS;
+	vec3 weightVert;
+	vec3 weightNorm;
+	blend(gl_VertexID,weightVert,weightNorm);
+	vec3 finalP=baseVert+weightVert;
+	// with MORPH_TOPOLOGY_NORMALS there are no normal deltas and the renormalise pass only runs for the
+	// single head, so the crowd shades with the base normals
+	vec3 finalN=baseNormal+weightNorm;
+	// crowd matrices only rotate, translate and scale uniformly so the upper 3x3 can transform the normal
+	mat4 MV=V*instanceMatrix(head);
+	normal=normalize(mat3(MV)*finalN);
+	position=vec3(MV*vec4(finalP,1.0));
+	gl_Position=P*vec4(position,1.0);
+}
+#else
 out vec3 position;
 out vec3 normal;
 out vec4 debugColour;
-uniform samplerBuffer TBO;
 void main()
 {
 
 	vec3  finalN;
 	vec3  finalP;
-	vec3 weightNorm=vec3(0.0f);
-	vec3 weightVert=vec3(0.0f);
-	// do the verts first
-	int i;
-	for (i=0; i<numWeights; ++i)
-	{
-		weightVert+= (texelFetch(TBO,int(meshOffset*gl_VertexID+i)).xyz*weights[i]);
-	}
+	vec3 weightNorm;
+	vec3 weightVert;
+	// the mesh is drawn indexed so gl_VertexID is the unique vertex id
+	blend(gl_VertexID,weightVert,weightNorm);
 
 	finalP= baseVert+weightVert;
 
-	for (; i<meshOffset; ++i)
-	{
-		weightNorm+= (texelFetch(TBO,int(meshOffset*gl_VertexID+i)).xyz*weights[i-numWeights]);
-	}
-
 	finalN= baseNormal+weightNorm;
 
 	// then normalize and mult by normal matrix for shading
 	normal = normalize( normalMatrix * finalN);
 	// now calculate the eye cord position for the frag stage
-	position = vec3(MV * vec4(baseVert,1.0));
+	position = vec3(MV * vec4(finalP,1.0));
 
 	//debugColour=vec4(weight3*poseVert3,1);
 	// Convert position to clip coordinates and pass along
 	gl_Position = MVP*vec4(finalP,1.0);
 
 }
-
-
-
-
-
-
-
-
-
+#endif
@@ -0,0 +1,80 @@
+#version 430 core
+// second compute pass for Normals,topology (see NormalRebuilder), the blend pass has written the
+// deformed positions and the base normals, this rebuilds the normals of the vertices the active targets
+// can change from the faces around them
+layout (local_size_x=64) in;
+// both laid out as the VAO, all the positions then all the normals
+layout (std430, binding=2) readonly buffer BaseMesh
+{
+	float base[];
+};
+layout (std430, binding=3) buffer DeformedMesh
+{
+	float deformed[];
+};
+// the faces around vertex v are faces[faceOffsets[v]] to faces[faceOffsets[v+1]]
+layout (std430, binding=4) readonly buffer FaceOffsets
+{
+	int faceOffsets[];
+};
+layout (std430, binding=5) readonly buffer Faces
+{
+	uint faces[];
+};
+// three corners per face
+layout (std430, binding=6) readonly buffer Corners
+{
+	uint corners[];
+};
+// unit sum of the face normals around each vertex at rest, xyz
+layout (std430, binding=7) readonly buffer RestNormals
+{
+	float restNormals[];
+};
+// the vertices to rebuild this frame
+layout (std430, binding=8) readonly buffer Touched
+{
+	uint touched[];
+};
+uniform int numVerts;
+uniform int numTouched;
+
+vec3 deformedPosition(uint _v)
+{
+	return vec3(deformed[3*_v],deformed[3*_v+1],deformed[3*_v+2]);
+}
+
+void main()
+{
+	int t=int(gl_GlobalInvocationID.x);
+	if (t>=numTouched)
+		return;
+	uint v=touched[t];
+	// area weighted, the cross product isn't normalized
+	vec3 d=vec3(0.0);
+	for (int i=faceOffsets[v]; i<faceOffsets[v+1]; ++i)
+	{
+		uint f=3*faces[i];
+		vec3 a=deformedPosition(corners[f]);
+		d+=cross(deformedPosition(corners[f+1])-a,deformedPosition(corners[f+2])-a);
+	}
+	uint n=3*(uint(numVerts)+v);
+	vec3 b=vec3(base[n],base[n+1],base[n+2]);
+	float len=length(b);
+	b=len>0.0 ? b/len : b;
+	vec3 r=vec3(restNormals[3*v],restNormals[3*v+1],restNormals[3*v+2]);
+	vec3 result=b;
+	// turn the authored normal by the rotation taking the rest face normal to the deformed one, collapsed
+	// or flipped faces keep the base normal
+	float dl=length(d);
+	float c=dl>0.0 ? dot(r,d/dl) : -1.0;
+	if (c>-0.999 && dot(r,r)>0.0)
+	{
+		d/=dl;
+		vec3 k=cross(r,d);
+		result=b*c+cross(k,b)+k*(dot(k,b)/(1.0+c));
+	}
+	deformed[n]=result.x;
+	deformed[n+1]=result.y;
+	deformed[n+2]=result.z;
+}
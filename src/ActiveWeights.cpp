@@ -0,0 +1,28 @@
+#include "ActiveWeights.h"
+
+void ActiveWeights::update(const float *_weights, size_t _count)
+{
+  m_numTargets = _count;
+  m_indices.clear();
+  m_weights.clear();
+  m_packed.clear();
+  for (size_t i = 0; i < _count; ++i)
+  {
+    // zero adds exactly nothing so these can be dropped without changing the result
+    if (_weights[i] == 0.0f)
+      continue;
+    m_indices.push_back(static_cast<uint32_t>(i));
+    m_weights.push_back(_weights[i]);
+    m_packed.push_back(static_cast<float>(i));
+    m_packed.push_back(_weights[i]);
+  }
+}
+
+bool ActiveWeights::cheaperThanRows(double _avgRowLength, size_t _maxRowLength) const
+{
+  // fetches for the search plus the one for the match
+  size_t steps = 1;
+  while ((size_t(1) << steps) <= _maxRowLength)
+    ++steps;
+  return static_cast<double>(size() * (steps + 1)) <= _avgRowLength;
+}
@@ -0,0 +1,234 @@
+#include "AnimationClip.h"
+#include "ParseNumber.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+constexpr char c_magic[4] = {'F', 'C', 'L', 'P'};
+constexpr uint32_t c_byteOrder = 0x01020304;
+
+struct Header
+{
+  char magic[4];
+  uint32_t byteOrder;
+  uint32_t version;
+  uint32_t numCurves;
+  uint32_t numKeys;
+  uint32_t namesSize;
+};
+static_assert(sizeof(Header) == 24, "AnimationClip header layout changed, bump c_version");
+
+struct CurveEntry
+{
+  uint32_t nameOffset;
+  uint32_t firstKey;
+  uint32_t numKeys;
+};
+
+struct KeyEntry
+{
+  float time;
+  float value;
+  float inSlope;
+  float outSlope;
+  float inWeight;
+  float outWeight;
+  uint32_t interpolation;
+};
+static_assert(sizeof(KeyEntry) == 28, "AnimationClip key layout changed, bump c_version");
+
+std::string trim(const std::string &_s)
+{
+  auto first = _s.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos)
+    return std::string();
+  auto last = _s.find_last_not_of(" \t\r\n");
+  return _s.substr(first, last - first + 1);
+}
+} // end anon namespace
+
+void AnimationClip::addCurve(Curve &&_curve)
+{
+  std::stable_sort(_curve.keys.begin(), _curve.keys.end(),
+                   [](const Key &_a, const Key &_b) { return _a.time < _b.time; });
+  m_curves.push_back(std::move(_curve));
+}
+
+size_t AnimationClip::numKeys() const
+{
+  size_t count = 0;
+  for (auto &c : m_curves)
+    count += c.keys.size();
+  return count;
+}
+
+float AnimationClip::duration() const
+{
+  float end = 0.0f;
+  for (auto &c : m_curves)
+  {
+    if (!c.keys.empty())
+      end = std::max(end, c.keys.back().time);
+  }
+  return end;
+}
+
+bool AnimationClip::save(const std::string &_fname) const
+{
+  std::vector<CurveEntry> curves;
+  std::vector<KeyEntry> keys;
+  std::vector<char> names;
+  for (auto &c : m_curves)
+  {
+    curves.push_back({static_cast<uint32_t>(names.size()), static_cast<uint32_t>(keys.size()),
+                      static_cast<uint32_t>(c.keys.size())});
+    names.insert(names.end(), c.target.c_str(), c.target.c_str() + c.target.size() + 1);
+    for (auto &k : c.keys)
+      keys.push_back({k.time, k.value, k.inSlope, k.outSlope, k.inWeight, k.outWeight,
+                      static_cast<uint32_t>(k.interpolation)});
+  }
+  Header header = {};
+  std::memcpy(header.magic, c_magic, sizeof(c_magic));
+  header.byteOrder = c_byteOrder;
+  header.version = c_version;
+  header.numCurves = static_cast<uint32_t>(curves.size());
+  header.numKeys = static_cast<uint32_t>(keys.size());
+  header.namesSize = static_cast<uint32_t>(names.size());
+
+  std::ofstream out(_fname, std::ios::binary | std::ios::trunc);
+  if (!out.is_open())
+    return false;
+  out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+  out.write(reinterpret_cast<const char *>(curves.data()), curves.size() * sizeof(CurveEntry));
+  out.write(reinterpret_cast<const char *>(keys.data()), keys.size() * sizeof(KeyEntry));
+  out.write(names.data(), static_cast<std::streamsize>(names.size()));
+  return out.good();
+}
+
+bool AnimationClip::load(const std::string &_fname)
+{
+  m_error.clear();
+  auto fail = [&](const std::string &_why) {
+    m_error = _fname + " " + _why;
+    return false;
+  };
+  std::ifstream in(_fname, std::ios::binary);
+  if (!in.is_open())
+    return fail("can't be read");
+  Header header;
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(Header)) ||
+      std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0 || header.byteOrder != c_byteOrder ||
+      header.version != c_version)
+    return fail("isn't a clip or is the wrong version");
+  std::vector<CurveEntry> curves(header.numCurves);
+  std::vector<KeyEntry> keys(header.numKeys);
+  std::vector<char> names(header.namesSize);
+  if (!in.read(reinterpret_cast<char *>(curves.data()), curves.size() * sizeof(CurveEntry)) ||
+      !in.read(reinterpret_cast<char *>(keys.data()), keys.size() * sizeof(KeyEntry)) ||
+      !in.read(names.data(), static_cast<std::streamsize>(names.size())))
+    return fail("is truncated");
+
+  std::vector<Curve> loaded;
+  for (auto &c : curves)
+  {
+    if (c.nameOffset >= names.size() || c.firstKey > keys.size() || c.numKeys > keys.size() - c.firstKey)
+      return fail("is damaged");
+    Curve curve;
+    curve.target.assign(names.data() + c.nameOffset, strnlen(names.data() + c.nameOffset, names.size() - c.nameOffset));
+    for (uint32_t k = c.firstKey; k < c.firstKey + c.numKeys; ++k)
+    {
+      auto &e = keys[k];
+      if (e.interpolation > static_cast<uint32_t>(Interpolation::Bezier))
+        return fail("is damaged");
+      curve.keys.push_back({e.time, e.value, e.inSlope, e.outSlope, e.inWeight, e.outWeight,
+                            static_cast<Interpolation>(e.interpolation)});
+    }
+    loaded.push_back(std::move(curve));
+  }
+  m_curves.clear();
+  for (auto &c : loaded)
+    addCurve(std::move(c));
+  return true;
+}
+
+bool AnimationClip::loadText(const std::string &_fname)
+{
+  m_error.clear();
+  std::ifstream in(_fname);
+  if (!in.is_open())
+  {
+    m_error = _fname + " can't be read";
+    return false;
+  }
+  std::vector<Curve> curves;
+  std::string line;
+  size_t lineNumber = 0;
+  auto badLine = [&](const std::string &_why) {
+    m_error = _fname + " line " + std::to_string(lineNumber) + ", " + _why;
+    return false;
+  };
+  while (std::getline(in, line))
+  {
+    ++lineNumber;
+    line = trim(line);
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::vector<std::string> tokens;
+    std::stringstream ss(line);
+    std::string token;
+    while (std::getline(ss, token, ','))
+      tokens.push_back(trim(token));
+
+    if (tokens[0] == "curve" && tokens.size() >= 2)
+    {
+      curves.push_back({tokens[1], {}});
+    }
+    else if (tokens[0] == "key" && tokens.size() >= 3 && !curves.empty())
+    {
+      Key key;
+      std::string mode = tokens.size() > 3 ? tokens[3] : "linear";
+      // the numbers each mode reads after time and value
+      float *fields[6] = {&key.time, &key.value, &key.inSlope, &key.outSlope, &key.inWeight, &key.outWeight};
+      size_t numFields = 2;
+      if (mode == "hermite" && tokens.size() >= 6)
+      {
+        key.interpolation = Interpolation::Hermite;
+        numFields = 4;
+      }
+      else if (mode == "bezier" && tokens.size() >= 8)
+      {
+        key.interpolation = Interpolation::Bezier;
+        numFields = 6;
+      }
+      else if (mode != "linear")
+      {
+        return badLine("\"" + mode + "\" isn't linear, hermite or bezier with its slopes");
+      }
+      for (size_t i = 0; i < numFields; ++i)
+      {
+        // time and value come before the mode, the slopes and weights after it
+        auto &field = tokens[i < 2 ? i + 1 : i + 2];
+        if (!parseNumber(field, *fields[i]))
+          return badLine("\"" + field + "\" isn't a number");
+      }
+      curves.back().keys.push_back(key);
+    }
+    else
+    {
+      return badLine("\"" + line + "\" isn't a curve or a key after one");
+    }
+  }
+  m_curves.clear();
+  for (auto &c : curves)
+    addCurve(std::move(c));
+  return true;
+}
+
+bool AnimationClip::loadAny(const std::string &_fname)
+{
+  bool text = _fname.size() >= 4 && _fname.compare(_fname.size() - 4, 4, ".txt") == 0;
+  return text ? loadText(_fname) : load(_fname);
+}
@@ -0,0 +1,126 @@
+#include "AsyncWriter.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+bool seek(std::FILE *_f, uint64_t _offset)
+{
+#if defined(_WIN32)
+  return _fseeki64(_f, static_cast<__int64>(_offset), SEEK_SET) == 0;
+#else
+  return fseeko(_f, static_cast<off_t>(_offset), SEEK_SET) == 0;
+#endif
+}
+} // end anon namespace
+
+AsyncWriter::AsyncWriter(size_t _numBuffers) : m_buffers(std::max<size_t>(_numBuffers, 1))
+{
+  for (auto &b : m_buffers)
+    m_free.push_back(&b);
+  m_thread = std::thread(&AsyncWriter::writer, this);
+}
+
+AsyncWriter::~AsyncWriter()
+{
+  finish();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  m_thread.join();
+}
+
+bool AsyncWriter::open(const std::string &_fname)
+{
+  finish();
+  m_file = std::fopen(_fname.c_str(), "wb");
+  return m_file != nullptr;
+}
+
+AsyncWriter::Buffer *AsyncWriter::acquire()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_bufferFree.wait(lock, [this]() { return !m_free.empty(); });
+  Buffer *buffer = m_free.back();
+  m_free.pop_back();
+  buffer->clear();
+  return buffer;
+}
+
+void AsyncWriter::queue(Job &&_job)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back(std::move(_job));
+  }
+  m_wake.notify_all();
+}
+
+void AsyncWriter::writeFile(const std::string &_fname, Buffer *_buffer)
+{
+  queue({_fname, 0, _buffer});
+}
+
+void AsyncWriter::writeAt(uint64_t _offset, Buffer *_buffer)
+{
+  queue({std::string(), _offset, _buffer});
+}
+
+bool AsyncWriter::finish()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_bufferFree.wait(lock, [this]() { return m_jobs.empty() && m_writing == 0; });
+  if (m_file != nullptr)
+  {
+    if (std::fclose(m_file) != 0)
+      m_failed = true;
+    m_file = nullptr;
+  }
+  bool ok = !m_failed;
+  m_failed = false;
+  return ok;
+}
+
+void AsyncWriter::writer()
+{
+  for (;;)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+      if (m_jobs.empty())
+        return;
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+      ++m_writing;
+    }
+    auto start = std::chrono::steady_clock::now();
+    bool ok;
+    if (job.fname.empty())
+    {
+      // only this thread touches m_file between open and finish
+      ok = m_file != nullptr && seek(m_file, job.offset) &&
+           std::fwrite(job.buffer->data(), 1, job.buffer->size(), m_file) == job.buffer->size();
+    }
+    else
+    {
+      std::FILE *f = std::fopen(job.fname.c_str(), "wb");
+      ok = f != nullptr && std::fwrite(job.buffer->data(), 1, job.buffer->size(), f) == job.buffer->size();
+      if (f != nullptr && std::fclose(f) != 0)
+        ok = false;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_writeMs += ms;
+      m_bytes += ok ? job.buffer->size() : 0;
+      m_failed = m_failed || !ok;
+      m_free.push_back(job.buffer);
+      --m_writing;
+    }
+    m_bufferFree.notify_all();
+  }
+}
@@ -0,0 +1,196 @@
+#include "BlendKernels.h"
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FACIAL_HAVE_SSE
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+void accumulateScalar(float *_dst, const float *_src, float _w, size_t _n)
+{
+  for (size_t i = 0; i < _n; ++i)
+    _dst[i] += _src[i] * _w;
+}
+
+void scatterAccumulateScalar(float *_dst, const uint32_t *_idx, const float *_src, float _w, size_t _n)
+{
+  for (size_t i = 0; i < _n; ++i)
+    _dst[_idx[i]] += _src[i] * _w;
+}
+
+void addScalar(float *_dst, const float *_a, const float *_b, size_t _n)
+{
+  for (size_t i = 0; i < _n; ++i)
+    _dst[i] = _a[i] + _b[i];
+}
+
+void normalizeScalar(float *_x, float *_y, float *_z, size_t _n)
+{
+  for (size_t i = 0; i < _n; ++i)
+  {
+    float len2 = _x[i] * _x[i] + _y[i] * _y[i] + _z[i] * _z[i];
+    if (len2 > 0.0f)
+    {
+      float inv = 1.0f / std::sqrt(len2);
+      _x[i] *= inv;
+      _y[i] *= inv;
+      _z[i] *= inv;
+    }
+  }
+}
+
+void multiplyScalar(float *_dst, const float *_a, const float *_b, size_t _n)
+{
+  for (size_t i = 0; i < _n; ++i)
+    _dst[i] = _a[i] * _b[i];
+}
+
+void rampScalar(float *_dst, const float *_w, const float *_left, const float *_peak, const float *_right,
+                size_t _n)
+{
+  for (size_t i = 0; i < _n; ++i)
+  {
+    float w = _w[i];
+    float v = 0.0f;
+    if (w <= _left[i])
+      v = 0.0f;
+    else if (w < _peak[i] || _right[i] == _peak[i])
+      v = (w - _left[i]) / (_peak[i] - _left[i]);
+    else if (w < _right[i])
+      v = (_right[i] - w) / (_right[i] - _peak[i]);
+    _dst[i] = v;
+  }
+}
+
+const blendkernels::Table s_scalar = {accumulateScalar, scatterAccumulateScalar, addScalar,
+                                      normalizeScalar,  multiplyScalar,          rampScalar};
+
+#if defined(FACIAL_HAVE_SSE)
+void accumulateSSE(float *_dst, const float *_src, float _w, size_t _n)
+{
+  const __m128 w = _mm_set1_ps(_w);
+  size_t i = 0;
+  for (; i + 4 <= _n; i += 4)
+    _mm_storeu_ps(_dst + i, _mm_add_ps(_mm_loadu_ps(_dst + i), _mm_mul_ps(_mm_loadu_ps(_src + i), w)));
+  accumulateScalar(_dst + i, _src + i, _w, _n - i);
+}
+
+void scatterAccumulateSSE(float *_dst, const uint32_t *_idx, const float *_src, float _w, size_t _n)
+{
+  // no gather / scatter in SSE2 so just do the multiply wide
+  const __m128 w = _mm_set1_ps(_w);
+  alignas(16) float scaled[4];
+  size_t i = 0;
+  for (; i + 4 <= _n; i += 4)
+  {
+    _mm_store_ps(scaled, _mm_mul_ps(_mm_loadu_ps(_src + i), w));
+    _dst[_idx[i]] += scaled[0];
+    _dst[_idx[i + 1]] += scaled[1];
+    _dst[_idx[i + 2]] += scaled[2];
+    _dst[_idx[i + 3]] += scaled[3];
+  }
+  scatterAccumulateScalar(_dst, _idx + i, _src + i, _w, _n - i);
+}
+
+void addSSE(float *_dst, const float *_a, const float *_b, size_t _n)
+{
+  size_t i = 0;
+  for (; i + 4 <= _n; i += 4)
+    _mm_storeu_ps(_dst + i, _mm_add_ps(_mm_loadu_ps(_a + i), _mm_loadu_ps(_b + i)));
+  addScalar(_dst + i, _a + i, _b + i, _n - i);
+}
+
+void normalizeSSE(float *_x, float *_y, float *_z, size_t _n)
+{
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  size_t i = 0;
+  for (; i + 4 <= _n; i += 4)
+  {
+    __m128 x = _mm_loadu_ps(_x + i);
+    __m128 y = _mm_loadu_ps(_y + i);
+    __m128 z = _mm_loadu_ps(_z + i);
+    __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+    __m128 inv = _mm_div_ps(one, _mm_sqrt_ps(len2));
+    // SSE2 has no blendv so select with and / andnot
+    __m128 valid = _mm_cmpgt_ps(len2, zero);
+    inv = _mm_or_ps(_mm_and_ps(valid, inv), _mm_andnot_ps(valid, one));
+    _mm_storeu_ps(_x + i, _mm_mul_ps(x, inv));
+    _mm_storeu_ps(_y + i, _mm_mul_ps(y, inv));
+    _mm_storeu_ps(_z + i, _mm_mul_ps(z, inv));
+  }
+  normalizeScalar(_x + i, _y + i, _z + i, _n - i);
+}
+
+void multiplySSE(float *_dst, const float *_a, const float *_b, size_t _n)
+{
+  size_t i = 0;
+  for (; i + 4 <= _n; i += 4)
+    _mm_storeu_ps(_dst + i, _mm_mul_ps(_mm_loadu_ps(_a + i), _mm_loadu_ps(_b + i)));
+  multiplyScalar(_dst + i, _a + i, _b + i, _n - i);
+}
+
+void rampSSE(float *_dst, const float *_w, const float *_left, const float *_peak, const float *_right, size_t _n)
+{
+  size_t i = 0;
+  for (; i + 4 <= _n; i += 4)
+  {
+    __m128 w = _mm_loadu_ps(_w + i);
+    __m128 left = _mm_loadu_ps(_left + i);
+    __m128 peak = _mm_loadu_ps(_peak + i);
+    __m128 right = _mm_loadu_ps(_right + i);
+    // both sides are divided out as the scalar code does, the one not chosen may be inf for the last key
+    __m128 up = _mm_div_ps(_mm_sub_ps(w, left), _mm_sub_ps(peak, left));
+    __m128 down = _mm_div_ps(_mm_sub_ps(right, w), _mm_sub_ps(right, peak));
+    __m128 rising = _mm_or_ps(_mm_cmplt_ps(w, peak), _mm_cmpeq_ps(right, peak));
+    __m128 falling = _mm_andnot_ps(rising, _mm_cmplt_ps(w, right));
+    __m128 v = _mm_or_ps(_mm_and_ps(rising, up), _mm_and_ps(falling, down));
+    // not w <= left rather than w > left so a NaN weight takes the same branch as in the scalar code
+    _mm_storeu_ps(_dst + i, _mm_and_ps(_mm_cmpnle_ps(w, left), v));
+  }
+  rampScalar(_dst + i, _w + i, _left + i, _peak + i, _right + i, _n - i);
+}
+
+const blendkernels::Table s_sse = {accumulateSSE, scatterAccumulateSSE, addSSE, normalizeSSE, multiplySSE, rampSSE};
+#endif
+} // end anon namespace
+
+const blendkernels::Table &blendkernels::scalar()
+{
+  return s_scalar;
+}
+
+const blendkernels::Table *blendkernels::sse()
+{
+#if defined(FACIAL_HAVE_SSE)
+  return &s_sse;
+#else
+  return nullptr;
+#endif
+}
+
+bool blendkernels::cpuHasAVX2()
+{
+  if (avx2() == nullptr)
+    return false;
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+  __cpuidex(info, 7, 0);
+  bool avx2Bit = (info[1] & (1 << 5)) != 0;
+  // the OS must also save the ymm registers
+  __cpuid(info, 1);
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  return avx2Bit && osxsave && ((_xgetbv(0) & 0x6) == 0x6);
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
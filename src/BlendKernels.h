@@ -0,0 +1,39 @@
+#ifndef BLENDKERNELS_H_
+#define BLENDKERNELS_H_
+#include <cstddef>
+#include <cstdint>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file BlendKernels.h
+/// @brief the inner loops used by the CPU blend code, one table per instruction set. The AVX2 versions
+/// live in BlendKernelsAVX2.cpp as that file is the only one built with AVX2 enabled, the choice is
+/// made at runtime so the same binary still runs on older farm machines.
+//----------------------------------------------------------------------------------------------------------------------
+namespace blendkernels
+{
+  struct Table
+  {
+    /// @brief _dst[i] += _src[i] * _w
+    void (*accumulate)(float *_dst, const float *_src, float _w, size_t _n);
+    /// @brief _dst[_idx[i]] += _src[i] * _w, the indices must be unique
+    void (*scatterAccumulate)(float *_dst, const uint32_t *_idx, const float *_src, float _w, size_t _n);
+    /// @brief _dst[i] = _a[i] + _b[i]
+    void (*add)(float *_dst, const float *_a, const float *_b, size_t _n);
+    /// @brief normalize n xyz vectors in place (zero length vectors are left alone)
+    void (*normalize)(float *_x, float *_y, float *_z, size_t _n);
+    /// @brief _dst[i] = _a[i] * _b[i]
+    void (*multiply)(float *_dst, const float *_a, const float *_b, size_t _n);
+    /// @brief the in-between ramps of WeightProgram, _dst[i] is 0 up to _left[i], rises to 1 at _peak[i]
+    /// and falls back to 0 at _right[i], or keeps rising if _right[i] is _peak[i]
+    void (*ramp)(float *_dst, const float *_w, const float *_left, const float *_peak, const float *_right,
+                 size_t _n);
+  };
+
+  const Table &scalar();
+  /// @brief these return nullptr if not compiled in
+  const Table *sse();
+  const Table *avx2();
+  /// @brief runtime cpu check
+  bool cpuHasAVX2();
+} // end namespace blendkernels
+
+#endif
@@ -0,0 +1,144 @@
+#include "BlendKernels.h"
+// this file is compiled with AVX2 enabled (see CMakeLists.txt) so nothing in here must be called
+// unless cpuHasAVX2() is true. FMA is left off so the sums round the same as the scalar and SSE kernels
+#if defined(FACIAL_HAVE_AVX2)
+#include <immintrin.h>
+#include <cmath>
+
+namespace
+{
+void accumulateAVX2(float *_dst, const float *_src, float _w, size_t _n)
+{
+  const __m256 w = _mm256_set1_ps(_w);
+  size_t i = 0;
+  for (; i + 8 <= _n; i += 8)
+  {
+    __m256 d = _mm256_loadu_ps(_dst + i);
+    // keep mul then add (not fma) so we round the same way as the scalar code
+    d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_loadu_ps(_src + i), w));
+    _mm256_storeu_ps(_dst + i, d);
+  }
+  for (; i < _n; ++i)
+    _dst[i] += _src[i] * _w;
+}
+
+void scatterAccumulateAVX2(float *_dst, const uint32_t *_idx, const float *_src, float _w, size_t _n)
+{
+  // AVX2 has no scatter and a gather of _dst is slower than just doing the adds one at a
+  // time, so only the multiply is done wide
+  const __m256 w = _mm256_set1_ps(_w);
+  alignas(32) float scaled[8];
+  size_t i = 0;
+  for (; i + 8 <= _n; i += 8)
+  {
+    _mm256_store_ps(scaled, _mm256_mul_ps(_mm256_loadu_ps(_src + i), w));
+    // written out by hand, as a loop gcc turns this into a (slow) gather
+    _dst[_idx[i]] += scaled[0];
+    _dst[_idx[i + 1]] += scaled[1];
+    _dst[_idx[i + 2]] += scaled[2];
+    _dst[_idx[i + 3]] += scaled[3];
+    _dst[_idx[i + 4]] += scaled[4];
+    _dst[_idx[i + 5]] += scaled[5];
+    _dst[_idx[i + 6]] += scaled[6];
+    _dst[_idx[i + 7]] += scaled[7];
+  }
+  for (; i < _n; ++i)
+    _dst[_idx[i]] += _src[i] * _w;
+}
+
+void addAVX2(float *_dst, const float *_a, const float *_b, size_t _n)
+{
+  size_t i = 0;
+  for (; i + 8 <= _n; i += 8)
+    _mm256_storeu_ps(_dst + i, _mm256_add_ps(_mm256_loadu_ps(_a + i), _mm256_loadu_ps(_b + i)));
+  for (; i < _n; ++i)
+    _dst[i] = _a[i] + _b[i];
+}
+
+void normalizeAVX2(float *_x, float *_y, float *_z, size_t _n)
+{
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  size_t i = 0;
+  for (; i + 8 <= _n; i += 8)
+  {
+    __m256 x = _mm256_loadu_ps(_x + i);
+    __m256 y = _mm256_loadu_ps(_y + i);
+    __m256 z = _mm256_loadu_ps(_z + i);
+    __m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+    // full precision sqrt / div rather than rsqrt to match the shader normalize
+    __m256 inv = _mm256_div_ps(one, _mm256_sqrt_ps(len2));
+    __m256 valid = _mm256_cmp_ps(len2, zero, _CMP_GT_OQ);
+    inv = _mm256_blendv_ps(one, inv, valid);
+    _mm256_storeu_ps(_x + i, _mm256_mul_ps(x, inv));
+    _mm256_storeu_ps(_y + i, _mm256_mul_ps(y, inv));
+    _mm256_storeu_ps(_z + i, _mm256_mul_ps(z, inv));
+  }
+  for (; i < _n; ++i)
+  {
+    float len2 = _x[i] * _x[i] + _y[i] * _y[i] + _z[i] * _z[i];
+    if (len2 > 0.0f)
+    {
+      float inv = 1.0f / std::sqrt(len2);
+      _x[i] *= inv;
+      _y[i] *= inv;
+      _z[i] *= inv;
+    }
+  }
+}
+
+void multiplyAVX2(float *_dst, const float *_a, const float *_b, size_t _n)
+{
+  size_t i = 0;
+  for (; i + 8 <= _n; i += 8)
+    _mm256_storeu_ps(_dst + i, _mm256_mul_ps(_mm256_loadu_ps(_a + i), _mm256_loadu_ps(_b + i)));
+  for (; i < _n; ++i)
+    _dst[i] = _a[i] * _b[i];
+}
+
+void rampAVX2(float *_dst, const float *_w, const float *_left, const float *_peak, const float *_right, size_t _n)
+{
+  const __m256 zero = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= _n; i += 8)
+  {
+    __m256 w = _mm256_loadu_ps(_w + i);
+    __m256 left = _mm256_loadu_ps(_left + i);
+    __m256 peak = _mm256_loadu_ps(_peak + i);
+    __m256 right = _mm256_loadu_ps(_right + i);
+    __m256 up = _mm256_div_ps(_mm256_sub_ps(w, left), _mm256_sub_ps(peak, left));
+    __m256 down = _mm256_div_ps(_mm256_sub_ps(right, w), _mm256_sub_ps(right, peak));
+    __m256 rising = _mm256_or_ps(_mm256_cmp_ps(w, peak, _CMP_LT_OQ), _mm256_cmp_ps(right, peak, _CMP_EQ_OQ));
+    __m256 v = _mm256_blendv_ps(zero, down, _mm256_cmp_ps(w, right, _CMP_LT_OQ));
+    v = _mm256_blendv_ps(v, up, rising);
+    // not w <= left as in the scalar code, a NaN weight isn't cut off here
+    _mm256_storeu_ps(_dst + i, _mm256_and_ps(_mm256_cmp_ps(w, left, _CMP_NLE_UQ), v));
+  }
+  for (; i < _n; ++i)
+  {
+    float w = _w[i];
+    float v = 0.0f;
+    if (w <= _left[i])
+      v = 0.0f;
+    else if (w < _peak[i] || _right[i] == _peak[i])
+      v = (w - _left[i]) / (_peak[i] - _left[i]);
+    else if (w < _right[i])
+      v = (_right[i] - w) / (_right[i] - _peak[i]);
+    _dst[i] = v;
+  }
+}
+
+const blendkernels::Table s_avx2 = {accumulateAVX2, scatterAccumulateAVX2, addAVX2,
+                                    normalizeAVX2,  multiplyAVX2,          rampAVX2};
+} // end anon namespace
+
+const blendkernels::Table *blendkernels::avx2()
+{
+  return &s_avx2;
+}
+#else
+const blendkernels::Table *blendkernels::avx2()
+{
+  return nullptr;
+}
+#endif
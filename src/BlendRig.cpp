@@ -0,0 +1,105 @@
+#include "BlendRig.h"
+#include <unordered_map>
+
+bool BlendRig::buildBase(const float *_positions, size_t _numPositions, const float *_normals, size_t _numNormals,
+                         const std::vector<Corner> &_corners)
+{
+  m_indices.clear();
+  m_positionIndex.clear();
+  m_normalIndex.clear();
+  m_targetNames.clear();
+  m_numSourcePositions = _numPositions;
+  m_numSourceNormals = _numNormals;
+
+  // give each (position, normal) pair an id in the order they are first seen, keeping first use
+  // order means triangles that are close in the obj use vertices that are close in memory
+  std::unordered_map<uint64_t, uint32_t> unique;
+  unique.reserve(_numPositions * 2);
+  m_indices.reserve(_corners.size());
+  for (auto &c : _corners)
+  {
+    if (c.vert >= _numPositions || c.norm >= _numNormals)
+      return false;
+    uint64_t key = (static_cast<uint64_t>(c.vert) << 32) | c.norm;
+    auto found = unique.find(key);
+    if (found == unique.end())
+    {
+      uint32_t id = static_cast<uint32_t>(m_positionIndex.size());
+      unique.emplace(key, id);
+      m_positionIndex.push_back(c.vert);
+      m_normalIndex.push_back(c.norm);
+      m_indices.push_back(id);
+    }
+    else
+    {
+      m_indices.push_back(found->second);
+    }
+  }
+
+  size_t numVerts = m_positionIndex.size();
+  m_vertexData.resize(numVerts * 6);
+  float *p = m_vertexData.data();
+  float *n = p + numVerts * 3;
+  for (size_t v = 0; v < numVerts; ++v)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      p[v * 3 + c] = _positions[m_positionIndex[v] * 3 + c];
+      n[v * 3 + c] = _normals[m_normalIndex[v] * 3 + c];
+    }
+  }
+  m_targets.reset(numVerts);
+  return true;
+}
+
+bool BlendRig::addTarget(const std::string &_name, const float *_positions, size_t _numPositions,
+                         const float *_normals, size_t _numNormals)
+{
+  if (_numPositions != m_numSourcePositions || _numNormals != m_numSourceNormals)
+    return false;
+  // the blend meshes are just the differences so we subtract the base mesh
+  // from the current one, once per unique vertex
+  size_t numVerts = this->numVerts();
+  std::vector<float> positionDeltas(numVerts * 3);
+  std::vector<float> normalDeltas(numVerts * 3);
+  const float *p = positions();
+  const float *n = normals();
+  for (size_t v = 0; v < numVerts; ++v)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      positionDeltas[v * 3 + c] = _positions[m_positionIndex[v] * 3 + c] - p[v * 3 + c];
+      normalDeltas[v * 3 + c] = _normals[m_normalIndex[v] * 3 + c] - n[v * 3 + c];
+    }
+  }
+  m_targets.addTarget(positionDeltas.data(), normalDeltas.data());
+  m_targetNames.push_back(_name);
+  return true;
+}
+
+void BlendRig::addTarget(const std::string &_name, BlendTargetSet::Target &&_target)
+{
+  m_targets.addTarget(std::move(_target));
+  m_targetNames.push_back(_name);
+}
+
+void BlendRig::removeTargets()
+{
+  m_targets.reset(numVerts());
+  m_targetNames.clear();
+}
+
+void BlendRig::assign(std::vector<float> &&_vertexData, std::vector<uint32_t> &&_indices,
+                      std::vector<uint32_t> &&_positionIndex, std::vector<uint32_t> &&_normalIndex,
+                      size_t _numSourcePositions, size_t _numSourceNormals, std::vector<std::string> &&_targetNames,
+                      BlendTargetSet &&_targets)
+{
+  m_vertexData = std::move(_vertexData);
+  m_indices = std::move(_indices);
+  m_positionIndex = std::move(_positionIndex);
+  m_normalIndex = std::move(_normalIndex);
+  m_numSourcePositions = _numSourcePositions;
+  m_numSourceNormals = _numSourceNormals;
+  m_targetNames = std::move(_targetNames);
+  m_targets = std::move(_targets);
+}
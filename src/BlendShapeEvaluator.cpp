@@ -0,0 +1,273 @@
+#include "BlendShapeEvaluator.h"
+#include "BlendKernels.h"
+#include <cstring>
+
+namespace
+{
+const blendkernels::Table &kernelTable(BlendShapeEvaluator::Kernel _k)
+{
+  switch (_k)
+  {
+  case BlendShapeEvaluator::Kernel::AVX2:
+    return *blendkernels::avx2();
+  case BlendShapeEvaluator::Kernel::SSE:
+    return *blendkernels::sse();
+  default:
+    return blendkernels::scalar();
+  }
+}
+} // end anon namespace
+
+void BlendShapeEvaluator::setBaseMesh(const float *_positions, const float *_normals, size_t _numVerts)
+{
+  m_numVerts = _numVerts;
+  m_basePositions.fromInterleaved(_positions, _numVerts);
+  m_baseNormals.fromInterleaved(_normals, _numVerts);
+  m_targets.reset(_numVerts);
+  m_outPositions = m_basePositions;
+  m_outNormals = m_baseNormals;
+  m_outputIsBase = false;
+  m_indices.clear();
+  m_positionIndex.clear();
+  m_normalMode = NormalRebuilder::Mode::Blend;
+  m_rebuilderDirty = true;
+  m_normalsFromTopology = false;
+}
+
+size_t BlendShapeEvaluator::addTarget(const float *_positionDeltas, const float *_normalDeltas)
+{
+  m_outputIsBase = false;
+  m_rebuilderDirty = true;
+  return m_targets.addTarget(_positionDeltas, _normalDeltas);
+}
+
+bool BlendShapeEvaluator::setTargets(const BlendTargetSet &_targets)
+{
+  if (_targets.numVerts() != m_numVerts)
+    return false;
+  m_targets = _targets;
+  m_outputIsBase = false;
+  m_rebuilderDirty = true;
+  return true;
+}
+
+void BlendShapeEvaluator::setRig(const BlendRig &_rig)
+{
+  NormalRebuilder::Mode mode = m_normalMode;
+  setBaseMesh(_rig.positions(), _rig.normals(), _rig.numVerts());
+  m_targets = _rig.targets();
+  setTopology(_rig.indices(), _rig.positionIndex());
+  setNormalMode(mode);
+}
+
+void BlendShapeEvaluator::setTopology(const std::vector<uint32_t> &_indices, const std::vector<uint32_t> &_positionIndex)
+{
+  m_indices = _indices;
+  m_positionIndex = _positionIndex;
+  m_rebuilderDirty = true;
+  m_outputIsBase = false;
+}
+
+bool BlendShapeEvaluator::setNormalMode(NormalRebuilder::Mode _m)
+{
+  if (_m == NormalRebuilder::Mode::Topology && (m_indices.empty() || m_positionIndex.size() != m_numVerts))
+    return false;
+  if (_m != m_normalMode)
+    m_outputIsBase = false;
+  m_normalMode = _m;
+  return true;
+}
+
+const NormalRebuilder &BlendShapeEvaluator::normalRebuilder()
+{
+  if (m_rebuilderDirty)
+  {
+    std::vector<float> positions(m_numVerts * 3);
+    std::vector<float> normals(m_numVerts * 3);
+    m_basePositions.toInterleaved(positions.data());
+    m_baseNormals.toInterleaved(normals.data());
+    m_rebuilder.build(m_indices.data(), m_indices.size(), m_positionIndex.data(), positions.data(), normals.data(),
+                      m_numVerts);
+    m_rebuilder.setTargets(m_targets);
+    m_unitBaseNormals = m_baseNormals;
+    blendkernels::scalar().normalize(m_unitBaseNormals.x.data(), m_unitBaseNormals.y.data(),
+                                     m_unitBaseNormals.z.data(), m_numVerts);
+    m_normalsFromTopology = false;
+    m_rebuilderDirty = false;
+  }
+  return m_rebuilder;
+}
+
+bool BlendShapeEvaluator::kernelSupported(Kernel _k)
+{
+  switch (_k)
+  {
+  case Kernel::Auto:
+  case Kernel::Scalar:
+    return true;
+  case Kernel::SSE:
+    return blendkernels::sse() != nullptr;
+  case Kernel::AVX2:
+    return blendkernels::cpuHasAVX2();
+  }
+  return false;
+}
+
+const char *BlendShapeEvaluator::kernelName(Kernel _k)
+{
+  switch (_k)
+  {
+  case Kernel::Auto:
+    return "Auto";
+  case Kernel::Scalar:
+    return "Scalar";
+  case Kernel::SSE:
+    return "SSE";
+  case Kernel::AVX2:
+    return "AVX2";
+  }
+  return "Unknown";
+}
+
+bool BlendShapeEvaluator::setKernel(Kernel _k)
+{
+  if (!kernelSupported(_k))
+    return false;
+  if (_k == Kernel::Auto)
+  {
+    if (kernelSupported(Kernel::AVX2))
+      _k = Kernel::AVX2;
+    else if (kernelSupported(Kernel::SSE))
+      _k = Kernel::SSE;
+    else
+      _k = Kernel::Scalar;
+  }
+  m_kernel = _k;
+  m_kernelChosen = true;
+  return true;
+}
+
+void BlendShapeEvaluator::evaluate(const float *_weights)
+{
+  m_active.update(_weights, m_targets.numTargets());
+  evaluate(m_active);
+}
+
+void BlendShapeEvaluator::evaluate(const ActiveWeights &_active)
+{
+  // the neutral pose doesn't change so there is nothing to do
+  if (_active.empty() && m_outputIsBase && m_outPositions.size() == m_numVerts)
+    return;
+  if (!m_kernelChosen)
+    setKernel(Kernel::Auto);
+  if (m_normalMode == NormalRebuilder::Mode::Topology)
+  {
+    evaluateTopology(_active);
+    return;
+  }
+  const blendkernels::Table &k = kernelTable(m_kernel);
+  m_outPositions.resize(m_numVerts);
+  m_outNormals.resize(m_numVerts);
+  m_normalsFromTopology = false;
+
+  float *outP[3] = {m_outPositions.x.data(), m_outPositions.y.data(), m_outPositions.z.data()};
+  float *outN[3] = {m_outNormals.x.data(), m_outNormals.y.data(), m_outNormals.z.data()};
+  const float *baseP[3] = {m_basePositions.x.data(), m_basePositions.y.data(), m_basePositions.z.data()};
+  const float *baseN[3] = {m_baseNormals.x.data(), m_baseNormals.y.data(), m_baseNormals.z.data()};
+
+  // same order of operations as the shader, sum the weighted deltas then add the base
+  for (int c = 0; c < 3; ++c)
+  {
+    std::memset(outP[c], 0, m_numVerts * sizeof(float));
+    std::memset(outN[c], 0, m_numVerts * sizeof(float));
+  }
+  // zero weights add exactly nothing in the shader so only the active targets are visited
+  for (size_t a = 0; a < _active.size(); ++a)
+  {
+    size_t ti = _active.indices()[a];
+    if (ti >= m_targets.numTargets())
+      continue;
+    float w = _active.weights()[a];
+    auto &t = m_targets.target(ti);
+    if (t.size() == m_numVerts)
+    {
+      // every vertex moves so the indices are just 0..n-1, use the straight loop
+      k.accumulate(outP[0], t.positions.x.data(), w, m_numVerts);
+      k.accumulate(outP[1], t.positions.y.data(), w, m_numVerts);
+      k.accumulate(outP[2], t.positions.z.data(), w, m_numVerts);
+      k.accumulate(outN[0], t.normals.x.data(), w, m_numVerts);
+      k.accumulate(outN[1], t.normals.y.data(), w, m_numVerts);
+      k.accumulate(outN[2], t.normals.z.data(), w, m_numVerts);
+      continue;
+    }
+    const uint32_t *idx = t.indices.data();
+    k.scatterAccumulate(outP[0], idx, t.positions.x.data(), w, t.size());
+    k.scatterAccumulate(outP[1], idx, t.positions.y.data(), w, t.size());
+    k.scatterAccumulate(outP[2], idx, t.positions.z.data(), w, t.size());
+    k.scatterAccumulate(outN[0], idx, t.normals.x.data(), w, t.size());
+    k.scatterAccumulate(outN[1], idx, t.normals.y.data(), w, t.size());
+    k.scatterAccumulate(outN[2], idx, t.normals.z.data(), w, t.size());
+  }
+  for (int c = 0; c < 3; ++c)
+  {
+    k.add(outP[c], outP[c], baseP[c], m_numVerts);
+    k.add(outN[c], outN[c], baseN[c], m_numVerts);
+  }
+  k.normalize(outN[0], outN[1], outN[2], m_numVerts);
+  m_outputIsBase = _active.empty();
+}
+
+void BlendShapeEvaluator::evaluateTopology(const ActiveWeights &_active)
+{
+  normalRebuilder();
+  const blendkernels::Table &k = kernelTable(m_kernel);
+  m_outPositions.resize(m_numVerts);
+  float *outP[3] = {m_outPositions.x.data(), m_outPositions.y.data(), m_outPositions.z.data()};
+  const float *baseP[3] = {m_basePositions.x.data(), m_basePositions.y.data(), m_basePositions.z.data()};
+  // positions exactly as evaluate, the normal deltas are never read
+  for (int c = 0; c < 3; ++c)
+    std::memset(outP[c], 0, m_numVerts * sizeof(float));
+  for (size_t a = 0; a < _active.size(); ++a)
+  {
+    size_t ti = _active.indices()[a];
+    if (ti >= m_targets.numTargets())
+      continue;
+    float w = _active.weights()[a];
+    auto &t = m_targets.target(ti);
+    if (t.size() == m_numVerts)
+    {
+      k.accumulate(outP[0], t.positions.x.data(), w, m_numVerts);
+      k.accumulate(outP[1], t.positions.y.data(), w, m_numVerts);
+      k.accumulate(outP[2], t.positions.z.data(), w, m_numVerts);
+      continue;
+    }
+    const uint32_t *idx = t.indices.data();
+    k.scatterAccumulate(outP[0], idx, t.positions.x.data(), w, t.size());
+    k.scatterAccumulate(outP[1], idx, t.positions.y.data(), w, t.size());
+    k.scatterAccumulate(outP[2], idx, t.positions.z.data(), w, t.size());
+  }
+  for (int c = 0; c < 3; ++c)
+    k.add(outP[c], outP[c], baseP[c], m_numVerts);
+
+  // everything outside last frame's region is still the base normal so only that region is reset
+  const float *baseN[3] = {m_unitBaseNormals.x.data(), m_unitBaseNormals.y.data(), m_unitBaseNormals.z.data()};
+  if (!m_normalsFromTopology || m_outNormals.size() != m_numVerts)
+  {
+    m_outNormals = m_unitBaseNormals;
+  }
+  else
+  {
+    for (auto v : m_lastTouched)
+    {
+      m_outNormals.x[v] = baseN[0][v];
+      m_outNormals.y[v] = baseN[1][v];
+      m_outNormals.z[v] = baseN[2][v];
+    }
+  }
+  float *outN[3] = {m_outNormals.x.data(), m_outNormals.y.data(), m_outNormals.z.data()};
+  const std::vector<uint32_t> &touched = m_rebuilder.touched(_active);
+  m_rebuilder.rebuild(outP, baseN, touched, outN);
+  m_lastTouched = touched;
+  m_normalsFromTopology = true;
+  m_outputIsBase = _active.empty();
+}
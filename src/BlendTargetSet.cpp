@@ -0,0 +1,87 @@
+#include "BlendTargetSet.h"
+#include <cmath>
+
+void BlendTargetSet::reset(size_t _numVerts)
+{
+  m_numVerts = _numVerts;
+  m_targets.clear();
+}
+
+size_t BlendTargetSet::addTarget(const float *_positionDeltas, const float *_normalDeltas)
+{
+  Target t;
+  for (size_t i = 0; i < m_numVerts; ++i)
+  {
+    const float *p = _positionDeltas + i * 3;
+    const float *n = _normalDeltas + i * 3;
+    bool moves = false;
+    for (int c = 0; c < 3 && !moves; ++c)
+      moves = std::fabs(p[c]) > m_epsilon || std::fabs(n[c]) > m_epsilon;
+    if (moves)
+    {
+      t.indices.push_back(static_cast<uint32_t>(i));
+      t.positions.push_back(p[0], p[1], p[2]);
+      t.normals.push_back(n[0], n[1], n[2]);
+    }
+  }
+  return addTarget(std::move(t));
+}
+
+size_t BlendTargetSet::addTarget(Target &&_target)
+{
+  m_targets.push_back(std::move(_target));
+  return m_targets.size() - 1;
+}
+
+size_t BlendTargetSet::numEntries() const
+{
+  size_t count = 0;
+  for (auto &t : m_targets)
+    count += t.size();
+  return count;
+}
+
+size_t BlendTargetSet::sparseBytes() const
+{
+  // index + 6 floats per entry
+  return numEntries() * (sizeof(uint32_t) + 6 * sizeof(float));
+}
+
+size_t BlendTargetSet::denseBytes() const
+{
+  return m_numVerts * m_targets.size() * 2 * 4 * sizeof(float);
+}
+
+void BlendTargetSet::buildVertexMajor(std::vector<int32_t> &_offsets, std::vector<float> &_entries) const
+{
+  // count per vertex first then a prefix sum gives the start of each row
+  _offsets.assign(m_numVerts + 1, 0);
+  for (auto &t : m_targets)
+  {
+    for (auto i : t.indices)
+      ++_offsets[i + 1];
+  }
+  for (size_t v = 0; v < m_numVerts; ++v)
+    _offsets[v + 1] += _offsets[v];
+
+  _entries.resize(static_cast<size_t>(_offsets[m_numVerts]) * 8);
+  std::vector<int32_t> cursor(_offsets.begin(), _offsets.end() - 1);
+  // walking the targets in order keeps each vertex row sorted by target index, so the shader
+  // sums in the same order as the CPU evaluator
+  for (size_t ti = 0; ti < m_targets.size(); ++ti)
+  {
+    auto &t = m_targets[ti];
+    for (size_t e = 0; e < t.size(); ++e)
+    {
+      float *out = &_entries[static_cast<size_t>(cursor[t.indices[e]]++) * 8];
+      out[0] = t.positions.x[e];
+      out[1] = t.positions.y[e];
+      out[2] = t.positions.z[e];
+      out[3] = static_cast<float>(ti);
+      out[4] = t.normals.x[e];
+      out[5] = t.normals.y[e];
+      out[6] = t.normals.z[e];
+      out[7] = 0.0f;
+    }
+  }
+}
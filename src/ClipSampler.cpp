@@ -0,0 +1,128 @@
+#include "ClipSampler.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+size_t ClipSampler::bind(const AnimationClip &_clip, const std::vector<std::string> &_targetNames)
+{
+  m_curves.clear();
+  m_segments.clear();
+  m_starts.clear();
+  m_ends.clear();
+  m_duration = _clip.duration();
+
+  std::unordered_map<std::string, uint32_t> targets;
+  for (size_t i = 0; i < _targetNames.size(); ++i)
+    targets.emplace(_targetNames[i], static_cast<uint32_t>(i));
+
+  for (auto &c : _clip.curves())
+  {
+    auto found = targets.find(c.target);
+    if (found == targets.end() || c.keys.empty())
+      continue;
+    Curve curve;
+    curve.target = found->second;
+    curve.first = static_cast<uint32_t>(m_segments.size());
+    curve.count = static_cast<uint32_t>(c.keys.size() - 1);
+    curve.cursor = 0;
+    curve.firstValue = c.keys.front().value;
+    curve.lastValue = c.keys.back().value;
+    for (size_t k = 0; k + 1 < c.keys.size(); ++k)
+    {
+      auto &k0 = c.keys[k];
+      auto &k1 = c.keys[k + 1];
+      float length = k1.time - k0.time;
+      Segment seg = {};
+      seg.invLength = length > 0.0f ? 1.0f / length : 0.0f;
+      if (k0.interpolation == AnimationClip::Interpolation::Linear)
+      {
+        seg.v[0] = k0.value;
+        seg.v[1] = k1.value - k0.value;
+      }
+      else
+      {
+        // Hermite is a Bezier with the handles a third of the way along
+        bool bezier = k0.interpolation == AnimationClip::Interpolation::Bezier;
+        float outWeight = bezier ? std::clamp(k0.outWeight, 0.0f, 1.0f) : 1.0f / 3.0f;
+        float inWeight = bezier ? std::clamp(k1.inWeight, 0.0f, 1.0f) : 1.0f / 3.0f;
+        float p0 = k0.value;
+        float p1 = k0.value + k0.outSlope * outWeight * length;
+        float p2 = k1.value - k1.inSlope * inWeight * length;
+        float p3 = k1.value;
+        seg.v[0] = p0;
+        seg.v[1] = 3.0f * (p1 - p0);
+        seg.v[2] = 3.0f * (p0 - 2.0f * p1 + p2);
+        seg.v[3] = p3 - p0 + 3.0f * (p1 - p2);
+        // the time handles, if they sit at a third and two thirds time is linear in s
+        float a = outWeight;
+        float b = 1.0f - inWeight;
+        seg.solveTime = std::fabs(a - 1.0f / 3.0f) > 1e-6f || std::fabs(b - 2.0f / 3.0f) > 1e-6f;
+        seg.x[0] = 3.0f * a;
+        seg.x[1] = 3.0f * (b - 2.0f * a);
+        seg.x[2] = 1.0f + 3.0f * (a - b);
+      }
+      m_segments.push_back(seg);
+      m_starts.push_back(k0.time);
+    }
+    m_ends.push_back(c.keys.back().time);
+    m_curves.push_back(curve);
+  }
+  return m_curves.size();
+}
+
+float ClipSampler::evaluate(const Segment &_seg, float _u) const
+{
+  float s = _u;
+  if (_seg.solveTime)
+  {
+    // Newton on time(s) = u, kept inside a bisection bracket as the handles can make it flat
+    float lo = 0.0f;
+    float hi = 1.0f;
+    for (int i = 0; i < 8; ++i)
+    {
+      float x = ((_seg.x[2] * s + _seg.x[1]) * s + _seg.x[0]) * s - _u;
+      if (std::fabs(x) < 1e-6f)
+        break;
+      if (x < 0.0f)
+        lo = s;
+      else
+        hi = s;
+      float dx = (3.0f * _seg.x[2] * s + 2.0f * _seg.x[1]) * s + _seg.x[0];
+      float next = dx != 0.0f ? s - x / dx : lo - 1.0f;
+      s = (next > lo && next < hi) ? next : 0.5f * (lo + hi);
+    }
+  }
+  return ((_seg.v[3] * s + _seg.v[2]) * s + _seg.v[1]) * s + _seg.v[0];
+}
+
+void ClipSampler::sample(float _time, float *_weights)
+{
+  for (size_t ci = 0; ci < m_curves.size(); ++ci)
+  {
+    auto &c = m_curves[ci];
+    if (c.count == 0 || _time <= m_starts[c.first])
+    {
+      _weights[c.target] = c.firstValue;
+      continue;
+    }
+    if (_time >= m_ends[ci])
+    {
+      _weights[c.target] = c.lastValue;
+      continue;
+    }
+    const float *starts = &m_starts[c.first];
+    auto contains = [&](uint32_t _s) { return starts[_s] <= _time && (_s + 1 == c.count || _time < starts[_s + 1]); };
+    // playing forward we are nearly always in the same segment or the next one
+    uint32_t s = c.cursor;
+    if (!contains(s))
+    {
+      if (s + 1 < c.count && contains(s + 1))
+        ++s;
+      else
+        s = static_cast<uint32_t>(std::upper_bound(starts, starts + c.count, _time) - starts - 1);
+    }
+    c.cursor = s;
+    auto &seg = m_segments[c.first + s];
+    _weights[c.target] = evaluate(seg, (_time - starts[s]) * seg.invLength);
+  }
+}
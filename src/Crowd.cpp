@@ -0,0 +1,67 @@
+#include "Crowd.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+// gaps between heads in the grid, the face is about 6 units wide
+constexpr float c_spacingX = 7.0f;
+constexpr float c_spacingZ = 9.0f;
+} // end anon namespace
+
+void Crowd::resize(size_t _count, size_t _numTargets, uint32_t _seed)
+{
+  m_numTargets = _numTargets;
+  m_heads.resize(_count);
+  m_weights.assign(_count * _numTargets, 0.0f);
+  m_matrices.assign(_count * 16, 0.0f);
+
+  std::mt19937 rng(_seed);
+  std::uniform_real_distribution<float> turn(-0.5f, 0.5f);
+  std::uniform_real_distribution<float> scale(0.9f, 1.1f);
+  std::uniform_real_distribution<float> phase(0.0f, 100.0f);
+  std::uniform_real_distribution<float> speed(0.7f, 1.3f);
+  size_t columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(_count))));
+  size_t rows = columns != 0 ? (_count + columns - 1) / columns : 0;
+  m_radius = 0.5f * std::max(columns * c_spacingX, rows * c_spacingZ);
+  for (size_t i = 0; i < _count; ++i)
+  {
+    float x = (static_cast<float>(i % columns) - 0.5f * (columns - 1)) * c_spacingX;
+    float z = -static_cast<float>(i / columns) * c_spacingZ;
+    float angle = turn(rng);
+    float s = scale(rng);
+    float c = std::cos(angle) * s;
+    float n = std::sin(angle) * s;
+    // a turn about y then a uniform scale, column major
+    float *m = &m_matrices[i * 16];
+    m[0] = c;
+    m[2] = -n;
+    m[5] = s;
+    m[8] = n;
+    m[10] = c;
+    m[12] = x;
+    m[14] = z;
+    m[15] = 1.0f;
+    m_heads[i] = {phase(rng), speed(rng)};
+  }
+}
+
+void Crowd::update(float _time, ClipSampler *_clip)
+{
+  if (_clip != nullptr && _clip->numCurves() != 0 && _clip->duration() > 0.0f)
+  {
+    float duration = _clip->duration();
+    for (size_t i = 0; i < m_heads.size(); ++i)
+      _clip->sample(std::fmod(_time * m_heads[i].speed + m_heads[i].phase, duration), &m_weights[i * m_numTargets]);
+    return;
+  }
+  for (size_t i = 0; i < m_heads.size(); ++i)
+  {
+    float *w = &m_weights[i * m_numTargets];
+    float t = _time * m_heads[i].speed + m_heads[i].phase;
+    // a few targets at a time rise and fall, the rest stay at zero
+    for (size_t j = 0; j < m_numTargets; ++j)
+      w[j] = std::max(0.0f, std::sin(t + 2.4f * static_cast<float>(j)) * 1.6f - 0.6f);
+  }
+}
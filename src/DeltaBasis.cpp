@@ -0,0 +1,313 @@
+#include "DeltaBasis.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+// the eigenvalues and eigenvectors of a symmetric _n x _n matrix by cyclic Jacobi rotations. _a is
+// overwritten, its diagonal ends up holding the eigenvalues and _v the eigenvectors as columns. _n is
+// the number of targets so this is never more than a few hundred
+void jacobiEigen(std::vector<double> &_a, size_t _n, std::vector<double> &_v)
+{
+  _v.assign(_n * _n, 0.0);
+  for (size_t i = 0; i < _n; ++i)
+    _v[i * _n + i] = 1.0;
+  for (int sweep = 0; sweep < 64; ++sweep)
+  {
+    double off = 0.0;
+    double diagonal = 0.0;
+    for (size_t p = 0; p < _n; ++p)
+    {
+      diagonal += _a[p * _n + p] * _a[p * _n + p];
+      for (size_t q = p + 1; q < _n; ++q)
+        off += _a[p * _n + q] * _a[p * _n + q];
+    }
+    if (off <= 1e-24 * diagonal)
+      break;
+    for (size_t p = 0; p < _n; ++p)
+    {
+      for (size_t q = p + 1; q < _n; ++q)
+      {
+        double apq = _a[p * _n + q];
+        if (apq == 0.0)
+          continue;
+        // the rotation that zeros a[p][q]
+        double theta = (_a[q * _n + q] - _a[p * _n + p]) / (2.0 * apq);
+        double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+        double c = 1.0 / std::sqrt(t * t + 1.0);
+        double s = t * c;
+        for (size_t k = 0; k < _n; ++k)
+        {
+          double akp = _a[k * _n + p];
+          double akq = _a[k * _n + q];
+          _a[k * _n + p] = c * akp - s * akq;
+          _a[k * _n + q] = s * akp + c * akq;
+        }
+        for (size_t k = 0; k < _n; ++k)
+        {
+          double apk = _a[p * _n + k];
+          double aqk = _a[q * _n + k];
+          _a[p * _n + k] = c * apk - s * aqk;
+          _a[q * _n + k] = s * apk + c * aqk;
+        }
+        for (size_t k = 0; k < _n; ++k)
+        {
+          double vkp = _v[k * _n + p];
+          double vkq = _v[k * _n + q];
+          _v[k * _n + p] = c * vkp - s * vkq;
+          _v[k * _n + q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+}
+
+/// @brief walks the vertices working out the first K shapes at each one from its row of target deltas
+class ShapeRows
+{
+  public:
+    ShapeRows(const int32_t *_offsets, const float *_entries, size_t _numTargets, const std::vector<float> &_mixing,
+              float _epsilon)
+        : m_offsets(_offsets), m_entries(_entries), m_numTargets(_numTargets), m_mixing(_mixing), m_epsilon(_epsilon)
+    {
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the 6 deltas (position then normal) of shapes 0 to _k - 1 at vertex _v, a shape whose
+    /// deltas are all within epsilon is zeroed as BlendTargetSet would drop it
+    //----------------------------------------------------------------------------------------------------------------------
+    const std::vector<float> &at(size_t _v, size_t _k)
+    {
+      m_shape.assign(_k * 6, 0.0f);
+      for (int32_t e = m_offsets[_v]; e < m_offsets[_v + 1]; ++e)
+      {
+        const float *entry = m_entries + e * 8;
+        const float *mix = m_mixing.data() + static_cast<size_t>(entry[3]) * m_numTargets;
+        for (size_t k = 0; k < _k; ++k)
+        {
+          float *s = m_shape.data() + k * 6;
+          for (size_t c = 0; c < 3; ++c)
+          {
+            s[c] += entry[c] * mix[k];
+            s[c + 3] += entry[c + 4] * mix[k];
+          }
+        }
+      }
+      for (size_t k = 0; k < _k; ++k)
+      {
+        float *s = m_shape.data() + k * 6;
+        if (std::all_of(s, s + 6, [this](float _d) { return std::fabs(_d) <= m_epsilon; }))
+          std::fill(s, s + 6, 0.0f);
+      }
+      return m_shape;
+    }
+
+  private:
+    const int32_t *m_offsets;
+    const float *m_entries;
+    size_t m_numTargets;
+    const std::vector<float> &m_mixing;
+    float m_epsilon;
+    std::vector<float> m_shape;
+};
+
+/// @brief the largest position and normal error of each target at full weight when it is mixed from
+/// the first _k shapes
+void measureErrors(const int32_t *_offsets, const float *_entries, size_t _numVerts, size_t _numTargets,
+                   const std::vector<float> &_mixing, float _epsilon, size_t _k, std::vector<float> &_position,
+                   std::vector<float> &_normal)
+{
+  _position.assign(_numTargets, 0.0f);
+  _normal.assign(_numTargets, 0.0f);
+  ShapeRows rows(_offsets, _entries, _numTargets, _mixing, _epsilon);
+  // the real deltas of every target at the vertex, most are zero
+  std::vector<float> truth(_numTargets * 6, 0.0f);
+  for (size_t v = 0; v < _numVerts; ++v)
+  {
+    const std::vector<float> &shape = rows.at(v, _k);
+    for (int32_t e = _offsets[v]; e < _offsets[v + 1]; ++e)
+    {
+      const float *entry = _entries + e * 8;
+      float *t = truth.data() + static_cast<size_t>(entry[3]) * 6;
+      std::copy_n(entry, 3, t);
+      std::copy_n(entry + 4, 3, t + 3);
+    }
+    for (size_t i = 0; i < _numTargets; ++i)
+    {
+      float mixed[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+      const float *mix = _mixing.data() + i * _numTargets;
+      for (size_t k = 0; k < _k; ++k)
+      {
+        for (size_t c = 0; c < 6; ++c)
+          mixed[c] += shape[k * 6 + c] * mix[k];
+      }
+      const float *t = truth.data() + i * 6;
+      float dp = 0.0f;
+      float dn = 0.0f;
+      for (size_t c = 0; c < 3; ++c)
+      {
+        dp += (mixed[c] - t[c]) * (mixed[c] - t[c]);
+        dn += (mixed[c + 3] - t[c + 3]) * (mixed[c + 3] - t[c + 3]);
+      }
+      _position[i] = std::max(_position[i], std::sqrt(dp));
+      _normal[i] = std::max(_normal[i], std::sqrt(dn));
+    }
+    for (int32_t e = _offsets[v]; e < _offsets[v + 1]; ++e)
+      std::fill_n(truth.data() + static_cast<size_t>(_entries[e * 8 + 3]) * 6, 6, 0.0f);
+  }
+}
+} // end anon namespace
+
+void DeltaBasis::assign(size_t _numTargets, size_t _numShapes, const float *_mixing)
+{
+  clear();
+  m_numTargets = _numTargets;
+  m_numShapes = _numShapes;
+  m_mixing.assign(_mixing, _mixing + _numTargets * _numShapes);
+  m_report.numTargets = _numTargets;
+  m_report.numShapes = _numShapes;
+}
+
+void DeltaBasis::clear()
+{
+  m_numTargets = 0;
+  m_numShapes = 0;
+  m_shapes.reset(0);
+  m_mixing.clear();
+  m_report = Report();
+}
+
+void DeltaBasis::build(const int32_t *_offsets, const float *_entries, size_t _numVerts, size_t _numTargets,
+                       float _epsilon, float _tolerance, size_t _maxShapes)
+{
+  auto start = std::chrono::steady_clock::now();
+  clear();
+  if (_numVerts == 0 || _numTargets == 0)
+    return;
+  size_t n = _numTargets;
+  // the Gram matrix of the targets' deltas, each vertex adds the products of the targets in its row
+  std::vector<double> gram(n * n, 0.0);
+  for (size_t v = 0; v < _numVerts; ++v)
+  {
+    for (int32_t a = _offsets[v]; a < _offsets[v + 1]; ++a)
+    {
+      const float *ea = _entries + a * 8;
+      size_t ta = static_cast<size_t>(ea[3]);
+      for (int32_t b = a; b < _offsets[v + 1]; ++b)
+      {
+        const float *eb = _entries + b * 8;
+        size_t tb = static_cast<size_t>(eb[3]);
+        double dot = 0.0;
+        for (size_t c = 0; c < 3; ++c)
+          dot += static_cast<double>(ea[c]) * eb[c] + static_cast<double>(ea[c + 4]) * eb[c + 4];
+        gram[ta * n + tb] += dot;
+        if (ta != tb)
+          gram[tb * n + ta] += dot;
+      }
+    }
+  }
+  std::vector<double> vectors;
+  jacobiEigen(gram, n, vectors);
+  // largest eigenvalue first, the first K shapes then carry the most of the deltas
+  std::vector<size_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t _a, size_t _b) { return gram[_a * n + _a] > gram[_b * n + _b]; });
+  // every column for now, cut down to K once it is known
+  std::vector<float> mixing(n * n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (size_t k = 0; k < n; ++k)
+      mixing[i * n + k] = static_cast<float>(vectors[i * n + order[k]]);
+  }
+
+  // the fewest shapes within the tolerance, the error falls as shapes are added so a binary search
+  // only measures a handful of K
+  size_t hi = _maxShapes != 0 ? std::min(_maxShapes, n) : n;
+  std::vector<float> position;
+  std::vector<float> normal;
+  auto within = [&](size_t _k) {
+    measureErrors(_offsets, _entries, _numVerts, n, mixing, _epsilon, _k, position, normal);
+    return *std::max_element(position.begin(), position.end()) <= _tolerance;
+  };
+  size_t k = hi;
+  if (within(hi))
+  {
+    size_t lo = 1;
+    while (lo < k)
+    {
+      size_t mid = (lo + k) / 2;
+      if (within(mid))
+        k = mid;
+      else
+        lo = mid + 1;
+    }
+  }
+  measureErrors(_offsets, _entries, _numVerts, n, mixing, _epsilon, k, position, normal);
+
+  // the shapes as sparse targets, walking the vertices in order keeps each one's indices sorted
+  std::vector<BlendTargetSet::Target> shapes(k);
+  ShapeRows rows(_offsets, _entries, n, mixing, _epsilon);
+  m_report.basisMaxRow = 0;
+  size_t basisEntries = 0;
+  for (size_t v = 0; v < _numVerts; ++v)
+  {
+    const std::vector<float> &shape = rows.at(v, k);
+    size_t row = 0;
+    for (size_t s = 0; s < k; ++s)
+    {
+      const float *d = shape.data() + s * 6;
+      if (std::all_of(d, d + 6, [](float _d) { return _d == 0.0f; }))
+        continue;
+      shapes[s].indices.push_back(static_cast<uint32_t>(v));
+      shapes[s].positions.push_back(d[0], d[1], d[2]);
+      shapes[s].normals.push_back(d[3], d[4], d[5]);
+      ++row;
+    }
+    basisEntries += row;
+    m_report.basisMaxRow = std::max(m_report.basisMaxRow, row);
+  }
+  m_shapes.setEpsilon(_epsilon);
+  m_shapes.reset(_numVerts);
+  for (auto &s : shapes)
+    m_shapes.addTarget(std::move(s));
+  m_mixing.resize(n * k);
+  for (size_t i = 0; i < n; ++i)
+    std::copy_n(mixing.begin() + i * n, k, m_mixing.begin() + i * k);
+  m_numTargets = n;
+  m_numShapes = k;
+
+  size_t targetEntries = static_cast<size_t>(_offsets[_numVerts]);
+  m_report.numTargets = n;
+  m_report.numShapes = k;
+  m_report.targetBytes = targetEntries * 8 * sizeof(float);
+  m_report.basisBytes = basisEntries * 8 * sizeof(float) + m_mixing.size() * sizeof(float);
+  m_report.targetRow = static_cast<double>(targetEntries) / _numVerts;
+  m_report.basisRow = static_cast<double>(basisEntries) / _numVerts;
+  for (size_t v = 0; v < _numVerts; ++v)
+    m_report.targetMaxRow = std::max(m_report.targetMaxRow, static_cast<size_t>(_offsets[v + 1] - _offsets[v]));
+  auto worst = std::max_element(position.begin(), position.end());
+  m_report.worstTarget = static_cast<size_t>(worst - position.begin());
+  m_report.positionError = *worst;
+  m_report.normalError = *std::max_element(normal.begin(), normal.end());
+  m_report.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void DeltaBasis::project(const float *_weights, float *_coefficients, size_t _count) const
+{
+  for (size_t set = 0; set < _count; ++set)
+  {
+    const float *w = _weights + set * m_numTargets;
+    float *c = _coefficients + set * m_numShapes;
+    std::fill_n(c, m_numShapes, 0.0f);
+    for (size_t i = 0; i < m_numTargets; ++i)
+    {
+      // most weights are zero
+      if (w[i] == 0.0f)
+        continue;
+      const float *mix = m_mixing.data() + i * m_numShapes;
+      for (size_t k = 0; k < m_numShapes; ++k)
+        c[k] += w[i] * mix[k];
+    }
+  }
+}
@@ -0,0 +1,336 @@
+#include "DeltaCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+constexpr float c_snormMax = 32767.0f;
+
+float signNotZero(float _v)
+{
+  return _v >= 0.0f ? 1.0f : -1.0f;
+}
+
+int16_t toSNorm(float _v)
+{
+  return static_cast<int16_t>(std::lround(std::clamp(_v, -1.0f, 1.0f) * c_snormMax));
+}
+
+/// @brief the largest position delta component of each target, used as the snorm scale
+std::vector<float> targetScales(const float *_entries, size_t _numEntries, size_t _numTargets)
+{
+  std::vector<float> scales(_numTargets, 0.0f);
+  for (size_t e = 0; e < _numEntries; ++e)
+  {
+    const float *in = _entries + e * 8;
+    size_t t = static_cast<size_t>(in[3]);
+    for (int c = 0; c < 3; ++c)
+      scales[t] = std::max(scales[t], std::fabs(in[c]));
+  }
+  // a target that doesn't move still needs something to divide by
+  for (auto &s : scales)
+  {
+    if (s == 0.0f)
+      s = 1.0f;
+  }
+  return scales;
+}
+
+/// @brief the normal delta after it has been through the octahedral encoding, as the shader decodes it
+void roundTripNormal(const float _base[3], const float _delta[3], float _out[3])
+{
+  float n[3] = {_base[0] + _delta[0], _base[1] + _delta[1], _base[2] + _delta[2]};
+  int16_t oct[2];
+  DeltaCodec::octEncode(n, oct);
+  DeltaCodec::octDecode(oct, n);
+  for (int c = 0; c < 3; ++c)
+    _out[c] = n[c] - _base[c];
+}
+} // end anon namespace
+
+size_t DeltaCodec::Packed::bytes() const
+{
+  return floats.size() * sizeof(float) + entries.size() * sizeof(uint16_t) + normals.size() * sizeof(int16_t) +
+         scales.size() * sizeof(float);
+}
+
+const char *DeltaCodec::formatName(Format _f)
+{
+  switch (_f)
+  {
+  case Format::Float32:
+    return "float";
+  case Format::Half:
+    return "half";
+  case Format::SNorm16:
+    return "snorm16";
+  }
+  return "unknown";
+}
+
+bool DeltaCodec::parseFormat(const std::string &_name, Format &_f)
+{
+  for (auto f : {Format::Float32, Format::Half, Format::SNorm16})
+  {
+    if (_name == formatName(f))
+    {
+      _f = f;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t DeltaCodec::maxTargets(Format _f)
+{
+  switch (_f)
+  {
+  case Format::Half:
+    return 2048;
+  case Format::SNorm16:
+    return 32768;
+  default:
+    return 16777216;
+  }
+}
+
+uint16_t DeltaCodec::toHalf(float _v)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &_v, sizeof(bits));
+  uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+  uint32_t exponent = (bits >> 23) & 0xffu;
+  uint32_t mantissa = bits & 0x7fffffu;
+  if (exponent == 0xffu)
+    return static_cast<uint16_t>(sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u));
+  int e = static_cast<int>(exponent) - 127 + 15;
+  if (e >= 31)
+    return static_cast<uint16_t>(sign | 0x7c00u);
+  if (e <= 0)
+  {
+    // denormal half (or zero), shift the mantissa with the implicit 1 and round to nearest even
+    if (e < -10)
+      return sign;
+    mantissa |= 0x800000u;
+    uint32_t shift = static_cast<uint32_t>(14 - e);
+    uint32_t half = mantissa >> shift;
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t midway = 1u << (shift - 1);
+    if (rest > midway || (rest == midway && (half & 1u)))
+      ++half;
+    return static_cast<uint16_t>(sign | half);
+  }
+  uint32_t half = (static_cast<uint32_t>(e) << 10) | (mantissa >> 13);
+  uint32_t rest = mantissa & 0x1fffu;
+  // a carry out of the mantissa bumps the exponent which is still the right answer
+  if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+    ++half;
+  return static_cast<uint16_t>(sign | half);
+}
+
+float DeltaCodec::fromHalf(uint16_t _h)
+{
+  uint32_t sign = static_cast<uint32_t>(_h & 0x8000u) << 16;
+  uint32_t exponent = (_h >> 10) & 0x1fu;
+  uint32_t mantissa = _h & 0x3ffu;
+  uint32_t bits;
+  if (exponent == 0)
+  {
+    if (mantissa == 0)
+    {
+      bits = sign;
+    }
+    else
+    {
+      // normalise the denormal
+      int e = -1;
+      do
+      {
+        ++e;
+        mantissa <<= 1;
+      } while ((mantissa & 0x400u) == 0);
+      bits = sign | (static_cast<uint32_t>(127 - 15 - e) << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+  }
+  else if (exponent == 0x1fu)
+  {
+    bits = sign | 0x7f800000u | (mantissa << 13);
+  }
+  else
+  {
+    bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
+  float v;
+  std::memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+void DeltaCodec::octEncode(const float _n[3], int16_t _out[2])
+{
+  float l1 = std::fabs(_n[0]) + std::fabs(_n[1]) + std::fabs(_n[2]);
+  if (l1 == 0.0f)
+  {
+    _out[0] = _out[1] = 0;
+    return;
+  }
+  float x = _n[0] / l1;
+  float y = _n[1] / l1;
+  if (_n[2] < 0.0f)
+  {
+    // fold the lower half over the diagonals
+    float fx = (1.0f - std::fabs(y)) * signNotZero(x);
+    float fy = (1.0f - std::fabs(x)) * signNotZero(y);
+    x = fx;
+    y = fy;
+  }
+  _out[0] = toSNorm(x);
+  _out[1] = toSNorm(y);
+}
+
+void DeltaCodec::octDecode(const int16_t _in[2], float _n[3])
+{
+  // same steps as octDecode in the vertex shader
+  float x = std::max(_in[0] / c_snormMax, -1.0f);
+  float y = std::max(_in[1] / c_snormMax, -1.0f);
+  float z = 1.0f - std::fabs(x) - std::fabs(y);
+  if (z < 0.0f)
+  {
+    float fx = (1.0f - std::fabs(y)) * signNotZero(x);
+    float fy = (1.0f - std::fabs(x)) * signNotZero(y);
+    x = fx;
+    y = fy;
+  }
+  float len = std::sqrt(x * x + y * y + z * z);
+  _n[0] = x / len;
+  _n[1] = y / len;
+  _n[2] = z / len;
+}
+
+DeltaCodec::Packed DeltaCodec::encode(Format _f, const float *_entries, const int32_t *_offsets, size_t _numVerts,
+                                      const float *_baseNormals, size_t _numTargets)
+{
+  Packed packed;
+  packed.format = _f;
+  size_t numEntries = static_cast<size_t>(_offsets[_numVerts]);
+  switch (_f)
+  {
+  case Format::Float32:
+    packed.floats.assign(_entries, _entries + numEntries * 8);
+    break;
+  case Format::Half:
+    packed.entries.resize(numEntries * 8);
+    for (size_t e = 0; e < numEntries * 8; ++e)
+      packed.entries[e] = toHalf(_entries[e]);
+    break;
+  case Format::SNorm16:
+    packed.scales = targetScales(_entries, numEntries, _numTargets);
+    packed.entries.resize(numEntries * 4);
+    packed.normals.resize(numEntries * 2);
+    for (size_t v = 0; v < _numVerts; ++v)
+    {
+      const float *base = _baseNormals + v * 3;
+      for (int32_t e = _offsets[v]; e < _offsets[v + 1]; ++e)
+      {
+        const float *in = _entries + static_cast<size_t>(e) * 8;
+        float scale = packed.scales[static_cast<size_t>(in[3])];
+        uint16_t *out = &packed.entries[static_cast<size_t>(e) * 4];
+        for (int c = 0; c < 3; ++c)
+          out[c] = static_cast<uint16_t>(toSNorm(in[c] / scale));
+        out[3] = static_cast<uint16_t>(in[3]);
+        float n[3] = {base[0] + in[4], base[1] + in[5], base[2] + in[6]};
+        octEncode(n, &packed.normals[static_cast<size_t>(e) * 2]);
+      }
+    }
+    break;
+  }
+  return packed;
+}
+
+void DeltaCodec::decode(const Packed &_packed, const int32_t *_offsets, size_t _numVerts, const float *_baseNormals,
+                        std::vector<float> &_entries)
+{
+  size_t numEntries = static_cast<size_t>(_offsets[_numVerts]);
+  switch (_packed.format)
+  {
+  case Format::Float32:
+    _entries = _packed.floats;
+    break;
+  case Format::Half:
+    _entries.resize(numEntries * 8);
+    for (size_t e = 0; e < numEntries * 8; ++e)
+      _entries[e] = fromHalf(_packed.entries[e]);
+    break;
+  case Format::SNorm16:
+    _entries.resize(numEntries * 8);
+    for (size_t v = 0; v < _numVerts; ++v)
+    {
+      const float *base = _baseNormals + v * 3;
+      for (int32_t e = _offsets[v]; e < _offsets[v + 1]; ++e)
+      {
+        const uint16_t *in = &_packed.entries[static_cast<size_t>(e) * 4];
+        float *out = &_entries[static_cast<size_t>(e) * 8];
+        float step = _packed.scales[in[3]] / c_snormMax;
+        for (int c = 0; c < 3; ++c)
+          out[c] = static_cast<int16_t>(in[c]) * step;
+        out[3] = static_cast<float>(in[3]);
+        float n[3];
+        octDecode(&_packed.normals[static_cast<size_t>(e) * 2], n);
+        for (int c = 0; c < 3; ++c)
+          out[4 + c] = n[c] - base[c];
+        out[7] = 0.0f;
+      }
+    }
+    break;
+  }
+}
+
+void DeltaCodec::quantise(BlendTargetSet &_targets, Format _f, const float *_baseNormals)
+{
+  if (_f == Format::Float32)
+    return;
+  BlendTargetSet out(_targets.epsilon());
+  out.reset(_targets.numVerts());
+  for (size_t ti = 0; ti < _targets.numTargets(); ++ti)
+  {
+    BlendTargetSet::Target t = _targets.target(ti);
+    std::vector<float> *positions[3] = {&t.positions.x, &t.positions.y, &t.positions.z};
+    std::vector<float> *normals[3] = {&t.normals.x, &t.normals.y, &t.normals.z};
+    if (_f == Format::Half)
+    {
+      for (int c = 0; c < 3; ++c)
+      {
+        for (auto &v : *positions[c])
+          v = fromHalf(toHalf(v));
+        for (auto &v : *normals[c])
+          v = fromHalf(toHalf(v));
+      }
+    }
+    else
+    {
+      // same scale encode picks, the largest component of the target
+      float scale = 0.0f;
+      for (int c = 0; c < 3; ++c)
+      {
+        for (auto v : *positions[c])
+          scale = std::max(scale, std::fabs(v));
+      }
+      if (scale == 0.0f)
+        scale = 1.0f;
+      float step = scale / c_snormMax;
+      for (size_t e = 0; e < t.size(); ++e)
+      {
+        for (int c = 0; c < 3; ++c)
+          (*positions[c])[e] = toSNorm((*positions[c])[e] / scale) * step;
+        const float *base = _baseNormals + t.indices[e] * 3;
+        float delta[3] = {t.normals.x[e], t.normals.y[e], t.normals.z[e]};
+        float n[3];
+        roundTripNormal(base, delta, n);
+        for (int c = 0; c < 3; ++c)
+          (*normals[c])[e] = n[c];
+      }
+    }
+    out.addTarget(std::move(t));
+  }
+  _targets = std::move(out);
+}
@@ -0,0 +1,159 @@
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace
+{
+/// @brief mean of the first _count values of a ring
+double mean(const std::vector<float> &_values, size_t _count)
+{
+  _count = std::min(_count, _values.size());
+  if (_count == 0)
+    return 0.0;
+  double total = 0.0;
+  for (size_t i = 0; i < _count; ++i)
+    total += _values[i];
+  return total / _count;
+}
+} // end anon namespace
+
+FrameProfiler::FrameProfiler(std::vector<std::string> _sections)
+    : m_start(std::chrono::steady_clock::now()), m_frameTimes(c_history, 0.0f)
+{
+  m_sections.resize(_sections.size());
+  for (size_t i = 0; i < _sections.size(); ++i)
+  {
+    m_sections[i].name = std::move(_sections[i]);
+    m_sections[i].cpuMs.assign(c_history, 0.0f);
+    m_sections[i].gpuMs.assign(c_history, 0.0f);
+  }
+}
+
+double FrameProfiler::now() const
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+void FrameProfiler::beginFrame()
+{
+  double start = now();
+  if (m_lastFrameStart >= 0.0)
+  {
+    m_frameTimes[m_frameNext] = static_cast<float>(start - m_lastFrameStart);
+    m_frameNext = (m_frameNext + 1) % c_history;
+    m_numFrameTimes = std::min(m_numFrameTimes + 1, c_history);
+  }
+  m_lastFrameStart = start;
+  for (auto &s : m_sections)
+    s.cpuThisFrame = 0.0;
+}
+
+void FrameProfiler::endFrame()
+{
+  for (auto &s : m_sections)
+    s.cpuMs[m_cpuNext] = static_cast<float>(s.cpuThisFrame);
+  m_cpuNext = (m_cpuNext + 1) % c_history;
+  m_numCpuFrames = std::min(m_numCpuFrames + 1, c_history);
+}
+
+void FrameProfiler::beginSection(size_t _section)
+{
+  m_sections[_section].startMs = now();
+}
+
+void FrameProfiler::endSection(size_t _section)
+{
+  auto &s = m_sections[_section];
+  double ms = now() - s.startMs;
+  s.cpuThisFrame += ms;
+  if (m_tracing)
+    trace(_section, 0, s.startMs, ms);
+}
+
+void FrameProfiler::addGpuTime(size_t _section, double _startMs, double _ms)
+{
+  auto &s = m_sections[_section];
+  s.gpuMs[s.gpuNext] = static_cast<float>(_ms);
+  s.gpuNext = (s.gpuNext + 1) % c_history;
+  s.numGpu = std::min(s.numGpu + 1, c_history);
+  m_hasGpu = true;
+  if (m_tracing)
+    trace(_section, 1, _startMs, _ms);
+}
+
+void FrameProfiler::resetFrameTimes()
+{
+  m_frameNext = 0;
+  m_numFrameTimes = 0;
+  m_lastFrameStart = -1.0;
+}
+
+double FrameProfiler::cpuMs(size_t _section) const
+{
+  return mean(m_sections[_section].cpuMs, m_numCpuFrames);
+}
+
+double FrameProfiler::gpuMs(size_t _section) const
+{
+  return mean(m_sections[_section].gpuMs, m_sections[_section].numGpu);
+}
+
+double FrameProfiler::percentile(double _p) const
+{
+  if (m_numFrameTimes == 0)
+    return 0.0;
+  std::vector<float> sorted(m_frameTimes.begin(), m_frameTimes.begin() + m_numFrameTimes);
+  std::sort(sorted.begin(), sorted.end());
+  // nearest rank, so p100 is the slowest frame and p0 the fastest
+  double rank = std::ceil(std::clamp(_p, 0.0, 100.0) / 100.0 * sorted.size());
+  size_t index = rank < 1.0 ? 0 : static_cast<size_t>(rank) - 1;
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+std::vector<size_t> FrameProfiler::histogram() const
+{
+  std::vector<size_t> buckets(c_numBuckets, 0);
+  for (size_t i = 0; i < m_numFrameTimes; ++i)
+  {
+    size_t b = 0;
+    while (b < c_numBuckets - 1 && m_frameTimes[i] >= c_bucketEdges[b])
+      ++b;
+    ++buckets[b];
+  }
+  return buckets;
+}
+
+void FrameProfiler::setTracing(bool _on)
+{
+  if (_on && !m_tracing)
+    m_trace.clear();
+  m_tracing = _on;
+}
+
+void FrameProfiler::trace(size_t _section, uint32_t _track, double _startMs, double _ms)
+{
+  if (m_trace.size() < c_maxTraceEvents)
+    m_trace.push_back({static_cast<uint32_t>(_section), _track, _startMs, _ms});
+}
+
+bool FrameProfiler::writeChromeTrace(const std::string &_fname) const
+{
+  std::ofstream out(_fname);
+  if (!out.is_open())
+    return false;
+  out.setf(std::ios::fixed);
+  out.precision(3);
+  // times are in microseconds, each track is a thread of one process
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"CPU\"}},\n";
+  out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": {\"name\": \"GPU\"}}";
+  for (auto &e : m_trace)
+  {
+    out << ",\n{\"name\": \"" << m_sections[e.section].name << "\", \"cat\": \"" << (e.track == 0 ? "cpu" : "gpu")
+        << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.track + 1 << ", \"ts\": " << e.startMs * 1000.0
+        << ", \"dur\": " << e.ms * 1000.0 << '}';
+  }
+  out << "\n]}\n";
+  return static_cast<bool>(out);
+}
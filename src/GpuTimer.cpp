@@ -0,0 +1,116 @@
+#include "GpuTimer.h"
+#include <algorithm>
+
+GpuTimer::~GpuTimer()
+{
+  destroy();
+}
+
+void GpuTimer::destroy()
+{
+  for (auto &f : m_frames)
+    glDeleteQueries(static_cast<GLsizei>(f.queries.size()), f.queries.data());
+  m_frames.clear();
+}
+
+bool GpuTimer::create(const FrameProfiler &_profiler, size_t _numFrames)
+{
+  destroy();
+  // timestamps are core in 3.3 but a driver can still report a counter with no bits
+  GLint major = 0;
+  GLint minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  if (major < 3 || (major == 3 && minor < 3))
+    return false;
+  GLint bits = 0;
+  glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+  if (bits == 0)
+    return false;
+  m_frames.resize(std::max<size_t>(_numFrames, 2));
+  size_t numSections = _profiler.numSections();
+  for (auto &f : m_frames)
+  {
+    f.queries.resize(numSections * 2);
+    f.begun.assign(numSections, false);
+    f.ended.assign(numSections, false);
+    glGenQueries(static_cast<GLsizei>(f.queries.size()), f.queries.data());
+  }
+  m_current = 0;
+  GLint64 gpuNow = 0;
+  glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+  m_offsetMs = _profiler.now() - gpuNow * 1e-6;
+  return true;
+}
+
+void GpuTimer::begin(size_t _section)
+{
+  if (!m_enabled || m_frames.empty())
+    return;
+  auto &f = m_frames[m_current];
+  if (f.begun[_section])
+    return;
+  glQueryCounter(f.queries[_section * 2], GL_TIMESTAMP);
+  f.begun[_section] = true;
+}
+
+void GpuTimer::end(size_t _section)
+{
+  if (!m_enabled || m_frames.empty())
+    return;
+  auto &f = m_frames[m_current];
+  if (!f.begun[_section] || f.ended[_section])
+    return;
+  glQueryCounter(f.queries[_section * 2 + 1], GL_TIMESTAMP);
+  f.ended[_section] = true;
+  f.lastQuery = f.queries[_section * 2 + 1];
+  f.pending = true;
+}
+
+bool GpuTimer::collect(Frame &_frame, FrameProfiler &_profiler, bool _wait)
+{
+  if (!_frame.pending)
+    return true;
+  if (!_wait)
+  {
+    // the queries finish in order so if the last one issued is done they all are
+    GLint available = 0;
+    glGetQueryObjectiv(_frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+      return false;
+  }
+  for (size_t s = 0; s < _frame.ended.size(); ++s)
+  {
+    if (_frame.ended[s])
+    {
+      GLuint64 start = 0;
+      GLuint64 end = 0;
+      glGetQueryObjectui64v(_frame.queries[s * 2], GL_QUERY_RESULT, &start);
+      glGetQueryObjectui64v(_frame.queries[s * 2 + 1], GL_QUERY_RESULT, &end);
+      _profiler.addGpuTime(s, start * 1e-6 + m_offsetMs, (end - start) * 1e-6);
+    }
+    _frame.begun[s] = false;
+    _frame.ended[s] = false;
+  }
+  _frame.pending = false;
+  return true;
+}
+
+void GpuTimer::endFrame(FrameProfiler &_profiler)
+{
+  if (m_frames.empty())
+    return;
+  // a section begun but not ended this frame can't be timed
+  auto &current = m_frames[m_current];
+  for (size_t s = 0; s < current.begun.size(); ++s)
+    current.begun[s] = current.ended[s];
+  m_current = (m_current + 1) % m_frames.size();
+  // oldest first so the times go to the profiler in order
+  for (size_t i = 0; i + 1 < m_frames.size(); ++i)
+  {
+    if (!collect(m_frames[(m_current + i) % m_frames.size()], _profiler, false))
+      break;
+  }
+  // the frame about to be reused has to be read now, which only waits if the GPU is that far behind
+  collect(m_frames[m_current], _profiler, true);
+}
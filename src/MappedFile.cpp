@@ -0,0 +1,157 @@
+#include "MappedFile.h"
+#include <algorithm>
+#include <utility>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+MappedFile::MappedFile(MappedFile &&_other) noexcept
+{
+  *this = std::move(_other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&_other) noexcept
+{
+  if (this != &_other)
+  {
+    close();
+    std::swap(m_data, _other.m_data);
+    std::swap(m_size, _other.m_size);
+    std::swap(m_open, _other.m_open);
+#if defined(_WIN32)
+    std::swap(m_file, _other.m_file);
+    std::swap(m_mapping, _other.m_mapping);
+#endif
+  }
+  return *this;
+}
+
+#if defined(_WIN32)
+bool MappedFile::open(const std::string &_fname)
+{
+  close();
+  HANDLE file = CreateFileA(_fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size))
+  {
+    CloseHandle(file);
+    return false;
+  }
+  m_file = file;
+  m_size = static_cast<size_t>(size.QuadPart);
+  m_open = true;
+  // can't map an empty file but that's not an error
+  if (m_size == 0)
+    return true;
+  m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_mapping != nullptr)
+    m_data = static_cast<const unsigned char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (m_data == nullptr)
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::advise(size_t _offset, size_t _bytes, Advice _advice) const
+{
+  if (m_data == nullptr || _offset >= m_size)
+    return;
+  _bytes = std::min(_bytes, m_size - _offset);
+  // there is no way to drop pages of a read only view short of unmapping it, the working set trimmer
+  // takes them back when memory is short
+  if (_advice != Advice::WillNeed || _bytes == 0)
+    return;
+  WIN32_MEMORY_RANGE_ENTRY range;
+  range.VirtualAddress = const_cast<unsigned char *>(m_data + _offset);
+  range.NumberOfBytes = _bytes;
+  PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MappedFile::close()
+{
+  if (m_data != nullptr)
+    UnmapViewOfFile(m_data);
+  if (m_mapping != nullptr)
+    CloseHandle(m_mapping);
+  if (m_file != nullptr)
+    CloseHandle(m_file);
+  m_data = nullptr;
+  m_mapping = nullptr;
+  m_file = nullptr;
+  m_size = 0;
+  m_open = false;
+}
+#else
+bool MappedFile::open(const std::string &_fname)
+{
+  close();
+  int fd = ::open(_fname.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+  {
+    ::close(fd);
+    return false;
+  }
+  m_size = static_cast<size_t>(st.st_size);
+  m_open = true;
+  if (m_size != 0)
+  {
+    void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+      ::close(fd);
+      m_size = 0;
+      m_open = false;
+      return false;
+    }
+    m_data = static_cast<const unsigned char *>(data);
+  }
+  // the mapping keeps its own reference to the file
+  ::close(fd);
+  return true;
+}
+
+void MappedFile::advise(size_t _offset, size_t _bytes, Advice _advice) const
+{
+  if (m_data == nullptr || _offset >= m_size)
+    return;
+  size_t end = _offset + std::min(_bytes, m_size - _offset);
+  // madvise wants a page aligned start, the mapping itself starts on a page
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t first = _advice == Advice::WillNeed ? _offset / page * page : (_offset + page - 1) / page * page;
+  size_t last = _advice == Advice::WillNeed ? end : (end == m_size ? end : end / page * page);
+  if (last <= first)
+    return;
+  // posix_madvise's DONTNEED does nothing on linux, madvise drops the pages of a file mapping
+  madvise(const_cast<unsigned char *>(m_data + first), last - first,
+          _advice == Advice::WillNeed ? MADV_WILLNEED : MADV_DONTNEED);
+}
+
+void MappedFile::close()
+{
+  if (m_data != nullptr)
+    munmap(const_cast<unsigned char *>(m_data), m_size);
+  m_data = nullptr;
+  m_size = 0;
+  m_open = false;
+}
+#endif
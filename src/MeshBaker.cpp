@@ -0,0 +1,348 @@
+#include "MeshBaker.h"
+#include "AnimationClip.h"
+#include "ClipSampler.h"
+#include "ParseNumber.h"
+#include "PointCache.h"
+#include "WeightStream.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+void appendFloat(AsyncWriter::Buffer &_out, float _v)
+{
+  // shortest text that reads back as the same float, much faster than iostreams
+  char text[32];
+  auto result = std::to_chars(text, text + sizeof(text), _v);
+  _out.insert(_out.end(), text, result.ptr);
+}
+
+void appendLine(AsyncWriter::Buffer &_out, const char *_prefix, float _x, float _y, float _z)
+{
+  _out.insert(_out.end(), _prefix, _prefix + std::strlen(_prefix));
+  appendFloat(_out, _x);
+  _out.push_back(' ');
+  appendFloat(_out, _y);
+  _out.push_back(' ');
+  appendFloat(_out, _z);
+  _out.push_back('\n');
+}
+
+bool loadCapture(const std::string &_fname, size_t _numTargets, std::vector<float> &_frames)
+{
+#if defined(_WIN32)
+  int fd = _open(_fname.c_str(), _O_RDONLY | _O_BINARY);
+#else
+  int fd = ::open(_fname.c_str(), O_RDONLY);
+#endif
+  if (fd < 0)
+    return false;
+  WeightStream::PacketHeader header;
+  std::vector<float> weights;
+  while (WeightStream::readPacket(fd, header, weights))
+  {
+    // the same rule as the live stream, extra weights are dropped and missing ones are zero
+    weights.resize(_numTargets, 0.0f);
+    _frames.insert(_frames.end(), weights.begin(), weights.end());
+  }
+#if defined(_WIN32)
+  _close(fd);
+#else
+  ::close(fd);
+#endif
+  return true;
+}
+
+bool loadCsv(const std::string &_fname, size_t _numTargets, std::vector<float> &_frames, std::string &_error)
+{
+  std::ifstream in(_fname);
+  if (!in.is_open())
+  {
+    _error = "unable to read weights from " + _fname;
+    return false;
+  }
+  std::string line;
+  size_t lineNumber = 0;
+  while (std::getline(in, line))
+  {
+    ++lineNumber;
+    if (line.empty() || line[0] == '#' || line == "\r")
+      continue;
+    std::stringstream ss(line);
+    std::string token;
+    size_t first = _frames.size();
+    _frames.resize(first + _numTargets);
+    // the first column is the time, then a weight per target
+    size_t column = 0;
+    for (; std::getline(ss, token, ','); ++column)
+    {
+      auto begin = token.find_first_not_of(" \t");
+      auto end = token.find_last_not_of(" \t\r");
+      token = begin == std::string::npos ? std::string() : token.substr(begin, end - begin + 1);
+      float value;
+      if (!parseNumber(token, value))
+      {
+        _error = _fname + " line " + std::to_string(lineNumber) + ", \"" + token + "\" isn't a number";
+        return false;
+      }
+      if (column != 0 && column <= _numTargets)
+        _frames[first + column - 1] = value;
+    }
+    if (column != _numTargets + 1)
+    {
+      _error = _fname + " line " + std::to_string(lineNumber) + " has " + std::to_string(column == 0 ? 0 : column - 1) +
+               " weights, the rig has " + std::to_string(_numTargets) + " targets";
+      return false;
+    }
+  }
+  return true;
+}
+} // end anon namespace
+
+MeshBaker::MeshBaker(const BlendRig &_rig, size_t _numThreads) : m_rig(_rig), m_pool(_numThreads)
+{
+  m_evaluators.resize(m_pool.size());
+  m_frames.resize(m_pool.size());
+  m_poseKeys.resize(m_pool.size());
+  for (auto &e : m_evaluators)
+  {
+    e.setRig(_rig);
+    e.setKernel(BlendShapeEvaluator::Kernel::Auto);
+  }
+  m_positionSource.assign(_rig.numSourcePositions(), -1);
+  m_normalSource.assign(_rig.numSourceNormals(), -1);
+  for (size_t v = 0; v < _rig.numVerts(); ++v)
+  {
+    if (m_positionSource[_rig.positionIndex()[v]] < 0)
+      m_positionSource[_rig.positionIndex()[v]] = static_cast<int64_t>(v);
+    if (m_normalSource[_rig.normalIndex()[v]] < 0)
+      m_normalSource[_rig.normalIndex()[v]] = static_cast<int64_t>(v);
+  }
+  // obj indices count from 1
+  auto &indices = _rig.indices();
+  for (size_t i = 0; i + 2 < indices.size(); i += 3)
+  {
+    m_objFaces += "f";
+    for (size_t c = 0; c < 3; ++c)
+    {
+      uint32_t v = indices[i + c];
+      m_objFaces += ' ' + std::to_string(_rig.positionIndex()[v] + 1) + "//" + std::to_string(_rig.normalIndex()[v] + 1);
+    }
+    m_objFaces += '\n';
+  }
+}
+
+void MeshBaker::setNormalMode(NormalRebuilder::Mode _m)
+{
+  // every worker builds its own adjacency on its first frame
+  for (auto &e : m_evaluators)
+    e.setNormalMode(_m);
+}
+
+void MeshBaker::setPoseCache(size_t _budgetBytes, float _step)
+{
+  m_poseBudget = _budgetBytes;
+  m_poseStep = _step;
+}
+
+bool MeshBaker::loadWeights(const std::string &_fname, const std::vector<std::string> &_targetNames, float _fps,
+                            std::vector<float> &_frames, std::string &_error)
+{
+  _frames.clear();
+  auto endsWith = [&](const char *_ext) {
+    size_t n = std::strlen(_ext);
+    return _fname.size() >= n && _fname.compare(_fname.size() - n, n, _ext) == 0;
+  };
+  if (endsWith(".fws"))
+  {
+    if (!loadCapture(_fname, _targetNames.size(), _frames))
+    {
+      _error = "unable to read weights from " + _fname;
+      return false;
+    }
+  }
+  else if (endsWith(".csv"))
+  {
+    if (!loadCsv(_fname, _targetNames.size(), _frames, _error))
+      return false;
+  }
+  else
+  {
+    AnimationClip clip;
+    if (!clip.loadAny(_fname))
+    {
+      _error = clip.errorString();
+      return false;
+    }
+    ClipSampler sampler;
+    sampler.bind(clip, _targetNames);
+    size_t numFrames = static_cast<size_t>(std::floor(sampler.duration() * _fps)) + 1;
+    _frames.assign(numFrames * _targetNames.size(), 0.0f);
+    for (size_t f = 0; f < numFrames; ++f)
+      sampler.sample(static_cast<float>(f) / _fps, &_frames[f * _targetNames.size()]);
+  }
+  if (_frames.empty())
+  {
+    _error = _fname + " has no frames";
+    return false;
+  }
+  return true;
+}
+
+std::string MeshBaker::objFrameName(const std::string &_pattern, size_t _frame)
+{
+  size_t hash = _pattern.find('#');
+  std::string number = std::to_string(_frame);
+  if (hash == std::string::npos)
+  {
+    // face.obj becomes face_0001.obj
+    size_t dot = _pattern.rfind('.');
+    size_t slash = _pattern.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+      dot = _pattern.size();
+    if (number.size() < 4)
+      number.insert(0, 4 - number.size(), '0');
+    return _pattern.substr(0, dot) + "_" + number + _pattern.substr(dot);
+  }
+  size_t end = _pattern.find_first_not_of('#', hash);
+  if (end == std::string::npos)
+    end = _pattern.size();
+  if (number.size() < end - hash)
+    number.insert(0, end - hash - number.size(), '0');
+  return _pattern.substr(0, hash) + number + _pattern.substr(end);
+}
+
+void MeshBaker::bake(size_t _numFrames, const std::vector<float> &_frames, AsyncWriter &_writer,
+                     const FrameWriter &_write)
+{
+  auto start = std::chrono::steady_clock::now();
+  size_t numTargets = m_rig.numTargets();
+  size_t numVerts = m_rig.numVerts();
+  size_t frameFloats = numVerts * 6;
+  for (auto &f : m_frames)
+    f.resize(frameFloats);
+  // sized for this bake, a short clip doesn't need the whole budget
+  m_poseCache.configure(numTargets, frameFloats * sizeof(float),
+                        std::min(m_poseBudget, _numFrames * frameFloats * sizeof(float)), m_poseStep);
+  m_poseCache.resetStats();
+  m_poses.reset(m_poseCache.enabled() ? new float[m_poseCache.numSlots() * frameFloats] : nullptr);
+  std::vector<double> computeMs(m_pool.size(), 0.0);
+  m_pool.parallelFor(_numFrames, [&](size_t _frame, size_t _worker) {
+    auto frameStart = std::chrono::steady_clock::now();
+    const float *weights = &_frames[_frame * numTargets];
+    float *frame = m_frames[_worker].data();
+    auto &key = m_poseKeys[_worker];
+    bool cached = false;
+    if (m_poseCache.enabled())
+    {
+      m_poseCache.makeKey(weights, key);
+      std::lock_guard<std::mutex> lock(m_poseMutex);
+      int64_t slot = m_poseCache.find(key);
+      if (slot >= 0)
+      {
+        std::copy_n(&m_poses[static_cast<size_t>(slot) * frameFloats], frameFloats, frame);
+        cached = true;
+      }
+    }
+    if (!cached)
+    {
+      auto &evaluator = m_evaluators[_worker];
+      evaluator.evaluate(weights);
+      evaluator.positions().toInterleaved(frame);
+      evaluator.normals().toInterleaved(frame + numVerts * 3);
+      if (m_poseCache.enabled())
+      {
+        std::lock_guard<std::mutex> lock(m_poseMutex);
+        std::copy_n(frame, frameFloats, &m_poses[m_poseCache.insert(key) * frameFloats]);
+      }
+    }
+    _write(_frame, frame, _writer);
+    computeMs[_worker] +=
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+  });
+  m_stats.frames = _numFrames;
+  m_stats.threads = m_pool.size();
+  m_stats.steals = m_pool.steals();
+  m_stats.poses = m_poseCache.stats();
+  m_stats.computeMs = 0.0;
+  for (auto ms : computeMs)
+    m_stats.computeMs += ms;
+  m_stats.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool MeshBaker::bakeObj(const std::vector<float> &_frames, const std::string &_pattern)
+{
+  size_t numFrames = m_rig.numTargets() != 0 ? _frames.size() / m_rig.numTargets() : 0;
+  AsyncWriter writer(2 * m_pool.size());
+  auto start = std::chrono::steady_clock::now();
+  size_t numVerts = m_rig.numVerts();
+  bake(numFrames, _frames, writer, [&](size_t _frame, const float *_data, AsyncWriter &_w) {
+    auto *out = _w.acquire();
+    const char *comment = "# FacialAnimation baked frame\n";
+    out->insert(out->end(), comment, comment + std::strlen(comment));
+    // the obj lists in the order of the base obj, every unique vertex using one has the same value
+    for (auto v : m_positionSource)
+    {
+      if (v < 0)
+        appendLine(*out, "v ", 0.0f, 0.0f, 0.0f);
+      else
+        appendLine(*out, "v ", _data[v * 3], _data[v * 3 + 1], _data[v * 3 + 2]);
+    }
+    const float *n = _data + numVerts * 3;
+    for (auto v : m_normalSource)
+    {
+      if (v < 0)
+        appendLine(*out, "vn ", 0.0f, 0.0f, 1.0f);
+      else
+        appendLine(*out, "vn ", n[v * 3], n[v * 3 + 1], n[v * 3 + 2]);
+    }
+    out->insert(out->end(), m_objFaces.begin(), m_objFaces.end());
+    _w.writeFile(objFrameName(_pattern, _frame), out);
+  });
+  bool ok = writer.finish();
+  m_stats.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  m_stats.writeMs = writer.writeMs();
+  m_stats.bytes = writer.bytesWritten();
+  return ok;
+}
+
+bool MeshBaker::bakePointCache(const std::vector<float> &_frames, float _fps, uint64_t _sourceHash,
+                               const std::string &_fname)
+{
+  size_t numFrames = m_rig.numTargets() != 0 ? _frames.size() / m_rig.numTargets() : 0;
+  size_t numVerts = m_rig.numVerts();
+  AsyncWriter writer(2 * m_pool.size());
+  if (!writer.open(_fname))
+    return false;
+  auto start = std::chrono::steady_clock::now();
+  auto header = PointCache::makeHeader(numVerts, numFrames, _fps, _sourceHash);
+  auto *headerBuffer = writer.acquire();
+  // the header fills the first page so the frames start page aligned
+  headerBuffer->assign(PointCache::c_pageSize, 0);
+  std::memcpy(headerBuffer->data(), &header, sizeof(header));
+  writer.writeAt(0, headerBuffer);
+  bake(numFrames, _frames, writer, [&](size_t _frame, const float *_data, AsyncWriter &_w) {
+    auto *out = _w.acquire();
+    // pad every frame to the stride, the last one as well so the file is the size the header says
+    out->assign(header.frameStride, 0);
+    std::memcpy(out->data(), _data, numVerts * 6 * sizeof(float));
+    _w.writeAt(PointCache::frameOffset(header, _frame), out);
+  });
+  bool ok = writer.finish();
+  m_stats.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  m_stats.writeMs = writer.writeMs();
+  m_stats.bytes = writer.bytesWritten();
+  return ok;
+}
@@ -0,0 +1,191 @@
+#include "ModelFile.h"
+#include "ParseNumber.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+// FNV-1a, it only has to notice changes not resist attacks
+constexpr uint64_t c_fnvOffset = 14695981039346656037ull;
+constexpr uint64_t c_fnvPrime = 1099511628211ull;
+
+void hashBytes(uint64_t &_h, const void *_data, size_t _size)
+{
+  auto bytes = static_cast<const unsigned char *>(_data);
+  for (size_t i = 0; i < _size; ++i)
+  {
+    _h ^= bytes[i];
+    _h *= c_fnvPrime;
+  }
+}
+
+void hashString(uint64_t &_h, const std::string &_s)
+{
+  hashBytes(_h, _s.data(), _s.size());
+  // include the terminator so "ab","c" and "a","bc" differ
+  hashBytes(_h, "", 1);
+}
+
+void hashFileStamp(uint64_t &_h, const std::string &_path)
+{
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  int64_t size = static_cast<int64_t>(fs::file_size(_path, ec));
+  if (ec)
+    size = -1;
+  int64_t time = 0;
+  auto stamp = fs::last_write_time(_path, ec);
+  if (!ec)
+    time = static_cast<int64_t>(stamp.time_since_epoch().count());
+  hashBytes(_h, &size, sizeof(size));
+  hashBytes(_h, &time, sizeof(time));
+}
+
+std::string trim(const std::string &_s)
+{
+  auto start = _s.find_first_not_of(" \t\r\n");
+  if (start == std::string::npos)
+    return "";
+  auto end = _s.find_last_not_of(" \t\r\n");
+  return _s.substr(start, end - start + 1);
+}
+} // end anon namespace
+
+bool ModelFile::load(const std::string &_fname)
+{
+  std::ifstream fileIn(_fname);
+  if (!fileIn.is_open())
+  {
+    m_error = "can't read " + _fname;
+    return false;
+  }
+  // start from the defaults, a line that has gone since the last load mustn't keep its value
+  *this = ModelFile();
+  m_fileName = _fname;
+
+  std::string lineBuffer;
+  size_t lineNumber = 0;
+  auto badNumber = [&](const std::string &_token) {
+    m_error = _fname + " line " + std::to_string(lineNumber) + ", \"" + _token + "\" isn't a number";
+    return false;
+  };
+  while (std::getline(fileIn, lineBuffer))
+  {
+    ++lineNumber;
+    lineBuffer = trim(lineBuffer);
+    if (lineBuffer.empty() || lineBuffer[0] == '#')
+      continue;
+    // split on ,
+    std::vector<std::string> tokens;
+    std::stringstream ss(lineBuffer);
+    std::string token;
+    while (std::getline(ss, token, ','))
+      tokens.push_back(trim(token));
+
+    if (tokens[0] == "BaseMesh" && tokens.size() >= 2)
+    {
+      m_baseMesh = tokens[1];
+    }
+    else if (tokens[0] == "BlendShape" && tokens.size() >= 3)
+    {
+      Entry e;
+      e.name = tokens[1];
+      e.path = tokens[2];
+      m_blendShapes.push_back(std::move(e));
+    }
+    else if (tokens[0] == "Corrective" && tokens.size() >= 5)
+    {
+      Entry e;
+      e.name = tokens[1];
+      e.path = tokens[2];
+      e.kind = Kind::Corrective;
+      e.drivers.assign(tokens.begin() + 3, tokens.end());
+      m_blendShapes.push_back(std::move(e));
+    }
+    else if (tokens[0] == "InBetween" && tokens.size() >= 5)
+    {
+      Entry e;
+      e.name = tokens[1];
+      e.path = tokens[2];
+      e.kind = Kind::InBetween;
+      e.drivers.push_back(tokens[3]);
+      if (!parseNumber(tokens[4], e.weight))
+        return badNumber(tokens[4]);
+      m_blendShapes.push_back(std::move(e));
+    }
+    else if (tokens[0] == "DeltaEpsilon" && tokens.size() >= 2)
+    {
+      if (!parseNumber(tokens[1], m_deltaEpsilon))
+        return badNumber(tokens[1]);
+    }
+    else if (tokens[0] == "DeltaFormat" && tokens.size() >= 2)
+    {
+      // the baked cache is always float so this isn't part of the source hash
+      DeltaCodec::parseFormat(tokens[1], m_deltaFormat);
+    }
+    else if (tokens[0] == "Normals" && tokens.size() >= 2)
+    {
+      // the adjacency is built at load time from the cached topology so this isn't hashed either
+      NormalRebuilder::parseMode(tokens[1], m_normalMode);
+    }
+    else if (tokens[0] == "Clip" && tokens.size() >= 2)
+    {
+      m_clip = tokens[1];
+    }
+    else if (tokens[0] == "Lod" && tokens.size() >= 2)
+    {
+      // the levels are decimated at load time from the cached rig so they aren't hashed
+      m_lodRatios.resize(tokens.size() - 1);
+      for (size_t i = 1; i < tokens.size(); ++i)
+      {
+        if (!parseNumber(tokens[i], m_lodRatios[i - 1]))
+          return badNumber(tokens[i]);
+      }
+    }
+    else if (tokens[0] == "LodPixels" && tokens.size() >= 2)
+    {
+      if (!parseNumber(tokens[1], m_lodPixels))
+        return badNumber(tokens[1]);
+    }
+    else if (tokens[0] == "Basis" && tokens.size() >= 2)
+    {
+      // FacialRigBake stores the settings with the shapes it builds so this isn't hashed
+      if (!parseNumber(tokens[1], m_basisTolerance))
+        return badNumber(tokens[1]);
+      m_basisMaxShapes = 0;
+      if (tokens.size() >= 3 && !parseNumber(tokens[2], m_basisMaxShapes))
+        return badNumber(tokens[2]);
+    }
+  }
+  if (m_baseMesh.empty())
+    m_error = _fname + " has no BaseMesh";
+  return !m_baseMesh.empty();
+}
+
+uint64_t ModelFile::sourceHash() const
+{
+  uint64_t h = c_fnvOffset;
+  hashString(h, m_baseMesh);
+  hashFileStamp(h, m_baseMesh);
+  for (auto &e : m_blendShapes)
+  {
+    hashString(h, e.name);
+    hashString(h, e.path);
+    hashFileStamp(h, e.path);
+  }
+  hashBytes(h, &m_deltaEpsilon, sizeof(m_deltaEpsilon));
+  return h;
+}
+
+uint64_t ModelFile::fileStamp(const std::string &_path)
+{
+  uint64_t h = c_fnvOffset;
+  hashFileStamp(h, _path);
+  return h;
+}
+
+std::string ModelFile::cacheFileName() const
+{
+  return std::filesystem::path(m_fileName).replace_extension(".rig").string();
+}
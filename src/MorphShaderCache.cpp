@@ -0,0 +1,47 @@
+#include "MorphShaderCache.h"
+#include <ngl/ShaderLib.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+MorphShaderCache::MorphShaderCache(const std::string &_vertexTemplate, const std::string &_fragmentShader,
+                                   const std::string &_baseName)
+    : m_fragmentShader(_fragmentShader), m_baseName(_baseName)
+{
+  std::ifstream in(_vertexTemplate);
+  if (!in.is_open())
+  {
+    std::cerr << "can't open shader template " << _vertexTemplate << '\n';
+    return;
+  }
+  std::stringstream source;
+  source << in.rdbuf();
+  m_template = source.str();
+}
+
+std::string MorphShaderCache::program(const MorphShaderSource::Variant &_variant, bool &_created)
+{
+  _created = false;
+  std::string name = MorphShaderSource::name(m_baseName, _variant);
+  if (m_programs.count(name) != 0)
+    return name;
+  if (m_template.empty())
+    return std::string();
+
+  // the compute pre-pass is a program on its own, the vertex shader is paired with the fragment shader
+  std::string shader = name + (_variant.compute ? "Compute" : "Vertex");
+  ngl::ShaderLib::createShaderProgram(name);
+  ngl::ShaderLib::attachShader(shader, _variant.compute ? ngl::ShaderType::COMPUTE : ngl::ShaderType::VERTEX);
+  ngl::ShaderLib::loadShaderSourceFromString(shader, MorphShaderSource::specialise(m_template, _variant));
+  if (!ngl::ShaderLib::compileShader(shader))
+    return std::string();
+  ngl::ShaderLib::attachShaderToProgram(name, shader);
+  if (!_variant.compute)
+    ngl::ShaderLib::attachShaderToProgram(name, m_fragmentShader);
+  if (!ngl::ShaderLib::linkProgramObject(name))
+    return std::string();
+  std::cout << "built shader " << name << '\n';
+  m_programs.insert(name);
+  _created = true;
+  return name;
+}
@@ -0,0 +1,49 @@
+#include "MorphShaderSource.h"
+
+std::string MorphShaderSource::name(const std::string &_base, const Variant &_variant)
+{
+  std::string name = _base + "_" + std::to_string(_variant.numTargets) + (_variant.weightsInTBO ? "_tbo" : "_ssbo");
+  // float and half share a program
+  if (_variant.deltaFormat == DeltaCodec::Format::SNorm16)
+    name += "_snorm16";
+  if (_variant.topologyNormals)
+    name += "_topo";
+  if (_variant.compute)
+    name += "_cs";
+  else if (_variant.instanced)
+    name += "_inst";
+  return name;
+}
+
+std::string MorphShaderSource::specialise(const std::string &_template, const Variant &_variant)
+{
+  // storage buffers need 4.3, without them we only rely on what mac has
+  bool weightsInTBO = _variant.weightsInTBO && !_variant.compute;
+  std::string source = weightsInTBO ? "#version 410 core\n" : "#version 430 core\n";
+  source += "#define NUM_TARGETS " + std::to_string(_variant.numTargets) + "\n";
+  if (_variant.unrolled())
+    source += "#define MORPH_UNROLLED\n";
+  if (weightsInTBO)
+    source += "#define WEIGHTS_IN_TBO\n";
+  if (_variant.compute)
+    source += "#define MORPH_COMPUTE\n";
+  else if (_variant.instanced)
+    source += "#define MORPH_INSTANCED\n";
+  if (_variant.deltaFormat == DeltaCodec::Format::SNorm16)
+    source += "#define DELTAS_SNORM16\n";
+  if (_variant.topologyNormals)
+    source += "#define MORPH_TOPOLOGY_NORMALS\n";
+
+  // drop the template's own #version, it has to be the first thing in the shader
+  size_t body = 0;
+  size_t first = _template.find_first_not_of(" \t\r\n");
+  if (first != std::string::npos && _template.compare(first, 8, "#version") == 0)
+  {
+    body = _template.find('\n', first);
+    body = (body == std::string::npos) ? _template.size() : body + 1;
+  }
+  // keep the line numbers in compile errors matching the file
+  source += (body == 0) ? "#line 1\n" : "#line 2\n";
+  source.append(_template, body, std::string::npos);
+  return source;
+}
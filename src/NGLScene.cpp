@@ -1,22 +1,114 @@
 #include <QMouseEvent>
+#include <QTimerEvent>
 #include <QGuiApplication>
 
 #include "NGLScene.h"
+#include "ModelFile.h"
+#include "RigLoader.h"
 #include <ngl/NGLInit.h>
 #include <ngl/VAOPrimitives.h>
 #include <ngl/ShaderLib.h>
 #include <ngl/Transformation.h>
-#include <ngl/pystring.h>
+#include <ngl/SimpleIndexVAO.h>
+#include <ngl/SimpleVAO.h>
+#include <ngl/VAOFactory.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <numeric>
 
-NGLScene::NGLScene()
+namespace
+{
+// times a section on both the CPU and the GPU
+class ProfileScope
+{
+  public:
+    ProfileScope(FrameProfiler &_profiler, GpuTimer &_gpu, size_t _section)
+        : m_cpu(_profiler, _section), m_gpu(_gpu, _section)
+    {
+    }
+
+  private:
+    FrameProfiler::Scope m_cpu;
+    GpuTimer::Scope m_gpu;
+};
+
+// the first four values of each eight value entry, the position delta and target without the normal delta
+template <typename T>
+std::vector<T> positionTexels(const T *_entries, size_t _numEntries)
+{
+  std::vector<T> positions(_numEntries * 4);
+  for (size_t i = 0; i < _numEntries; ++i)
+    std::copy_n(_entries + i * 8, 4, positions.begin() + i * 4);
+  return positions;
+}
+
+// the texture buffers are filled from bytes so every format can be compared and patched the same way
+template <typename T>
+void assignBytes(std::vector<unsigned char> &_out, const T *_data, size_t _count)
+{
+  auto bytes = reinterpret_cast<const unsigned char *>(_data);
+  _out.assign(bytes, bytes + _count * sizeof(T));
+}
+} // end anon namespace
+
+NGLScene::NGLScene() : m_reloader(&RigLoader::parseTarget, &RigLoader::loadRig)
 {
   setTitle("Qt5 Simple NGL Demo");
   m_activeWeight = 0;
+  // end to end stream latency is measured once the frame showing the weights is on screen
+  connect(this, &QOpenGLWindow::frameSwapped, this, [this]() {
+    streamFrameShown();
+    crowdBenchmarkFrame();
+  });
+}
+
+void NGLScene::setCrowd(size_t _count)
+{
+  m_crowdMode = true;
+  m_crowdCount = std::clamp<size_t>(_count, 1, c_maxCrowd);
+}
+
+void NGLScene::startCrowdBenchmark()
+{
+  m_crowdMode = true;
+  m_benchmarking = true;
+  m_benchFrames = 0;
+  m_crowdCount = 1;
+  std::cout << "crowd benchmark, " << c_benchFrames << " frames per step\n";
+}
+
+void NGLScene::setStreamSource(const std::string &_source)
+{
+  m_streamSource = _source;
+}
+
+void NGLScene::setTraceFile(const std::string &_fname)
+{
+  m_traceFile = _fname;
+  m_profiler.setTracing(true);
+}
+
+void NGLScene::setWatch(bool _watch)
+{
+  m_watch = _watch;
+}
+
+void NGLScene::setPointCache(const std::string &_fname)
+{
+  m_cacheFile = _fname;
+}
+
+void NGLScene::setPoseCache(size_t _budgetBytes, float _step)
+{
+  m_poseCacheBytes = _budgetBytes;
+  m_poseStep = _step;
 }
 
 NGLScene::~NGLScene()
 {
+  if (m_profiler.isTracing())
+    toggleTrace();
   std::cout << "Shutting down NGL, removing VAO's and Shaders\n";
 }
 
@@ -44,25 +136,456 @@ void NGLScene::initializeGL()
   // set the shape using FOV 45 Aspect Ratio based on Width and Height
   // The final two are near and far clipping planes of 0.5 and 10
   m_project = ngl::perspective(45, (float)720.0 / 576.0, 0.05, 350);
-  // we are creating a shader called PerFragADS
-  ngl::ShaderLib::createShaderProgram("PerFragADS");
-  // now we are going to create empty shaders for Frag and Vert
-  ngl::ShaderLib::attachShader("PerFragADSVertex", ngl::ShaderType::VERTEX);
+  m_lightPos = from;
+  // the fragment shader is shared by every blend shader, the vertex shader depends on the rig so it
+  // is built once we have loaded it (see selectMorphShader)
   ngl::ShaderLib::attachShader("PerFragADSFragment", ngl::ShaderType::FRAGMENT);
-  // attach the source
-  ngl::ShaderLib::loadShaderSource("PerFragADSVertex", "shaders/PerFragASDVert.glsl");
   ngl::ShaderLib::loadShaderSource("PerFragADSFragment", "shaders/PerFragASDFrag.glsl");
-  // compile the shaders
-  ngl::ShaderLib::compileShader("PerFragADSVertex");
   ngl::ShaderLib::compileShader("PerFragADSFragment");
-  // add them to the program
-  ngl::ShaderLib::attachShaderToProgram("PerFragADS", "PerFragADSVertex");
-  ngl::ShaderLib::attachShaderToProgram("PerFragADS", "PerFragADSFragment");
-
-  // now we have associated this data we can link the shader
-  ngl::ShaderLib::linkProgramObject("PerFragADS");
-  // and make it active ready to load values
-  ngl::ShaderLib::use("PerFragADS");
+  m_morphShaders = std::make_unique<MorphShaderCache>("shaders/PerFragASDVert.glsl", "PerFragADSFragment", "PerFragADS");
+  // storage buffers need 4.3, mac only goes to 4.1 so the weights go in a texture buffer there
+  GLint major = 0;
+  GLint minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  m_weightsInTBO = major < 4 || (major == 4 && minor < 3);
+  // draws the output of the compute pre-pass, compute shaders are 4.3 as well
+  ngl::ShaderLib::createShaderProgram("PerFragADSDeformed");
+  ngl::ShaderLib::attachShader("PerFragADSDeformedVertex", ngl::ShaderType::VERTEX);
+  ngl::ShaderLib::loadShaderSource("PerFragADSDeformedVertex", "shaders/DeformedVert.glsl");
+  ngl::ShaderLib::compileShader("PerFragADSDeformedVertex");
+  ngl::ShaderLib::attachShaderToProgram("PerFragADSDeformed", "PerFragADSDeformedVertex");
+  ngl::ShaderLib::attachShaderToProgram("PerFragADSDeformed", "PerFragADSFragment");
+  ngl::ShaderLib::linkProgramObject("PerFragADSDeformed");
+  setLightingUniforms("PerFragADSDeformed");
+  // rebuilds the normals after the pre-pass for Normals,topology
+  if (!m_weightsInTBO)
+  {
+    ngl::ShaderLib::createShaderProgram("Renormalise");
+    ngl::ShaderLib::attachShader("RenormaliseCompute", ngl::ShaderType::COMPUTE);
+    ngl::ShaderLib::loadShaderSource("RenormaliseCompute", "shaders/RenormaliseComp.glsl");
+    if (ngl::ShaderLib::compileShader("RenormaliseCompute"))
+    {
+      ngl::ShaderLib::attachShaderToProgram("Renormalise", "RenormaliseCompute");
+      if (ngl::ShaderLib::linkProgramObject("Renormalise"))
+        m_renormaliseProgram = "Renormalise";
+    }
+  }
+  // the eyes of the crowd, two instances per head
+  ngl::ShaderLib::createShaderProgram("CrowdEyes");
+  ngl::ShaderLib::attachShader("CrowdEyesVertex", ngl::ShaderType::VERTEX);
+  ngl::ShaderLib::loadShaderSource("CrowdEyesVertex", "shaders/CrowdEyeVert.glsl");
+  ngl::ShaderLib::compileShader("CrowdEyesVertex");
+  ngl::ShaderLib::attachShaderToProgram("CrowdEyes", "CrowdEyesVertex");
+  ngl::ShaderLib::attachShaderToProgram("CrowdEyes", "PerFragADSFragment");
+  ngl::ShaderLib::linkProgramObject("CrowdEyes");
+  setLightingUniforms("CrowdEyes");
+  ngl::ShaderLib::setUniform("instanceTBO", 6);
+
+  glEnable(GL_DEPTH_TEST); // for removal of hidden surfaces
+
+  ngl::ShaderLib::use("nglDiffuseShader");
+  ngl::ShaderLib::setUniform("Colour", 1.0f, 1.0f, 1.0f, 1.0f);
+
+  ngl::ShaderLib::setUniform("lightPos", from);
+  ngl::ShaderLib::setUniform("lightDiffuse", 1.0f, 1.0f, 1.0f, 1.0f);
+
+  // first we create a mesh from an obj passing in the obj file and texture
+  m_eyeMesh.reset(new ngl::Obj("models/Eyeball.obj"));
+  m_eyeMesh->createVAO();
+  createCrowdEyes();
+  parseModelFile();
+
+  m_text = std::make_unique<ngl::Text>("fonts/Arial.ttf", 16);
+  createMorphMesh();
+  selectMorphShader();
+  loadClip();
+  if (!m_cacheFile.empty())
+  {
+    if (m_cachePlayer.open(m_cacheFile, m_numVerts))
+    {
+      std::cout << "playing " << m_cachePlayer.numFrames() << " frames of " << m_cacheFile << " at "
+                << m_cachePlayer.fps() << " fps\n";
+      if (m_cachePlayer.sourceHash() != m_modelFile.sourceHash())
+        std::cout << m_cacheFile << " was baked from a different models.txt\n";
+      createCacheMesh();
+      m_cacheMode = m_cachePlayer.isOpen();
+      m_cacheClock = std::chrono::steady_clock::now();
+    }
+    else
+    {
+      std::cout << m_cachePlayer.errorString() << '\n';
+    }
+  }
+  if (m_watch)
+    startWatching();
+  if (!m_streamSource.empty())
+  {
+    if (m_stream.open(m_streamSource, m_weights.size()))
+      std::cout << "streaming weights from " << m_streamSource << '\n';
+    else
+      std::cout << "unable to stream weights from " << m_streamSource << '\n';
+  }
+  glViewport(0, 0, 1024, 720);
+  m_text->setScreenSize(width(), height());
+  if (!m_gpuTimer.create(m_profiler))
+    std::cout << "no GL timer queries, the profiler only has CPU times\n";
+}
+
+void NGLScene::createMorphMesh()
+{
+  // the data either comes straight from the mapped rig cache or, if that couldn't be
+  // written, from the rig we just built
+  const float *vertexData;
+  const uint32_t *indices;
+  const int32_t *offsets;
+  const float *entries;
+  size_t numVerts;
+  size_t numIndices;
+  size_t numEntries;
+  std::vector<int32_t> offsetStore;
+  std::vector<float> entryStore;
+  if (m_rigCache.isOpen())
+  {
+    vertexData = m_rigCache.vertexData();
+    indices = m_rigCache.indices();
+    offsets = m_rigCache.deltaOffsets();
+    entries = m_rigCache.deltaEntries();
+    numVerts = m_rigCache.numVerts();
+    numIndices = m_rigCache.numIndices();
+    numEntries = m_rigCache.numEntries();
+  }
+  else
+  {
+    m_rig.targets().buildVertexMajor(offsetStore, entryStore);
+    vertexData = m_rig.vertexData().data();
+    indices = m_rig.indices().data();
+    offsets = offsetStore.data();
+    entries = entryStore.data();
+    numVerts = m_rig.numVerts();
+    numIndices = m_rig.numIndices();
+    numEntries = entryStore.size() / 8;
+  }
+  // the normals can only be rebuilt by the compute passes
+  if (m_normalMode == NormalRebuilder::Mode::Topology && m_renormaliseProgram.empty())
+  {
+    std::cout << "rebuilding the normals needs compute shaders, blending the normal deltas\n";
+    m_normalMode = NormalRebuilder::Mode::Blend;
+  }
+  bool topologyNormals = m_normalMode == NormalRebuilder::Mode::Topology;
+  // with a Basis line the GPU blends basis shapes mixed from the targets if FacialRigBake found them
+  // smaller, the levels of detail still measure the targets' own deltas
+  const int32_t *blendOffsets = offsets;
+  const float *blendEntries = entries;
+  size_t numBlendEntries = numEntries;
+  m_basis.clear();
+  if (m_basisTolerance > 0.0f)
+  {
+    // the eigen solve and tolerance search take seconds on a large rig so they are only done offline
+    if (!m_rigCache.isOpen() || m_rigCache.basisTolerance() != m_basisTolerance ||
+        m_rigCache.basisMaxShapes() != m_basisMaxShapes)
+    {
+      std::cout << "no basis baked for this Basis line, run FacialRigBake to build it, blending the targets\n";
+    }
+    else if (m_rigCache.numBasisShapes() == 0)
+    {
+      std::cout << "the basis is no smaller, blending the targets\n";
+    }
+    else
+    {
+      m_basis.assign(m_meshNames.size(), m_rigCache.numBasisShapes(), m_rigCache.basisMixing());
+      blendOffsets = m_rigCache.basisOffsets();
+      blendEntries = m_rigCache.basisEntries();
+      numBlendEntries = m_rigCache.numBasisEntries();
+      std::cout << fmt::format("baked basis of {} shapes for {} targets, {:.2f} deltas per vertex rather than {:.2f}, "
+                               "error {:.4f}\n",
+                               m_basis.numShapes(), m_meshNames.size(), static_cast<double>(numBlendEntries) / numVerts,
+                               static_cast<double>(numEntries) / numVerts, m_rigCache.basisError());
+    }
+  }
+  measureRows(blendOffsets, numVerts, numBlendEntries);
+  // shrink the deltas if models.txt asks for it, the index has to fit in the format
+  if (numBlendTargets() > DeltaCodec::maxTargets(m_deltaFormat))
+  {
+    std::cout << "too many targets for " << DeltaCodec::formatName(m_deltaFormat) << " deltas, using float\n";
+    m_deltaFormat = DeltaCodec::Format::Float32;
+  }
+  DeltaTexels texels;
+  packDeltas(blendOffsets, blendEntries, numVerts, numBlendEntries, vertexData + numVerts * 3, texels);
+  std::cout << "sparse targets " << numBlendEntries << " entries " << DeltaCodec::formatName(m_deltaFormat) << " "
+            << (texels.entries.size() + texels.normals.size() + texels.scales.size()) / 1024 << " KB on the GPU\n";
+
+  // each vertex's entries are sorted by target, one texel (dP.xyz, target index) per entry, followed by
+  // a (dN.xyz, unused) texel when the normal deltas are stored in full; SNorm16 keeps dP as int16 steps
+  // of its target's scale and the normals in their own buffers, topology normals drop the dN
+  setDeltaBuffer(DeltaEntries, m_tboID, GL_TEXTURE0, deltaEntryFormat(), texels.entries);
+  if (m_deltaFormat == DeltaCodec::Format::SNorm16)
+  {
+    // the octahedral normals and the scale for each target
+    if (!topologyNormals)
+      setDeltaBuffer(DeltaNormals, m_normalTboID, GL_TEXTURE4, GL_RG16I, texels.normals);
+    setDeltaBuffer(DeltaScales, m_scaleTboID, GL_TEXTURE5, GL_R32F, texels.scales);
+  }
+  // the start of each vertex's row of entries, indexed by the unique vertex id
+  setDeltaBuffer(DeltaOffsets, m_offsetTboID, GL_TEXTURE1, GL_R32I, texels.offsets);
+  // only kept to work out what changed when the rig is reloaded
+  if (m_reloader.isWatching() || m_watch)
+    m_deltaTexels = std::move(texels);
+  else
+    m_deltaTexels = DeltaTexels();
+
+  // the simplified levels keep a subset of the vertices so they draw from the same vertex and delta
+  // buffers, only their indices are added to the element buffer after the full mesh's
+  const uint32_t *positionIndex = m_rigCache.isOpen() ? m_rigCache.positionIndex() : m_rig.positionIndex().data();
+  m_lod.build(indices, numIndices, positionIndex, vertexData, numVerts, offsets, entries, m_lodRatios);
+  std::vector<uint32_t> lodIndices = m_lod.packedIndices();
+  for (size_t l = 1; l < m_lod.numLevels(); ++l)
+    std::cout << fmt::format("level of detail {} {} triangles {} vertices error {:.4f}\n", l,
+                             m_lod.level(l).indices.size() / 3, m_lod.level(l).numVerts, m_lod.level(l).error);
+  m_faceLevel = 0;
+
+  // first we grab an instance of our VOA class as indexed triangles
+  m_vaoMesh = ngl::VAOFactory::createVAO("simpleIndexVAO", GL_TRIANGLES);
+  // next we bind it so it's active for setting data
+  m_vaoMesh->bind();
+  // now we have our data add it to the VAO, we need to tell the VAO the following
+  // how much (in bytes) data we are copying
+  // a pointer to the first element of data plus the element buffer
+  m_vaoMesh->setData(ngl::SimpleIndexVAO::VertexData(numVerts * 6 * sizeof(float), vertexData[0], lodIndices.size(),
+                                                     lodIndices.data(), GL_UNSIGNED_INT));
+
+  // the data is all the positions then all the normals
+  m_vaoMesh->setVertexAttributePointer(0, 3, GL_FLOAT, 0, 0);
+  m_vaoMesh->setVertexAttributePointer(1, 3, GL_FLOAT, 0, numVerts * 3);
+
+  // now we have set the vertex attributes we tell the VAO class how many indices to draw when
+  // glDrawElements is called
+  m_vaoMesh->setNumIndices(numIndices);
+  // finally we have finished for now so time to unbind the VAO
+  m_vaoMesh->unbind();
+
+  m_numVerts = numVerts;
+  m_numIndices = numIndices;
+  m_deformedDirty = true;
+  if (!m_weightsInTBO)
+  {
+    // the compute pre-pass reads the base mesh from a storage buffer and writes over the vertex buffer
+    // of a second VAO, which starts off as a copy of the base mesh
+    if (m_baseBuffer == 0)
+      glGenBuffers(1, &m_baseBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_baseBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, numVerts * 6 * sizeof(float), vertexData, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    m_vaoDeformed = ngl::VAOFactory::createVAO("simpleIndexVAO", GL_TRIANGLES);
+    m_vaoDeformed->bind();
+    m_vaoDeformed->setData(ngl::SimpleIndexVAO::VertexData(numVerts * 6 * sizeof(float), vertexData[0],
+                                                           lodIndices.size(), lodIndices.data(), GL_UNSIGNED_INT));
+    m_vaoDeformed->setVertexAttributePointer(0, 3, GL_FLOAT, 0, 0);
+    m_vaoDeformed->setVertexAttributePointer(1, 3, GL_FLOAT, 0, numVerts * 3);
+    m_vaoDeformed->setNumIndices(numIndices);
+    m_vaoDeformed->unbind();
+  }
+  if (topologyNormals)
+  {
+    createNormalAdjacency(vertexData, indices, numIndices, positionIndex, blendOffsets, blendEntries);
+  }
+
+  // the levels of detail may have changed, the cache draws with them too
+  if (m_cachePlayer.isOpen())
+    createCacheMesh();
+
+  // now set all the weights
+  m_weights.assign(m_meshNames.size(), 0.0f);
+  createWeightBuffers();
+}
+
+void NGLScene::createWeightBuffers()
+{
+  m_blendWeights.assign(m_meshNames.size(), 0.0f);
+  m_weightBuffer.create(numBlendTargets(), m_weightsInTBO ? 2 : 0, 3,
+                        m_weightsInTBO ? WeightBuffer::Target::TextureBuffer : WeightBuffer::Target::StorageBuffer);
+  // (index, weight) for each active target
+  m_activeBuffer.create(numBlendTargets() * 2, m_weightsInTBO ? 3 : 1, 3,
+                        m_weightsInTBO ? WeightBuffer::Target::TextureBuffer : WeightBuffer::Target::StorageBuffer);
+}
+
+void NGLScene::measureRows(const int32_t *_offsets, size_t _numVerts, size_t _numEntries)
+{
+  // how long the rows are decides when searching them for the active targets is the cheaper loop
+  m_maxRowLength = 0;
+  for (size_t v = 0; v < _numVerts; ++v)
+    m_maxRowLength = std::max(m_maxRowLength, static_cast<size_t>(_offsets[v + 1] - _offsets[v]));
+  m_avgRowLength = _numVerts != 0 ? static_cast<double>(_numEntries) / _numVerts : 0.0;
+}
+
+void NGLScene::packDeltas(const int32_t *_offsets, const float *_entries, size_t _numVerts, size_t _numEntries,
+                          const float *_baseNormals, DeltaTexels &_out) const
+{
+  bool topologyNormals = m_normalMode == NormalRebuilder::Mode::Topology;
+  _out = DeltaTexels();
+  if (m_deltaFormat != DeltaCodec::Format::Float32)
+  {
+    DeltaCodec::Packed packed =
+        DeltaCodec::encode(m_deltaFormat, _entries, _offsets, _numVerts, _baseNormals, numBlendTargets());
+    if (topologyNormals)
+    {
+      // half keeps the position texel, snorm16 entries are positions already and its normals aren't sent
+      if (m_deltaFormat == DeltaCodec::Format::Half)
+        packed.entries = positionTexels(packed.entries.data(), _numEntries);
+      packed.normals.clear();
+    }
+    assignBytes(_out.entries, packed.entries.data(), packed.entries.size());
+    assignBytes(_out.normals, packed.normals.data(), packed.normals.size());
+    assignBytes(_out.scales, packed.scales.data(), packed.scales.size());
+  }
+  else if (topologyNormals)
+  {
+    // without normal deltas only the first texel of each entry is sent
+    std::vector<float> positions = positionTexels(_entries, _numEntries);
+    assignBytes(_out.entries, positions.data(), positions.size());
+  }
+  else
+  {
+    assignBytes(_out.entries, _entries, _numEntries * 8);
+  }
+  assignBytes(_out.offsets, _offsets, _numVerts + 1);
+  // keep at least one entry so we never create an empty buffer
+  const float emptyEntry[8] = {0.0f};
+  const int16_t emptyNormal[2] = {0, 0};
+  const float emptyScale = 1.0f;
+  if (_numEntries == 0)
+    assignBytes(_out.entries, emptyEntry, 8);
+  if (_out.normals.empty())
+    assignBytes(_out.normals, emptyNormal, 2);
+  if (_out.scales.empty())
+    assignBytes(_out.scales, &emptyScale, 1);
+}
+
+GLenum NGLScene::deltaEntryFormat() const
+{
+  switch (m_deltaFormat)
+  {
+  case DeltaCodec::Format::Half:
+    return GL_RGBA16F;
+  case DeltaCodec::Format::SNorm16:
+    return GL_RGBA16I;
+  default:
+    return GL_RGBA32F;
+  }
+}
+
+void NGLScene::setDeltaBuffer(DeltaBuffer _b, GLuint &_texture, GLenum _unit, GLenum _format,
+                              const std::vector<unsigned char> &_data)
+{
+  if (m_deltaBuffers[_b] == 0)
+  {
+    glGenBuffers(1, &m_deltaBuffers[_b]);
+    glGenTextures(1, &_texture);
+  }
+  glBindBuffer(GL_TEXTURE_BUFFER, m_deltaBuffers[_b]);
+  glBufferData(GL_TEXTURE_BUFFER, _data.size(), _data.data(), GL_STATIC_DRAW);
+  glActiveTexture(_unit);
+  glBindTexture(GL_TEXTURE_BUFFER, _texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, _format, m_deltaBuffers[_b]);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+size_t NGLScene::patchDeltaBuffer(DeltaBuffer _b, GLuint &_texture, GLenum _unit, GLenum _format,
+                                  const std::vector<unsigned char> &_data)
+{
+  std::vector<unsigned char> &current = _b == DeltaEntries   ? m_deltaTexels.entries
+                                        : _b == DeltaNormals ? m_deltaTexels.normals
+                                        : _b == DeltaScales  ? m_deltaTexels.scales
+                                                             : m_deltaTexels.offsets;
+  size_t bytes = 0;
+  if (m_deltaBuffers[_b] == 0 || current.size() != _data.size())
+  {
+    // the rows have grown or shrunk so everything after the first change has moved, send the lot
+    setDeltaBuffer(_b, _texture, _unit, _format, _data);
+    bytes = _data.size();
+  }
+  else
+  {
+    // 4 KB pieces, a change to one target only touches the rows of the vertices it moves
+    RigReloader::changedRanges(current.data(), _data.data(), _data.size(), 4096, m_changedRanges);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_deltaBuffers[_b]);
+    for (auto &r : m_changedRanges)
+    {
+      glBufferSubData(GL_TEXTURE_BUFFER, r.first, r.second, _data.data() + r.first);
+      bytes += r.second;
+    }
+  }
+  current = _data;
+  return bytes;
+}
+
+void NGLScene::selectMorphShader()
+{
+  MorphShaderSource::Variant variant;
+  variant.numTargets = numBlendTargets();
+  variant.weightsInTBO = m_weightsInTBO;
+  variant.deltaFormat = m_deltaFormat;
+  variant.topologyNormals = m_normalMode == NormalRebuilder::Mode::Topology;
+  bool created = false;
+  m_morphProgram = m_morphShaders->program(variant, created);
+  if (m_morphProgram.empty())
+  {
+    std::cout << "failed to build the blend shader for " << variant.numTargets << " targets Exiting\n";
+    exit(EXIT_FAILURE);
+  }
+  if (created)
+  {
+    setLightingUniforms(m_morphProgram);
+    setDeltaUniforms(m_morphProgram);
+  }
+
+  // the crowd draws every head with one instanced draw of the same rig
+  variant.instanced = true;
+  m_crowdProgram = m_morphShaders->program(variant, created);
+  if (m_crowdProgram.empty())
+  {
+    std::cout << "crowd shader unavailable\n";
+    m_crowdMode = false;
+    m_benchmarking = false;
+  }
+  else if (created)
+  {
+    setLightingUniforms(m_crowdProgram);
+    setDeltaUniforms(m_crowdProgram);
+    ngl::ShaderLib::setUniform("instanceTBO", 6);
+    ngl::ShaderLib::setUniform("headTBO", 7);
+  }
+  variant.instanced = false;
+
+  // the compute version of the same shader for the pre-pass
+  m_computeProgram.clear();
+  m_useCompute = false;
+  if (m_weightsInTBO)
+    return;
+  variant.compute = true;
+  m_computeProgram = m_morphShaders->program(variant, created);
+  if (m_computeProgram.empty())
+  {
+    std::cout << "compute blend unavailable, using the vertex shader\n";
+    return;
+  }
+  if (created)
+    setDeltaUniforms(m_computeProgram);
+  ngl::ShaderLib::use(m_computeProgram);
+  ngl::ShaderLib::setUniform("numVerts", static_cast<int>(m_numVerts));
+  if (m_normalMode == NormalRebuilder::Mode::Topology)
+  {
+    // the vertex shader has no normal deltas to blend so the face is always drawn from the pre-pass
+    m_useCompute = true;
+    ngl::ShaderLib::use(m_renormaliseProgram);
+    ngl::ShaderLib::setUniform("numVerts", static_cast<int>(m_numVerts));
+  }
+}
+
+void NGLScene::setLightingUniforms(const std::string &_program)
+{
+  ngl::ShaderLib::use(_program);
   // now we need to set the material and light values
   /*
    *struct MaterialInfo
@@ -82,7 +605,6 @@ void NGLScene::initializeGL()
   // white spec
   ngl::ShaderLib::setUniform("material.Ks", 1.0f, 1.0f, 1.0f);
   ngl::ShaderLib::setUniform("material.shininess", 800.0f);
-  ngl::ShaderLib::setUniform("TBO", 0);
   // now for  the lights values (all set to white)
   /*struct LightInfo
   {
@@ -95,141 +617,308 @@ void NGLScene::initializeGL()
   // Specular light intensity
   vec3 Ls;
   };*/
-  ngl::ShaderLib::setUniform("light.position", from);
+  ngl::ShaderLib::setUniform("light.position", m_lightPos);
   ngl::ShaderLib::setUniform("light.La", 0.1f, 0.1f, 0.1f);
   ngl::ShaderLib::setUniform("light.Ld", 1.0f, 1.0f, 1.0f);
   ngl::ShaderLib::setUniform("light.Ls", 0.9f, 0.9f, 0.9f);
+}
 
-  glEnable(GL_DEPTH_TEST); // for removal of hidden surfaces
-
-  ngl::ShaderLib::use("nglDiffuseShader");
-  ngl::ShaderLib::setUniform("Colour", 1.0f, 1.0f, 1.0f, 1.0f);
-
-  ngl::ShaderLib::setUniform("lightPos", from);
-  ngl::ShaderLib::setUniform("lightDiffuse", 1.0f, 1.0f, 1.0f, 1.0f);
+void NGLScene::setDeltaUniforms(const std::string &_program)
+{
+  ngl::ShaderLib::use(_program);
+  ngl::ShaderLib::setUniform("TBO", 0);
+  ngl::ShaderLib::setUniform("deltaOffsets", 1);
+  if (m_weightsInTBO)
+  {
+    ngl::ShaderLib::setUniform("weightTBO", 2);
+    ngl::ShaderLib::setUniform("activeTBO", 3);
+  }
+  if (m_deltaFormat == DeltaCodec::Format::SNorm16)
+  {
+    if (m_normalMode == NormalRebuilder::Mode::Blend)
+      ngl::ShaderLib::setUniform("normalTBO", 4);
+    ngl::ShaderLib::setUniform("targetScale", 5);
+  }
+}
 
-  // first we create a mesh from an obj passing in the obj file and texture
-  m_eyeMesh.reset(new ngl::Obj("models/Eyeball.obj"));
-  m_eyeMesh->createVAO();
-  parseModelFile();
+void NGLScene::bindDeltaTextures()
+{
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_BUFFER, m_offsetTboID);
+  if (m_deltaFormat == DeltaCodec::Format::SNorm16)
+  {
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_BUFFER, m_normalTboID);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_BUFFER, m_scaleTboID);
+  }
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_BUFFER, m_tboID);
+}
 
-  m_text = std::make_unique<ngl::Text>("fonts/Arial.ttf", 16);
-  createMorphMesh();
-  glViewport(0, 0, 1024, 720);
-  m_text->setScreenSize(width(), height());
+void NGLScene::uploadWeights()
+{
+  // correctives and in-betweens are worked out here so the shader only sees ordinary targets
+  m_weightProgram.evaluate(m_weights.data(), m_blendWeights.data());
+  // with a basis the shaders blend the shapes and their coefficients are the weights they see
+  const std::vector<float> *weights = &m_blendWeights;
+  if (!m_basis.empty())
+  {
+    m_basisWeights.resize(m_basis.numShapes());
+    m_basis.project(m_blendWeights.data(), m_basisWeights.data());
+    weights = &m_basisWeights;
+  }
+  // one write for all the weights rather than a uniform per weight
+  m_weightBuffer.upload(weights->data(), weights->size());
+  // and the compact list of the ones that are non zero
+  m_active.update(*weights);
+  m_activeBuffer.upload(m_active.packed().data(), m_active.packed().size());
+  ngl::ShaderLib::setUniform("numActive", static_cast<int>(m_active.size()));
+  ngl::ShaderLib::setUniform("useActiveList", m_active.cheaperThanRows(m_avgRowLength, m_maxRowLength) ? 1 : 0);
 }
 
-// a simple structure to hold our vertex data
-struct vertData
+void NGLScene::blendDeformedMesh()
 {
-  ngl::Vec3 p1;
-  ngl::Vec3 n1;
-};
-void NGLScene::createMorphMesh()
+  // the deformed mesh only depends on the weights so there is nothing to do if they haven't changed
+  if (!m_deformedDirty && m_weights == m_blendedWeights)
+    return;
+  if (m_deformedDirty)
+    createPoseCache();
+  ngl::ShaderLib::use(m_computeProgram);
+  // still sent on a hit so the driven weights and active list on screen are this pose's
+  uploadWeights();
+  int64_t slot = -1;
+  if (m_poseCache.enabled())
+  {
+    m_poseCache.makeKey(m_weights.data(), m_poseKey);
+    slot = m_poseCache.find(m_poseKey);
+  }
+  size_t poseBytes = m_poseCache.poseBytes();
+  if (slot >= 0)
+  {
+    // blended before, a copy on the GPU replaces both passes
+    glBindBuffer(GL_COPY_READ_BUFFER, m_poseBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vaoDeformed->getBufferID(0));
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(slot * poseBytes), 0,
+                        static_cast<GLsizeiptr>(poseBytes));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    m_numTouched = 0;
+    m_weightBuffer.fence();
+    m_activeBuffer.fence();
+    m_blendedWeights = m_weights;
+    m_deformedDirty = false;
+    return;
+  }
+  bindDeltaTextures();
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_baseBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_vaoDeformed->getBufferID(0));
+  glDispatchCompute(static_cast<GLuint>((m_numVerts + 63) / 64), 1, 1);
+  if (m_normalMode == NormalRebuilder::Mode::Topology)
+  {
+    // the blend wrote the base normals everywhere, only the vertices the active targets move faces
+    // around need rebuilding and they read the positions it just wrote
+    const std::vector<uint32_t> &touched = m_normalRebuilder.touched(m_active);
+    m_numTouched = touched.size();
+    if (!touched.empty())
+    {
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_touchedBuffer);
+      // a new store each time so we never wait for the last frame's pass to finish with it
+      glBufferData(GL_SHADER_STORAGE_BUFFER, touched.size() * sizeof(uint32_t), touched.data(), GL_STREAM_DRAW);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+      ngl::ShaderLib::use(m_renormaliseProgram);
+      ngl::ShaderLib::setUniform("numTouched", static_cast<int>(touched.size()));
+      for (GLuint i = 0; i < 4; ++i)
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4 + i, m_adjacencyBuffers[i]);
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, m_touchedBuffer);
+      glDispatchCompute(static_cast<GLuint>((touched.size() + 63) / 64), 1, 1);
+    }
+  }
+  // every pass after this reads the result as vertex attributes
+  glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+  if (m_poseCache.enabled())
+  {
+    // keep the result for the next time these weights come round, the least recently used pose makes way
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    size_t insert = m_poseCache.insert(m_poseKey);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_vaoDeformed->getBufferID(0));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_poseBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, static_cast<GLintptr>(insert * poseBytes),
+                        static_cast<GLsizeiptr>(poseBytes));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+  m_weightBuffer.fence();
+  m_activeBuffer.fence();
+  m_blendedWeights = m_weights;
+  m_deformedDirty = false;
+  ++m_computePasses;
+}
+
+void NGLScene::createPoseCache()
 {
-  // texture buffers have to be vec4 unless using GL 4.x so mac is out for now
-  // just use Vec4 and waste data see http://www.opengl.org/wiki/Buffer_Texture
-  std::vector<ngl::Vec4> targets;
-  // base pose is mesh 1 stored in m_meshes[0]
-  // get the obj data so we can process it locally
-  std::vector<ngl::Vec3> baseVert = m_baseMesh->getVertexList();
-  std::vector<ngl::Vec3> baseNormal = m_baseMesh->getNormalList();
+  // a new rig, normal mode or set of deltas, none of the poses blended so far look the same now
+  size_t poseBytes = m_numVerts * 6 * sizeof(float);
+  if (m_poseCache.numWeights() == m_weights.size() && m_poseCache.poseBytes() == poseBytes &&
+      m_poseCache.budgetBytes() == m_poseCacheBytes)
+  {
+    m_poseCache.clear();
+    return;
+  }
+  m_poseCache.configure(m_weights.size(), poseBytes, m_poseCacheBytes, m_poseStep);
+  if (!m_poseCache.enabled())
+    return;
+  if (m_poseBuffer == 0)
+    glGenBuffers(1, &m_poseBuffer);
+  // only ever copied to and from on the GPU
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_poseBuffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(m_poseCache.numSlots() * poseBytes), nullptr,
+               GL_DYNAMIC_COPY);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
 
-  // should really check to see if the poses match if we were doing this properly
-  auto numMeshes = m_meshes.size();
-  std::cout << "num meshes " << numMeshes;
-  std::vector<std::vector<ngl::Vec3>> verts;
-  std::vector<std::vector<ngl::Vec3>> normals;
-  // faces will be the same for each mesh so only need one
-  // really we should check that this conforms, however it will
-  // just break if it's not right so should know!
-  std::vector<ngl::Face> faces = m_baseMesh->getFaceList();
+void NGLScene::createNormalAdjacency(const float *_vertexData, const uint32_t *_indices, size_t _numIndices,
+                                     const uint32_t *_positionIndex, const int32_t *_offsets, const float *_entries)
+{
+  m_normalRebuilder.build(_indices, _numIndices, _positionIndex, _vertexData, _vertexData + m_numVerts * 3,
+                          m_numVerts);
+  m_normalRebuilder.setTargets(_offsets, _entries, numBlendTargets());
+  // the GPU only needs the adjacency, the per target regions stay on the CPU to build the touched list
+  const void *data[4] = {m_normalRebuilder.offsets().data(), m_normalRebuilder.faces().data(),
+                         m_normalRebuilder.indices().data(), m_normalRebuilder.restNormals().data()};
+  size_t sizes[4] = {m_normalRebuilder.offsets().size() * sizeof(int32_t),
+                     m_normalRebuilder.faces().size() * sizeof(uint32_t),
+                     m_normalRebuilder.indices().size() * sizeof(uint32_t),
+                     m_normalRebuilder.restNormals().size() * sizeof(float)};
+  size_t gpuBytes = 0;
+  for (size_t i = 0; i < 4; ++i)
+  {
+    if (m_adjacencyBuffers[i] == 0)
+      glGenBuffers(1, &m_adjacencyBuffers[i]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_adjacencyBuffers[i]);
+    // never empty, a mesh with no faces still has its one offset
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(sizes[i], sizeof(float)), sizes[i] ? data[i] : nullptr,
+                 GL_STATIC_DRAW);
+    gpuBytes += sizes[i];
+  }
+  if (m_touchedBuffer == 0)
+    glGenBuffers(1, &m_touchedBuffer);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  std::cout << "normal adjacency " << gpuBytes / 1024 << " KB on the GPU, " << m_normalRebuilder.bytes() / 1024
+            << " KB on the CPU\n";
+}
 
-  for (size_t i = 0; i < numMeshes; ++i)
+void NGLScene::loadClip()
+{
+  if (m_clipName.empty())
+    return;
+  AnimationClip clip;
+  if (!clip.loadAny(m_clipName))
   {
-    verts.push_back(m_meshes[i]->getVertexList());
-    normals.push_back(m_meshes[i]->getNormalList());
+    std::cout << clip.errorString() << ", no clip to play\n";
+    return;
   }
+  size_t bound = m_clipSampler.bind(clip, m_meshNames);
+  std::cout << "clip " << m_clipName << " " << bound << " of " << clip.curves().size() << " curves match the rig\n";
+}
 
-  // now we are going to process and pack the mesh into an ngl::VertexArrayObject
-  std::vector<vertData> vboMesh;
-  vertData d;
-  auto nFaces = faces.size();
-  // loop for each of the faces
-  ngl::Vec3 current;
+void NGLScene::createCacheMesh()
+{
+  if (m_cachePlayer.numVerts() != m_numVerts)
+  {
+    std::cout << "the point cache doesn't match the reloaded rig, closing it\n";
+    m_cachePlayer.close();
+    m_cacheMode = false;
+    return;
+  }
+  // the same indices as the morph mesh, the full mesh followed by its levels
+  std::vector<uint32_t> indices = m_lod.packedIndices();
+  if (m_cacheVAO == 0)
+  {
+    glGenVertexArrays(1, &m_cacheVAO);
+    glGenBuffers(1, &m_cacheIndexBuffer);
+  }
+  glBindVertexArray(m_cacheVAO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_cacheIndexBuffer);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glBindVertexArray(0);
+  // a frame is the whole mesh in the rig's vertex data layout
+  m_cacheRing.create(m_numVerts * 6, 0, 3, WeightBuffer::Target::ArrayBuffer);
+  m_cacheShown = m_cachePlayer.numFrames();
+}
 
-  for (size_t i = 0; i < nFaces; ++i)
+void NGLScene::drawCachedFace()
+{
+  bool uploaded = false;
   {
-    // now for each triangle in the face (remember we ensured tri above)
-    for (size_t j = 0; j < 3; ++j)
+    ProfileScope scope(m_profiler, m_gpuTimer, ProfileCacheUpload);
+    size_t frame = m_cachePlayer.frameAt(m_cacheTime);
+    m_cachePlayer.setPlayhead(frame, m_cacheDirection);
+    // never wait on the disk, only a frame the prefetch thread has read is copied and until then the last
+    // one is drawn from the segment it is already in (the thread may be dropping its pages by now)
+    if (frame != m_cacheShown)
     {
-      // pack in the vertex data first
-
-      d.p1 = baseVert[faces[i].m_vert[j]];
-      // the blend meshes are just the differences so we subtract the base mesh
-      // from the current one (could do this on GPU but this saves processing time)
-      for (size_t vi = 0; vi < numMeshes; ++vi)
+      const float *data = m_cachePlayer.frame(frame);
+      if (data != nullptr)
       {
-        current = verts[vi][faces[i].m_vert[j]] - d.p1;
-        targets.push_back(ngl::Vec4(current.m_x, current.m_y, current.m_z, 1.0));
+        m_cacheRing.upload(data, m_numVerts * 6);
+        m_cacheOffset = m_cacheRing.offset();
+        m_cacheShown = frame;
+        uploaded = true;
       }
-
-      // now do the normals
-      d.n1 = baseNormal[faces[i].m_norm[j]];
-      for (size_t ni = 0; ni < numMeshes; ++ni)
-      {
-        current = normals[ni][faces[i].m_norm[j]] - d.n1;
-        targets.push_back(ngl::Vec4(current.m_x, current.m_y, current.m_z, 1.0));
-      }
-
-      // finally add it to our mesh VAO structure
-      vboMesh.push_back(d);
     }
   }
+  // nothing has been read since the mesh was made
+  if (m_cacheShown >= m_cachePlayer.numFrames())
+    return;
+  {
+    ProfileScope scope(m_profiler, m_gpuTimer, ProfileMatrices);
+    loadMatricesToShader();
+  }
+  ProfileScope scope(m_profiler, m_gpuTimer, ProfileMorphDraw);
+  glBindVertexArray(m_cacheVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, m_cacheRing.buffer());
+  size_t offset = m_cacheOffset;
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<const void *>(offset));
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0,
+                        reinterpret_cast<const void *>(offset + m_numVerts * 3 * sizeof(float)));
+  drawLevel(m_faceLevel);
+  glBindVertexArray(0);
+  // the segment can be written again once this draw is done with it
+  if (uploaded)
+    m_cacheRing.fence();
+  else
+    m_cacheRing.refence(m_cacheOffset);
+}
 
-  // generate and bind our matrix buffer this is going to be fed to the feedback shader to
-  // generate our model position data for later, if we update how many instances we use
-  // this will need to be re-generated (done in the draw routine)
-  GLuint morphTarget;
-  glGenBuffers(1, &morphTarget);
-
-  glBindBuffer(GL_TEXTURE_BUFFER, morphTarget);
-  glBufferData(GL_TEXTURE_BUFFER, targets.size() * sizeof(ngl::Vec4), NULL, GL_STATIC_DRAW);
-  glBufferSubData(GL_TEXTURE_BUFFER, 0, targets.size() * sizeof(ngl::Vec4), &targets[0].m_x); // Fill
-
-  glGenTextures(1, &m_tboID);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_BUFFER, m_tboID);
-
-  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, morphTarget);
-
-  // first we grab an instance of our VOA class as a TRIANGLE_STRIP
-  m_vaoMesh = ngl::VAOFactory::createVAO("simpleVAO", GL_TRIANGLES);
-  // next we bind it so it's active for setting data
-  m_vaoMesh->bind();
-  auto meshSize = vboMesh.size();
-  // now we have our data add it to the VAO, we need to tell the VAO the following
-  // how much (in bytes) data we are copying
-  // a pointer to the first element of data (in this case the address of the first element of the
-  // std::vector
-  m_vaoMesh->setData(ngl::AbstractVAO::VertexData(meshSize * sizeof(vertData), vboMesh[0].p1.m_x));
-
-  // so data is Vert / Normal for each mesh
-  m_vaoMesh->setVertexAttributePointer(0, 3, GL_FLOAT, sizeof(vertData), 0);
-  m_vaoMesh->setVertexAttributePointer(1, 3, GL_FLOAT, sizeof(vertData), 3);
+void NGLScene::stepCache(int _frames)
+{
+  m_cacheDirection = 0;
+  auto frame = static_cast<int64_t>(m_cachePlayer.frameAt(m_cacheTime)) + _frames;
+  // the middle of the frame so rounding can't land on the one before
+  m_cacheTime = (static_cast<double>(frame) + 0.5) / m_cachePlayer.fps();
+}
 
-  // now we have set the vertex attributes we tell the VAO class how many indices to draw when
-  // glDrawArrays is called, in this case we use buffSize (but if we wished less of the sphere to be drawn we could
-  // specify less (in steps of 3))
-  m_vaoMesh->setNumIndices(meshSize);
-  // finally we have finished for now so time to unbind the VAO
-  m_vaoMesh->unbind();
+void NGLScene::togglePlayback()
+{
+  m_playing = !m_playing && m_clipSampler.numCurves() != 0;
+  m_playStart = std::chrono::steady_clock::now();
+}
 
-  // now set all the weights
-  for (unsigned int i = 0; i < m_meshes.size(); ++i)
-  {
-    m_weights.push_back(0.0f);
-  }
+void NGLScene::streamFrameShown()
+{
+  if (!m_streamShowing)
+    return;
+  m_streamShowing = false;
+  float latency = static_cast<float>(WeightStream::now() - m_streamFrame.sendTime) * 1e-6f;
+  if (m_streamLatency.size() < c_latencySamples)
+    m_streamLatency.push_back(latency);
+  else
+    m_streamLatency[m_latencyIndex] = latency;
+  m_latencyIndex = (m_latencyIndex + 1) % c_latencySamples;
 }
 
 void NGLScene::resetWeights()
@@ -243,8 +932,8 @@ void NGLScene::changeActiveWeight(Direction _d)
   switch (_d)
   {
   case UP:
-    if (++m_activeWeight >= static_cast<int>(m_meshes.size()))
-      m_activeWeight = m_meshes.size() - 1;
+    if (++m_activeWeight >= m_meshNames.size())
+      m_activeWeight = m_meshNames.size() - 1;
     break;
   case DOWN:
     if (--m_activeWeight <= 0)
@@ -267,55 +956,186 @@ void NGLScene::changeWeight(Direction _d)
 
 void NGLScene::parseModelFile()
 {
-  // open the file to parse
-  std::fstream fileIn;
-  fileIn.open("models.txt");
-  if (!fileIn.is_open())
+  ModelFile models;
+  if (!models.load("models.txt"))
   {
-    std::cout << "File : models.txt Not found Exiting " << std::endl;
+    std::cout << models.errorString() << " Exiting" << std::endl;
     exit(EXIT_FAILURE);
   }
+  m_modelFile = models;
+  applyModelSettings();
+  // the cache is only used if it was baked from exactly these files
+  auto hash = models.sourceHash();
+  auto cacheName = models.cacheFileName();
+  if (m_rigCache.open(cacheName) && m_rigCache.sourceHash() == hash)
+  {
+    std::cout << "using baked rig " << cacheName << '\n';
+    m_meshNames = m_rigCache.targetNames();
+  }
+  else
+  {
+    m_rigCache.close();
+    std::cout << "rig cache " << cacheName << " missing or out of date, parsing obj files\n";
+    RigLoader loader;
+    if (!loader.load(models, m_rig))
+    {
+      std::cout << loader.errorString() << " Exiting\n";
+      exit(EXIT_FAILURE);
+    }
+    loader.printTimings();
+    m_meshNames = m_rig.targetNames();
+    // save it for next time, if we can't write it we just use the rig we have
+    if (RigCache::write(cacheName, m_rig, hash))
+    {
+      m_rigCache.open(cacheName);
+    }
+  }
+  // the drivers aren't in the cache, they are always read from models.txt
+  compileWeightProgram();
+}
 
-  // this is the line we wish to parse
-  std::string lineBuffer;
-  // say which separators should be used in this
-  // case Spaces, Tabs and return \ new line
-  // I'm also doing , seperated list this time
-  namespace ps = pystring;
-  // loop through the file
-  while (!fileIn.eof())
+void NGLScene::applyModelSettings()
+{
+  m_deltaEpsilon = m_modelFile.deltaEpsilon();
+  m_deltaFormat = m_modelFile.deltaFormat();
+  m_normalMode = m_modelFile.normalMode();
+  m_clipName = m_modelFile.clip();
+  m_lodRatios = m_modelFile.lodRatios();
+  m_lod.setMaxPixelError(m_modelFile.lodPixels());
+  m_basisTolerance = m_modelFile.basisTolerance();
+  m_basisMaxShapes = m_modelFile.basisMaxShapes();
+}
+
+void NGLScene::compileWeightProgram()
+{
+  std::string error;
+  if (!m_weightProgram.compile(m_modelFile, m_meshNames, error))
+    std::cout << error << ", correctives and in-betweens will be set like any other target\n";
+  else if (!m_weightProgram.empty())
+    std::cout << m_weightProgram.numCorrectives() << " correctives and " << m_weightProgram.numInBetweens()
+              << " in-betweens\n";
+}
+
+void NGLScene::startWatching()
+{
+  // changes are worked out against the rig, if it came from the cache it has to be unpacked first
+  if (m_rigCache.isOpen())
+    m_rigCache.toRig(m_rig);
+  m_reloader.start(m_modelFile, m_rig);
+  if (m_watchTimer == 0)
+    m_watchTimer = startTimer(250);
+  std::cout << "watching " << m_modelFile.fileName() << " and the obj files it lists\n";
+}
+
+void NGLScene::timerEvent(QTimerEvent *_event)
+{
+  if (_event->timerId() != m_watchTimer)
+    return;
+  // the worker has done the parsing already, the buffers can only be touched with the context current
+  if (!m_reloadPending && m_reloader.poll(m_reload))
+  {
+    m_reloadPending = true;
+    update();
+  }
+}
+
+void NGLScene::applyReload()
+{
+  m_reloadPending = false;
+  auto start = std::chrono::steady_clock::now();
+  RigReloader::Result &reload = m_reload;
+  if (!reload.error.empty())
+  {
+    std::cout << reload.error << ", keeping the last rig\n";
+    m_reloadStatus = reload.error;
+  }
+  // an error carries no rig, anything else is a finished rig even when every target was loaded again
+  if (reload.offsets.empty())
+    return;
+  ModelFile models = std::move(reload.models);
+  BlendRig rig = std::move(reload.rig);
+  std::vector<std::string> oldNames = std::move(m_meshNames);
+  std::vector<float> oldWeights = m_weights;
+  // a baked basis describes the old targets so the buffers go back to blending the targets themselves
+  bool layoutChanged = reload.fullReload || models.deltaFormat() != m_modelFile.deltaFormat() ||
+                       models.normalMode() != m_modelFile.normalMode() ||
+                       models.lodRatios() != m_modelFile.lodRatios() || !m_basis.empty();
+  bool clipChanged = models.clip() != m_modelFile.clip();
+  // the cache now describes an older rig, it is baked again on the next start
+  m_rigCache.close();
+  m_rig = std::move(rig);
+  m_modelFile = std::move(models);
+  m_meshNames = m_rig.targetNames();
+  applyModelSettings();
+  compileWeightProgram();
+  bool useCompute = m_useCompute;
+  size_t bytes = 0;
+  if (layoutChanged || numBlendTargets() > DeltaCodec::maxTargets(m_deltaFormat))
   {
-    // grab a line from the input
-    getline(fileIn, lineBuffer, '\n');
-    // make sure it's not an empty line
-    if (lineBuffer.size() != 0)
+    // the buffers are laid out differently so they are made again from the new rig
+    createMorphMesh();
+    selectMorphShader();
+    bytes = m_deltaTexels.entries.size() + m_deltaTexels.normals.size() + m_deltaTexels.scales.size() +
+            m_deltaTexels.offsets.size();
+  }
+  else
+  {
+    // only the targets that changed are different, and so only the rows of the vertices they move
+    size_t numVerts = m_rig.numVerts();
+    size_t numEntries = reload.entries.size() / 8;
+    DeltaTexels texels;
+    packDeltas(reload.offsets.data(), reload.entries.data(), numVerts, numEntries,
+               m_rig.vertexData().data() + numVerts * 3, texels);
+    bytes += patchDeltaBuffer(DeltaEntries, m_tboID, GL_TEXTURE0, deltaEntryFormat(), texels.entries);
+    if (m_deltaFormat == DeltaCodec::Format::SNorm16)
     {
-      // now tokenize the line using pystring (included in ngl)
-      std::vector<std::string> tokens;
-      // strip leading spaces
-      lineBuffer = ps::lstrip(lineBuffer);
-      // now split on ,
-      ps::split(lineBuffer, tokens, ",");
-      // now see if it's a valid one and call the correct function
-      if (tokens[0] == "BaseMesh")
-      {
-        std::cout << "found base mesh loading " << tokens[1] << '\n';
-        m_baseMesh.reset(new ngl::Obj(tokens[1]));
-      }
-      else if (tokens[0] == "BlendShape")
-      {
-        std::cout << "Found " << tokens[1] << '\n';
-        m_meshNames.push_back(tokens[1]);
-        std::unique_ptr<ngl::Obj> mesh(new ngl::Obj(tokens[2]));
-        m_meshes.push_back(std::move(mesh));
-      }
-    } // end zero loop
+      if (m_normalMode != NormalRebuilder::Mode::Topology)
+        bytes += patchDeltaBuffer(DeltaNormals, m_normalTboID, GL_TEXTURE4, GL_RG16I, texels.normals);
+      bytes += patchDeltaBuffer(DeltaScales, m_scaleTboID, GL_TEXTURE5, GL_R32F, texels.scales);
+    }
+    bytes += patchDeltaBuffer(DeltaOffsets, m_offsetTboID, GL_TEXTURE1, GL_R32I, texels.offsets);
+    measureRows(reload.offsets.data(), numVerts, numEntries);
+    if (m_normalMode == NormalRebuilder::Mode::Topology)
+      m_normalRebuilder.setTargets(reload.offsets.data(), reload.entries.data(), numBlendTargets());
+    if (reload.targetsChanged)
+    {
+      // the shaders are built for a number of targets
+      createWeightBuffers();
+      selectMorphShader();
+    }
+    m_deformedDirty = true;
+  }
+  // selectMorphShader goes back to the vertex shader, stay on the pre-pass if it was in use
+  m_useCompute = m_useCompute || (useCompute && !m_computeProgram.empty());
+  // keep the weights of the targets that are still there
+  m_weights.assign(m_meshNames.size(), 0.0f);
+  for (size_t t = 0; t < m_meshNames.size(); ++t)
+  {
+    auto found = std::find(oldNames.begin(), oldNames.end(), m_meshNames[t]);
+    if (found != oldNames.end())
+      m_weights[t] = oldWeights[found - oldNames.begin()];
   }
+  m_activeWeight = std::min(m_activeWeight, std::max<size_t>(m_meshNames.size(), 1) - 1);
+  if (reload.targetsChanged || clipChanged)
+    loadClip();
+  // from now on changes are measured against this rig
+  m_reloader.accept();
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  if (reload.fullReload)
+    m_reloadStatus = fmt::format("reloaded the rig in {:.1f} ms ({:.1f} ms parsing)", ms, reload.ms);
+  else
+    m_reloadStatus = fmt::format("reloaded {} of {} targets in {:.1f} ms ({:.1f} ms parsing), {} KB sent",
+                                 reload.parsed.size(), m_meshNames.size(), ms, reload.ms, bytes / 1024);
+  std::cout << m_reloadStatus << '\n';
+  m_reload = RigReloader::Result();
 }
 
 void NGLScene::loadMatricesToShader()
 {
-  ngl::ShaderLib::use("PerFragADS");
+  // with the pre-pass the mesh is already blended so it just needs drawing
+  // the point cache is already deformed too
+  bool deformed = m_useCompute || m_cacheMode;
+  ngl::ShaderLib::use(deformed ? "PerFragADSDeformed" : m_morphProgram);
   ngl::Mat4 MV;
   ngl::Mat4 MVP;
   ngl::Mat3 normalMatrix;
@@ -326,34 +1146,258 @@ void NGLScene::loadMatricesToShader()
   ngl::ShaderLib::setUniform("MVP", MVP);
   ngl::ShaderLib::setUniform("MV", MV);
   ngl::ShaderLib::setUniform("normalMatrix", normalMatrix);
-  for (unsigned int i = 0; i < m_weights.size(); ++i)
+  if (!deformed)
+    uploadWeights();
+}
+
+void NGLScene::createCrowdEyes()
+{
+  // the eye as plain triangles, all the positions then all the normals like the face
+  auto verts = m_eyeMesh->getVertexList();
+  auto normals = m_eyeMesh->getNormalList();
+  auto faces = m_eyeMesh->getFaceList();
+  std::vector<ngl::Vec3> data;
+  data.reserve(faces.size() * 6);
+  for (auto &f : faces)
+  {
+    for (size_t j = 0; j < 3; ++j)
+      data.push_back(verts[f.m_vert[j]]);
+  }
+  m_numEyeVerts = data.size();
+  for (auto &f : faces)
   {
-    ngl::ShaderLib::setUniform(fmt::format("weights[{}]", i), m_weights[i]);
+    for (size_t j = 0; j < 3; ++j)
+      data.push_back(normals.empty() ? ngl::Vec3(0.0f, 0.0f, 1.0f) : normals[f.m_norm[j]]);
   }
+  m_vaoEyes = ngl::VAOFactory::createVAO("simpleVAO", GL_TRIANGLES);
+  m_vaoEyes->bind();
+  m_vaoEyes->setData(ngl::SimpleVAO::VertexData(data.size() * sizeof(ngl::Vec3), data[0].m_x));
+  m_vaoEyes->setVertexAttributePointer(0, 3, GL_FLOAT, 0, 0);
+  m_vaoEyes->setVertexAttributePointer(1, 3, GL_FLOAT, 0, m_numEyeVerts * 3);
+  m_vaoEyes->setNumIndices(m_numEyeVerts);
+  m_vaoEyes->unbind();
+
+  // the same placement as the single face's eyes
+  ngl::ShaderLib::use("CrowdEyes");
+  ngl::Transformation t;
+  t.setScale(0.685f, 0.583f, 0.583f);
+  t.setPosition(-1.276f, 3.209f, 2.271f);
+  ngl::ShaderLib::setUniform("eyeTX[0]", t.getMatrix());
+  t.setPosition(1.276f, 3.209f, 2.271f);
+  ngl::ShaderLib::setUniform("eyeTX[1]", t.getMatrix());
 }
 
-void NGLScene::paintGL()
+void NGLScene::resizeCrowd()
 {
-  // clear the screen and depth buffer
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  // Rotation based on the mouse position for our global transform
-  ngl::Transformation trans;
-  auto rotX = ngl::Mat4::rotateX(m_win.spinXFace);
-  auto rotY = ngl::Mat4::rotateY(m_win.spinYFace);
-  // multiply the rotations
-  m_mouseGlobalTX = rotY * rotX;
-  // add the translations
-  m_mouseGlobalTX.m_m[3][0] = m_modelPos.m_x;
-  m_mouseGlobalTX.m_m[3][1] = m_modelPos.m_y;
-  m_mouseGlobalTX.m_m[3][2] = m_modelPos.m_z;
+  size_t count = m_crowdCount;
+  if (m_weightsInTBO)
+  {
+    // every head's weights have to fit in one texture buffer
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    size_t perHead = std::max<size_t>(numBlendTargets(), 4);
+    count = std::min(count, std::max<size_t>(1, static_cast<size_t>(maxTexels) / perHead));
+  }
+  m_crowdCount = count;
+  m_crowd.resize(count, m_weights.size());
+  m_crowdWeights.create(count * numBlendTargets(), m_weightsInTBO ? 2 : 0, 3,
+                        m_weightsInTBO ? WeightBuffer::Target::TextureBuffer : WeightBuffer::Target::StorageBuffer);
+  // the heads don't move so their matrices are only written here
+  if (m_instanceBuffer == 0)
+  {
+    glGenBuffers(1, &m_instanceBuffer);
+    glGenTextures(1, &m_instanceTboID);
+  }
+  glBindBuffer(GL_TEXTURE_BUFFER, m_instanceBuffer);
+  glBufferData(GL_TEXTURE_BUFFER, m_crowd.matrices().size() * sizeof(float), m_crowd.matrices().data(),
+               GL_STATIC_DRAW);
+  glActiveTexture(GL_TEXTURE6);
+  glBindTexture(GL_TEXTURE_BUFFER, m_instanceTboID);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_instanceBuffer);
+  // the order the heads are drawn in changes every frame as they move between levels
+  if (m_headBuffer == 0)
+  {
+    glGenBuffers(1, &m_headBuffer);
+    glGenTextures(1, &m_headTboID);
+  }
+  glBindBuffer(GL_TEXTURE_BUFFER, m_headBuffer);
+  glBufferData(GL_TEXTURE_BUFFER, m_crowd.size() * sizeof(int32_t), nullptr, GL_STREAM_DRAW);
+  glActiveTexture(GL_TEXTURE7);
+  glBindTexture(GL_TEXTURE_BUFFER, m_headTboID);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_R32I, m_headBuffer);
+  glActiveTexture(GL_TEXTURE0);
+  m_crowdStart = std::chrono::steady_clock::now();
+}
 
-  loadMatricesToShader();
-  // draw the mesh
-  m_vaoMesh->bind();
-  glBindTexture(GL_TEXTURE_BUFFER, m_tboID);
-  m_vaoMesh->draw();
-  m_vaoMesh->unbind();
+void NGLScene::drawCrowd()
+{
+  // a reload drops a baked basis so the same targets can be blended as a different number of shapes
+  if (m_crowd.size() != m_crowdCount || m_crowd.numTargets() != m_weights.size() ||
+      m_crowdWeights.capacity() != std::max<size_t>(m_crowdCount * numBlendTargets(), 1))
+    resizeCrowd();
+  // pull the camera back far enough to see the whole grid
+  float r = m_crowd.radius();
+  ngl::Mat4 V = ngl::lookAt(ngl::Vec3(0.0f, 1.5f + 0.4f * r, 15.0f + 1.5f * r), ngl::Vec3(0.0f, 1.5f, -r),
+                            ngl::Vec3(0.0f, 1.0f, 0.0f)) *
+                m_mouseGlobalTX;
+  ngl::Mat4 P = ngl::perspective(45.0f, static_cast<float>(width()) / height(), 0.05f, 350.0f + 4.0f * r);
+  GLsizei count = static_cast<GLsizei>(m_crowd.size());
 
+  {
+    ProfileScope scope(m_profiler, m_gpuTimer, ProfileCrowd);
+    float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_crowdStart).count();
+    m_crowd.update(time, &m_clipSampler);
+    // group the heads by the level their size on screen needs
+    if (m_useLod)
+    {
+      m_lod.selectLevels(&V.m_m[0][0], m_crowd.matrices().data(), m_crowd.size(), P.m_m[1][1],
+                         static_cast<float>(m_win.height), m_crowdOrder, m_crowdLevels);
+    }
+    else
+    {
+      m_crowdOrder.resize(m_crowd.size());
+      std::iota(m_crowdOrder.begin(), m_crowdOrder.end(), 0);
+      m_crowdLevels.assign(1, static_cast<uint32_t>(m_crowd.size()));
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, m_headBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, m_crowdOrder.size() * sizeof(int32_t), m_crowdOrder.data());
+    // a draw per level, each head reads its weights at head * numTargets
+    ngl::ShaderLib::use(m_crowdProgram);
+    ngl::ShaderLib::setUniform("V", V);
+    ngl::ShaderLib::setUniform("P", P);
+    // each head has its own weights so the shared active list doesn't apply
+    ngl::ShaderLib::setUniform("useActiveList", 0);
+    m_crowdBlendWeights.resize(m_crowd.weights().size());
+    m_weightProgram.evaluate(m_crowd.weights().data(), m_crowdBlendWeights.data(), m_crowd.size());
+    if (!m_basis.empty())
+    {
+      // every head's coefficients, still head * numTargets apart as the shader has a target per shape
+      m_crowdBasisWeights.resize(m_crowd.size() * m_basis.numShapes());
+      m_basis.project(m_crowdBlendWeights.data(), m_crowdBasisWeights.data(), m_crowd.size());
+      m_crowdWeights.upload(m_crowdBasisWeights.data(), m_crowdBasisWeights.size());
+    }
+    else
+    {
+      m_crowdWeights.upload(m_crowdBlendWeights.data(), m_crowdBlendWeights.size());
+    }
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_BUFFER, m_instanceTboID);
+    glActiveTexture(GL_TEXTURE7);
+    glBindTexture(GL_TEXTURE_BUFFER, m_headTboID);
+    bindDeltaTextures();
+    m_vaoMesh->bind();
+    int firstHead = 0;
+    for (size_t l = 0; l < m_crowdLevels.size(); ++l)
+    {
+      if (m_crowdLevels[l] == 0)
+        continue;
+      ngl::ShaderLib::setUniform("firstHead", firstHead);
+      drawLevel(l, static_cast<GLsizei>(m_crowdLevels[l]));
+      firstHead += static_cast<int>(m_crowdLevels[l]);
+    }
+    m_vaoMesh->unbind();
+    m_crowdWeights.fence();
+  }
+
+  // and every eye in another
+  ProfileScope scope(m_profiler, m_gpuTimer, ProfileEyes);
+  ngl::ShaderLib::use("CrowdEyes");
+  ngl::ShaderLib::setUniform("V", V);
+  ngl::ShaderLib::setUniform("P", P);
+  m_vaoEyes->bind();
+  glDrawArraysInstanced(GL_TRIANGLES, 0, static_cast<GLsizei>(m_numEyeVerts), 2 * count);
+  m_vaoEyes->unbind();
+}
+
+void NGLScene::crowdBenchmarkFrame()
+{
+  if (!m_benchmarking)
+    return;
+  // the first frames after a resize are left out, they include the upload and any driver warm up
+  auto now = std::chrono::steady_clock::now();
+  if (++m_benchFrames == c_benchWarmup)
+  {
+    m_benchStart = now;
+    return;
+  }
+  if (m_benchFrames < c_benchWarmup + c_benchFrames)
+    return;
+  double ms = std::chrono::duration<double, std::milli>(now - m_benchStart).count() / c_benchFrames;
+  std::cout << fmt::format("{:>6} heads {:>9.3f} ms/frame {:>12.0f} heads/s\n", m_crowdCount, ms,
+                           m_crowdCount * 1000.0 / ms);
+  m_benchFrames = 0;
+  if (m_crowdCount >= c_maxCrowd)
+  {
+    m_benchmarking = false;
+    QGuiApplication::exit(EXIT_SUCCESS);
+    return;
+  }
+  size_t before = m_crowdCount;
+  m_crowdCount = std::min(m_crowdCount * 4, c_maxCrowd);
+  resizeCrowd();
+  // a texture buffer limit can stop the crowd growing
+  if (m_crowdCount == before)
+  {
+    m_benchmarking = false;
+    QGuiApplication::exit(EXIT_SUCCESS);
+  }
+}
+
+void NGLScene::drawLevel(size_t _level, GLsizei _instances) const
+{
+  // the levels are ranges of the one element buffer
+  auto first = reinterpret_cast<const void *>(m_lod.firstIndex(_level) * sizeof(uint32_t));
+  auto count = static_cast<GLsizei>(m_lod.level(_level).indices.size());
+  if (_instances == 1)
+    glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, first);
+  else
+    glDrawElementsInstanced(GL_TRIANGLES, count, GL_UNSIGNED_INT, first, _instances);
+}
+
+void NGLScene::drawFace()
+{
+  ngl::Mat4 faceMV = m_view * m_mouseGlobalTX;
+  m_faceLevel = m_useLod ? m_lod.selectLevel(m_lod.pixelsPerUnit(&faceMV.m_m[0][0], m_project.m_m[1][1],
+                                                                 static_cast<float>(m_win.height)))
+                         : 0;
+  if (m_cacheMode)
+  {
+    drawCachedFace();
+  }
+  else if (m_useCompute)
+  {
+    // blend once into the deformed mesh, any number of passes can then draw it
+    {
+      ProfileScope scope(m_profiler, m_gpuTimer, ProfileBlend);
+      blendDeformedMesh();
+    }
+    {
+      ProfileScope scope(m_profiler, m_gpuTimer, ProfileMatrices);
+      loadMatricesToShader();
+    }
+    ProfileScope scope(m_profiler, m_gpuTimer, ProfileMorphDraw);
+    m_vaoDeformed->bind();
+    drawLevel(m_faceLevel);
+    m_vaoDeformed->unbind();
+  }
+  else
+  {
+    {
+      ProfileScope scope(m_profiler, m_gpuTimer, ProfileMatrices);
+      loadMatricesToShader();
+    }
+    // draw the mesh
+    ProfileScope scope(m_profiler, m_gpuTimer, ProfileMorphDraw);
+    m_vaoMesh->bind();
+    bindDeltaTextures();
+    drawLevel(m_faceLevel);
+    m_vaoMesh->unbind();
+    // the draw that reads this frame's weights has been issued
+    m_weightBuffer.fence();
+    m_activeBuffer.fence();
+  }
+
+  ProfileScope scope(m_profiler, m_gpuTimer, ProfileEyes);
   ngl::ShaderLib::use("nglDiffuseShader");
   // left Eye
 
@@ -383,9 +1427,212 @@ void NGLScene::paintGL()
   ngl::ShaderLib::setUniform("MVP", MVP);
   ngl::ShaderLib::setUniform("normalMatrix", normalMatrix);
   m_eyeMesh->draw();
+}
+
+void NGLScene::paintGL()
+{
+  // the GPU is only asked for timings when someone is looking at them
+  m_gpuTimer.setEnabled(m_showProfiler || m_profiler.isTracing());
+  m_profiler.beginFrame();
+  m_profiler.beginSection(ProfileFrame);
+  m_gpuTimer.begin(ProfileFrame);
+  // clear the screen and depth buffer
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  // Rotation based on the mouse position for our global transform
+  ngl::Transformation trans;
+  auto rotX = ngl::Mat4::rotateX(m_win.spinXFace);
+  auto rotY = ngl::Mat4::rotateY(m_win.spinYFace);
+  // multiply the rotations
+  m_mouseGlobalTX = rotY * rotX;
+  // add the translations
+  m_mouseGlobalTX.m_m[3][0] = m_modelPos.m_x;
+  m_mouseGlobalTX.m_m[3][1] = m_modelPos.m_y;
+  m_mouseGlobalTX.m_m[3][2] = m_modelPos.m_z;
+
+  if (m_reloadPending)
+    applyReload();
+  if (m_cacheMode)
+  {
+    // the playhead follows the clock either way and wraps at the ends
+    auto now = std::chrono::steady_clock::now();
+    double duration = m_cachePlayer.numFrames() / m_cachePlayer.fps();
+    m_cacheTime += m_cacheDirection * std::chrono::duration<double>(now - m_cacheClock).count();
+    m_cacheTime = std::fmod(m_cacheTime, duration);
+    if (m_cacheTime < 0.0)
+      m_cacheTime += duration;
+    m_cacheClock = now;
+  }
+  if (m_stream.isOpen() && m_stream.latest(m_streamFrame))
+  {
+    // a live stream overrides everything else, a reload may have changed the number of targets since it opened
+    std::copy_n(m_streamFrame.weights.begin(), std::min(m_streamFrame.weights.size(), m_weights.size()),
+                m_weights.begin());
+    m_streamShowing = true;
+  }
+  else if (m_playing)
+  {
+    // the clip drives the weights, looping
+    float t = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_playStart).count();
+    float duration = m_clipSampler.duration();
+    m_clipSampler.sample(duration > 0.0f ? std::fmod(t, duration) : 0.0f, m_weights);
+  }
+
+  if (m_crowdMode)
+    drawCrowd();
+  else
+    drawFace();
+
+  {
+    ProfileScope scope(m_profiler, m_gpuTimer, ProfileText);
+    drawText();
+  }
+  m_gpuTimer.end(ProfileFrame);
+  m_profiler.endSection(ProfileFrame);
+  m_gpuTimer.endFrame(m_profiler);
+  m_profiler.endFrame();
+  // keep drawing while the clip plays or frames may arrive, swaps are paced by vsync
+  if (m_playing || m_stream.isOpen() || m_crowdMode || m_cacheMode || m_showProfiler || m_profiler.isTracing())
+    update();
+}
+
+void NGLScene::drawText()
+{
   m_text->setColour(1.0f, 1.0f, 1.0f);
-  m_text->renderText(10, 700, fmt::format("Current Mesh {} value {}", m_meshNames[m_activeWeight], m_weights[m_activeWeight]));
+  if (m_weightProgram.isDriven(m_activeWeight))
+    m_text->renderText(10, 700, fmt::format("Current Mesh {} driven to {}", m_meshNames[m_activeWeight],
+                                            m_blendWeights[m_activeWeight]));
+  else
+    m_text->renderText(10, 700, fmt::format("Current Mesh {} value {}", m_meshNames[m_activeWeight],
+                                            m_weights[m_activeWeight]));
   m_text->renderText(10, 680, "Q-W change Pose Arrows to swap weights");
+  if (m_basis.empty())
+    m_text->renderText(10, 660, fmt::format("Active targets {} / {}", m_active.size(), m_active.numTargets()));
+  else
+    m_text->renderText(10, 660, fmt::format("Active basis shapes {} / {} for {} targets", m_active.size(),
+                                            m_active.numTargets(), m_meshNames.size()));
+  // the heads are blended in the vertex shader and there are no normal deltas to blend
+  if (m_normalMode == NormalRebuilder::Mode::Topology && m_crowdMode)
+    m_text->renderText(10, 640, "crowd heads shade with the base normals, normals are only rebuilt for one head");
+  else if (m_normalMode == NormalRebuilder::Mode::Topology)
+    m_text->renderText(10, 640, fmt::format("compute pre-pass, {} blends, normals rebuilt for {} vertices",
+                                            m_computePasses, m_numTouched));
+  else if (m_useCompute)
+    m_text->renderText(10, 640, fmt::format("C compute pre-pass, {} blends", m_computePasses));
+  else
+    m_text->renderText(10, 640, "C vertex shader blend");
+  if (m_useCompute && m_poseCache.enabled())
+  {
+    auto &poses = m_poseCache.stats();
+    m_text->renderText(10, 480, fmt::format("pose cache {} / {} poses ({} MB), {} hits {} misses ({:.0f}%), {} evicted",
+                                            m_poseCache.size(), m_poseCache.numSlots(),
+                                            m_poseCache.bytes() / (1024 * 1024), poses.hits, poses.misses,
+                                            100.0 * m_poseCache.hitRate(), poses.evictions));
+  }
+  m_text->renderText(10, 620, m_playing ? "P stop clip" : "P play clip");
+  if (m_crowdMode)
+  {
+    size_t draws = 1 + std::count_if(m_crowdLevels.begin(), m_crowdLevels.end(), [](uint32_t _n) { return _n != 0; });
+    m_text->renderText(10, 580, fmt::format("G crowd of {} heads in {} draws, +/- to change", m_crowd.size(), draws));
+  }
+  else
+  {
+    m_text->renderText(10, 580, "G crowd");
+  }
+  if (m_profiler.isTracing())
+    m_text->renderText(10, 560,
+                       fmt::format("T timings, R stop recording trace ({} events)", m_profiler.numTraceEvents()));
+  else
+    m_text->renderText(10, 560, "T timings, R record trace");
+  if (!m_useLod)
+    m_text->renderText(10, 540, "L levels of detail off");
+  else if (m_crowdMode)
+  {
+    std::string levels;
+    for (auto n : m_crowdLevels)
+      levels += fmt::format(" {}", n);
+    m_text->renderText(10, 540, "L heads at each level of detail" + levels);
+  }
+  else
+    m_text->renderText(10, 540, fmt::format("L level of detail {} of {}, {} triangles", m_faceLevel,
+                                            m_lod.numLevels() - 1, m_lod.level(m_faceLevel).indices.size() / 3));
+  if (m_reloader.isWatching())
+    m_text->renderText(10, 520, m_reloadStatus.empty() ? "watching models.txt" : m_reloadStatus);
+  if (m_cacheMode)
+  {
+    auto stats = m_cachePlayer.stats();
+    m_text->renderText(10, 500, fmt::format("K point cache frame {} / {}, , . play back / forward [ ] step, {} "
+                                            "frames in memory, {} late, {} upload",
+                                            m_cacheShown, m_cachePlayer.numFrames(), m_cachePlayer.numResident(),
+                                            stats.late, m_cacheRing.isPersistent() ? "mapped" : "glBufferSubData"));
+  }
+  else if (m_cachePlayer.isOpen())
+  {
+    m_text->renderText(10, 500, "K play point cache " + m_cacheFile);
+  }
+  if (m_showProfiler)
+    drawProfiler();
+  if (m_stream.isOpen())
+  {
+    float mean = 0.0f;
+    float worst = 0.0f;
+    for (auto l : m_streamLatency)
+    {
+      mean += l;
+      worst = std::max(worst, l);
+    }
+    if (!m_streamLatency.empty())
+      mean /= m_streamLatency.size();
+    m_text->renderText(10, 600, fmt::format("Stream frame {} latency {:.2f} ms (max {:.2f}) skipped {} dropped {}",
+                                            m_streamFrame.sequence, mean, worst, m_stream.skipped(),
+                                            m_stream.dropped()));
+  }
+}
+
+void NGLScene::drawProfiler()
+{
+  int x = 620;
+  int y = 700;
+  m_text->renderText(x, y, fmt::format("frame p50 {:.2f} p95 {:.2f} p99 {:.2f} ms ({} frames)",
+                                       m_profiler.percentile(50.0), m_profiler.percentile(95.0),
+                                       m_profiler.percentile(99.0), m_profiler.numFrames()));
+  y -= 20;
+  bool gpu = m_profiler.hasGpuTimes();
+  m_text->renderText(x, y, gpu ? "section  cpu ms  gpu ms" : "section  cpu ms");
+  for (size_t s = 0; s < m_profiler.numSections(); ++s)
+  {
+    y -= 20;
+    if (gpu)
+      m_text->renderText(x, y, fmt::format("{}  {:.3f}  {:.3f}", m_profiler.sectionName(s), m_profiler.cpuMs(s),
+                                           m_profiler.gpuMs(s)));
+    else
+      m_text->renderText(x, y, fmt::format("{}  {:.3f}", m_profiler.sectionName(s), m_profiler.cpuMs(s)));
+  }
+  // one bar per bucket, scaled so the fullest one is 30 characters
+  auto buckets = m_profiler.histogram();
+  size_t most = std::max<size_t>(1, *std::max_element(buckets.begin(), buckets.end()));
+  for (size_t b = 0; b < buckets.size(); ++b)
+  {
+    y -= 20;
+    std::string label = b + 1 < buckets.size()
+                            ? fmt::format("< {} ms", FrameProfiler::c_bucketEdges[b])
+                            : fmt::format(">= {} ms", FrameProfiler::c_bucketEdges[b - 1]);
+    m_text->renderText(x, y, fmt::format("{} {} {}", label, std::string(buckets[b] * 30 / most, '|'), buckets[b]));
+  }
+}
+
+void NGLScene::toggleTrace()
+{
+  if (!m_profiler.isTracing())
+  {
+    m_profiler.setTracing(true);
+    std::cout << "recording trace\n";
+    return;
+  }
+  m_profiler.setTracing(false);
+  if (m_profiler.writeChromeTrace(m_traceFile))
+    std::cout << "wrote " << m_profiler.numTraceEvents() << " trace events to " << m_traceFile << '\n';
+  else
+    std::cout << "unable to write trace " << m_traceFile << '\n';
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -519,6 +1766,60 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
   case Qt::Key_Space:
     resetWeights();
     break;
+  case Qt::Key_P:
+    // pauses the point cache when it is showing
+    if (m_cacheMode)
+      m_cacheDirection = m_cacheDirection == 0 ? 1 : 0;
+    else
+      togglePlayback();
+    break;
+  case Qt::Key_K:
+    m_cacheMode = !m_cacheMode && m_cachePlayer.isOpen();
+    m_cacheClock = std::chrono::steady_clock::now();
+    break;
+  case Qt::Key_Comma:
+    m_cacheDirection = -1;
+    break;
+  case Qt::Key_Period:
+    m_cacheDirection = 1;
+    break;
+  case Qt::Key_BracketLeft:
+    if (m_cacheMode)
+      stepCache(-1);
+    break;
+  case Qt::Key_BracketRight:
+    if (m_cacheMode)
+      stepCache(1);
+    break;
+  case Qt::Key_G:
+    m_crowdMode = !m_crowdMode && !m_crowdProgram.empty();
+    break;
+  case Qt::Key_Plus:
+  case Qt::Key_Equal:
+    m_crowdCount = std::min(m_crowdCount * 2, c_maxCrowd);
+    break;
+  case Qt::Key_Minus:
+    m_crowdCount = std::max<size_t>(m_crowdCount / 2, 1);
+    break;
+  case Qt::Key_T:
+    m_showProfiler = !m_showProfiler;
+    // the window may have been idle, only time frames from now on
+    m_profiler.resetFrameTimes();
+    break;
+  case Qt::Key_R:
+    toggleTrace();
+    break;
+  case Qt::Key_L:
+    m_useLod = !m_useLod;
+    break;
+  case Qt::Key_C:
+    // switch between blending in the vertex shader and the compute pre-pass
+    // rebuilt normals are only made by the pre-pass
+    if (m_normalMode == NormalRebuilder::Mode::Blend)
+      m_useCompute = !m_useCompute && !m_computeProgram.empty();
+    // the deformed mesh and the cached poses still hold the last blend of this rig, if the weights moved
+    // while the vertex shader was blending the pre-pass notices they differ from m_blendedWeights
+    break;
   default:
     break;
   }
@@ -0,0 +1,355 @@
+#include "NormalRebuilder.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+/// @brief seam vertices share faces when their base normals are this close
+constexpr float c_sameNormal = 0.9999f;
+
+void faceNormal(const float *const _p[3], const uint32_t *_corners, float _n[3])
+{
+  // not normalized so bigger faces count for more
+  uint32_t a = _corners[0];
+  uint32_t b = _corners[1];
+  uint32_t c = _corners[2];
+  float e1[3] = {_p[0][b] - _p[0][a], _p[1][b] - _p[1][a], _p[2][b] - _p[2][a]};
+  float e2[3] = {_p[0][c] - _p[0][a], _p[1][c] - _p[1][a], _p[2][c] - _p[2][a]};
+  _n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+  _n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+  _n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+bool normalize(float _v[3])
+{
+  float len = std::sqrt(_v[0] * _v[0] + _v[1] * _v[1] + _v[2] * _v[2]);
+  if (len <= 0.0f)
+    return false;
+  _v[0] /= len;
+  _v[1] /= len;
+  _v[2] /= len;
+  return true;
+}
+} // end anon namespace
+
+const char *NormalRebuilder::modeName(Mode _m)
+{
+  return _m == Mode::Topology ? "topology" : "blend";
+}
+
+bool NormalRebuilder::parseMode(const std::string &_name, Mode &_m)
+{
+  if (_name == "blend")
+    _m = Mode::Blend;
+  else if (_name == "topology")
+    _m = Mode::Topology;
+  else
+    return false;
+  return true;
+}
+
+void NormalRebuilder::build(const uint32_t *_indices, size_t _numIndices, const uint32_t *_positionIndex,
+                            const float *_positions, const float *_normals, size_t _numVerts)
+{
+  m_numVerts = _numVerts;
+  size_t numFaces = _numIndices / 3;
+  m_indices.assign(_indices, _indices + numFaces * 3);
+  m_targetOffsets.clear();
+  m_targetVerts.clear();
+  m_stamps.assign(_numVerts, 0);
+  m_stamp = 0;
+
+  // the faces using each vertex as a corner
+  m_cornerOffsets.assign(_numVerts + 1, 0);
+  for (auto v : m_indices)
+    ++m_cornerOffsets[v + 1];
+  for (size_t v = 0; v < _numVerts; ++v)
+    m_cornerOffsets[v + 1] += m_cornerOffsets[v];
+  m_cornerFaces.resize(m_indices.size());
+  std::vector<int32_t> fill(m_cornerOffsets.begin(), m_cornerOffsets.end() - 1);
+  for (size_t f = 0; f < numFaces; ++f)
+  {
+    for (size_t c = 0; c < 3; ++c)
+      m_cornerFaces[fill[m_indices[f * 3 + c]]++] = static_cast<uint32_t>(f);
+  }
+
+  // group the vertices at each obj position by base normal
+  uint32_t numPositions = 0;
+  for (size_t v = 0; v < _numVerts; ++v)
+    numPositions = std::max(numPositions, _positionIndex[v] + 1);
+  std::vector<int32_t> positionOffsets(numPositions + 1, 0);
+  for (size_t v = 0; v < _numVerts; ++v)
+    ++positionOffsets[_positionIndex[v] + 1];
+  for (size_t p = 0; p < numPositions; ++p)
+    positionOffsets[p + 1] += positionOffsets[p];
+  std::vector<uint32_t> atPosition(_numVerts);
+  fill.assign(positionOffsets.begin(), positionOffsets.end() - 1);
+  for (size_t v = 0; v < _numVerts; ++v)
+    atPosition[fill[_positionIndex[v]]++] = static_cast<uint32_t>(v);
+  m_vertexGroup.assign(_numVerts, 0);
+  uint32_t numGroups = 0;
+  for (size_t p = 0; p < numPositions; ++p)
+  {
+    uint32_t first = numGroups;
+    for (int32_t i = positionOffsets[p]; i < positionOffsets[p + 1]; ++i)
+    {
+      uint32_t v = atPosition[i];
+      const float *n = _normals + v * 3;
+      // join an earlier vertex here with the same normal, there are rarely more than a couple
+      uint32_t group = numGroups;
+      for (int32_t j = positionOffsets[p]; j < i && group == numGroups; ++j)
+      {
+        uint32_t u = atPosition[j];
+        const float *m = _normals + u * 3;
+        if (n[0] * m[0] + n[1] * m[1] + n[2] * m[2] >= c_sameNormal && m_vertexGroup[u] >= first)
+          group = m_vertexGroup[u];
+      }
+      m_vertexGroup[v] = group;
+      if (group == numGroups)
+        ++numGroups;
+    }
+  }
+  m_groupOffsets.assign(numGroups + 1, 0);
+  for (size_t v = 0; v < _numVerts; ++v)
+    ++m_groupOffsets[m_vertexGroup[v] + 1];
+  for (size_t g = 0; g < numGroups; ++g)
+    m_groupOffsets[g + 1] += m_groupOffsets[g];
+  m_groupVerts.resize(_numVerts);
+  fill.assign(m_groupOffsets.begin(), m_groupOffsets.end() - 1);
+  for (size_t v = 0; v < _numVerts; ++v)
+    m_groupVerts[fill[m_vertexGroup[v]]++] = static_cast<uint32_t>(v);
+
+  // every vertex gets the faces of its whole group
+  m_offsets.assign(_numVerts + 1, 0);
+  for (size_t v = 0; v < _numVerts; ++v)
+  {
+    uint32_t g = m_vertexGroup[v];
+    int32_t count = 0;
+    for (int32_t i = m_groupOffsets[g]; i < m_groupOffsets[g + 1]; ++i)
+    {
+      uint32_t u = m_groupVerts[i];
+      count += m_cornerOffsets[u + 1] - m_cornerOffsets[u];
+    }
+    m_offsets[v + 1] = m_offsets[v] + count;
+  }
+  m_faces.resize(m_offsets[_numVerts]);
+  for (size_t v = 0; v < _numVerts; ++v)
+  {
+    uint32_t g = m_vertexGroup[v];
+    int32_t out = m_offsets[v];
+    for (int32_t i = m_groupOffsets[g]; i < m_groupOffsets[g + 1]; ++i)
+    {
+      uint32_t u = m_groupVerts[i];
+      for (int32_t f = m_cornerOffsets[u]; f < m_cornerOffsets[u + 1]; ++f)
+        m_faces[out++] = m_cornerFaces[f];
+    }
+  }
+
+  // the rest pose normal from the faces, what rebuild measures the change against
+  std::vector<float> x(_numVerts);
+  std::vector<float> y(_numVerts);
+  std::vector<float> z(_numVerts);
+  for (size_t v = 0; v < _numVerts; ++v)
+  {
+    x[v] = _positions[v * 3];
+    y[v] = _positions[v * 3 + 1];
+    z[v] = _positions[v * 3 + 2];
+  }
+  const float *p[3] = {x.data(), y.data(), z.data()};
+  m_restNormals.assign(_numVerts * 3, 0.0f);
+  for (size_t v = 0; v < _numVerts; ++v)
+  {
+    float *sum = &m_restNormals[v * 3];
+    for (int32_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i)
+    {
+      float n[3];
+      faceNormal(p, &m_indices[m_faces[i] * 3], n);
+      sum[0] += n[0];
+      sum[1] += n[1];
+      sum[2] += n[2];
+    }
+    normalize(sum);
+  }
+}
+
+uint32_t NormalRebuilder::nextStamp()
+{
+  if (++m_stamp == 0)
+  {
+    // wrapped, clear the old stamps so none of them match
+    std::fill(m_stamps.begin(), m_stamps.end(), 0);
+    m_stamp = 1;
+  }
+  return m_stamp;
+}
+
+void NormalRebuilder::region(const std::vector<uint32_t> &_moved, std::vector<uint32_t> &_out)
+{
+  // a face changes if any corner moves and every vertex sharing that face (through its group) can change
+  uint32_t stamp = nextStamp();
+  size_t first = _out.size();
+  for (auto m : _moved)
+  {
+    for (int32_t f = m_cornerOffsets[m]; f < m_cornerOffsets[m + 1]; ++f)
+    {
+      const uint32_t *corners = &m_indices[m_cornerFaces[f] * 3];
+      for (size_t c = 0; c < 3; ++c)
+      {
+        uint32_t g = m_vertexGroup[corners[c]];
+        for (int32_t i = m_groupOffsets[g]; i < m_groupOffsets[g + 1]; ++i)
+        {
+          uint32_t u = m_groupVerts[i];
+          if (m_stamps[u] != stamp)
+          {
+            m_stamps[u] = stamp;
+            _out.push_back(u);
+          }
+        }
+      }
+    }
+  }
+  std::sort(_out.begin() + first, _out.end());
+}
+
+void NormalRebuilder::beginTargets()
+{
+  m_targetOffsets.assign(1, 0);
+  m_targetVerts.clear();
+}
+
+void NormalRebuilder::addTarget(const std::vector<uint32_t> &_moved)
+{
+  region(_moved, m_targetVerts);
+  m_targetOffsets.push_back(static_cast<int64_t>(m_targetVerts.size()));
+}
+
+void NormalRebuilder::setTargets(const BlendTargetSet &_targets)
+{
+  beginTargets();
+  for (size_t t = 0; t < _targets.numTargets(); ++t)
+    addTarget(_targets.target(t).indices);
+}
+
+void NormalRebuilder::setTargets(const int32_t *_offsets, const float *_entries, size_t _numTargets)
+{
+  // flip the rows back to a list of vertices per target, the target index is in the w of each entry
+  std::vector<std::vector<uint32_t>> moved(_numTargets);
+  for (size_t v = 0; v < m_numVerts; ++v)
+  {
+    for (int32_t i = _offsets[v]; i < _offsets[v + 1]; ++i)
+    {
+      size_t t = static_cast<size_t>(_entries[i * 8 + 3]);
+      if (t < _numTargets)
+        moved[t].push_back(static_cast<uint32_t>(v));
+    }
+  }
+  beginTargets();
+  for (auto &m : moved)
+    addTarget(m);
+}
+
+const std::vector<uint32_t> &NormalRebuilder::touched(const ActiveWeights &_active)
+{
+  m_touched.clear();
+  size_t numTargets = this->numTargets();
+  if (_active.size() == 1 && _active.indices()[0] < numTargets)
+  {
+    // one target is already a sorted list
+    size_t t = _active.indices()[0];
+    m_touched.assign(m_targetVerts.begin() + m_targetOffsets[t], m_targetVerts.begin() + m_targetOffsets[t + 1]);
+    return m_touched;
+  }
+  uint32_t stamp = nextStamp();
+  for (auto t : _active.indices())
+  {
+    if (t >= numTargets)
+      continue;
+    for (int64_t i = m_targetOffsets[t]; i < m_targetOffsets[t + 1]; ++i)
+    {
+      uint32_t v = m_targetVerts[i];
+      if (m_stamps[v] != stamp)
+      {
+        m_stamps[v] = stamp;
+        m_touched.push_back(v);
+      }
+    }
+  }
+  if (m_touched.size() > m_numVerts / 16)
+  {
+    // a big region is quicker to put in order by walking the stamps than by sorting it
+    m_touched.clear();
+    for (size_t v = 0; v < m_numVerts; ++v)
+    {
+      if (m_stamps[v] == stamp)
+        m_touched.push_back(static_cast<uint32_t>(v));
+    }
+  }
+  else
+  {
+    std::sort(m_touched.begin(), m_touched.end());
+  }
+  return m_touched;
+}
+
+void NormalRebuilder::rebuild(const float *const _positions[3], const float *const _baseNormals[3],
+                              const std::vector<uint32_t> &_vertices, float *const _normals[3])
+{
+  // each face is shared by three (or more across a seam) vertices so work its normal out once
+  m_faceNormals.resize(m_indices.size());
+  m_faceStamps.resize(m_indices.size() / 3, 0);
+  if (++m_faceStamp == 0)
+  {
+    std::fill(m_faceStamps.begin(), m_faceStamps.end(), 0);
+    m_faceStamp = 1;
+  }
+  for (auto v : _vertices)
+  {
+    for (int32_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i)
+    {
+      uint32_t f = m_faces[i];
+      if (m_faceStamps[f] != m_faceStamp)
+      {
+        m_faceStamps[f] = m_faceStamp;
+        faceNormal(_positions, &m_indices[f * 3], &m_faceNormals[f * 3]);
+      }
+    }
+  }
+  for (auto v : _vertices)
+  {
+    float d[3] = {0.0f, 0.0f, 0.0f};
+    for (int32_t i = m_offsets[v]; i < m_offsets[v + 1]; ++i)
+    {
+      const float *n = &m_faceNormals[m_faces[i] * 3];
+      d[0] += n[0];
+      d[1] += n[1];
+      d[2] += n[2];
+    }
+    const float *r = &m_restNormals[v * 3];
+    float b[3] = {_baseNormals[0][v], _baseNormals[1][v], _baseNormals[2][v]};
+    float out[3] = {b[0], b[1], b[2]};
+    // collapsed faces, or faces turned right over, keep the base normal
+    float c = normalize(d) ? r[0] * d[0] + r[1] * d[1] + r[2] * d[2] : -1.0f;
+    if (c > -0.999f && (r[0] != 0.0f || r[1] != 0.0f || r[2] != 0.0f))
+    {
+      // rotate the base normal by the rotation taking r to d (Rodrigues with k = r x d, |k| = sin)
+      float k[3] = {r[1] * d[2] - r[2] * d[1], r[2] * d[0] - r[0] * d[2], r[0] * d[1] - r[1] * d[0]};
+      float kb = (k[0] * b[0] + k[1] * b[1] + k[2] * b[2]) / (1.0f + c);
+      out[0] = b[0] * c + (k[1] * b[2] - k[2] * b[1]) + k[0] * kb;
+      out[1] = b[1] * c + (k[2] * b[0] - k[0] * b[2]) + k[1] * kb;
+      out[2] = b[2] * c + (k[0] * b[1] - k[1] * b[0]) + k[2] * kb;
+    }
+    _normals[0][v] = out[0];
+    _normals[1][v] = out[1];
+    _normals[2][v] = out[2];
+  }
+}
+
+size_t NormalRebuilder::bytes() const
+{
+  return m_offsets.size() * sizeof(int32_t) + m_faces.size() * sizeof(uint32_t) +
+         m_indices.size() * sizeof(uint32_t) + m_restNormals.size() * sizeof(float) +
+         m_cornerOffsets.size() * sizeof(int32_t) + m_cornerFaces.size() * sizeof(uint32_t) +
+         m_vertexGroup.size() * sizeof(uint32_t) + m_groupOffsets.size() * sizeof(int32_t) +
+         m_groupVerts.size() * sizeof(uint32_t) + m_targetOffsets.size() * sizeof(int64_t) +
+         m_targetVerts.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,129 @@
+#include "ObjTargetReader.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+inline bool isBlank(char _c)
+{
+  return _c == ' ' || _c == '\t';
+}
+
+// one number, nullptr if there isn't one. from_chars where the standard library has it for floats,
+// strtof on a copy of the token where it doesn't (the mapping isn't null terminated)
+const char *parseFloat(const char *_p, const char *_end, float &_value)
+{
+  while (_p < _end && isBlank(*_p))
+    ++_p;
+  // from_chars doesn't take a leading +
+  if (_p < _end && *_p == '+')
+    ++_p;
+#if defined(__cpp_lib_to_chars)
+  auto result = std::from_chars(_p, _end, _value);
+  if (result.ec == std::errc::invalid_argument)
+    return nullptr;
+  // too small for a float is as good as zero
+  if (result.ec == std::errc::result_out_of_range)
+    _value = 0.0f;
+  return result.ptr;
+#else
+  char token[64];
+  size_t n = 0;
+  while (_p + n < _end && n < sizeof(token) - 1 && !isBlank(_p[n]) && _p[n] != '\r' && _p[n] != '\n')
+  {
+    token[n] = _p[n];
+    ++n;
+  }
+  token[n] = '\0';
+  char *stop = nullptr;
+  _value = std::strtof(token, &stop);
+  return stop == token ? nullptr : _p + (stop - token);
+#endif
+}
+} // end anon namespace
+
+bool ObjTargetReader::read(const std::string &_path, size_t _numPositions, size_t _numNormals)
+{
+  m_error.clear();
+  m_fileBytes = 0;
+  MappedFile file;
+  if (!file.open(_path))
+  {
+    m_error = "can't open " + _path;
+    return false;
+  }
+  m_fileBytes = file.size();
+  // sized from the base mesh so every number is written straight to where it ends up, without a size
+  // the arrays grow (and keep their capacity for the next file)
+  m_positions.resize(_numPositions * 3);
+  m_normals.resize(_numNormals * 3);
+  size_t count[2] = {0, 0};
+  const size_t expected[2] = {_numPositions, _numNormals};
+  std::vector<float> *lists[2] = {&m_positions, &m_normals};
+  auto p = reinterpret_cast<const char *>(file.data());
+  auto end = p + file.size();
+  size_t line = 1;
+  while (p < end)
+  {
+    while (p < end && isBlank(*p))
+      ++p;
+    // only the type of the line is looked at before it is skipped
+    int list = -1;
+    if (end - p > 2 && p[0] == 'v' && isBlank(p[1]))
+    {
+      list = 0;
+      p += 2;
+    }
+    else if (end - p > 3 && p[0] == 'v' && p[1] == 'n' && isBlank(p[2]))
+    {
+      list = 1;
+      p += 3;
+    }
+    if (list >= 0)
+    {
+      std::vector<float> &out = *lists[list];
+      size_t i = count[list]++;
+      float extra[3];
+      float *xyz = extra;
+      if (expected[list] == 0)
+      {
+        if (out.size() < (i + 1) * 3)
+          out.resize(std::max<size_t>(out.size() * 2, 3 * 1024));
+        xyz = out.data() + i * 3;
+      }
+      else if (i < expected[list])
+      {
+        xyz = out.data() + i * 3;
+      }
+      // more than the base has are still counted so the error can say how many there are
+      for (size_t k = 0; k < 3; ++k)
+      {
+        p = parseFloat(p, end, xyz[k]);
+        if (p == nullptr)
+        {
+          m_error = _path + " line " + std::to_string(line) + " isn't three numbers";
+          return false;
+        }
+      }
+    }
+    // the rest of the line is skipped, that includes the w of a position or any vertex colour
+    auto next = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+    p = next != nullptr ? next + 1 : end;
+    ++line;
+  }
+  const char *names[2] = {"positions", "normals"};
+  for (size_t l = 0; l < 2; ++l)
+  {
+    if (expected[l] != 0 && count[l] != expected[l])
+    {
+      m_error = _path + " has " + std::to_string(count[l]) + " " + names[l] + ", the base mesh has " +
+                std::to_string(expected[l]);
+      return false;
+    }
+    lists[l]->resize(count[l] * 3);
+  }
+  return true;
+}
@@ -0,0 +1,30 @@
+#include "PointCache.h"
+#include <cstring>
+
+namespace
+{
+constexpr char c_magic[4] = {'F', 'P', 'C', 'H'};
+constexpr uint32_t c_byteOrder = 0x01020304;
+} // end anon namespace
+
+static_assert(sizeof(PointCache::Header) == 48, "PointCache header layout changed, bump c_version");
+
+PointCache::Header PointCache::makeHeader(size_t _numVerts, size_t _numFrames, float _fps, uint64_t _sourceHash)
+{
+  Header header = {};
+  std::memcpy(header.magic, c_magic, sizeof(c_magic));
+  header.byteOrder = c_byteOrder;
+  header.version = c_version;
+  header.numVerts = static_cast<uint32_t>(_numVerts);
+  header.numFrames = _numFrames;
+  header.sourceHash = _sourceHash;
+  header.frameStride = (frameBytes(_numVerts) + c_pageSize - 1) / c_pageSize * c_pageSize;
+  header.fps = _fps;
+  return header;
+}
+
+bool PointCache::valid(const Header &_header)
+{
+  return std::memcmp(_header.magic, c_magic, sizeof(c_magic)) == 0 && _header.byteOrder == c_byteOrder &&
+         _header.version == c_version && _header.frameStride >= frameBytes(_header.numVerts);
+}
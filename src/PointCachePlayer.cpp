@@ -0,0 +1,222 @@
+#include "PointCachePlayer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+PointCachePlayer::~PointCachePlayer()
+{
+  close();
+}
+
+bool PointCachePlayer::open(const std::string &_fname, size_t _numVerts)
+{
+  close();
+  if (!m_file.open(_fname) || m_file.size() < sizeof(PointCache::Header))
+  {
+    m_error = "can't open " + _fname;
+    m_file.close();
+    return false;
+  }
+  std::memcpy(&m_header, m_file.data(), sizeof(m_header));
+  if (!PointCache::valid(m_header) || m_file.size() < PointCache::fileSize(m_header))
+    m_error = _fname + " isn't a point cache or is truncated";
+  else if (m_header.numVerts != _numVerts)
+    m_error = _fname + " has " + std::to_string(m_header.numVerts) + " vertices, the rig has " + std::to_string(_numVerts);
+  else if (m_header.numFrames == 0)
+    m_error = _fname + " has no frames";
+  if (!m_error.empty())
+  {
+    m_file.close();
+    m_header = {};
+    return false;
+  }
+  m_ready.reset(new std::atomic<bool>[numFrames()]);
+  for (size_t f = 0; f < numFrames(); ++f)
+    m_ready[f].store(false, std::memory_order_relaxed);
+  m_numResident = 0;
+  m_framesRead = 0;
+  m_framesDropped = 0;
+  m_late = 0;
+  m_playhead = 0;
+  m_direction = 1;
+  m_moves = 1;
+  m_stop = false;
+  m_thread = std::thread(&PointCachePlayer::prefetch, this);
+  return true;
+}
+
+void PointCachePlayer::close()
+{
+  if (m_thread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+  }
+  m_file.close();
+  m_ready.reset();
+  m_header = {};
+  m_error.clear();
+}
+
+void PointCachePlayer::setWindow(size_t _ahead, size_t _behind)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ahead = std::max<size_t>(_ahead, 1);
+    m_behind = _behind;
+    ++m_moves;
+  }
+  m_wake.notify_one();
+}
+
+void PointCachePlayer::setPlayhead(size_t _frame, int _direction)
+{
+  if (!isOpen())
+    return;
+  _frame %= numFrames();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // called every frame, only wake the thread when something has changed
+    if (_frame == m_playhead && _direction == m_direction)
+      return;
+    m_playhead = _frame;
+    m_direction = _direction;
+    ++m_moves;
+  }
+  m_wake.notify_one();
+}
+
+bool PointCachePlayer::isReady(size_t _frame) const
+{
+  return _frame < numFrames() && m_ready[_frame].load(std::memory_order_acquire);
+}
+
+const float *PointCachePlayer::frame(size_t _frame)
+{
+  if (!isReady(_frame))
+  {
+    if (_frame < numFrames())
+      m_late.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  return reinterpret_cast<const float *>(m_file.data() + PointCache::frameOffset(m_header, _frame));
+}
+
+size_t PointCachePlayer::frameAt(double _seconds) const
+{
+  if (!isOpen())
+    return 0;
+  auto n = static_cast<int64_t>(numFrames());
+  auto f = static_cast<int64_t>(std::floor(_seconds * m_header.fps)) % n;
+  return static_cast<size_t>(f < 0 ? f + n : f);
+}
+
+PointCachePlayer::Stats PointCachePlayer::stats() const
+{
+  Stats s;
+  s.framesRead = m_framesRead.load(std::memory_order_relaxed);
+  s.framesDropped = m_framesDropped.load(std::memory_order_relaxed);
+  s.late = m_late.load(std::memory_order_relaxed);
+  return s;
+}
+
+size_t PointCachePlayer::distance(size_t _frame, size_t _playhead, int _direction, bool _forward) const
+{
+  size_t n = numFrames();
+  bool up = _forward == (_direction >= 0);
+  return up ? (_frame + n - _playhead) % n : (_playhead + n - _frame) % n;
+}
+
+void PointCachePlayer::prefetch()
+{
+  // only this thread changes which frames are resident, so it keeps its own list of them
+  std::vector<size_t> resident;
+  std::vector<size_t> order;
+  uint64_t seen = 0;
+  size_t n = numFrames();
+  size_t frameBytes = PointCache::frameBytes(m_header.numVerts);
+  for (;;)
+  {
+    size_t playhead;
+    int direction;
+    size_t ahead;
+    size_t behind;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [&]() { return m_stop || m_moves != seen; });
+      if (m_stop)
+        return;
+      seen = m_moves;
+      playhead = m_playhead;
+      direction = m_direction;
+      ahead = m_ahead;
+      behind = m_behind;
+    }
+    // scrubbing could go either way so the window is split evenly
+    if (direction == 0)
+    {
+      ahead = (ahead + behind + 1) / 2;
+      behind = ahead;
+    }
+    auto wanted = [&](size_t _f) {
+      return distance(_f, playhead, direction, true) <= ahead || distance(_f, playhead, direction, false) <= behind;
+    };
+    // drop what has left the window first so memory stays bounded even while the disk can't keep up
+    auto left = std::partition(resident.begin(), resident.end(), wanted);
+    for (auto f = left; f != resident.end(); ++f)
+    {
+      m_ready[*f].store(false, std::memory_order_release);
+      m_file.advise(PointCache::frameOffset(m_header, *f), frameBytes, MappedFile::Advice::DontNeed);
+    }
+    m_framesDropped.fetch_add(static_cast<uint64_t>(resident.end() - left), std::memory_order_relaxed);
+    resident.erase(left, resident.end());
+    m_numResident.store(resident.size(), std::memory_order_relaxed);
+    // nearest first, the frames about to be shown before the ones already passed
+    auto along = [&](size_t _d, bool _forward) {
+      return (direction >= 0) == _forward ? (playhead + _d) % n : (playhead + n - _d) % n;
+    };
+    order.clear();
+    if (ahead + behind + 1 >= n)
+    {
+      for (size_t d = 0; d < n; ++d)
+        order.push_back(along(d, true));
+    }
+    else
+    {
+      for (size_t d = 0; d <= std::max(ahead, behind); ++d)
+      {
+        if (d <= ahead)
+          order.push_back(along(d, true));
+        if (d != 0 && d <= behind)
+          order.push_back(along(d, false));
+      }
+    }
+    for (auto f : order)
+    {
+      // a new playhead wins over finishing this window
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_moves != seen || m_stop)
+          break;
+      }
+      if (m_ready[f].load(std::memory_order_relaxed))
+        continue;
+      size_t offset = PointCache::frameOffset(m_header, f);
+      m_file.advise(offset, frameBytes, MappedFile::Advice::WillNeed);
+      // the hint is only a hint, reading a byte of every page makes sure they are all in
+      const volatile unsigned char *data = m_file.data() + offset;
+      unsigned char sum = 0;
+      for (size_t b = 0; b < frameBytes; b += PointCache::c_pageSize)
+        sum = static_cast<unsigned char>(sum + data[b]);
+      (void)sum;
+      m_ready[f].store(true, std::memory_order_release);
+      resident.push_back(f);
+      m_numResident.store(resident.size(), std::memory_order_relaxed);
+      m_framesRead.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+}
@@ -0,0 +1,149 @@
+#include "PoseCache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+// FNV-1a over the steps, the keys are compared as well so collisions only cost a miss
+constexpr uint64_t c_fnvOffset = 14695981039346656037ull;
+constexpr uint64_t c_fnvPrime = 1099511628211ull;
+} // end anon namespace
+
+void PoseCache::configure(size_t _numWeights, size_t _poseBytes, size_t _budgetBytes, float _step)
+{
+  m_numWeights = _numWeights;
+  m_poseBytes = _poseBytes;
+  m_budgetBytes = _budgetBytes;
+  m_step = std::max(_step, 0.0f);
+  m_numSlots = _poseBytes != 0 ? std::min<size_t>(_budgetBytes / _poseBytes, c_none - 1) : 0;
+  m_slotSteps.assign(m_numSlots * m_numWeights, 0);
+  m_slotHashes.assign(m_numSlots, 0);
+  m_prev.assign(m_numSlots, c_none);
+  m_next.assign(m_numSlots, c_none);
+  clear();
+}
+
+void PoseCache::clear()
+{
+  m_size = 0;
+  m_head = c_none;
+  m_tail = c_none;
+  m_slots.clear();
+}
+
+void PoseCache::makeKey(const float *_weights, Key &_key) const
+{
+  _key.steps.resize(m_numWeights);
+  uint64_t h = c_fnvOffset;
+  for (size_t i = 0; i < m_numWeights; ++i)
+  {
+    float w = _weights[i];
+    int32_t s = 0;
+    if (m_step > 0.0f)
+    {
+      double q = std::round(static_cast<double>(w) / m_step);
+      if (q == q)
+        s = static_cast<int32_t>(std::clamp(q, static_cast<double>(INT32_MIN), static_cast<double>(INT32_MAX)));
+    }
+    else if (w != 0.0f)
+    {
+      // the exact bits, -0 is left as 0 so it matches 0
+      std::memcpy(&s, &w, sizeof(s));
+    }
+    _key.steps[i] = s;
+    auto bytes = reinterpret_cast<const unsigned char *>(&s);
+    for (size_t b = 0; b < sizeof(s); ++b)
+    {
+      h ^= bytes[b];
+      h *= c_fnvPrime;
+    }
+  }
+  _key.hash = h;
+}
+
+int64_t PoseCache::find(const Key &_key)
+{
+  if (!enabled())
+    return -1;
+  auto it = m_slots.find(_key.hash);
+  if (it == m_slots.end() ||
+      !std::equal(_key.steps.begin(), _key.steps.end(), m_slotSteps.begin() + it->second * m_numWeights))
+  {
+    ++m_stats.misses;
+    return -1;
+  }
+  ++m_stats.hits;
+  uint32_t slot = it->second;
+  if (slot != m_head)
+  {
+    unlink(slot);
+    pushFront(slot);
+  }
+  return slot;
+}
+
+size_t PoseCache::insert(const Key &_key)
+{
+  uint32_t slot;
+  auto it = m_slots.find(_key.hash);
+  if (it != m_slots.end())
+  {
+    // the same pose missed twice before it was written, or another pose with the same hash which loses its slot
+    slot = it->second;
+    if (!std::equal(_key.steps.begin(), _key.steps.end(), m_slotSteps.begin() + slot * m_numWeights))
+    {
+      ++m_stats.evictions;
+      m_stats.evictedBytes += m_poseBytes;
+    }
+    unlink(slot);
+  }
+  else if (m_size < m_numSlots)
+  {
+    slot = static_cast<uint32_t>(m_size++);
+  }
+  else
+  {
+    slot = m_tail;
+    unlink(slot);
+    m_slots.erase(m_slotHashes[slot]);
+    ++m_stats.evictions;
+    m_stats.evictedBytes += m_poseBytes;
+  }
+  std::copy(_key.steps.begin(), _key.steps.end(), m_slotSteps.begin() + slot * m_numWeights);
+  m_slotHashes[slot] = _key.hash;
+  m_slots[_key.hash] = slot;
+  pushFront(slot);
+  return slot;
+}
+
+double PoseCache::hitRate() const
+{
+  uint64_t lookups = m_stats.hits + m_stats.misses;
+  return lookups != 0 ? static_cast<double>(m_stats.hits) / lookups : 0.0;
+}
+
+void PoseCache::unlink(uint32_t _slot)
+{
+  if (m_prev[_slot] != c_none)
+    m_next[m_prev[_slot]] = m_next[_slot];
+  else
+    m_head = m_next[_slot];
+  if (m_next[_slot] != c_none)
+    m_prev[m_next[_slot]] = m_prev[_slot];
+  else
+    m_tail = m_prev[_slot];
+  m_prev[_slot] = c_none;
+  m_next[_slot] = c_none;
+}
+
+void PoseCache::pushFront(uint32_t _slot)
+{
+  m_prev[_slot] = c_none;
+  m_next[_slot] = m_head;
+  if (m_head != c_none)
+    m_prev[m_head] = _slot;
+  m_head = _slot;
+  if (m_tail == c_none)
+    m_tail = _slot;
+}
@@ -0,0 +1,349 @@
+#include "RigCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+constexpr char c_magic[4] = {'F', 'R', 'I', 'G'};
+constexpr uint32_t c_byteOrder = 0x01020304;
+constexpr uint64_t c_alignment = 16;
+
+struct Header
+{
+  char magic[4];
+  uint32_t byteOrder;
+  uint32_t version;
+  uint32_t numSections;
+  uint64_t sourceHash;
+  uint32_t numVerts;
+  uint32_t numIndices;
+  uint32_t numTargets;
+  uint32_t numEntries;
+  uint32_t numSourcePositions;
+  uint32_t numSourceNormals;
+  float deltaEpsilon;
+  float basisTolerance;
+  uint32_t basisMaxShapes;
+  uint32_t numBasisShapes;
+  uint32_t numBasisEntries;
+  float basisError;
+};
+static_assert(sizeof(Header) == 72, "RigCache header layout changed, bump c_version");
+
+struct SectionEntry
+{
+  uint64_t offset;
+  uint64_t size;
+};
+
+uint64_t alignUp(uint64_t _v)
+{
+  return (_v + c_alignment - 1) & ~(c_alignment - 1);
+}
+
+/// @brief gathers the sections in memory before they are written so the table can be filled in
+class SectionWriter
+{
+  public:
+    explicit SectionWriter(size_t _numSections) : m_table(_numSections) {}
+    template <typename T>
+    void add(size_t _section, const T *_data, size_t _count)
+    {
+      m_table[_section].size = _count * sizeof(T);
+      m_sections.emplace_back(reinterpret_cast<const char *>(_data), reinterpret_cast<const char *>(_data) + _count * sizeof(T));
+      m_order.push_back(_section);
+    }
+    bool write(std::ofstream &_out, const Header &_header)
+    {
+      uint64_t offset = alignUp(sizeof(Header) + m_table.size() * sizeof(SectionEntry));
+      for (size_t i = 0; i < m_order.size(); ++i)
+      {
+        m_table[m_order[i]].offset = offset;
+        offset = alignUp(offset + m_sections[i].size());
+      }
+      _out.write(reinterpret_cast<const char *>(&_header), sizeof(Header));
+      _out.write(reinterpret_cast<const char *>(m_table.data()), m_table.size() * sizeof(SectionEntry));
+      const char zeros[c_alignment] = {};
+      uint64_t pos = sizeof(Header) + m_table.size() * sizeof(SectionEntry);
+      for (size_t i = 0; i < m_order.size(); ++i)
+      {
+        _out.write(zeros, static_cast<std::streamsize>(m_table[m_order[i]].offset - pos));
+        _out.write(m_sections[i].data(), static_cast<std::streamsize>(m_sections[i].size()));
+        pos = m_table[m_order[i]].offset + m_sections[i].size();
+      }
+      return _out.good();
+    }
+
+  private:
+    std::vector<SectionEntry> m_table;
+    std::vector<std::vector<char>> m_sections;
+    std::vector<size_t> m_order;
+};
+
+template <typename T>
+std::vector<T> copySection(const unsigned char *_data, size_t _count)
+{
+  std::vector<T> out(_count);
+  if (_count != 0)
+    std::memcpy(out.data(), _data, _count * sizeof(T));
+  return out;
+}
+} // end anon namespace
+
+bool RigCache::write(const std::string &_fname, const BlendRig &_rig, uint64_t _sourceHash, const DeltaBasis *_basis,
+                     float _basisTolerance, size_t _basisMaxShapes)
+{
+  auto &targets = _rig.targets();
+  std::vector<int32_t> offsets;
+  std::vector<float> entries;
+  targets.buildVertexMajor(offsets, entries);
+
+  // target major data, all of the indices for every target then the six delta streams
+  size_t numEntries = targets.numEntries();
+  std::vector<uint32_t> targetSizes;
+  std::vector<uint32_t> targetIndices;
+  std::vector<float> targetDeltas(numEntries * 6);
+  targetIndices.reserve(numEntries);
+  size_t start = 0;
+  for (size_t t = 0; t < targets.numTargets(); ++t)
+  {
+    auto &target = targets.target(t);
+    targetSizes.push_back(static_cast<uint32_t>(target.size()));
+    targetIndices.insert(targetIndices.end(), target.indices.begin(), target.indices.end());
+    const std::vector<float> *streams[6] = {&target.positions.x, &target.positions.y, &target.positions.z,
+                                            &target.normals.x,   &target.normals.y,   &target.normals.z};
+    for (size_t s = 0; s < 6; ++s)
+      std::copy(streams[s]->begin(), streams[s]->end(), targetDeltas.begin() + s * numEntries + start);
+    start += target.size();
+  }
+
+  // the shapes are stored as the GPU blends them, the mixing is all the CPU needs
+  std::vector<float> basisMixing;
+  std::vector<int32_t> basisOffsets;
+  std::vector<float> basisEntries;
+  size_t numBasisShapes = _basis != nullptr ? _basis->numShapes() : 0;
+  if (numBasisShapes != 0)
+  {
+    basisMixing = _basis->mixing();
+    _basis->shapes().buildVertexMajor(basisOffsets, basisEntries);
+  }
+
+  std::vector<char> names;
+  for (auto &n : _rig.targetNames())
+    names.insert(names.end(), n.c_str(), n.c_str() + n.size() + 1);
+
+  Header header = {};
+  std::memcpy(header.magic, c_magic, sizeof(c_magic));
+  header.byteOrder = c_byteOrder;
+  header.version = c_version;
+  header.numSections = NumSections;
+  header.sourceHash = _sourceHash;
+  header.numVerts = static_cast<uint32_t>(_rig.numVerts());
+  header.numIndices = static_cast<uint32_t>(_rig.numIndices());
+  header.numTargets = static_cast<uint32_t>(targets.numTargets());
+  header.numEntries = static_cast<uint32_t>(numEntries);
+  header.numSourcePositions = static_cast<uint32_t>(_rig.numSourcePositions());
+  header.numSourceNormals = static_cast<uint32_t>(_rig.numSourceNormals());
+  header.deltaEpsilon = targets.epsilon();
+  header.basisTolerance = _basis != nullptr ? _basisTolerance : 0.0f;
+  header.basisMaxShapes = static_cast<uint32_t>(_basis != nullptr ? _basisMaxShapes : 0);
+  header.numBasisShapes = static_cast<uint32_t>(numBasisShapes);
+  header.numBasisEntries = static_cast<uint32_t>(basisEntries.size() / 8);
+  header.basisError = numBasisShapes != 0 ? _basis->report().positionError : 0.0f;
+
+  SectionWriter writer(NumSections);
+  writer.add(VertexData, _rig.vertexData().data(), _rig.vertexData().size());
+  writer.add(Indices, _rig.indices().data(), _rig.indices().size());
+  writer.add(PositionIndex, _rig.positionIndex().data(), _rig.positionIndex().size());
+  writer.add(NormalIndex, _rig.normalIndex().data(), _rig.normalIndex().size());
+  writer.add(DeltaOffsets, offsets.data(), offsets.size());
+  writer.add(DeltaEntries, entries.data(), entries.size());
+  writer.add(TargetSizes, targetSizes.data(), targetSizes.size());
+  writer.add(TargetIndices, targetIndices.data(), targetIndices.size());
+  writer.add(TargetDeltas, targetDeltas.data(), targetDeltas.size());
+  writer.add(TargetNames, names.data(), names.size());
+  writer.add(BasisMixing, basisMixing.data(), basisMixing.size());
+  writer.add(BasisOffsets, basisOffsets.data(), basisOffsets.size());
+  writer.add(BasisEntries, basisEntries.data(), basisEntries.size());
+
+  // write to a temp file and rename so a crash never leaves a half written cache behind
+  std::string tmpName = _fname + ".tmp";
+  {
+    std::ofstream out(tmpName, std::ios::binary | std::ios::trunc);
+    if (!out.is_open() || !writer.write(out, header))
+      return false;
+  }
+  std::remove(_fname.c_str());
+  return std::rename(tmpName.c_str(), _fname.c_str()) == 0;
+}
+
+bool RigCache::open(const std::string &_fname)
+{
+  close();
+  if (!m_file.open(_fname) || m_file.size() < sizeof(Header))
+  {
+    close();
+    return false;
+  }
+  Header header;
+  std::memcpy(&header, m_file.data(), sizeof(Header));
+  if (std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0 || header.byteOrder != c_byteOrder ||
+      header.version != c_version || header.numSections != NumSections ||
+      m_file.size() < sizeof(Header) + NumSections * sizeof(SectionEntry))
+  {
+    close();
+    return false;
+  }
+  SectionEntry table[NumSections];
+  std::memcpy(table, m_file.data() + sizeof(Header), sizeof(table));
+
+  // the size every section should be, anything else means the file is damaged
+  uint64_t expected[NumSections] = {};
+  expected[VertexData] = uint64_t(header.numVerts) * 6 * sizeof(float);
+  expected[Indices] = uint64_t(header.numIndices) * sizeof(uint32_t);
+  expected[PositionIndex] = uint64_t(header.numVerts) * sizeof(uint32_t);
+  expected[NormalIndex] = uint64_t(header.numVerts) * sizeof(uint32_t);
+  expected[DeltaOffsets] = (uint64_t(header.numVerts) + 1) * sizeof(int32_t);
+  expected[DeltaEntries] = uint64_t(header.numEntries) * 8 * sizeof(float);
+  expected[TargetSizes] = uint64_t(header.numTargets) * sizeof(uint32_t);
+  expected[TargetIndices] = uint64_t(header.numEntries) * sizeof(uint32_t);
+  expected[TargetDeltas] = uint64_t(header.numEntries) * 6 * sizeof(float);
+  expected[BasisMixing] = uint64_t(header.numTargets) * header.numBasisShapes * sizeof(float);
+  expected[BasisOffsets] = header.numBasisShapes != 0 ? (uint64_t(header.numVerts) + 1) * sizeof(int32_t) : 0;
+  expected[BasisEntries] = uint64_t(header.numBasisEntries) * 8 * sizeof(float);
+  for (uint32_t s = 0; s < NumSections; ++s)
+  {
+    bool sizeOk = (s == TargetNames) || table[s].size == expected[s];
+    if (!sizeOk || table[s].offset % c_alignment != 0 || table[s].offset > m_file.size() ||
+        table[s].size > m_file.size() - table[s].offset)
+    {
+      close();
+      return false;
+    }
+    m_sectionOffsets[s] = table[s].offset;
+  }
+
+  // the per target sizes must add up to the number of entries or toRig would read past the end
+  auto sizes = reinterpret_cast<const uint32_t *>(section(TargetSizes));
+  uint64_t total = 0;
+  for (uint32_t t = 0; t < header.numTargets; ++t)
+    total += sizes[t];
+  if (total != header.numEntries)
+  {
+    close();
+    return false;
+  }
+
+  m_sourceHash = header.sourceHash;
+  m_deltaEpsilon = header.deltaEpsilon;
+  m_numVerts = header.numVerts;
+  m_numIndices = header.numIndices;
+  m_numEntries = header.numEntries;
+  m_numSourcePositions = header.numSourcePositions;
+  m_numSourceNormals = header.numSourceNormals;
+  m_basisTolerance = header.basisTolerance;
+  m_basisMaxShapes = header.basisMaxShapes;
+  m_numBasisShapes = header.numBasisShapes;
+  m_numBasisEntries = header.numBasisEntries;
+  m_basisError = header.basisError;
+
+  auto names = reinterpret_cast<const char *>(section(TargetNames));
+  size_t namesSize = table[TargetNames].size;
+  size_t pos = 0;
+  while (pos < namesSize && m_targetNames.size() < header.numTargets)
+  {
+    size_t len = strnlen(names + pos, namesSize - pos);
+    m_targetNames.emplace_back(names + pos, len);
+    pos += len + 1;
+  }
+  if (m_targetNames.size() != header.numTargets)
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void RigCache::close()
+{
+  m_file.close();
+  m_targetNames.clear();
+  m_numVerts = m_numIndices = m_numEntries = 0;
+  m_basisTolerance = m_basisError = 0.0f;
+  m_basisMaxShapes = m_numBasisShapes = m_numBasisEntries = 0;
+}
+
+const float *RigCache::vertexData() const
+{
+  return reinterpret_cast<const float *>(section(VertexData));
+}
+
+const uint32_t *RigCache::indices() const
+{
+  return reinterpret_cast<const uint32_t *>(section(Indices));
+}
+
+const uint32_t *RigCache::positionIndex() const
+{
+  return reinterpret_cast<const uint32_t *>(section(PositionIndex));
+}
+
+const int32_t *RigCache::deltaOffsets() const
+{
+  return reinterpret_cast<const int32_t *>(section(DeltaOffsets));
+}
+
+const float *RigCache::deltaEntries() const
+{
+  return reinterpret_cast<const float *>(section(DeltaEntries));
+}
+
+const float *RigCache::basisMixing() const
+{
+  return reinterpret_cast<const float *>(section(BasisMixing));
+}
+
+const int32_t *RigCache::basisOffsets() const
+{
+  return reinterpret_cast<const int32_t *>(section(BasisOffsets));
+}
+
+const float *RigCache::basisEntries() const
+{
+  return reinterpret_cast<const float *>(section(BasisEntries));
+}
+
+void RigCache::toRig(BlendRig &_rig) const
+{
+  auto sizes = reinterpret_cast<const uint32_t *>(section(TargetSizes));
+  auto indices = reinterpret_cast<const uint32_t *>(section(TargetIndices));
+  auto deltas = reinterpret_cast<const float *>(section(TargetDeltas));
+
+  BlendTargetSet targets(m_deltaEpsilon);
+  targets.reset(m_numVerts);
+  size_t start = 0;
+  for (size_t t = 0; t < numTargets(); ++t)
+  {
+    BlendTargetSet::Target target;
+    size_t n = sizes[t];
+    target.indices.assign(indices + start, indices + start + n);
+    std::vector<float> *streams[6] = {&target.positions.x, &target.positions.y, &target.positions.z,
+                                      &target.normals.x,   &target.normals.y,   &target.normals.z};
+    for (size_t s = 0; s < 6; ++s)
+    {
+      const float *src = deltas + s * m_numEntries + start;
+      streams[s]->assign(src, src + n);
+    }
+    targets.addTarget(std::move(target));
+    start += n;
+  }
+
+  auto names = m_targetNames;
+  _rig.assign(copySection<float>(section(VertexData), m_numVerts * 6),
+              copySection<uint32_t>(section(Indices), m_numIndices),
+              copySection<uint32_t>(section(PositionIndex), m_numVerts),
+              copySection<uint32_t>(section(NormalIndex), m_numVerts), m_numSourcePositions, m_numSourceNormals,
+              std::move(names), std::move(targets));
+}
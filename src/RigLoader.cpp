@@ -0,0 +1,143 @@
+#include "RigLoader.h"
+#include "ObjTargetReader.h"
+#include "ThreadPool.h"
+#include <ngl/Obj.h>
+#include <chrono>
+#include <future>
+#include <iostream>
+
+namespace
+{
+/// @brief the base mesh, the only obj whose faces are needed
+struct ParsedMesh
+{
+  std::vector<ngl::Vec3> verts;
+  std::vector<ngl::Vec3> normals;
+  std::vector<BlendRig::Corner> corners;
+  double ms = 0.0;
+};
+
+ParsedMesh parseBase(const std::string &_path)
+{
+  auto start = std::chrono::steady_clock::now();
+  ParsedMesh result;
+  ngl::Obj mesh(_path);
+  result.verts = mesh.getVertexList();
+  result.normals = mesh.getNormalList();
+  std::vector<ngl::Face> faces = mesh.getFaceList();
+  result.corners.reserve(faces.size() * 3);
+  for (auto &f : faces)
+  {
+    // now for each triangle in the face (remember we ensured tri above)
+    for (size_t j = 0; j < 3; ++j)
+    {
+      result.corners.push_back({static_cast<uint32_t>(f.m_vert[j]), static_cast<uint32_t>(f.m_norm[j])});
+    }
+  }
+  result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+/// @brief a target's positions and normals, the faces are the base mesh's so they aren't read
+struct ParsedTarget
+{
+  ObjTargetReader reader;
+  bool ok = false;
+  double ms = 0.0;
+};
+
+ParsedTarget readTarget(const std::string &_path, size_t _numPositions, size_t _numNormals)
+{
+  auto start = std::chrono::steady_clock::now();
+  ParsedTarget result;
+  result.ok = result.reader.read(_path, _numPositions, _numNormals);
+  result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+} // end anon namespace
+
+bool RigLoader::load(const ModelFile &_models, BlendRig &_rig)
+{
+  static_assert(sizeof(ngl::Vec3) == 3 * sizeof(float), "BlendRig expects packed xyz floats");
+  auto start = std::chrono::steady_clock::now();
+  m_timings.clear();
+
+  {
+    ThreadPool pool(m_numThreads);
+    // the base goes first, its list sizes are what every target is read into and checked against
+    ParsedMesh baseMesh = parseBase(_models.baseMesh());
+    m_timings.push_back({_models.baseMesh(), baseMesh.ms});
+    if (baseMesh.verts.empty() || baseMesh.normals.empty())
+    {
+      m_error = "base mesh " + _models.baseMesh() + " has no vertices or normals";
+      return false;
+    }
+    size_t numPositions = baseMesh.verts.size();
+    size_t numNormals = baseMesh.normals.size();
+    // queue every target, the futures are kept in models.txt order
+    std::vector<std::future<ParsedTarget>> targets;
+    for (auto &entry : _models.blendShapes())
+    {
+      std::string path = entry.path;
+      targets.push_back(
+          pool.submit([path, numPositions, numNormals]() { return readTarget(path, numPositions, numNormals); }));
+    }
+
+    // targets that are still parsing carry on while we build the base
+    _rig = BlendRig(_models.deltaEpsilon());
+    if (!_rig.buildBase(&baseMesh.verts[0].m_x, numPositions, &baseMesh.normals[0].m_x, numNormals,
+                        baseMesh.corners))
+    {
+      m_error = "base mesh has faces that reference missing vertices";
+      return false;
+    }
+    for (size_t i = 0; i < targets.size(); ++i)
+    {
+      auto &entry = _models.blendShapes()[i];
+      ParsedTarget target = targets[i].get();
+      m_timings.push_back({entry.path, target.ms});
+      if (!target.ok)
+      {
+        m_error = "Blend shape " + entry.name + ": " + target.reader.errorString();
+        return false;
+      }
+      // the reader has already checked the list sizes against the base
+      auto &positions = target.reader.positions();
+      auto &normals = target.reader.normals();
+      _rig.addTarget(entry.name, positions.data(), positions.size() / 3, normals.data(), normals.size() / 3);
+    }
+  }
+  m_totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  std::cout << _rig.numIndices() << " corners " << _rig.numVerts() << " unique vertices\n";
+  return true;
+}
+
+bool RigLoader::parseTarget(const std::string &_path, std::vector<float> &_positions, std::vector<float> &_normals)
+{
+  ObjTargetReader reader;
+  if (!reader.read(_path) || reader.numPositions() == 0 || reader.numNormals() == 0)
+    return false;
+  _positions = reader.positions();
+  _normals = reader.normals();
+  return true;
+}
+
+bool RigLoader::loadRig(const ModelFile &_models, BlendRig &_rig, std::string &_error)
+{
+  RigLoader loader;
+  if (loader.load(_models, _rig))
+    return true;
+  _error = loader.errorString();
+  return false;
+}
+
+void RigLoader::printTimings() const
+{
+  double sum = 0.0;
+  for (auto &t : m_timings)
+  {
+    std::cout << "  " << t.path << " " << t.ms << " ms\n";
+    sum += t.ms;
+  }
+  std::cout << "parsed " << m_timings.size() << " files in " << m_totalMs << " ms (" << sum << " ms of parsing)\n";
+}
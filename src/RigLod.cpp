@@ -0,0 +1,487 @@
+#include "RigLod.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+namespace
+{
+/// @brief sum of squared distances to a set of planes, the symmetric 4x4 as its upper triangle
+struct Quadric
+{
+  double m[10] = {0.0};
+  void addPlane(double _a, double _b, double _c, double _d)
+  {
+    m[0] += _a * _a;
+    m[1] += _a * _b;
+    m[2] += _a * _c;
+    m[3] += _a * _d;
+    m[4] += _b * _b;
+    m[5] += _b * _c;
+    m[6] += _b * _d;
+    m[7] += _c * _c;
+    m[8] += _c * _d;
+    m[9] += _d * _d;
+  }
+  void add(const Quadric &_q)
+  {
+    for (int i = 0; i < 10; ++i)
+      m[i] += _q.m[i];
+  }
+  double evaluate(const float *_p) const
+  {
+    double x = _p[0];
+    double y = _p[1];
+    double z = _p[2];
+    return x * x * m[0] + 2.0 * x * y * m[1] + 2.0 * x * z * m[2] + 2.0 * x * m[3] + y * y * m[4] +
+           2.0 * y * z * m[5] + 2.0 * y * m[6] + z * z * m[7] + 2.0 * z * m[8] + m[9];
+  }
+};
+
+enum class VertexKind : uint8_t
+{
+  Interior,
+  /// @brief on an open edge of the mesh, only moves along it
+  Border,
+  /// @brief on a seam or a non manifold edge, never moves
+  Locked
+};
+
+struct Collapse
+{
+  float cost;
+  uint32_t from;
+  uint32_t to;
+  bool operator<(const Collapse &_c) const { return cost > _c.cost; }
+};
+
+void cross(const float *_a, const float *_b, const float *_c, float *_n)
+{
+  float e1[3] = {_b[0] - _a[0], _b[1] - _a[1], _b[2] - _a[2]};
+  float e2[3] = {_c[0] - _a[0], _c[1] - _a[1], _c[2] - _a[2]};
+  _n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+  _n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+  _n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+/// @brief the working mesh while it is collapsed
+class Decimator
+{
+  public:
+    Decimator(const uint32_t *_indices, size_t _numIndices, const uint32_t *_positionIndex, const float *_positions,
+              size_t _numVerts, const int32_t *_offsets, const float *_entries)
+        : m_positions(_positions), m_offsets(_offsets), m_entries(_entries), m_tris(_indices, _indices + _numIndices),
+          m_alive(_numIndices / 3, true), m_vertTris(_numVerts), m_quadrics(_numVerts), m_bound(_numVerts, 0.0f),
+          m_kind(_numVerts, VertexKind::Interior)
+    {
+      m_numAlive = m_alive.size();
+      for (size_t t = 0; t < m_alive.size(); ++t)
+        for (int c = 0; c < 3; ++c)
+          m_vertTris[m_tris[3 * t + c]].push_back(static_cast<uint32_t>(t));
+      classify(_positionIndex);
+      for (size_t t = 0; t < m_alive.size(); ++t)
+      {
+        const uint32_t *tri = &m_tris[3 * t];
+        float n[3];
+        cross(position(tri[0]), position(tri[1]), position(tri[2]), n);
+        double len = std::sqrt(double(n[0]) * n[0] + double(n[1]) * n[1] + double(n[2]) * n[2]);
+        if (len == 0.0)
+          continue;
+        double a = n[0] / len;
+        double b = n[1] / len;
+        double c = n[2] / len;
+        const float *p = position(tri[0]);
+        double d = -(a * p[0] + b * p[1] + c * p[2]);
+        for (int k = 0; k < 3; ++k)
+          m_quadrics[tri[k]].addPlane(a, b, c, d);
+        // a plane standing on each open edge keeps the outline where it is
+        for (int k = 0; k < 3; ++k)
+        {
+          uint32_t e0 = tri[k];
+          uint32_t e1 = tri[(k + 1) % 3];
+          if (sharedTris(e0, e1) != 1)
+            continue;
+          const float *p0 = position(e0);
+          const float *p1 = position(e1);
+          double ex = p1[0] - p0[0];
+          double ey = p1[1] - p0[1];
+          double ez = p1[2] - p0[2];
+          double px = ey * c - ez * b;
+          double py = ez * a - ex * c;
+          double pz = ex * b - ey * a;
+          double plen = std::sqrt(px * px + py * py + pz * pz);
+          if (plen == 0.0)
+            continue;
+          px /= plen;
+          py /= plen;
+          pz /= plen;
+          double pd = -(px * p0[0] + py * p0[1] + pz * p0[2]);
+          m_quadrics[e0].addPlane(px, py, pz, pd);
+          m_quadrics[e1].addPlane(px, py, pz, pd);
+        }
+      }
+      for (size_t v = 0; v < _numVerts; ++v)
+        for (uint32_t n : neighbours(static_cast<uint32_t>(v)))
+          push(static_cast<uint32_t>(v), n);
+    }
+
+    size_t numAlive() const { return m_numAlive; }
+    float error() const { return m_error; }
+
+    /// @brief collapse until at most _triangles are left
+    /// @returns false if nothing more can be collapsed
+    bool collapseTo(size_t _triangles)
+    {
+      while (m_numAlive > _triangles)
+      {
+        if (m_queue.empty())
+          return false;
+        Collapse c = m_queue.top();
+        m_queue.pop();
+        if (m_vertTris[c.from].empty() || m_vertTris[c.to].empty())
+          continue;
+        // costs only ever go up, one that has is put back to wait its turn
+        float cost = collapseCost(c.from, c.to);
+        if (cost > c.cost)
+        {
+          m_queue.push({cost, c.from, c.to});
+          continue;
+        }
+        if (!canCollapse(c.from, c.to))
+          continue;
+        collapse(c.from, c.to, cost);
+      }
+      return true;
+    }
+
+    void levelIndices(std::vector<uint32_t> &_indices) const
+    {
+      _indices.clear();
+      _indices.reserve(m_numAlive * 3);
+      for (size_t t = 0; t < m_alive.size(); ++t)
+        if (m_alive[t])
+          _indices.insert(_indices.end(), &m_tris[3 * t], &m_tris[3 * t] + 3);
+    }
+
+  private:
+    const float *m_positions;
+    const int32_t *m_offsets;
+    const float *m_entries;
+    std::vector<uint32_t> m_tris;
+    std::vector<bool> m_alive;
+    size_t m_numAlive = 0;
+    std::vector<std::vector<uint32_t>> m_vertTris;
+    std::vector<Quadric> m_quadrics;
+    /// @brief how far the deltas of the vertices already collapsed into each one can be from its own
+    std::vector<float> m_bound;
+    std::vector<VertexKind> m_kind;
+    std::priority_queue<Collapse> m_queue;
+    float m_error = 0.0f;
+
+    const float *position(uint32_t _v) const { return m_positions + 3 * _v; }
+
+    void classify(const uint32_t *_positionIndex)
+    {
+      // vertices that share an obj position are split by a seam
+      std::unordered_map<uint32_t, uint32_t> users;
+      for (size_t v = 0; v < m_vertTris.size(); ++v)
+        ++users[_positionIndex[v]];
+      std::unordered_map<uint64_t, uint32_t> edges;
+      for (size_t t = 0; t < m_alive.size(); ++t)
+        for (int k = 0; k < 3; ++k)
+        {
+          uint64_t a = m_tris[3 * t + k];
+          uint64_t b = m_tris[3 * t + (k + 1) % 3];
+          ++edges[std::min(a, b) << 32 | std::max(a, b)];
+        }
+      for (auto &e : edges)
+      {
+        uint32_t a = static_cast<uint32_t>(e.first >> 32);
+        uint32_t b = static_cast<uint32_t>(e.first & 0xffffffffu);
+        VertexKind kind = e.second == 1 ? VertexKind::Border : e.second > 2 ? VertexKind::Locked : VertexKind::Interior;
+        m_kind[a] = std::max(m_kind[a], kind);
+        m_kind[b] = std::max(m_kind[b], kind);
+      }
+      for (size_t v = 0; v < m_vertTris.size(); ++v)
+        if (users[_positionIndex[v]] > 1)
+          m_kind[v] = VertexKind::Locked;
+    }
+
+    std::vector<uint32_t> neighbours(uint32_t _v) const
+    {
+      std::vector<uint32_t> out;
+      for (uint32_t t : m_vertTris[_v])
+        for (int k = 0; k < 3; ++k)
+          if (m_tris[3 * t + k] != _v)
+            out.push_back(m_tris[3 * t + k]);
+      std::sort(out.begin(), out.end());
+      out.erase(std::unique(out.begin(), out.end()), out.end());
+      return out;
+    }
+
+    bool hasVertex(uint32_t _t, uint32_t _v) const
+    {
+      return m_tris[3 * _t] == _v || m_tris[3 * _t + 1] == _v || m_tris[3 * _t + 2] == _v;
+    }
+
+    size_t sharedTris(uint32_t _a, uint32_t _b) const
+    {
+      size_t count = 0;
+      for (uint32_t t : m_vertTris[_a])
+        count += hasVertex(t, _b) ? 1 : 0;
+      return count;
+    }
+
+    /// @brief the largest difference between the position deltas of two vertices over all the targets
+    float deltaDistance(uint32_t _a, uint32_t _b) const
+    {
+      if (m_offsets == nullptr)
+        return 0.0f;
+      float worst = 0.0f;
+      auto rowDistance = [&](uint32_t _v, uint32_t _other, bool _both)
+      {
+        for (int32_t i = m_offsets[_v]; i < m_offsets[_v + 1]; ++i)
+        {
+          const float *e = m_entries + 8 * i;
+          float d[3] = {e[0], e[1], e[2]};
+          bool found = false;
+          for (int32_t j = m_offsets[_other]; j < m_offsets[_other + 1]; ++j)
+          {
+            const float *o = m_entries + 8 * j;
+            if (o[3] == e[3])
+            {
+              d[0] -= o[0];
+              d[1] -= o[1];
+              d[2] -= o[2];
+              found = true;
+              break;
+            }
+          }
+          // the entries found in both rows are only measured once
+          if (found && !_both)
+            continue;
+          worst = std::max(worst, std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+        }
+      };
+      rowDistance(_a, _b, true);
+      rowDistance(_b, _a, false);
+      return worst;
+    }
+
+    float collapseCost(uint32_t _from, uint32_t _to) const
+    {
+      Quadric q = m_quadrics[_from];
+      q.add(m_quadrics[_to]);
+      float geometric = static_cast<float>(std::sqrt(std::max(0.0, q.evaluate(position(_to)))));
+      float motion = std::max(m_bound[_from] + deltaDistance(_from, _to), m_bound[_to]);
+      return geometric + motion;
+    }
+
+    void push(uint32_t _from, uint32_t _to)
+    {
+      if (m_kind[_from] == VertexKind::Locked)
+        return;
+      if (m_kind[_from] == VertexKind::Border && m_kind[_to] == VertexKind::Interior)
+        return;
+      m_queue.push({collapseCost(_from, _to), _from, _to});
+    }
+
+    bool canCollapse(uint32_t _from, uint32_t _to) const
+    {
+      size_t shared = sharedTris(_from, _to);
+      // a border vertex slides along its own edge, an interior one along an edge with a triangle each side
+      if (shared != (m_kind[_from] == VertexKind::Border ? 1u : 2u))
+        return false;
+      // the two can only have the vertices opposite their shared edge in common or the mesh pinches
+      std::vector<uint32_t> a = neighbours(_from);
+      std::vector<uint32_t> b = neighbours(_to);
+      std::vector<uint32_t> common;
+      std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(common));
+      if (common.size() != shared)
+        return false;
+      // and no triangle that is left may turn over
+      for (uint32_t t : m_vertTris[_from])
+      {
+        if (hasVertex(t, _to))
+          continue;
+        const float *p[3];
+        const float *moved[3];
+        for (int k = 0; k < 3; ++k)
+        {
+          p[k] = position(m_tris[3 * t + k]);
+          moved[k] = m_tris[3 * t + k] == _from ? position(_to) : p[k];
+        }
+        float before[3];
+        float after[3];
+        cross(p[0], p[1], p[2], before);
+        cross(moved[0], moved[1], moved[2], after);
+        float dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+        float lenBefore = std::sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]);
+        float lenAfter = std::sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+        if (lenAfter <= 1e-12f || dot < 0.2f * lenBefore * lenAfter)
+          return false;
+      }
+      return true;
+    }
+
+    void collapse(uint32_t _from, uint32_t _to, float _cost)
+    {
+      for (uint32_t t : m_vertTris[_from])
+      {
+        if (hasVertex(t, _to))
+        {
+          m_alive[t] = false;
+          --m_numAlive;
+          for (int k = 0; k < 3; ++k)
+          {
+            uint32_t v = m_tris[3 * t + k];
+            if (v == _from)
+              continue;
+            auto &list = m_vertTris[v];
+            list.erase(std::find(list.begin(), list.end(), t));
+          }
+          continue;
+        }
+        for (int k = 0; k < 3; ++k)
+          if (m_tris[3 * t + k] == _from)
+            m_tris[3 * t + k] = _to;
+        m_vertTris[_to].push_back(t);
+      }
+      m_vertTris[_from].clear();
+      m_vertTris[_from].shrink_to_fit();
+      m_quadrics[_to].add(m_quadrics[_from]);
+      m_bound[_to] = std::max(m_bound[_to], m_bound[_from] + deltaDistance(_from, _to));
+      m_error = std::max(m_error, _cost);
+      // the edges around _to have new costs and _from's old neighbours are now its neighbours
+      for (uint32_t n : neighbours(_to))
+      {
+        push(n, _to);
+        push(_to, n);
+      }
+    }
+};
+} // end anonymous namespace
+
+void RigLod::build(const uint32_t *_indices, size_t _numIndices, const uint32_t *_positionIndex,
+                   const float *_positions, size_t _numVerts, const int32_t *_offsets, const float *_entries,
+                   const std::vector<float> &_ratios)
+{
+  m_levels.clear();
+  Level full;
+  full.indices.assign(_indices, _indices + _numIndices);
+  std::vector<bool> used(_numVerts, false);
+  for (size_t i = 0; i < _numIndices; ++i)
+    used[_indices[i]] = true;
+  full.numVerts = static_cast<size_t>(std::count(used.begin(), used.end(), true));
+  m_levels.push_back(std::move(full));
+
+  // the bounding sphere picks the level so it is worked out on the vertices drawn
+  float lo[3] = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                 std::numeric_limits<float>::max()};
+  float hi[3] = {-lo[0], -lo[1], -lo[2]};
+  for (size_t v = 0; v < _numVerts; ++v)
+    for (int c = 0; c < 3 && used[v]; ++c)
+    {
+      lo[c] = std::min(lo[c], _positions[3 * v + c]);
+      hi[c] = std::max(hi[c], _positions[3 * v + c]);
+    }
+  m_radius = 0.0f;
+  for (int c = 0; c < 3; ++c)
+    m_centre[c] = m_levels[0].numVerts != 0 ? 0.5f * (lo[c] + hi[c]) : 0.0f;
+  for (size_t v = 0; v < _numVerts; ++v)
+  {
+    if (!used[v])
+      continue;
+    float dx = _positions[3 * v] - m_centre[0];
+    float dy = _positions[3 * v + 1] - m_centre[1];
+    float dz = _positions[3 * v + 2] - m_centre[2];
+    m_radius = std::max(m_radius, std::sqrt(dx * dx + dy * dy + dz * dz));
+  }
+  if (_ratios.empty() || _numIndices < 3)
+    return;
+
+  Decimator decimator(_indices, _numIndices, _positionIndex, _positions, _numVerts, _offsets, _entries);
+  size_t numTriangles = _numIndices / 3;
+  for (float ratio : _ratios)
+  {
+    size_t target = static_cast<size_t>(std::max(0.0f, ratio) * numTriangles);
+    bool more = decimator.collapseTo(target);
+    // a level that couldn't get any smaller than the last isn't worth keeping
+    if (decimator.numAlive() * 3 >= m_levels.back().indices.size())
+      break;
+    Level level;
+    decimator.levelIndices(level.indices);
+    std::fill(used.begin(), used.end(), false);
+    for (uint32_t i : level.indices)
+      used[i] = true;
+    level.numVerts = static_cast<size_t>(std::count(used.begin(), used.end(), true));
+    level.error = decimator.error();
+    m_levels.push_back(std::move(level));
+    if (!more)
+      break;
+  }
+}
+
+std::vector<uint32_t> RigLod::packedIndices() const
+{
+  std::vector<uint32_t> out;
+  out.reserve(firstIndex(m_levels.size()));
+  for (auto &l : m_levels)
+    out.insert(out.end(), l.indices.begin(), l.indices.end());
+  return out;
+}
+
+size_t RigLod::firstIndex(size_t _i) const
+{
+  size_t first = 0;
+  for (size_t l = 0; l < _i && l < m_levels.size(); ++l)
+    first += m_levels[l].indices.size();
+  return first;
+}
+
+float RigLod::pixelsPerUnit(const float *_modelView, float _projectionY, float _viewportHeight) const
+{
+  const float *m = _modelView;
+  float z = m[2] * m_centre[0] + m[6] * m_centre[1] + m[10] * m_centre[2] + m[14];
+  float scale = std::sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+  // the camera looks down -z so the distance in front of it is -z
+  float depth = -z;
+  if (depth <= m_radius * scale)
+    return std::numeric_limits<float>::max();
+  return scale * _projectionY * 0.5f * _viewportHeight / depth;
+}
+
+size_t RigLod::selectLevel(float _pixelsPerUnit) const
+{
+  for (size_t l = m_levels.size(); l > 1; --l)
+    if (m_levels[l - 1].error * _pixelsPerUnit <= m_maxPixelError)
+      return l - 1;
+  return 0;
+}
+
+void RigLod::selectLevels(const float *_view, const float *_models, size_t _count, float _projectionY,
+                          float _viewportHeight, std::vector<int32_t> &_order, std::vector<uint32_t> &_counts) const
+{
+  std::vector<uint8_t> levels(_count);
+  _counts.assign(std::max<size_t>(m_levels.size(), 1), 0);
+  for (size_t i = 0; i < _count; ++i)
+  {
+    const float *model = _models + 16 * i;
+    float modelView[16];
+    for (int c = 0; c < 4; ++c)
+      for (int r = 0; r < 4; ++r)
+        modelView[4 * c + r] = _view[r] * model[4 * c] + _view[4 + r] * model[4 * c + 1] +
+                               _view[8 + r] * model[4 * c + 2] + _view[12 + r] * model[4 * c + 3];
+    levels[i] = static_cast<uint8_t>(selectLevel(pixelsPerUnit(modelView, _projectionY, _viewportHeight)));
+    ++_counts[levels[i]];
+  }
+  // a counting sort keeps each level's instances in their original order
+  std::vector<uint32_t> next(_counts.size(), 0);
+  for (size_t l = 1; l < _counts.size(); ++l)
+    next[l] = next[l - 1] + _counts[l - 1];
+  _order.resize(_count);
+  for (size_t i = 0; i < _count; ++i)
+    _order[next[levels[i]]++] = static_cast<int32_t>(i);
+}
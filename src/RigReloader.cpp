@@ -0,0 +1,252 @@
+#include "RigReloader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+RigReloader::RigReloader(Parser _parser, Loader _loader)
+    : m_parser(std::move(_parser)), m_loader(std::move(_loader))
+{
+}
+
+RigReloader::~RigReloader()
+{
+  stop();
+}
+
+void RigReloader::start(const ModelFile &_models, const BlendRig &_rig, unsigned int _intervalMs)
+{
+  stop();
+  m_current.models = _models;
+  m_current.rig = _rig;
+  m_current.base = _rig;
+  m_current.base.removeTargets();
+  m_current.modelsStamp = ModelFile::fileStamp(_models.fileName());
+  m_current.baseStamp = ModelFile::fileStamp(_models.baseMesh());
+  m_current.stamps.clear();
+  for (auto &e : _models.blendShapes())
+    m_current.stamps[e.name] = ModelFile::fileStamp(e.path);
+  m_next = Source();
+  m_intervalMs = std::max(_intervalMs, 1u);
+  m_ready = false;
+  m_waiting = false;
+  m_checkNow = false;
+  m_lastError.clear();
+  m_thread = std::thread(&RigReloader::worker, this);
+}
+
+void RigReloader::stop()
+{
+  if (!m_thread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  m_thread.join();
+  m_stop = false;
+}
+
+void RigReloader::check()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_checkNow = true;
+  }
+  m_wake.notify_all();
+}
+
+bool RigReloader::poll(Result &_result)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_ready)
+    return false;
+  _result = std::move(m_result);
+  m_result = Result();
+  m_ready = false;
+  return true;
+}
+
+void RigReloader::accept()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_waiting)
+      return;
+    // the worker is waiting so it isn't reading m_current, a full reload brought its own base
+    bool newBase = !m_next.base.vertexData().empty();
+    m_current.models = std::move(m_next.models);
+    m_current.rig = std::move(m_next.rig);
+    if (newBase)
+      m_current.base = std::move(m_next.base);
+    m_current.modelsStamp = m_next.modelsStamp;
+    m_current.baseStamp = m_next.baseStamp;
+    m_current.stamps = std::move(m_next.stamps);
+    m_next = Source();
+    m_waiting = false;
+    // anything saved while it was waiting is picked up straight away
+    m_checkNow = true;
+  }
+  m_wake.notify_all();
+}
+
+void RigReloader::worker()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stop)
+  {
+    m_wake.wait_for(lock, std::chrono::milliseconds(m_intervalMs), [this]() { return m_stop || m_checkNow; });
+    if (m_stop)
+      break;
+    m_checkNow = false;
+    // the last rig hasn't been accepted, a change now would be measured against the wrong one
+    if (m_waiting)
+      continue;
+    // the files are read and parsed without holding the lock so poll never waits on them
+    lock.unlock();
+    Result result;
+    bool changed = rebuild(result);
+    lock.lock();
+    if (!changed)
+      continue;
+    // an error that hasn't been taken yet is replaced, it carries no rig
+    m_waiting = !result.offsets.empty();
+    m_result = std::move(result);
+    m_ready = true;
+  }
+}
+
+bool RigReloader::reloadAll(ModelFile &_models, uint64_t _modelsStamp, uint64_t _baseStamp, Result &_result,
+                            std::string &_error)
+{
+  BlendRig rig;
+  if (!m_loader(_models, rig, _error))
+  {
+    if (_error.empty())
+      _error = "the rig couldn't be loaded from " + _models.fileName();
+    return false;
+  }
+  m_next.base = rig;
+  m_next.base.removeTargets();
+  m_next.stamps.clear();
+  for (size_t i = 0; i < _models.blendShapes().size(); ++i)
+  {
+    auto &e = _models.blendShapes()[i];
+    m_next.stamps[e.name] = ModelFile::fileStamp(e.path);
+    _result.parsed.push_back(i);
+  }
+  m_next.modelsStamp = _modelsStamp;
+  m_next.baseStamp = _baseStamp;
+  rig.targets().buildVertexMajor(_result.offsets, _result.entries);
+  _result.fullReload = true;
+  _result.targetsChanged = true;
+  _result.rig = rig;
+  m_next.rig = std::move(rig);
+  m_next.models = _models;
+  _result.models = std::move(_models);
+  return true;
+}
+
+bool RigReloader::rebuild(Result &_result)
+{
+  auto start = std::chrono::steady_clock::now();
+  // an error is only reported once, until it changes or the files load
+  auto fail = [&](const std::string &_error)
+  {
+    if (_error == m_lastError)
+      return false;
+    m_lastError = _error;
+    _result.error = _error;
+    return true;
+  };
+  auto finish = [&]()
+  {
+    m_lastError.clear();
+    _result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+  };
+  uint64_t modelsStamp = ModelFile::fileStamp(m_current.models.fileName());
+  ModelFile models = m_current.models;
+  if (modelsStamp != m_current.modelsStamp && !models.load(m_current.models.fileName()))
+    return fail(models.errorString());
+  uint64_t baseStamp = ModelFile::fileStamp(models.baseMesh());
+  if (models.baseMesh() != m_current.models.baseMesh() || baseStamp != m_current.baseStamp ||
+      models.deltaEpsilon() != m_current.models.deltaEpsilon())
+  {
+    // every delta is measured from the base so there is nothing worth keeping, the stamps stay as they
+    // were until it loads so a failure is tried again
+    std::string error;
+    if (!reloadAll(models, modelsStamp, baseStamp, _result, error))
+      return fail(error);
+    return finish();
+  }
+
+  std::unordered_map<std::string, size_t> oldIndex;
+  for (size_t t = 0; t < m_current.rig.targetNames().size(); ++t)
+    oldIndex[m_current.rig.targetNames()[t]] = t;
+  std::unordered_map<std::string, std::string> oldPath;
+  for (auto &e : m_current.models.blendShapes())
+    oldPath[e.name] = e.path;
+  std::unordered_map<std::string, uint64_t> stamps;
+  BlendRig rig = m_current.base;
+  std::vector<float> positions;
+  std::vector<float> normals;
+  for (size_t i = 0; i < models.blendShapes().size(); ++i)
+  {
+    auto &e = models.blendShapes()[i];
+    uint64_t stamp = ModelFile::fileStamp(e.path);
+    stamps[e.name] = stamp;
+    auto found = oldIndex.find(e.name);
+    auto stampFound = m_current.stamps.find(e.name);
+    if (found != oldIndex.end() && oldPath[e.name] == e.path && stampFound != m_current.stamps.end() &&
+        stampFound->second == stamp)
+    {
+      // untouched, the deltas are copied rather than worked out again
+      rig.addTarget(e.name, BlendTargetSet::Target(m_current.rig.targets().target(found->second)));
+      continue;
+    }
+    positions.clear();
+    normals.clear();
+    if (!m_parser(e.path, positions, normals) ||
+        !rig.addTarget(e.name, positions.data(), positions.size() / 3, normals.data(), normals.size() / 3))
+      return fail("Blend shape " + e.name + " couldn't be loaded from " + e.path);
+    _result.parsed.push_back(i);
+  }
+
+  bool targetsChanged = rig.targetNames() != m_current.rig.targetNames();
+  if (modelsStamp == m_current.modelsStamp && _result.parsed.empty() && !targetsChanged)
+  {
+    // nothing changed, or a file changed back, so there is nothing to send
+    m_lastError.clear();
+    return false;
+  }
+  rig.targets().buildVertexMajor(_result.offsets, _result.entries);
+  m_next.models = models;
+  m_next.modelsStamp = modelsStamp;
+  m_next.baseStamp = baseStamp;
+  m_next.stamps = std::move(stamps);
+  _result.models = std::move(models);
+  _result.rig = rig;
+  _result.targetsChanged = targetsChanged;
+  m_next.rig = std::move(rig);
+  return finish();
+}
+
+void RigReloader::changedRanges(const void *_old, const void *_new, size_t _bytes, size_t _block,
+                                std::vector<std::pair<size_t, size_t>> &_ranges)
+{
+  _ranges.clear();
+  auto a = static_cast<const unsigned char *>(_old);
+  auto b = static_cast<const unsigned char *>(_new);
+  size_t block = std::max<size_t>(_block, 1);
+  for (size_t offset = 0; offset < _bytes; offset += block)
+  {
+    size_t size = std::min(block, _bytes - offset);
+    if (std::memcmp(a + offset, b + offset, size) == 0)
+      continue;
+    if (!_ranges.empty() && offset - (_ranges.back().first + _ranges.back().second) <= block)
+      _ranges.back().second = offset + size - _ranges.back().first;
+    else
+      _ranges.push_back({offset, size});
+  }
+}
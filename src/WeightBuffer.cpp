@@ -0,0 +1,150 @@
+#include "WeightBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+WeightBuffer::~WeightBuffer()
+{
+  destroy();
+}
+
+void WeightBuffer::destroy()
+{
+  for (auto &f : m_fences)
+  {
+    if (f != nullptr)
+      glDeleteSync(f);
+    f = nullptr;
+  }
+  if (m_buffer != 0)
+  {
+    if (m_mapped != nullptr)
+    {
+      glBindBuffer(m_target, m_buffer);
+      glUnmapBuffer(m_target);
+    }
+    glDeleteBuffers(1, &m_buffer);
+  }
+  if (!m_textures.empty())
+  {
+    glDeleteTextures(static_cast<GLsizei>(m_textures.size()), m_textures.data());
+    glDeleteBuffers(static_cast<GLsizei>(m_texBuffers.size()), m_texBuffers.data());
+  }
+  m_textures.clear();
+  m_texBuffers.clear();
+  m_buffer = 0;
+  m_mapped = nullptr;
+}
+
+void WeightBuffer::create(size_t _count, GLuint _binding, size_t _numSegments, Target _target)
+{
+  destroy();
+  m_binding = _binding;
+  m_capacity = std::max<size_t>(_count, 1);
+  m_fences.assign(_numSegments, nullptr);
+  m_current = 0;
+  if (_target == Target::TextureBuffer)
+  {
+    m_texBuffers.resize(_numSegments);
+    m_textures.resize(_numSegments);
+    glGenBuffers(static_cast<GLsizei>(_numSegments), m_texBuffers.data());
+    glGenTextures(static_cast<GLsizei>(_numSegments), m_textures.data());
+    for (size_t i = 0; i < _numSegments; ++i)
+    {
+      glBindBuffer(GL_TEXTURE_BUFFER, m_texBuffers[i]);
+      glBufferData(GL_TEXTURE_BUFFER, m_capacity * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+      glBindTexture(GL_TEXTURE_BUFFER, m_textures[i]);
+      glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, m_texBuffers[i]);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    return;
+  }
+  // each segment has to start on the alignment the driver wants for bind ranges, attribute offsets
+  // only need 4 but keep segments on separate cache lines
+  m_target = _target == Target::ArrayBuffer ? GL_ARRAY_BUFFER : GL_SHADER_STORAGE_BUFFER;
+  GLint alignment = 256;
+  if (_target == Target::StorageBuffer)
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  size_t bytes = m_capacity * sizeof(float);
+  m_segmentSize = (bytes + alignment - 1) / alignment * alignment;
+  size_t total = m_segmentSize * _numSegments;
+
+  GLint major = 0;
+  GLint minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  glGenBuffers(1, &m_buffer);
+  glBindBuffer(m_target, m_buffer);
+  if (major > 4 || (major == 4 && minor >= 4))
+  {
+    // immutable storage mapped for the life of the buffer, coherent so no flush is needed
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(m_target, total, nullptr, flags);
+    m_mapped = static_cast<unsigned char *>(glMapBufferRange(m_target, 0, total, flags));
+  }
+  else
+  {
+    glBufferData(m_target, total, nullptr, GL_DYNAMIC_DRAW);
+  }
+  glBindBuffer(m_target, 0);
+}
+
+void WeightBuffer::upload(const float *_data, size_t _count)
+{
+  _count = std::min(_count, m_capacity);
+  if (!m_textures.empty())
+  {
+    glBindBuffer(GL_TEXTURE_BUFFER, m_texBuffers[m_current]);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, _count * sizeof(float), _data);
+    glActiveTexture(GL_TEXTURE0 + m_binding);
+    glBindTexture(GL_TEXTURE_BUFFER, m_textures[m_current]);
+    glActiveTexture(GL_TEXTURE0);
+    return;
+  }
+  if (m_buffer == 0)
+    return;
+  size_t offset = m_current * m_segmentSize;
+  if (m_mapped != nullptr)
+  {
+    // only wait if the GPU is still reading this segment from numSegments frames ago
+    GLsync &sync = m_fences[m_current];
+    if (sync != nullptr)
+    {
+      while (glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+        ;
+      glDeleteSync(sync);
+      sync = nullptr;
+    }
+    std::memcpy(m_mapped + offset, _data, _count * sizeof(float));
+  }
+  else
+  {
+    glBindBuffer(m_target, m_buffer);
+    glBufferSubData(m_target, offset, _count * sizeof(float), _data);
+  }
+  if (m_target == GL_SHADER_STORAGE_BUFFER)
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, m_binding, m_buffer, offset, m_capacity * sizeof(float));
+}
+
+void WeightBuffer::fence()
+{
+  if (m_fences.empty())
+    return;
+  if (m_mapped != nullptr)
+  {
+    GLsync &sync = m_fences[m_current];
+    if (sync != nullptr)
+      glDeleteSync(sync);
+    sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  m_current = (m_current + 1) % m_fences.size();
+}
+
+void WeightBuffer::refence(size_t _offset)
+{
+  if (m_mapped == nullptr || m_segmentSize == 0)
+    return;
+  GLsync &sync = m_fences[_offset / m_segmentSize];
+  if (sync != nullptr)
+    glDeleteSync(sync);
+  sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
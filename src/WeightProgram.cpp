@@ -0,0 +1,261 @@
+#include "WeightProgram.h"
+#include "BlendKernels.h"
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+namespace
+{
+/// @brief products and ramps are worked out this many at a time in arrays on the stack
+constexpr uint32_t c_chunk = 64;
+
+/// @brief the widest kernels the cpu has, as BlendShapeEvaluator::Kernel::Auto picks
+const blendkernels::Table &kernels()
+{
+  static const blendkernels::Table &table = blendkernels::cpuHasAVX2() ? *blendkernels::avx2()
+                                            : blendkernels::sse() != nullptr ? *blendkernels::sse()
+                                                                             : blendkernels::scalar();
+  return table;
+}
+
+void gather(float *_dst, const float *_src, const uint32_t *_idx, size_t _n)
+{
+  for (size_t i = 0; i < _n; ++i)
+    _dst[i] = _src[_idx[i]];
+}
+
+void scatter(float *_dst, const uint32_t *_idx, const float *_src, size_t _n)
+{
+  for (size_t i = 0; i < _n; ++i)
+    _dst[_idx[i]] = _src[i];
+}
+} // end anon namespace
+
+void WeightProgram::clear()
+{
+  m_numTargets = 0;
+  m_numInBetweens = 0;
+  m_productGroups.clear();
+  m_productTargets.clear();
+  m_productDrivers.clear();
+  m_rampTargets.clear();
+  m_rampDrivers.clear();
+  m_rampLeft.clear();
+  m_rampPeak.clear();
+  m_rampRight.clear();
+  m_driven.clear();
+}
+
+bool WeightProgram::compile(const ModelFile &_models, const std::vector<std::string> &_targetNames,
+                            std::string &_error)
+{
+  clear();
+  // until it compiles the weights are passed straight through
+  m_numTargets = _targetNames.size();
+  m_driven.assign(m_numTargets, false);
+  std::unordered_map<std::string, uint32_t> byName;
+  for (size_t t = 0; t < _targetNames.size(); ++t)
+    byName[_targetNames[t]] = static_cast<uint32_t>(t);
+  size_t numTargets = _targetNames.size();
+  std::vector<ModelFile::Kind> kinds(numTargets, ModelFile::Kind::BlendShape);
+  std::vector<const ModelFile::Entry *> entries(numTargets, nullptr);
+  for (auto &e : _models.blendShapes())
+  {
+    auto found = byName.find(e.name);
+    if (found == byName.end())
+    {
+      _error = e.name + " is not a target of the rig";
+      return false;
+    }
+    kinds[found->second] = e.kind;
+    entries[found->second] = &e;
+  }
+  // resolve every driver first so the errors name the line at fault
+  std::vector<std::vector<uint32_t>> drivers(numTargets);
+  for (size_t t = 0; t < numTargets; ++t)
+  {
+    if (kinds[t] == ModelFile::Kind::BlendShape)
+      continue;
+    for (auto &name : entries[t]->drivers)
+    {
+      auto found = byName.find(name);
+      if (found == byName.end())
+      {
+        _error = "unknown driver " + name + " for " + _targetNames[t];
+        return false;
+      }
+      if (found->second == t || kinds[found->second] == ModelFile::Kind::InBetween)
+      {
+        _error = _targetNames[t] + " can't be driven by " + name;
+        return false;
+      }
+      drivers[t].push_back(found->second);
+    }
+  }
+
+  // correctives in dependency order, a depth first walk that spots a cycle by meeting a target it is
+  // still working on
+  enum State : uint8_t
+  {
+    Unvisited,
+    Visiting,
+    Done
+  };
+  std::vector<State> state(numTargets, Unvisited);
+  // one more than the deepest corrective driving it, correctives of the same layer don't depend on each other
+  std::vector<uint32_t> layer(numTargets, 0);
+  std::vector<uint32_t> order;
+  std::vector<std::pair<uint32_t, size_t>> stack;
+  for (size_t root = 0; root < numTargets; ++root)
+  {
+    if (kinds[root] != ModelFile::Kind::Corrective || state[root] == Done)
+      continue;
+    stack.push_back({static_cast<uint32_t>(root), 0});
+    state[root] = Visiting;
+    while (!stack.empty())
+    {
+      auto &top = stack.back();
+      uint32_t t = top.first;
+      if (top.second < drivers[t].size())
+      {
+        uint32_t d = drivers[t][top.second++];
+        if (kinds[d] != ModelFile::Kind::Corrective || state[d] == Done)
+          continue;
+        if (state[d] == Visiting)
+        {
+          _error = "corrective " + _targetNames[d] + " depends on itself through " + _targetNames[t];
+          return false;
+        }
+        state[d] = Visiting;
+        stack.push_back({d, 0});
+        continue;
+      }
+      // every driver is worked out before this one
+      for (auto d : drivers[t])
+        if (kinds[d] == ModelFile::Kind::Corrective)
+          layer[t] = std::max(layer[t], layer[d] + 1);
+      order.push_back(t);
+      state[t] = Done;
+      stack.pop_back();
+    }
+  }
+
+  // the in-betweens of each driver in weight order then the driver itself at 1
+  std::map<uint32_t, std::vector<std::pair<float, uint32_t>>> keys;
+  for (size_t t = 0; t < numTargets; ++t)
+  {
+    if (kinds[t] != ModelFile::Kind::InBetween)
+      continue;
+    float weight = entries[t]->weight;
+    if (drivers[t].size() != 1 || !(weight > 0.0f && weight < 1.0f))
+    {
+      _error = "in-between " + _targetNames[t] + " needs one driver and a weight between 0 and 1";
+      return false;
+    }
+    keys[drivers[t][0]].push_back({weight, static_cast<uint32_t>(t)});
+  }
+  std::vector<uint32_t> rampTargets;
+  std::vector<uint32_t> rampDrivers;
+  std::vector<float> rampLeft;
+  std::vector<float> rampPeak;
+  std::vector<float> rampRight;
+  for (auto &k : keys)
+  {
+    auto &list = k.second;
+    std::sort(list.begin(), list.end());
+    list.push_back({1.0f, k.first});
+    for (size_t i = 0; i < list.size(); ++i)
+    {
+      if (i != 0 && list[i].first == list[i - 1].first)
+      {
+        _error = "two in-betweens of " + _targetNames[k.first] + " at the same weight";
+        return false;
+      }
+      float peak = list[i].first;
+      rampTargets.push_back(list[i].second);
+      rampDrivers.push_back(k.first);
+      rampLeft.push_back(i == 0 ? 0.0f : list[i - 1].first);
+      rampPeak.push_back(peak);
+      rampRight.push_back(i + 1 < list.size() ? list[i + 1].first : peak);
+    }
+  }
+
+  m_rampTargets = std::move(rampTargets);
+  m_rampDrivers = std::move(rampDrivers);
+  m_rampLeft = std::move(rampLeft);
+  m_rampPeak = std::move(rampPeak);
+  m_rampRight = std::move(rampRight);
+  // group the products by layer then number of drivers, each group is one run of the kernels
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t _a, uint32_t _b) {
+    return layer[_a] != layer[_b] ? layer[_a] < layer[_b] : drivers[_a].size() < drivers[_b].size();
+  });
+  for (size_t begin = 0; begin < order.size();)
+  {
+    size_t end = begin;
+    while (end < order.size() && layer[order[end]] == layer[order[begin]] &&
+           drivers[order[end]].size() == drivers[order[begin]].size())
+      ++end;
+    ProductGroup group;
+    group.first = static_cast<uint32_t>(m_productTargets.size());
+    group.count = static_cast<uint32_t>(end - begin);
+    group.numDrivers = static_cast<uint32_t>(drivers[order[begin]].size());
+    group.driverFirst = static_cast<uint32_t>(m_productDrivers.size());
+    for (size_t i = begin; i < end; ++i)
+      m_productTargets.push_back(order[i]);
+    for (uint32_t j = 0; j < group.numDrivers; ++j)
+      for (size_t i = begin; i < end; ++i)
+        m_productDrivers.push_back(drivers[order[i]][j]);
+    m_productGroups.push_back(group);
+    begin = end;
+  }
+  for (size_t t = 0; t < numTargets; ++t)
+  {
+    m_driven[t] = kinds[t] != ModelFile::Kind::BlendShape;
+    if (kinds[t] == ModelFile::Kind::InBetween)
+      ++m_numInBetweens;
+  }
+  return true;
+}
+
+void WeightProgram::evaluate(const float *_in, float *_out) const
+{
+  std::copy(_in, _in + m_numTargets, _out);
+  const blendkernels::Table &k = kernels();
+  alignas(32) float values[c_chunk];
+  alignas(32) float factors[c_chunk];
+  for (auto &g : m_productGroups)
+  {
+    for (uint32_t start = 0; start < g.count; start += c_chunk)
+    {
+      size_t n = std::min(c_chunk, g.count - start);
+      const uint32_t *drivers = m_productDrivers.data() + g.driverFirst + start;
+      // the first factor as is, so a product rounds the same as multiplying from 1
+      gather(values, _out, drivers, n);
+      for (uint32_t j = 1; j < g.numDrivers; ++j)
+      {
+        gather(factors, _out, drivers + j * g.count, n);
+        k.multiply(values, values, factors, n);
+      }
+      scatter(_out, m_productTargets.data() + g.first + start, values, n);
+    }
+  }
+  // a driver's own key is the last of its ramps so the ones before it still read the weight as set
+  for (size_t start = 0; start < m_rampTargets.size(); start += c_chunk)
+  {
+    size_t n = std::min<size_t>(c_chunk, m_rampTargets.size() - start);
+    gather(factors, _out, m_rampDrivers.data() + start, n);
+    k.ramp(values, factors, m_rampLeft.data() + start, m_rampPeak.data() + start, m_rampRight.data() + start, n);
+    scatter(_out, m_rampTargets.data() + start, values, n);
+  }
+}
+
+void WeightProgram::evaluate(const float *_in, float *_out, size_t _count) const
+{
+  if (empty())
+  {
+    std::copy(_in, _in + m_numTargets * _count, _out);
+    return;
+  }
+  for (size_t i = 0; i < _count; ++i)
+    evaluate(_in + i * m_numTargets, _out + i * m_numTargets);
+}
@@ -0,0 +1,219 @@
+#include "WeightSolver.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+/// @brief frames a worker solves one after another, each starts from the last one's weights
+constexpr size_t c_runLength = 32;
+} // end anon namespace
+
+void WeightSolver::setRig(const BlendRig &_rig, const WeightProgram *_program)
+{
+  m_numTargets = _rig.numTargets();
+  size_t numPositions = _rig.numSourcePositions();
+  m_fixed.assign(m_numTargets, false);
+  if (_program != nullptr)
+  {
+    for (size_t t = 0; t < m_numTargets; ++t)
+      m_fixed[t] = _program->isDriven(t);
+  }
+  // the first unique vertex made from each obj position speaks for it, the others are copies split by a
+  // seam in the normals
+  std::vector<int64_t> source(numPositions, -1);
+  auto &positionIndex = _rig.positionIndex();
+  for (size_t v = 0; v < positionIndex.size(); ++v)
+  {
+    if (source[positionIndex[v]] < 0)
+      source[positionIndex[v]] = static_cast<int64_t>(v);
+  }
+  m_basePositions.assign(numPositions * 3, 0.0f);
+  for (size_t p = 0; p < numPositions; ++p)
+  {
+    if (source[p] >= 0)
+      std::copy_n(_rig.positions() + source[p] * 3, 3, &m_basePositions[p * 3]);
+  }
+  // flip the targets to position major, counting first so it can be filled in place
+  auto &targets = _rig.targets();
+  auto uses = [&](uint32_t _v) { return source[positionIndex[_v]] == static_cast<int64_t>(_v); };
+  m_deltaOffsets.assign(numPositions + 1, 0);
+  for (size_t t = 0; t < m_numTargets; ++t)
+  {
+    if (m_fixed[t])
+      continue;
+    for (auto v : targets.target(t).indices)
+    {
+      if (uses(v))
+        ++m_deltaOffsets[positionIndex[v] + 1];
+    }
+  }
+  for (size_t p = 0; p < numPositions; ++p)
+    m_deltaOffsets[p + 1] += m_deltaOffsets[p];
+  m_deltas.resize(m_deltaOffsets.back());
+  std::vector<uint32_t> fill(m_deltaOffsets.begin(), m_deltaOffsets.end() - 1);
+  for (size_t t = 0; t < m_numTargets; ++t)
+  {
+    if (m_fixed[t])
+      continue;
+    auto &target = targets.target(t);
+    for (size_t i = 0; i < target.size(); ++i)
+    {
+      uint32_t v = target.indices[i];
+      if (uses(v))
+      {
+        m_deltas[fill[positionIndex[v]]++] = {static_cast<uint32_t>(t), target.positions.x[i], target.positions.y[i],
+                                              target.positions.z[i]};
+      }
+    }
+  }
+  m_rows.resize(numPositions);
+  for (size_t p = 0; p < numPositions; ++p)
+    m_rows[p] = static_cast<uint32_t>(p);
+  buildNormalEquations();
+}
+
+bool WeightSolver::setMarkers(const std::vector<uint32_t> &_positions)
+{
+  size_t numPositions = m_basePositions.size() / 3;
+  if (std::any_of(_positions.begin(), _positions.end(), [numPositions](uint32_t _p) { return _p >= numPositions; }))
+    return false;
+  if (_positions.empty())
+  {
+    m_rows.resize(numPositions);
+    for (size_t p = 0; p < numPositions; ++p)
+      m_rows[p] = static_cast<uint32_t>(p);
+  }
+  else
+  {
+    m_rows = _positions;
+  }
+  buildNormalEquations();
+  return true;
+}
+
+void WeightSolver::buildNormalEquations()
+{
+  size_t n = m_numTargets;
+  m_rowBase.resize(m_rows.size() * 3);
+  m_gram.assign(n * n, 0.0);
+  for (size_t r = 0; r < m_rows.size(); ++r)
+  {
+    uint32_t p = m_rows[r];
+    std::copy_n(&m_basePositions[p * 3], 3, &m_rowBase[r * 3]);
+    // each position adds the outer product of its deltas, only the targets that move it
+    for (uint32_t a = m_deltaOffsets[p]; a < m_deltaOffsets[p + 1]; ++a)
+    {
+      auto &da = m_deltas[a];
+      for (uint32_t b = m_deltaOffsets[p]; b < m_deltaOffsets[p + 1]; ++b)
+      {
+        auto &db = m_deltas[b];
+        m_gram[da.target * n + db.target] += static_cast<double>(da.x) * db.x + static_cast<double>(da.y) * db.y +
+                                             static_cast<double>(da.z) * db.z;
+      }
+    }
+  }
+}
+
+WeightSolver::Result WeightSolver::solve(const float *_positions, float *_weights)
+{
+  return solve(_positions, _weights, m_scratch);
+}
+
+WeightSolver::Result WeightSolver::solve(const float *_positions, float *_weights, Scratch &_scratch) const
+{
+  size_t n = m_numTargets;
+  Result result;
+  // D^T y and |y|^2 in one pass over the fitted positions
+  auto &rhs = _scratch.rhs;
+  rhs.assign(n, 0.0);
+  double yy = 0.0;
+  for (size_t r = 0; r < m_rows.size(); ++r)
+  {
+    double y[3];
+    for (size_t c = 0; c < 3; ++c)
+    {
+      y[c] = static_cast<double>(_positions[r * 3 + c]) - m_rowBase[r * 3 + c];
+      yy += y[c] * y[c];
+    }
+    uint32_t p = m_rows[r];
+    for (uint32_t e = m_deltaOffsets[p]; e < m_deltaOffsets[p + 1]; ++e)
+    {
+      auto &d = m_deltas[e];
+      rhs[d.target] += d.x * y[0] + d.y * y[1] + d.z * y[2];
+    }
+  }
+  // A w is kept up to date as each weight moves so a coordinate step is O(N)
+  auto &w = _scratch.w;
+  auto &aw = _scratch.aw;
+  w.resize(n);
+  aw.assign(n, 0.0);
+  for (size_t t = 0; t < n; ++t)
+    w[t] = m_fixed[t] ? 0.0 : std::clamp(static_cast<double>(_weights[t]), 0.0, 1.0);
+  for (size_t t = 0; t < n; ++t)
+  {
+    if (w[t] != 0.0)
+    {
+      for (size_t j = 0; j < n; ++j)
+        aw[j] += m_gram[j * n + t] * w[t];
+    }
+  }
+  double halfSparsity = 0.5 * m_settings.sparsity;
+  double damping = m_settings.damping;
+  for (result.iterations = 0; result.iterations < m_settings.maxIterations;)
+  {
+    ++result.iterations;
+    double largest = 0.0;
+    for (size_t t = 0; t < n; ++t)
+    {
+      if (m_fixed[t])
+        continue;
+      // minimise along w[t] with the others held then clamp to the bounds, the penalty only pulls down
+      // as the weights are never negative
+      double diagonal = m_gram[t * n + t] + damping;
+      double others = aw[t] - m_gram[t * n + t] * w[t];
+      double next = std::clamp((rhs[t] - halfSparsity - others) / diagonal, 0.0, 1.0);
+      double step = next - w[t];
+      if (step != 0.0)
+      {
+        for (size_t j = 0; j < n; ++j)
+          aw[j] += m_gram[j * n + t] * step;
+        w[t] = next;
+        largest = std::max(largest, std::abs(step));
+      }
+    }
+    if (largest <= m_settings.tolerance)
+      break;
+  }
+  // |D w - y|^2 = w^T A w - 2 w^T D^T y + |y|^2 so the error comes without blending the mesh
+  double error = yy;
+  for (size_t t = 0; t < n; ++t)
+  {
+    error += w[t] * (aw[t] - 2.0 * rhs[t]);
+    _weights[t] = static_cast<float>(w[t]);
+  }
+  if (!m_rows.empty())
+    result.rmsError = static_cast<float>(std::sqrt(std::max(error, 0.0) / m_rows.size()));
+  return result;
+}
+
+void WeightSolver::solveSequence(const float *_frames, size_t _numFrames, float *_weights, WorkStealingPool &_pool,
+                                 Result *_results) const
+{
+  size_t n = m_numTargets;
+  size_t stride = m_rows.size() * 3;
+  size_t numRuns = (_numFrames + c_runLength - 1) / c_runLength;
+  std::vector<Scratch> scratch(_pool.size());
+  _pool.parallelFor(numRuns, [&](size_t _run, size_t _worker) {
+    size_t begin = _run * c_runLength;
+    size_t end = std::min(begin + c_runLength, _numFrames);
+    std::fill_n(_weights + begin * n, n, 0.0f);
+    for (size_t f = begin; f < end; ++f)
+    {
+      if (f != begin)
+        std::copy_n(_weights + (f - 1) * n, n, _weights + f * n);
+      Result result = solve(_frames + f * stride, _weights + f * n, scratch[_worker]);
+      if (_results != nullptr)
+        _results[f] = result;
+    }
+  });
+}
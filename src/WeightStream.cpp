@@ -0,0 +1,339 @@
+#include "WeightStream.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(WeightStream::PacketHeader) == 24, "WeightStream packet layout changed");
+
+WeightStream::~WeightStream()
+{
+  stop();
+}
+
+int64_t WeightStream::now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool WeightStream::latest(Frame &_frame)
+{
+  // the slot gets _frame's vector back so it has to be the right size
+  if (_frame.weights.size() != m_numWeights)
+    _frame.weights.assign(m_numWeights, 0.0f);
+  bool found = false;
+  while (Frame *f = m_ring.front())
+  {
+    if (found)
+      ++m_skipped;
+    std::swap(_frame.weights, f->weights);
+    _frame.sequence = f->sequence;
+    _frame.sendTime = f->sendTime;
+    _frame.receiveTime = f->receiveTime;
+    m_ring.pop();
+    found = true;
+  }
+  return found;
+}
+
+bool WeightStream::flushOverflow()
+{
+  if (!m_hasOverflow)
+    return true;
+  Frame *f = m_ring.beginPush();
+  if (f == nullptr)
+    return false;
+  std::swap(f->weights, m_overflow.weights);
+  f->sequence = m_overflow.sequence;
+  f->sendTime = m_overflow.sendTime;
+  f->receiveTime = m_overflow.receiveTime;
+  m_ring.endPush();
+  m_hasOverflow = false;
+  return true;
+}
+
+bool WeightStream::consume()
+{
+  size_t offset = 0;
+  while (m_pending.size() - offset >= sizeof(PacketHeader))
+  {
+    PacketHeader header;
+    std::memcpy(&header, m_pending.data() + offset, sizeof(PacketHeader));
+    if (std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0 || header.numWeights > c_maxWeights)
+      return false;
+    size_t size = sizeof(PacketHeader) + header.numWeights * sizeof(float);
+    if (m_pending.size() - offset < size)
+      break;
+    m_received.fetch_add(1, std::memory_order_relaxed);
+    // with the ring full the newest frame waits in m_overflow, replacing any older one waiting there
+    Frame *f = flushOverflow() ? m_ring.beginPush() : nullptr;
+    if (f == nullptr)
+    {
+      if (m_hasOverflow)
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+      f = &m_overflow;
+    }
+    size_t n = std::min<size_t>(header.numWeights, m_numWeights);
+    std::memcpy(f->weights.data(), m_pending.data() + offset + sizeof(PacketHeader), n * sizeof(float));
+    std::fill(f->weights.begin() + n, f->weights.end(), 0.0f);
+    f->sequence = header.sequence;
+    f->sendTime = header.sendTime;
+    f->receiveTime = now();
+    if (f == &m_overflow)
+      m_hasOverflow = true;
+    else
+      m_ring.endPush();
+    offset += size;
+  }
+  m_pending.erase(m_pending.begin(), m_pending.begin() + offset);
+  return true;
+}
+
+#if defined(_WIN32)
+bool WeightStream::open(const std::string &, size_t)
+{
+  return false;
+}
+
+void WeightStream::stop()
+{
+}
+
+void WeightStream::reader()
+{
+}
+
+bool WeightStream::writePacket(int, uint64_t, int64_t, const float *, uint32_t)
+{
+  return false;
+}
+
+bool WeightStream::readPacket(int, PacketHeader &, std::vector<float> &)
+{
+  return false;
+}
+
+int WeightStream::connect(const std::string &)
+{
+  return -1;
+}
+#else
+namespace
+{
+bool socketAddress(const std::string &_path, sockaddr_un &_addr)
+{
+  std::memset(&_addr, 0, sizeof(sockaddr_un));
+  _addr.sun_family = AF_UNIX;
+  if (_path.size() >= sizeof(_addr.sun_path))
+    return false;
+  std::memcpy(_addr.sun_path, _path.c_str(), _path.size() + 1);
+  return true;
+}
+
+bool writeFully(int _fd, const void *_data, size_t _size)
+{
+  auto bytes = static_cast<const unsigned char *>(_data);
+  while (_size != 0)
+  {
+    ssize_t written = ::write(_fd, bytes, _size);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return false;
+    bytes += written;
+    _size -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+bool readFully(int _fd, void *_data, size_t _size)
+{
+  auto bytes = static_cast<unsigned char *>(_data);
+  while (_size != 0)
+  {
+    ssize_t got = ::read(_fd, bytes, _size);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return false;
+    bytes += got;
+    _size -= static_cast<size_t>(got);
+  }
+  return true;
+}
+} // end anon namespace
+
+bool WeightStream::open(const std::string &_source, size_t _numWeights)
+{
+  stop();
+  m_numWeights = _numWeights;
+  for (auto &f : m_ring.slots())
+    f.weights.assign(_numWeights, 0.0f);
+  m_overflow.weights.assign(_numWeights, 0.0f);
+  m_hasOverflow = false;
+  m_pending.clear();
+  m_skipped = 0;
+  m_received = 0;
+  m_dropped = 0;
+  m_malformed = 0;
+
+  if (_source == "-")
+  {
+    m_fd = STDIN_FILENO;
+  }
+  else
+  {
+    sockaddr_un addr;
+    if (!socketAddress(_source, addr))
+      return false;
+    m_listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_listenFd < 0)
+      return false;
+    ::unlink(_source.c_str());
+    if (::bind(m_listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(sockaddr_un)) != 0 ||
+        ::listen(m_listenFd, 1) != 0)
+    {
+      ::close(m_listenFd);
+      m_listenFd = -1;
+      return false;
+    }
+    m_socketPath = _source;
+  }
+  if (::pipe(m_wakeFds) != 0)
+  {
+    stop();
+    return false;
+  }
+  m_thread = std::thread(&WeightStream::reader, this);
+  return true;
+}
+
+void WeightStream::stop()
+{
+  if (m_thread.joinable())
+  {
+    char wake = 0;
+    writeFully(m_wakeFds[1], &wake, 1);
+    m_thread.join();
+  }
+  for (int &fd : m_wakeFds)
+  {
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+  }
+  // stdin belongs to the process
+  if (m_fd >= 0 && m_fd != STDIN_FILENO)
+    ::close(m_fd);
+  m_fd = -1;
+  if (m_listenFd >= 0)
+  {
+    ::close(m_listenFd);
+    ::unlink(m_socketPath.c_str());
+  }
+  m_listenFd = -1;
+  m_socketPath.clear();
+}
+
+void WeightStream::reader()
+{
+  std::vector<unsigned char> buffer(64 * 1024);
+  for (;;)
+  {
+    // with no sender wait on the listening socket for the next one
+    pollfd fds[2] = {{m_fd >= 0 ? m_fd : m_listenFd, POLLIN, 0}, {m_wakeFds[0], POLLIN, 0}};
+    if (fds[0].fd < 0)
+      return;
+    // a frame stuck in m_overflow is retried every millisecond until the render thread makes room
+    if (::poll(fds, 2, m_hasOverflow ? 1 : -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    if (fds[1].revents != 0)
+      return;
+    flushOverflow();
+    if (fds[0].revents == 0)
+      continue;
+    if (m_fd < 0)
+    {
+      m_fd = ::accept(m_listenFd, nullptr, nullptr);
+      m_pending.clear();
+      continue;
+    }
+    ssize_t got = ::read(m_fd, buffer.data(), buffer.size());
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got > 0)
+    {
+      m_pending.insert(m_pending.end(), buffer.begin(), buffer.begin() + got);
+      if (consume())
+        continue;
+      m_malformed.fetch_add(1, std::memory_order_relaxed);
+    }
+    // the sender closed, failed or sent garbage, a socket waits for the next one and stdin is done
+    // once its last frame is in the ring
+    if (m_listenFd < 0)
+    {
+      while (!flushOverflow())
+      {
+        pollfd wake = {m_wakeFds[0], POLLIN, 0};
+        if (::poll(&wake, 1, 1) > 0)
+          break;
+      }
+      return;
+    }
+    ::close(m_fd);
+    m_fd = -1;
+  }
+}
+
+bool WeightStream::writePacket(int _fd, uint64_t _sequence, int64_t _sendTime, const float *_weights,
+                               uint32_t _numWeights)
+{
+  // one write per packet so the reader rarely sees half of one
+  std::vector<unsigned char> packet(sizeof(PacketHeader) + _numWeights * sizeof(float));
+  PacketHeader header;
+  std::memcpy(header.magic, c_magic, sizeof(c_magic));
+  header.numWeights = _numWeights;
+  header.sequence = _sequence;
+  header.sendTime = _sendTime;
+  std::memcpy(packet.data(), &header, sizeof(PacketHeader));
+  std::memcpy(packet.data() + sizeof(PacketHeader), _weights, _numWeights * sizeof(float));
+  return writeFully(_fd, packet.data(), packet.size());
+}
+
+bool WeightStream::readPacket(int _fd, PacketHeader &_header, std::vector<float> &_weights)
+{
+  if (!readFully(_fd, &_header, sizeof(PacketHeader)) || std::memcmp(_header.magic, c_magic, sizeof(c_magic)) != 0 ||
+      _header.numWeights > c_maxWeights)
+    return false;
+  _weights.resize(_header.numWeights);
+  return readFully(_fd, _weights.data(), _weights.size() * sizeof(float));
+}
+
+int WeightStream::connect(const std::string &_path)
+{
+  sockaddr_un addr;
+  if (!socketAddress(_path, addr))
+    return -1;
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(sockaddr_un)) != 0)
+  {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+#endif
@@ -0,0 +1,121 @@
+#include "WorkStealingPool.h"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(size_t _numThreads)
+{
+  if (_numThreads == 0)
+    _numThreads = std::max(1u, std::thread::hardware_concurrency());
+  m_ranges = std::make_unique<Range[]>(_numThreads);
+  for (size_t i = 0; i < _numThreads; ++i)
+    m_threads.emplace_back(&WorkStealingPool::worker, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (auto &t : m_threads)
+    t.join();
+}
+
+void WorkStealingPool::parallelFor(size_t _count, const std::function<void(size_t, size_t)> &_task)
+{
+  if (_count == 0)
+    return;
+  size_t n = m_threads.size();
+  for (size_t i = 0; i < n; ++i)
+  {
+    std::lock_guard<std::mutex> lock(m_ranges[i].mutex);
+    m_ranges[i].begin = _count * i / n;
+    m_ranges[i].end = _count * (i + 1) / n;
+  }
+  m_steals = 0;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_task = &_task;
+  m_busy = n;
+  ++m_generation;
+  m_wake.notify_all();
+  m_finished.wait(lock, [this]() { return m_busy == 0; });
+  m_task = nullptr;
+}
+
+bool WorkStealingPool::next(size_t _worker, size_t &_index)
+{
+  {
+    Range &own = m_ranges[_worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.begin < own.end)
+    {
+      _index = own.begin++;
+      return true;
+    }
+  }
+  // out of work, take the back half of whichever range has the most left
+  size_t n = m_threads.size();
+  for (;;)
+  {
+    size_t victim = n;
+    size_t most = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      if (i == _worker)
+        continue;
+      std::lock_guard<std::mutex> lock(m_ranges[i].mutex);
+      size_t left = m_ranges[i].end - m_ranges[i].begin;
+      if (left > most)
+      {
+        most = left;
+        victim = i;
+      }
+    }
+    if (victim == n)
+      return false;
+    size_t begin;
+    size_t end;
+    {
+      Range &range = m_ranges[victim];
+      std::lock_guard<std::mutex> lock(range.mutex);
+      // it may have been drained since we looked
+      if (range.begin >= range.end)
+        continue;
+      end = range.end;
+      begin = range.end - (range.end - range.begin + 1) / 2;
+      range.end = begin;
+    }
+    m_steals.fetch_add(1, std::memory_order_relaxed);
+    Range &own = m_ranges[_worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    own.begin = begin + 1;
+    own.end = end;
+    _index = begin;
+    return true;
+  }
+}
+
+void WorkStealingPool::worker(size_t _index)
+{
+  uint64_t seen = 0;
+  for (;;)
+  {
+    const std::function<void(size_t, size_t)> *task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [&]() { return m_stop || m_generation != seen; });
+      if (m_stop)
+        return;
+      seen = m_generation;
+      task = m_task;
+    }
+    size_t i;
+    while (next(_index, i))
+      (*task)(i, _index);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_busy == 0)
+        m_finished.notify_one();
+    }
+  }
+}
@@ -2,13 +2,130 @@
 basic OpenGL demo modified from http://qt-project.org/doc/qt-5.0/qtgui/openglwindow.html
 ****************************************************************************/
 #include <QtGui/QGuiApplication>
+#include <algorithm>
 #include <iostream>
+#include <string>
 #include "NGLScene.h"
+#include "MeshBaker.h"
+#include "ParseNumber.h"
+#include "RigCache.h"
+#include "RigLoader.h"
+#include "WeightProgram.h"
 
-
+namespace
+{
+// FacialAnimation --bake weights output [--models models.txt] [--fps 30] [--threads N] [--pose-cache MB]
+//                 [--pose-step s]
+// evaluates every frame on the CPU and writes output.fpc as a PointCache, or anything else as an obj
+// per frame (see MeshBaker::objFrameName). No window or GL context is created so it runs on machines
+// without a GPU or display. --pose-cache copies frames whose weights have been baked already, see PoseCache.
+int bake(int argc, char **argv)
+{
+  std::string weightsName;
+  std::string outName;
+  std::string modelName = "models.txt";
+  float fps = 30.0f;
+  size_t threads = 0;
+  size_t poseCacheMB = 0;
+  float poseStep = 0.0f;
+  bool argsOk = true;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "--bake" && i + 2 < argc)
+    {
+      weightsName = argv[++i];
+      outName = argv[++i];
+    }
+    else if (arg == "--models" && i + 1 < argc)
+      modelName = argv[++i];
+    else if (arg == "--fps" && i + 1 < argc)
+      argsOk = parseNumber(argv[++i], fps) && argsOk;
+    else if (arg == "--threads" && i + 1 < argc)
+      argsOk = parseNumber(argv[++i], threads) && argsOk;
+    else if (arg == "--pose-cache" && i + 1 < argc)
+      argsOk = parseNumber(argv[++i], poseCacheMB) && argsOk;
+    else if (arg == "--pose-step" && i + 1 < argc)
+      argsOk = parseNumber(argv[++i], poseStep) && argsOk;
+  }
+  if (!argsOk || weightsName.empty() || fps <= 0.0f)
+  {
+    std::cerr << "usage FacialAnimation --bake weights output [--models models.txt] [--fps 30] [--threads N] "
+                 "[--pose-cache MB] [--pose-step s]\n";
+    return EXIT_FAILURE;
+  }
+  ModelFile models;
+  if (!models.load(modelName))
+  {
+    std::cerr << models.errorString() << '\n';
+    return EXIT_FAILURE;
+  }
+  // the same rig the viewer would use, from the baked cache when it is up to date
+  BlendRig rig(models.deltaEpsilon());
+  RigCache cache;
+  if (cache.open(models.cacheFileName()) && cache.sourceHash() == models.sourceHash())
+  {
+    cache.toRig(rig);
+  }
+  else
+  {
+    RigLoader loader;
+    if (!loader.load(models, rig))
+    {
+      std::cerr << loader.errorString() << '\n';
+      return EXIT_FAILURE;
+    }
+  }
+  std::vector<float> frames;
+  std::string error;
+  if (!MeshBaker::loadWeights(weightsName, rig.targetNames(), fps, frames, error))
+  {
+    std::cerr << error << '\n';
+    return EXIT_FAILURE;
+  }
+  // the baker blends the weights as they are so work out the correctives and in-betweens first
+  WeightProgram program;
+  if (!program.compile(models, rig.targetNames(), error))
+  {
+    std::cerr << error << '\n';
+    return EXIT_FAILURE;
+  }
+  if (!program.empty())
+  {
+    std::vector<float> blendFrames(frames.size());
+    program.evaluate(frames.data(), blendFrames.data(), frames.size() / std::max<size_t>(rig.numTargets(), 1));
+    frames.swap(blendFrames);
+  }
+  MeshBaker baker(rig, threads);
+  baker.setNormalMode(models.normalMode());
+  baker.setPoseCache(poseCacheMB * 1024 * 1024, poseStep);
+  bool pointCache = outName.size() >= 4 && outName.compare(outName.size() - 4, 4, ".fpc") == 0;
+  bool ok = pointCache ? baker.bakePointCache(frames, fps, models.sourceHash(), outName) : baker.bakeObj(frames, outName);
+  if (!ok)
+  {
+    std::cerr << "unable to write " << outName << '\n';
+    return EXIT_FAILURE;
+  }
+  auto &stats = baker.stats();
+  std::cout << "baked " << stats.frames << " frames of " << rig.numVerts() << " vertices to " << outName << " in "
+            << stats.wallMs << " ms on " << stats.threads << " threads (" << stats.computeMs
+            << " ms evaluating and formatting, " << stats.writeMs << " ms writing " << stats.bytes / (1024 * 1024)
+            << " MB, " << stats.steals << " steals)\n";
+  if (poseCacheMB != 0)
+    std::cout << "pose cache " << stats.poses.hits << " hits " << stats.poses.misses << " misses "
+              << stats.poses.evictions << " evictions\n";
+  return EXIT_SUCCESS;
+}
+} // end anon namespace
 
 int main(int argc, char **argv)
 {
+  // the batch bake doesn't need a window, check for it before Qt looks for a display
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::string(argv[i]) == "--bake")
+      return bake(argc, argv);
+  }
   QGuiApplication app(argc, argv);
   // create an OpenGL format specifier
   QSurfaceFormat format;
@@ -31,6 +148,51 @@ int main(int argc, char **argv)
   format.setDepthBufferSize(24);
   // now we are going to create our scene window
   NGLScene window;
+  // --stream - reads weights from stdin, --stream path listens on a unix socket
+  // --crowd N starts with N heads, --crowd-bench times the crowd at increasing sizes
+  // --trace file.json records a Chrome trace of every frame until R is pressed or the window closes
+  // --watch reloads the rig when models.txt or any obj it lists is saved
+  // --cache file.fpc plays a baked point cache (see --bake) instead of blending, K switches back
+  // --pose-cache MB (64, 0 for none) and --pose-step s (0.01) set up the poses the compute pre-pass keeps
+  size_t poseCacheMB = 64;
+  float poseStep = 0.01f;
+  bool argsOk = true;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "--stream" && i + 1 < argc)
+      window.setStreamSource(argv[++i]);
+    else if (arg == "--crowd" && i + 1 < argc)
+    {
+      size_t heads = 0;
+      argsOk = parseNumber(argv[++i], heads) && argsOk;
+      window.setCrowd(heads);
+    }
+    else if (arg == "--trace" && i + 1 < argc)
+      window.setTraceFile(argv[++i]);
+    else if (arg == "--watch")
+      window.setWatch(true);
+    else if (arg == "--cache" && i + 1 < argc)
+      window.setPointCache(argv[++i]);
+    else if (arg == "--pose-cache" && i + 1 < argc)
+      argsOk = parseNumber(argv[++i], poseCacheMB) && argsOk;
+    else if (arg == "--pose-step" && i + 1 < argc)
+      argsOk = parseNumber(argv[++i], poseStep) && argsOk;
+    else if (arg == "--crowd-bench")
+    {
+      // without vsync so the frame time is the time it takes to draw
+      format.setSwapInterval(0);
+      window.startCrowdBenchmark();
+    }
+  }
+  if (!argsOk)
+  {
+    std::cerr << "usage FacialAnimation [--stream -|path] [--crowd N] [--crowd-bench] [--trace file.json] [--watch] "
+                 "[--cache file.fpc] [--pose-cache MB] [--pose-step s]\n"
+              << "      FacialAnimation --bake weights output [options]\n";
+    return EXIT_FAILURE;
+  }
+  window.setPoseCache(poseCacheMB * 1024 * 1024, poseStep);
   // and set the OpenGL format
   window.setFormat(format);
   // we can now query the version to see if it worked
@@ -0,0 +1,117 @@
+// FacialBasis reports how many basis shapes (see DeltaBasis) a rig needs at a range of error
+// tolerances, the memory and per vertex fetches they save and the error they add to the blended mesh
+// usage FacialBasis [models.txt] [tolerance ...]
+#include "BlendShapeEvaluator.h"
+#include "DeltaBasis.h"
+#include "ModelFile.h"
+#include "ParseNumber.h"
+#include "RigCache.h"
+#include "RigLoader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+/// @brief largest distance between two sets of blended positions
+float maxDistance(const SoAVec3 &_a, const SoAVec3 &_b)
+{
+  float diff = 0.0f;
+  for (size_t i = 0; i < _a.size(); ++i)
+  {
+    float dx = _a.x[i] - _b.x[i];
+    float dy = _a.y[i] - _b.y[i];
+    float dz = _a.z[i] - _b.z[i];
+    diff = std::max(diff, std::sqrt(dx * dx + dy * dy + dz * dz));
+  }
+  return diff;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  std::string modelName = argc > 1 ? argv[1] : "models.txt";
+  ModelFile models;
+  if (!models.load(modelName))
+  {
+    std::cerr << models.errorString() << '\n';
+    return EXIT_FAILURE;
+  }
+  std::vector<float> tolerances;
+  for (int i = 2; i < argc; ++i)
+  {
+    float tolerance = 0.0f;
+    if (!parseNumber(argv[i], tolerance))
+    {
+      std::cerr << "usage FacialBasis [models.txt] [tolerance ...]\n";
+      return EXIT_FAILURE;
+    }
+    tolerances.push_back(tolerance);
+  }
+  if (tolerances.empty())
+  {
+    tolerances = {0.001f, 0.01f, 0.05f, 0.1f, 0.25f, 0.5f};
+    if (models.basisTolerance() > 0.0f)
+      tolerances.push_back(models.basisTolerance());
+    std::sort(tolerances.begin(), tolerances.end());
+  }
+  // use the baked rig if it is up to date as it is much quicker
+  BlendRig rig;
+  RigCache cache;
+  if (cache.open(models.cacheFileName()) && cache.sourceHash() == models.sourceHash())
+  {
+    cache.toRig(rig);
+  }
+  else
+  {
+    RigLoader loader;
+    if (!loader.load(models, rig))
+    {
+      std::cerr << loader.errorString() << '\n';
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<int32_t> offsets;
+  std::vector<float> entries;
+  rig.targets().buildVertexMajor(offsets, entries);
+  std::cout << rig.numTargets() << " targets " << rig.numVerts() << " vertices " << entries.size() / 8
+            << " entries " << entries.size() * sizeof(float) << " bytes\n";
+
+  BlendShapeEvaluator reference;
+  reference.setRig(rig);
+  BlendShapeEvaluator mixed;
+  mixed.setRig(rig);
+  std::vector<float> weights(rig.numTargets(), 1.0f);
+  reference.evaluate(weights);
+
+  std::cout << std::left << std::setw(11) << "tolerance" << std::setw(8) << "shapes" << std::setw(12) << "bytes"
+            << std::setw(8) << "ratio" << std::setw(16) << "fetches (max)" << std::setw(12) << "target dP"
+            << std::setw(12) << "target dN" << std::setw(12) << "all dP" << std::setw(10) << "ms"
+            << "worst target\n";
+  DeltaBasis basis;
+  for (auto tolerance : tolerances)
+  {
+    basis.build(offsets.data(), entries.data(), rig.numVerts(), rig.numTargets(), rig.targets().epsilon(), tolerance,
+                models.basisMaxShapes());
+    auto &report = basis.report();
+    // the error of one target at a time is in the report, errors can add up so blend them all as well
+    std::vector<float> coefficients(basis.numShapes());
+    basis.project(weights.data(), coefficients.data());
+    mixed.setTargets(basis.shapes());
+    mixed.evaluate(coefficients);
+    std::ostringstream fetches;
+    fetches << std::fixed << std::setprecision(2) << report.basisRow << " (" << report.basisMaxRow << ")";
+    std::cout << std::setw(11) << tolerance << std::setw(8) << report.numShapes << std::setw(12) << report.basisBytes
+              << std::setw(8) << std::setprecision(3) << static_cast<double>(report.targetBytes) / report.basisBytes
+              << std::setw(16) << fetches.str() << std::setw(12) << report.positionError << std::setw(12)
+              << report.normalError << std::setw(12) << maxDistance(reference.positions(), mixed.positions())
+              << std::setw(10) << std::setprecision(4) << report.ms << rig.targetNames()[report.worstTarget] << '\n';
+  }
+  std::cout << "the targets fetch " << std::fixed << std::setprecision(2) << basis.report().targetRow << " ("
+            << basis.report().targetMaxRow << ") deltas per vertex, a ratio above 1 is a saving\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+// FacialClip converts text animation clips to the binary format and samples clips headless
+// usage FacialClip convert in.txt out.fclip
+//       FacialClip sample clip [fps] [models.txt]   writes one line of weights per frame to stdout
+#include "AnimationClip.h"
+#include "ClipSampler.h"
+#include "ModelFile.h"
+#include "ParseNumber.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+int convert(const std::string &_in, const std::string &_out)
+{
+  AnimationClip clip;
+  if (!clip.loadAny(_in))
+  {
+    std::cerr << clip.errorString() << '\n';
+    return EXIT_FAILURE;
+  }
+  if (!clip.save(_out))
+  {
+    std::cerr << "unable to write " << _out << '\n';
+    return EXIT_FAILURE;
+  }
+  std::cerr << "wrote " << clip.curves().size() << " curves " << clip.numKeys() << " keys to " << _out << '\n';
+  return EXIT_SUCCESS;
+}
+
+int sample(const std::string &_clipName, float _fps, const std::string &_modelName)
+{
+  AnimationClip clip;
+  if (!clip.loadAny(_clipName))
+  {
+    std::cerr << clip.errorString() << '\n';
+    return EXIT_FAILURE;
+  }
+  ModelFile models;
+  if (!models.load(_modelName))
+  {
+    std::cerr << models.errorString() << '\n';
+    return EXIT_FAILURE;
+  }
+  std::vector<std::string> names;
+  for (auto &b : models.blendShapes())
+    names.push_back(b.name);
+  ClipSampler sampler;
+  sampler.bind(clip, names);
+
+  std::vector<float> weights(names.size(), 0.0f);
+  size_t numFrames = static_cast<size_t>(sampler.duration() * _fps) + 1;
+  std::vector<float> frames(numFrames * names.size());
+  auto start = std::chrono::steady_clock::now();
+  for (size_t f = 0; f < numFrames; ++f)
+  {
+    sampler.sample(static_cast<float>(f) / _fps, weights);
+    std::copy(weights.begin(), weights.end(), frames.begin() + f * names.size());
+  }
+  auto end = std::chrono::steady_clock::now();
+  for (size_t f = 0; f < numFrames; ++f)
+  {
+    std::cout << static_cast<float>(f) / _fps;
+    for (size_t w = 0; w < names.size(); ++w)
+      std::cout << ',' << frames[f * names.size() + w];
+    std::cout << '\n';
+  }
+  double ms = std::chrono::duration<double, std::milli>(end - start).count();
+  std::cerr << "sampled " << numFrames << " frames of " << sampler.numCurves() << " curves in " << ms << " ms ("
+            << (ms > 0.0 ? numFrames / ms * 1000.0 : 0.0) << " frames/s)\n";
+  return EXIT_SUCCESS;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  std::string mode = argc > 1 ? argv[1] : "";
+  if (mode == "convert" && argc > 3)
+    return convert(argv[2], argv[3]);
+  float fps = 60.0f;
+  if (mode == "sample" && argc > 2 && (argc == 3 || (parseNumber(argv[3], fps) && fps > 0.0f)))
+    return sample(argv[2], fps, argc > 4 ? argv[4] : "models.txt");
+  std::cerr << "usage FacialClip convert in.txt out.fclip\n"
+            << "      FacialClip sample clip [fps] [models.txt]\n";
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,129 @@
+// FacialDeltaError reports how much GPU memory each DeltaCodec format uses for a rig and the error it
+// introduces against the float deltas, both per entry and on the blended mesh
+// usage FacialDeltaError [models.txt]
+#include "BlendShapeEvaluator.h"
+#include "DeltaCodec.h"
+#include "ModelFile.h"
+#include "RigCache.h"
+#include "RigLoader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+/// @brief largest difference between two sets of blended positions / normals
+float maxDifference(const SoAVec3 &_a, const SoAVec3 &_b)
+{
+  float diff = 0.0f;
+  for (size_t i = 0; i < _a.size(); ++i)
+  {
+    diff = std::max(diff, std::fabs(_a.x[i] - _b.x[i]));
+    diff = std::max(diff, std::fabs(_a.y[i] - _b.y[i]));
+    diff = std::max(diff, std::fabs(_a.z[i] - _b.z[i]));
+  }
+  return diff;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  std::string modelName = argc > 1 ? argv[1] : "models.txt";
+  ModelFile models;
+  if (!models.load(modelName))
+  {
+    std::cerr << models.errorString() << '\n';
+    return EXIT_FAILURE;
+  }
+  // use the baked rig if it is up to date as it is much quicker
+  BlendRig rig;
+  RigCache cache;
+  if (cache.open(models.cacheFileName()) && cache.sourceHash() == models.sourceHash())
+  {
+    cache.toRig(rig);
+  }
+  else
+  {
+    RigLoader loader;
+    if (!loader.load(models, rig))
+    {
+      std::cerr << loader.errorString() << '\n';
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<int32_t> offsets;
+  std::vector<float> entries;
+  rig.targets().buildVertexMajor(offsets, entries);
+  size_t numEntries = entries.size() / 8;
+  size_t floatBytes = entries.size() * sizeof(float);
+  std::cout << rig.numTargets() << " targets " << rig.numVerts() << " vertices " << numEntries << " entries\n";
+
+  // the float mesh for each target on its own at full weight, and everything at full weight
+  BlendShapeEvaluator reference;
+  reference.setRig(rig);
+  std::vector<float> weights(rig.numTargets(), 0.0f);
+
+  std::cout << std::left << std::setw(10) << "format" << std::setw(12) << "bytes" << std::setw(8) << "ratio"
+            << std::setw(14) << "entry dP" << std::setw(14) << "entry dN" << std::setw(14) << "mesh P"
+            << std::setw(14) << "mesh N"
+            << "worst target\n";
+  for (auto format : {DeltaCodec::Format::Float32, DeltaCodec::Format::Half, DeltaCodec::Format::SNorm16})
+  {
+    if (rig.numTargets() > DeltaCodec::maxTargets(format))
+    {
+      std::cout << std::setw(10) << DeltaCodec::formatName(format) << "too many targets\n";
+      continue;
+    }
+    auto packed = DeltaCodec::encode(format, entries.data(), offsets.data(), rig.numVerts(), rig.normals(),
+                                     rig.numTargets());
+    std::vector<float> decoded;
+    DeltaCodec::decode(packed, offsets.data(), rig.numVerts(), rig.normals(), decoded);
+    float entryP = 0.0f;
+    float entryN = 0.0f;
+    for (size_t e = 0; e < numEntries; ++e)
+    {
+      for (int c = 0; c < 3; ++c)
+      {
+        entryP = std::max(entryP, std::fabs(entries[e * 8 + c] - decoded[e * 8 + c]));
+        entryN = std::max(entryN, std::fabs(entries[e * 8 + 4 + c] - decoded[e * 8 + 4 + c]));
+      }
+    }
+
+    // errors add up when targets are combined so blend with the quantised targets too
+    BlendShapeEvaluator quantised;
+    quantised.setRig(rig);
+    BlendTargetSet targets = rig.targets();
+    DeltaCodec::quantise(targets, format, rig.normals());
+    quantised.setTargets(targets);
+    float meshP = 0.0f;
+    float meshN = 0.0f;
+    std::string worst = "-";
+    for (size_t t = 0; t <= rig.numTargets(); ++t)
+    {
+      // one target at a time then all of them
+      if (t < rig.numTargets())
+      {
+        std::fill(weights.begin(), weights.end(), 0.0f);
+        weights[t] = 1.0f;
+      }
+      else
+      {
+        std::fill(weights.begin(), weights.end(), 1.0f);
+      }
+      reference.evaluate(weights);
+      quantised.evaluate(weights);
+      float p = maxDifference(reference.positions(), quantised.positions());
+      if (p > meshP)
+        worst = t < rig.numTargets() ? rig.targetNames()[t] : "all";
+      meshP = std::max(meshP, p);
+      meshN = std::max(meshN, maxDifference(reference.normals(), quantised.normals()));
+    }
+    std::cout << std::setw(10) << DeltaCodec::formatName(format) << std::setw(12) << packed.bytes() << std::setw(8)
+              << std::setprecision(3) << static_cast<double>(floatBytes) / packed.bytes() << std::setw(14) << entryP
+              << std::setw(14) << entryN << std::setw(14) << meshP << std::setw(14) << meshN << worst << '\n';
+  }
+  return EXIT_SUCCESS;
+}
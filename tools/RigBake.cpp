@@ -0,0 +1,63 @@
+// FacialRigBake parses the obj files listed in a models.txt and writes the binary rig cache
+// the viewer would otherwise build on its first run, along with the basis shapes of a Basis line
+// which the viewer never builds itself
+// usage FacialRigBake [models.txt] [output.rig]
+#include "DeltaBasis.h"
+#include "ModelFile.h"
+#include "RigCache.h"
+#include "RigLoader.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char **argv)
+{
+  std::string modelName = argc > 1 ? argv[1] : "models.txt";
+  ModelFile models;
+  if (!models.load(modelName))
+  {
+    std::cerr << models.errorString() << '\n';
+    return EXIT_FAILURE;
+  }
+  std::string outName = argc > 2 ? argv[2] : models.cacheFileName();
+
+  auto start = std::chrono::steady_clock::now();
+  BlendRig rig;
+  RigLoader loader;
+  if (!loader.load(models, rig))
+  {
+    std::cerr << loader.errorString() << '\n';
+    return EXIT_FAILURE;
+  }
+  loader.printTimings();
+  DeltaBasis basis;
+  if (models.basisTolerance() > 0.0f && rig.numTargets() != 0)
+  {
+    std::vector<int32_t> offsets;
+    std::vector<float> entries;
+    rig.targets().buildVertexMajor(offsets, entries);
+    basis.build(offsets.data(), entries.data(), rig.numVerts(), rig.numTargets(), rig.targets().epsilon(),
+                models.basisTolerance(), models.basisMaxShapes());
+    auto &report = basis.report();
+    std::cout << "basis of " << report.numShapes << " shapes for " << report.numTargets << " targets in "
+              << report.ms << " ms, " << report.basisBytes / 1024 << " KB rather than " << report.targetBytes / 1024
+              << " KB, error " << report.positionError << " on " << rig.targetNames()[report.worstTarget] << '\n';
+    // the shapes are denser than the targets, the viewer blends whichever is smaller
+    if (report.basisBytes >= report.targetBytes)
+    {
+      std::cout << "the basis is no smaller, the targets will be blended\n";
+      basis.clear();
+    }
+  }
+  if (!RigCache::write(outName, rig, models.sourceHash(), models.basisTolerance() > 0.0f ? &basis : nullptr,
+                       models.basisTolerance(), models.basisMaxShapes()))
+  {
+    std::cerr << "unable to write " << outName << '\n';
+    return EXIT_FAILURE;
+  }
+  auto end = std::chrono::steady_clock::now();
+  std::cout << "baked " << rig.numTargets() << " targets " << rig.numVerts() << " vertices "
+            << rig.targets().numEntries() << " delta entries to " << outName << " in "
+            << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+// FacialSolve fits the rig's weights to a scanned or tracked face, see WeightSolver
+// usage FacialSolve obj scan.obj [options]             prints the weight of each target
+//       FacialSolve cache baked.fpc out.csv [options]  solves every frame of a PointCache
+//       FacialSolve csv tracked.csv out.csv [options]  solves one line of time then xyz per position a frame
+// options --models models.txt --markers markers.txt --sparsity s --threads N
+// the markers file lists the 0 based obj positions to fit (whitespace or comma separated, # for comments),
+// without one every position is fitted. The csv files written have a time then a weight per target a
+// line, as FacialClip sample writes, so they can be baked or played like any other weights.
+#include "MappedFile.h"
+#include "ModelFile.h"
+#include "ObjTargetReader.h"
+#include "ParseNumber.h"
+#include "PointCache.h"
+#include "RigCache.h"
+#include "RigLoader.h"
+#include "WeightProgram.h"
+#include "WeightSolver.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+bool readMarkers(const std::string &_fname, std::vector<uint32_t> &_markers)
+{
+  std::ifstream in(_fname);
+  if (!in.is_open())
+    return false;
+  std::string line;
+  while (std::getline(in, line))
+  {
+    line = line.substr(0, line.find('#'));
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream tokens(line);
+    long index;
+    while (tokens >> index)
+    {
+      if (index < 0)
+        return false;
+      _markers.push_back(static_cast<uint32_t>(index));
+    }
+    if (!tokens.eof())
+      return false;
+  }
+  return true;
+}
+
+/// @brief the positions of _markers (or all of them) from a full set of obj positions
+void gather(const float *_positions, const std::vector<uint32_t> &_markers, size_t _numPositions, float *_out)
+{
+  if (_markers.empty())
+  {
+    std::copy_n(_positions, _numPositions * 3, _out);
+    return;
+  }
+  for (size_t m = 0; m < _markers.size(); ++m)
+    std::copy_n(_positions + _markers[m] * 3, 3, _out + m * 3);
+}
+
+/// @brief every frame of a point cache as obj positions, each unique vertex writes the position it was made from
+bool readPointCache(const std::string &_fname, const BlendRig &_rig, const std::vector<uint32_t> &_markers,
+                    std::vector<float> &_frames, float &_fps)
+{
+  MappedFile file;
+  PointCache::Header header;
+  if (!file.open(_fname) || file.size() < sizeof(header))
+    return false;
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (!PointCache::valid(header) || header.numVerts != _rig.numVerts() || file.size() < PointCache::fileSize(header))
+    return false;
+  _fps = header.fps;
+  size_t numPositions = _rig.numSourcePositions();
+  size_t inputs = _markers.empty() ? numPositions : _markers.size();
+  std::vector<float> positions(numPositions * 3, 0.0f);
+  _frames.resize(header.numFrames * inputs * 3);
+  auto &positionIndex = _rig.positionIndex();
+  for (size_t f = 0; f < header.numFrames; ++f)
+  {
+    auto frame = reinterpret_cast<const float *>(file.data() + PointCache::frameOffset(header, f));
+    for (size_t v = 0; v < positionIndex.size(); ++v)
+      std::copy_n(frame + v * 3, 3, &positions[positionIndex[v] * 3]);
+    gather(positions.data(), _markers, numPositions, &_frames[f * inputs * 3]);
+  }
+  return true;
+}
+
+/// @brief a line of time then inputs xyz values per frame
+bool readCsv(const std::string &_fname, size_t _inputs, std::vector<float> &_times, std::vector<float> &_frames)
+{
+  std::ifstream in(_fname);
+  if (!in.is_open())
+    return false;
+  std::string line;
+  while (std::getline(in, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream tokens(line);
+    float time;
+    if (!(tokens >> time))
+      return false;
+    _times.push_back(time);
+    size_t start = _frames.size();
+    _frames.resize(start + _inputs * 3);
+    for (size_t i = 0; i < _inputs * 3; ++i)
+    {
+      if (!(tokens >> _frames[start + i]))
+        return false;
+    }
+  }
+  return true;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  std::string mode = argc > 1 ? argv[1] : "";
+  std::string inName = argc > 2 ? argv[2] : "";
+  std::string outName;
+  std::string modelName = "models.txt";
+  std::string markerName;
+  WeightSolver::Settings settings;
+  size_t threads = 0;
+  bool argsOk = true;
+  int first = mode == "obj" ? 3 : 4;
+  if (mode != "obj" && argc > 3)
+    outName = argv[3];
+  for (int i = first; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "--models" && i + 1 < argc)
+      modelName = argv[++i];
+    else if (arg == "--markers" && i + 1 < argc)
+      markerName = argv[++i];
+    else if (arg == "--sparsity" && i + 1 < argc)
+      argsOk = parseNumber(argv[++i], settings.sparsity) && argsOk;
+    else if (arg == "--threads" && i + 1 < argc)
+      argsOk = parseNumber(argv[++i], threads) && argsOk;
+  }
+  if (!argsOk || inName.empty() || (mode != "obj" && mode != "cache" && mode != "csv") || (mode != "obj" && outName.empty()))
+  {
+    std::cerr << "usage FacialSolve obj scan.obj [options]\n"
+              << "      FacialSolve cache baked.fpc out.csv [options]\n"
+              << "      FacialSolve csv tracked.csv out.csv [options]\n"
+              << "options --models models.txt --markers markers.txt --sparsity s --threads N\n";
+    return EXIT_FAILURE;
+  }
+  ModelFile models;
+  if (!models.load(modelName))
+  {
+    std::cerr << models.errorString() << '\n';
+    return EXIT_FAILURE;
+  }
+  // the same rig the viewer would use, from the baked cache when it is up to date
+  BlendRig rig(models.deltaEpsilon());
+  RigCache cache;
+  if (cache.open(models.cacheFileName()) && cache.sourceHash() == models.sourceHash())
+  {
+    cache.toRig(rig);
+  }
+  else
+  {
+    RigLoader loader;
+    if (!loader.load(models, rig))
+    {
+      std::cerr << loader.errorString() << '\n';
+      return EXIT_FAILURE;
+    }
+  }
+  std::string error;
+  WeightProgram program;
+  if (!program.compile(models, rig.targetNames(), error))
+  {
+    std::cerr << error << '\n';
+    return EXIT_FAILURE;
+  }
+  std::vector<uint32_t> markers;
+  if (!markerName.empty() && !readMarkers(markerName, markers))
+  {
+    std::cerr << "unable to read markers " << markerName << '\n';
+    return EXIT_FAILURE;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  WeightSolver solver;
+  solver.setSettings(settings);
+  solver.setRig(rig, &program);
+  if (!solver.setMarkers(markers))
+  {
+    std::cerr << markerName << " has a position past the " << rig.numSourcePositions() << " of the base mesh\n";
+    return EXIT_FAILURE;
+  }
+  double setupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  size_t numTargets = rig.numTargets();
+  size_t inputs = solver.numInputs();
+
+  if (mode == "obj")
+  {
+    ObjTargetReader reader;
+    if (!reader.read(inName, rig.numSourcePositions()))
+    {
+      std::cerr << reader.errorString() << '\n';
+      return EXIT_FAILURE;
+    }
+    std::vector<float> positions(inputs * 3);
+    gather(reader.positions().data(), markers, rig.numSourcePositions(), positions.data());
+    std::vector<float> weights(numTargets, 0.0f);
+    start = std::chrono::steady_clock::now();
+    auto result = solver.solve(positions.data(), weights.data());
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (size_t t = 0; t < numTargets; ++t)
+      std::cout << rig.targetNames()[t] << ',' << weights[t] << '\n';
+    std::cerr << "fitted " << inputs << " positions in " << ms << " ms (" << result.iterations
+              << " iterations, normal equations " << setupMs << " ms), rms error " << result.rmsError << '\n';
+    return EXIT_SUCCESS;
+  }
+
+  std::vector<float> times;
+  std::vector<float> frames;
+  if (mode == "cache")
+  {
+    float fps = 30.0f;
+    if (!readPointCache(inName, rig, markers, frames, fps))
+    {
+      std::cerr << inName << " isn't a point cache of this rig\n";
+      return EXIT_FAILURE;
+    }
+    for (size_t f = 0; f < frames.size() / (inputs * 3); ++f)
+      times.push_back(static_cast<float>(f) / fps);
+  }
+  else if (!readCsv(inName, inputs, times, frames))
+  {
+    std::cerr << "unable to read " << inName << ", each line should be a time then " << inputs * 3 << " numbers\n";
+    return EXIT_FAILURE;
+  }
+  size_t numFrames = times.size();
+  std::vector<float> weights(numFrames * numTargets);
+  std::vector<WeightSolver::Result> results(numFrames);
+  WorkStealingPool pool(threads);
+  start = std::chrono::steady_clock::now();
+  solver.solveSequence(frames.data(), numFrames, weights.data(), pool, results.data());
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  std::ofstream out(outName);
+  if (!out.is_open())
+  {
+    std::cerr << "unable to write " << outName << '\n';
+    return EXIT_FAILURE;
+  }
+  double rms = 0.0;
+  float worst = 0.0f;
+  size_t iterations = 0;
+  for (size_t f = 0; f < numFrames; ++f)
+  {
+    out << times[f];
+    for (size_t t = 0; t < numTargets; ++t)
+      out << ',' << weights[f * numTargets + t];
+    out << '\n';
+    rms += results[f].rmsError;
+    worst = std::max(worst, results[f].rmsError);
+    iterations += results[f].iterations;
+  }
+  if (numFrames > 0)
+  {
+    rms /= numFrames;
+    std::cerr << "solved " << numFrames << " frames of " << inputs << " positions in " << ms << " ms on "
+              << pool.size() << " threads (" << ms * 1000.0 / numFrames * pool.size() << " us a frame per thread, "
+              << static_cast<double>(iterations) / numFrames << " iterations, normal equations " << setupMs
+              << " ms), rms error mean " << rms << " worst " << worst << '\n';
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+// FacialStream writes and replays weight stream captures (see WeightStream)
+// usage FacialStream replay capture.fws [socket]   plays the capture at its recorded timing to stdout or a socket
+//       FacialStream clip clip models.txt capture.fws [fps]   bakes an animation clip into a capture
+// a live stream can be recorded with tee, e.g. tracker | tee capture.fws | FacialAnimation --stream -
+#include "AnimationClip.h"
+#include "ClipSampler.h"
+#include "ModelFile.h"
+#include "ParseNumber.h"
+#include "WeightStream.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+int replay(const std::string &_capture, const std::string &_socket)
+{
+  int in = ::open(_capture.c_str(), O_RDONLY);
+  if (in < 0)
+  {
+    std::cerr << "unable to open " << _capture << '\n';
+    return EXIT_FAILURE;
+  }
+  int out = STDOUT_FILENO;
+  if (!_socket.empty())
+  {
+    out = WeightStream::connect(_socket);
+    if (out < 0)
+    {
+      std::cerr << "unable to connect to " << _socket << '\n';
+      ::close(in);
+      return EXIT_FAILURE;
+    }
+  }
+  // a reader going away should end the replay not the process
+  std::signal(SIGPIPE, SIG_IGN);
+
+  WeightStream::PacketHeader header;
+  std::vector<float> weights;
+  size_t count = 0;
+  int64_t firstSend = 0;
+  int64_t start = 0;
+  int64_t maxLate = 0;
+  while (WeightStream::readPacket(in, header, weights))
+  {
+    int64_t now = WeightStream::now();
+    if (count == 0)
+    {
+      firstSend = header.sendTime;
+      start = now;
+    }
+    // keep the gaps between packets the capture had, stamped with our own clock
+    int64_t due = start + (header.sendTime - firstSend);
+    if (due > now)
+      std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+    int64_t sent = WeightStream::now();
+    maxLate = std::max(maxLate, sent - due);
+    if (!WeightStream::writePacket(out, header.sequence, sent, weights.data(), header.numWeights))
+    {
+      std::cerr << "reader closed the stream\n";
+      break;
+    }
+    ++count;
+  }
+  double seconds = count != 0 ? (WeightStream::now() - start) * 1e-9 : 0.0;
+  std::cerr << "replayed " << count << " packets in " << seconds << " s, at most " << maxLate * 1e-6
+            << " ms behind\n";
+  ::close(in);
+  if (out != STDOUT_FILENO)
+    ::close(out);
+  return EXIT_SUCCESS;
+}
+
+int bakeClip(const std::string &_clipName, const std::string &_modelName, const std::string &_capture, float _fps)
+{
+  AnimationClip clip;
+  if (!clip.loadAny(_clipName))
+  {
+    std::cerr << clip.errorString() << '\n';
+    return EXIT_FAILURE;
+  }
+  ModelFile models;
+  if (!models.load(_modelName))
+  {
+    std::cerr << models.errorString() << '\n';
+    return EXIT_FAILURE;
+  }
+  std::vector<std::string> names;
+  for (auto &b : models.blendShapes())
+    names.push_back(b.name);
+  ClipSampler sampler;
+  sampler.bind(clip, names);
+
+  int out = ::open(_capture.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (out < 0)
+  {
+    std::cerr << "unable to write " << _capture << '\n';
+    return EXIT_FAILURE;
+  }
+  std::vector<float> weights(names.size(), 0.0f);
+  size_t numFrames = static_cast<size_t>(sampler.duration() * _fps) + 1;
+  for (size_t f = 0; f < numFrames; ++f)
+  {
+    sampler.sample(static_cast<float>(f) / _fps, weights);
+    int64_t time = static_cast<int64_t>(f * 1e9 / _fps);
+    if (!WeightStream::writePacket(out, f, time, weights.data(), static_cast<uint32_t>(weights.size())))
+    {
+      std::cerr << "unable to write " << _capture << '\n';
+      ::close(out);
+      return EXIT_FAILURE;
+    }
+  }
+  ::close(out);
+  std::cerr << "wrote " << numFrames << " frames of " << names.size() << " weights to " << _capture << '\n';
+  return EXIT_SUCCESS;
+}
+} // end anon namespace
+
+int main(int argc, char **argv)
+{
+  std::string mode = argc > 1 ? argv[1] : "";
+  if (mode == "replay" && argc > 2)
+    return replay(argv[2], argc > 3 ? argv[3] : "");
+  float fps = 120.0f;
+  if (mode == "clip" && argc > 4 && (argc == 5 || (parseNumber(argv[5], fps) && fps > 0.0f)))
+    return bakeClip(argv[2], argv[3], argv[4], fps);
+  std::cerr << "usage FacialStream replay capture.fws [socket]\n"
+            << "      FacialStream clip clip models.txt capture.fws [fps]\n";
+  return EXIT_FAILURE;
+}